@@ -22,6 +22,10 @@ private:
   bool load(const std::string& path);
   void quick_save();
   void quick_load();
+  void toggle_capture();
+  void toggle_vgm_log();
+  void toggle_pacing_clock();
+  void start_loop(OSBridge bridge);
   void show_error(const std::string& title, const std::string& message);
   OSBridge get_os_bridge();
   std::string get_rom_name_without_extension(const std::string& path);
@@ -33,6 +37,8 @@ private:
   std::string boot_rom_path_;     // Path to boot ROM file
   std::optional<ROMLoader> loader_;
   std::optional<MainLoop> loop_;
+  bool capturing_ = false;
+  PacingClock pacing_clock_ = PacingClock::Wall;  // Kept for every ROM loaded
 };
 
 
@@ -2,6 +2,8 @@
 
 #include <inttypes.h>
 #include <functional>
+#include "audio_output_buffer.h"
+#include "pixel_conversion.h"
 
 struct JoypadState;
 
@@ -9,5 +11,9 @@ struct OSBridge {
   std::function<void(const int16_t* samples, int num_samples)> on_audio_generated;
   std::function<void()> present_frame;
   std::function<bool(JoypadState& joypad_state)> handle_events;
-  std::function<void(const uint32_t* pixels, size_t pitch)> blit_screen;
+  std::function<void(const void* pixels, size_t pitch)> blit_screen;
+  std::function<FrameDestination()> acquire_frame;
+  // Optional. Polled once per frame: the APU generates at the returned sample rate, and the buffer's state is
+  // reported with the FPS.
+  std::function<AudioOutputStatus()> audio_output_status;
 };
\ No newline at end of file
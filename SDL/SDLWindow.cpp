@@ -1,7 +1,8 @@
 #include "SDLWindow.h"
 #include <signal.h>
-#include <array>
+#include <algorithm>
 #include <csignal>
+#include "audio_constants.h"
 #include "utils.h"
 
 void signal_handler(int signal) {
@@ -13,7 +14,6 @@ SDLWindow::SDLWindow(const std::string& title, int width, int height)
       renderer_(nullptr),
       texture_(nullptr),
       audio_device_(0),
-      audio_stream_(nullptr),
       base_width_(width),
       base_height_(height) {
   if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO | SDL_INIT_GAMECONTROLLER | SDL_INIT_JOYSTICK) < 0) {
@@ -60,9 +60,7 @@ SDLWindow::SDLWindow(const std::string& title, int width, int height)
   SDL_RenderSetLogicalSize(renderer_, width, height);
   SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "0");
 
-  texture_ =
-      SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
-  if (!texture_) {
+  if (!create_texture()) {
     SDL_DestroyRenderer(renderer_);
     SDL_DestroyWindow(window_);
     SDL_Quit();
@@ -70,26 +68,24 @@ SDLWindow::SDLWindow(const std::string& title, int width, int height)
     return;
   }
 
-  // Set up audio specification for queue-based audio
+  // The device pulls samples from audio_buffer_ on its own thread. It runs at whatever rate it likes, and
+  // the APU generates samples at that rate, so SDL never has to resample.
   SDL_AudioSpec desired_spec;
   SDL_zero(desired_spec);
-  desired_spec.freq = 48000;
+  desired_spec.freq = AUDIO_SAMPLE_RATE;
   desired_spec.format = AUDIO_S16SYS;  // 16-bit signed integer audio
   desired_spec.channels = 2;           // Stereo
   desired_spec.samples = 512;          // Buffer size in samples
+  desired_spec.callback = audio_callback;
+  desired_spec.userdata = this;
 
-  audio_device_ = SDL_OpenAudioDevice(nullptr, 0, &desired_spec, nullptr, 0);
+  audio_device_ =
+      SDL_OpenAudioDevice(nullptr, 0, &desired_spec, &audio_spec_, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
   if (audio_device_ == 0) {
     std::string error_msg = std::string("Failed to open audio device: ") + SDL_GetError();
     FATAL(error_msg.c_str());
   }
-
-  audio_stream_ = SDL_NewAudioStream(AUDIO_S16SYS, 2, 48000, desired_spec.format, desired_spec.channels,
-                                     desired_spec.freq);
-  if (!audio_stream_) {
-    std::string error_msg = std::string("Failed to create audio stream: ") + SDL_GetError();
-    FATAL(error_msg.c_str());
-  }
+  audio_buffer_ = std::make_unique<AudioOutputBuffer>(audio_spec_.freq);
 
   // Try to open the first available game controller
   const int num_joysticks = SDL_NumJoysticks();
@@ -113,12 +109,11 @@ SDLWindow::~SDLWindow() {
     controller_lx_ = 0;
     controller_ly_ = 0;
   }
-  if (audio_stream_) {
-    SDL_FreeAudioStream(audio_stream_);
-  }
   if (audio_device_ != 0) {
     SDL_CloseAudioDevice(audio_device_);
   }
+  if (locked_pixels_)
+    SDL_UnlockTexture(texture_);
   if (texture_)
     SDL_DestroyTexture(texture_);
   if (renderer_)
@@ -137,8 +132,50 @@ void SDLWindow::present() {
   SDL_RenderPresent(renderer_);
 }
 
-void SDLWindow::blit_screen(const uint32_t* pixels, size_t pitch) {
-  SDL_UpdateTexture(texture_, nullptr, pixels, static_cast<int>(pitch));
+void* SDLWindow::lock_screen(size_t& pitch) {
+  if (texture_scale_ > 1) {
+    return nullptr;
+  }
+
+  if (locked_pixels_) {
+    SDL_UnlockTexture(texture_);
+    locked_pixels_ = nullptr;
+  }
+
+  int locked_pitch = 0;
+  if (SDL_LockTexture(texture_, nullptr, &locked_pixels_, &locked_pitch) != 0) {
+    locked_pixels_ = nullptr;
+    return nullptr;
+  }
+  pitch = static_cast<size_t>(locked_pitch);
+  return locked_pixels_;
+}
+
+void SDLWindow::blit_screen(const void* pixels, size_t pitch) {
+  if (texture_scale_ > 1) {
+    void* texture_pixels = nullptr;
+    int texture_pitch = 0;
+    if (SDL_LockTexture(texture_, nullptr, &texture_pixels, &texture_pitch) != 0) {
+      return;
+    }
+    const bool settled =
+        scaler_.scale(*scale_filter_, texture_scale_, static_cast<const uint32_t*>(pixels), pitch, base_width_,
+                      base_height_, texture_pixels, static_cast<size_t>(texture_pitch));
+    SDL_UnlockTexture(texture_);
+    // The LCD ghosting is still fading, so the next frame is needed even if the emulator's output is the same
+    if (!settled && on_redraw_needed_) {
+      on_redraw_needed_();
+    }
+  } else if (locked_pixels_) {
+    SDL_UnlockTexture(texture_);
+    const bool written_in_place = pixels == locked_pixels_;
+    locked_pixels_ = nullptr;
+    if (!written_in_place) {
+      SDL_UpdateTexture(texture_, nullptr, pixels, static_cast<int>(pitch));
+    }
+  } else {
+    SDL_UpdateTexture(texture_, nullptr, pixels, static_cast<int>(pitch));
+  }
   SDL_RenderCopy(renderer_, texture_, nullptr, nullptr);
 }
 
@@ -185,12 +222,33 @@ bool SDLWindow::handleEvents(JoypadState& joypad_state) {
               on_quick_save_();
             }
             break;
+          case SDLK_F7:
+            // Pace frames by the wall clock or the audio device's clock
+            if (on_toggle_pacing_clock_) {
+              on_toggle_pacing_clock_();
+            }
+            break;
           case SDLK_F8:
             // Trigger Quick Load
             if (on_quick_load_) {
               on_quick_load_();
             }
             break;
+          case SDLK_F9:
+            cycle_scale_filter();
+            break;
+          case SDLK_F10:
+            // Start or stop recording
+            if (on_toggle_capture_) {
+              on_toggle_capture_();
+            }
+            break;
+          case SDLK_F11:
+            // Start or stop logging the music
+            if (on_toggle_vgm_log_) {
+              on_toggle_vgm_log_();
+            }
+            break;
           default:
             // Handle gamepad keys
             switch (event.key.keysym.sym) {
@@ -251,6 +309,11 @@ bool SDLWindow::handleEvents(JoypadState& joypad_state) {
           keyboard_state_.right_pressed = false;
           break;
       }
+    } else if (event.type == SDL_WINDOWEVENT) {
+      if ((event.window.event == SDL_WINDOWEVENT_EXPOSED || event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) &&
+          on_redraw_needed_) {
+        on_redraw_needed_();
+      }
     } else if (event.type == SDL_CONTROLLERDEVICEADDED) {
       if (!controller_ && SDL_IsGameController(event.cdevice.which)) {
         controller_ = SDL_GameControllerOpen(event.cdevice.which);
@@ -375,43 +438,24 @@ void SDLWindow::stop_audio() {
 
 // Queue audio samples to be played
 void SDLWindow::queue_audio(const int16_t* samples, int num_samples) {
-
-  if (!audio_stream_ || audio_device_ == 0) {
-    return;
+  if (audio_buffer_) {
+    audio_buffer_->push(samples, static_cast<size_t>(num_samples));
   }
+}
 
-  last_audio_samples_.assign(samples, samples + num_samples);
-  Uint32 queued_bytes = SDL_GetQueuedAudioSize(audio_device_);
-  int queued_samples = queued_bytes / sizeof(int16_t);
-
-  const int MIN = 960;   // 10ms at 48kHz stereo - increased to prevent underruns
-  const int MAX = 4800;  // 50ms at 48kHz stereo
-
-  if (queued_samples > (MAX * 2)) {
-  } else if (queued_samples < (MIN / 2)) {
-    SDL_AudioStreamPut(audio_stream_, samples, num_samples * sizeof(int16_t));
-    const uint32_t extra_samples = std::min(num_samples, 64);
-    SDL_AudioStreamPut(audio_stream_, samples + num_samples - extra_samples, extra_samples * sizeof(int16_t));
-  } else {
-    SDL_AudioStreamPut(audio_stream_, samples, num_samples * sizeof(int16_t));
-  }
+int SDLWindow::get_queued_audio_samples() const {
+  return audio_buffer_ ? static_cast<int>(audio_buffer_->size()) : 0;
+}
 
-  int available = SDL_AudioStreamAvailable(audio_stream_);
-  if (available > 0 && queued_samples < MAX) {
-    std::array<uint8_t, 20480> buffer;
-    int received = SDL_AudioStreamGet(audio_stream_, buffer.data(), buffer.size());
-    if (received > 0) {
-      SDL_QueueAudio(audio_device_, buffer.data(), received);
-    }
-  }
+AudioOutputStatus SDLWindow::audio_output_status() {
+  return audio_buffer_->update();
 }
 
-int SDLWindow::get_queued_audio_samples() const {
-  if (audio_device_ == 0) {
-    return 0;
-  }
-  Uint32 queued_bytes = SDL_GetQueuedAudioSize(audio_device_);
-  return queued_bytes / sizeof(int16_t);
+// Runs on SDL's audio thread
+void SDLWindow::audio_callback(void* userdata, Uint8* stream, int length) {
+  auto* window = static_cast<SDLWindow*>(userdata);
+  const size_t samples = static_cast<size_t>(length) / sizeof(int16_t);
+  window->audio_buffer_->pull(reinterpret_cast<int16_t*>(stream), samples);
 }
 
 void SDLWindow::apply_scale_factor(uint32_t factor) {
@@ -425,37 +469,65 @@ void SDLWindow::apply_scale_factor(uint32_t factor) {
   int scaled_height = base_height_ * static_cast<int>(scale_factor_);
 
   SDL_SetWindowSize(window_, scaled_width, scaled_height);
+  create_texture();
 }
 
-void SDLWindow::prepare_for_pause() {
-  if (audio_device_ == 0)
-    return;
+void SDLWindow::set_scale_filter(std::optional<ScaleFilter> filter) {
+  scale_filter_ = filter;
+  scaler_.reset_ghosting();
+  create_texture();
+}
 
-  // We can't read the queue, but we have the last samples we queued
-  // Apply a fade-out to those samples and re-queue them
+// F9: SDL scaling -> Nearest -> Scale2x -> LCD grid -> SDL scaling
+void SDLWindow::cycle_scale_filter() {
+  if (!scale_filter_) {
+    set_scale_filter(ScaleFilter::Nearest);
+  } else if (*scale_filter_ == ScaleFilter::Nearest) {
+    set_scale_filter(ScaleFilter::Scale2x);
+  } else if (*scale_filter_ == ScaleFilter::Scale2x) {
+    set_scale_filter(ScaleFilter::LCDGrid);
+  } else {
+    set_scale_filter(std::nullopt);
+  }
+}
 
-  if (!last_audio_samples_.empty()) {
-    // Create a fade-out version of the last audio samples
-    std::vector<int16_t> faded_samples = last_audio_samples_;
-    int num_samples = faded_samples.size();
+// Only called between frames, so the PPU never holds a pointer into a locked texture that is destroyed here
+bool SDLWindow::create_texture() {
+  texture_scale_ = 1;
+  if (scale_filter_ && scale_factor_ >= MIN_SCALE_FACTOR) {
+    texture_scale_ = std::min(scale_factor_, MAX_SCALE_FACTOR);
+  }
 
-    for (int i = 0; i < num_samples; i++) {
-      float fade_multiplier = 1.0f - (static_cast<float>(i) / num_samples);
-      faded_samples[i] = static_cast<int16_t>(faded_samples[i] * fade_multiplier);
+  if (texture_) {
+    if (locked_pixels_) {
+      SDL_UnlockTexture(texture_);
+      locked_pixels_ = nullptr;
     }
+    SDL_DestroyTexture(texture_);
+  }
 
-    // Clear the queue and re-queue with fade
-    SDL_ClearQueuedAudio(audio_device_);
-    SDL_QueueAudio(audio_device_, faded_samples.data(), num_samples * sizeof(int16_t));
-
-    // Wait for the faded audio to play
-    int wait_ms = (num_samples / 2 / 48) + 5;  // stereo samples to ms + margin
-    SDL_Delay(wait_ms);
+  texture_ = SDL_CreateTexture(renderer_, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                               base_width_ * static_cast<int>(texture_scale_),
+                               base_height_ * static_cast<int>(texture_scale_));
+  if (on_redraw_needed_) {
+    on_redraw_needed_();
   }
+  return texture_ != nullptr;
+}
+
+void SDLWindow::prepare_for_pause() {
+  if (audio_device_ == 0)
+    return;
 
-  // Now pause cleanly at near-zero amplitude
-  SDL_ClearQueuedAudio(audio_device_);
+  // Let the callback fade out from the last sample it played, then pause at zero amplitude
+  audio_buffer_->fade_out();
+  const int callback_ms = static_cast<int>(audio_spec_.samples * 1000 / audio_spec_.freq);
+  SDL_Delay(callback_ms * 2 + 5);
   SDL_PauseAudioDevice(audio_device_, 1);
+
+  SDL_LockAudioDevice(audio_device_);
+  audio_buffer_->clear();
+  SDL_UnlockAudioDevice(audio_device_);
 }
 
 void SDLWindow::resume_from_pause() {
@@ -4,8 +4,12 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <string>
+#include "audio_output_buffer.h"
 #include "joypad_state.h"
+#include "scaler.h"
 
 class SDLWindow {
 public:
@@ -15,7 +19,10 @@ public:
   void clear();
   void present();
 
-  void blit_screen(const uint32_t* pixels, size_t pitch);
+  // Locks the screen texture so the next frame can be written straight into it. blit_screen unlocks it.
+  // Returns nullptr while a scale filter is in use, as blit_screen then scales the frame into the texture.
+  void* lock_screen(size_t& pitch);
+  void blit_screen(const void* pixels, size_t pitch);
   // Handle events and return true if window should close
   bool handleEvents(JoypadState& joypad_state);
 
@@ -23,18 +30,28 @@ public:
   void start_audio();
   void stop_audio();
 
-  // Queue audio samples (stereo int16 format)
+  // Queue audio samples (stereo int16 format). Never blocks; samples that don't fit are dropped.
   void queue_audio(const int16_t* samples, int num_samples);
 
   // Get current queued audio sample count
   int get_queued_audio_samples() const;
 
+  // Call once per frame from the emulation thread. Returns the rate the APU should generate at to keep the
+  // audio buffer half full, along with the buffer's fill level and error counts.
+  AudioOutputStatus audio_output_status();
+
   // Callbacks for keyboard shortcuts
   void set_on_quick_save(std::function<void()> cb) { on_quick_save_ = std::move(cb); }
   void set_on_quick_load(std::function<void()> cb) { on_quick_load_ = std::move(cb); }
   void set_on_open_rom(std::function<void()> cb) { on_open_rom_ = std::move(cb); }
   void set_on_save(std::function<void()> cb) { on_save_ = std::move(cb); }
   void set_on_exit(std::function<void()> cb) { on_exit_ = std::move(cb); }
+  void set_on_toggle_capture(std::function<void()> cb) { on_toggle_capture_ = std::move(cb); }
+  void set_on_toggle_vgm_log(std::function<void()> cb) { on_toggle_vgm_log_ = std::move(cb); }
+  void set_on_toggle_pacing_clock(std::function<void()> cb) { on_toggle_pacing_clock_ = std::move(cb); }
+
+  // Called when the window has to be redrawn, so a frame is presented even if it's a duplicate
+  void set_on_redraw_needed(std::function<void()> cb) { on_redraw_needed_ = std::move(cb); }
 
   // Audio pause/resume methods (for blocking operations like file dialogs)
   void prepare_for_pause();  // Call before blocking operations
@@ -42,19 +59,35 @@ public:
 
   // Scale factor management
   void apply_scale_factor(uint32_t factor);
+
+  // Built-in upscaling into the screen texture. std::nullopt leaves scaling to SDL_RenderCopy. Defaults to
+  // ScaleFilter::Nearest. Scale factors above MAX_SCALE_FACTOR are scaled the rest of the way by SDL.
+  void set_scale_filter(std::optional<ScaleFilter> filter);
+  std::optional<ScaleFilter> scale_filter() const { return scale_filter_; }
   uint32_t get_max_scale_factor() const { return max_scale_factor_; }
 
   // Get the underlying SDL_Window pointer (for platform-specific extensions)
   SDL_Window* get_sdl_window() { return window_; }
 
 private:
+  static void audio_callback(void* userdata, Uint8* stream, int length);
+  bool create_texture();
+  void cycle_scale_filter();
+
   SDL_Window* window_;
   SDL_Renderer* renderer_;
   SDL_Texture* texture_ = nullptr;
+  void* locked_pixels_ = nullptr;
+
+  // Built-in upscaling
+  Scaler scaler_;
+  std::optional<ScaleFilter> scale_filter_ = ScaleFilter::Nearest;
+  uint32_t texture_scale_ = 1;  // The texture is this many times the Game Boy's resolution
 
   // Audio members
   SDL_AudioDeviceID audio_device_;
-  SDL_AudioStream* audio_stream_;
+  SDL_AudioSpec audio_spec_;  // What the device was opened with
+  std::unique_ptr<AudioOutputBuffer> audio_buffer_;
 
   // Controller members
   SDL_GameController* controller_ = nullptr;
@@ -77,6 +110,8 @@ private:
   std::function<void()> on_open_rom_;
   std::function<void()> on_save_;
   std::function<void()> on_exit_;
-
-  std::vector<int16_t> last_audio_samples_;
+  std::function<void()> on_toggle_capture_;
+  std::function<void()> on_toggle_vgm_log_;
+  std::function<void()> on_toggle_pacing_clock_;
+  std::function<void()> on_redraw_needed_;
 };
\ No newline at end of file
@@ -1,17 +1,36 @@
 #include "apu.h"
+#include <algorithm>
 #include <cstdint>
+#include <stdexcept>
+#include <string>
 #include "audio_constants.h"
+#include "audio_event_sink.h"
 #include "save_state.h"
 
 // Sample conversion constant
 constexpr float SAMPLE_RANGE_MAX = 32767.0f;
 
+// Stereo samples per callback
+constexpr uint32_t SAMPLE_BUFFER_FRAMES = SAMPLE_BUFFER_SIZE / 2;
+
 APU::APU(std::function<void(const int16_t* samples, int num_samples)> sample_generated_callback)
     : mixer_(frame_sequencer_, audio_registers_) {
   on_samples_generated_ = sample_generated_callback;
+  // Until they're written, the registers are logged as they read after the boot ROM
+  std::copy_n(audio_registers_.registers_, written_registers_.size(), written_registers_.begin());
+  blip_frame_end_ = blip_buffer_.clocks_needed(SAMPLE_BUFFER_FRAMES);
 }
 
 void APU::audio_register_write(uint16_t address, uint8_t value) {
+  catch_up();
+  for (AudioEventSink* sink : event_sinks_) {
+    sink->write(apu_clock_, address, value);
+  }
+  apply_register_write(address, value);
+}
+
+// A write from the CPU or the APU itself, after catching up
+void APU::apply_register_write(uint16_t address, uint8_t value) {
   if (address == NR26_ADDR) {
     audio_registers_.write_register(address, value);
     const bool previous_master_enabled = master_enabled_;
@@ -27,6 +46,7 @@ void APU::audio_register_write(uint16_t address, uint8_t value) {
     }
 
     master_enabled_ = new_master_enabled;
+    update_output(blip_clock_);
     return;
   }
 
@@ -38,6 +58,9 @@ void APU::audio_register_write(uint16_t address, uint8_t value) {
         audio_registers_.set_WAVE_RAM(mixer_.channel3().ram_position() >> 1, value);
       }
     } else {
+      if (address <= AUDIO_REG_END) {
+        written_registers_[address - AUDIO_REG_START] = value;
+      }
       audio_registers_.write_register(address, value);
       mixer_.audio_register_write(address, value);
     }
@@ -45,13 +68,16 @@ void APU::audio_register_write(uint16_t address, uint8_t value) {
     //We're only allowed to write length counter bits, not duty, when powered off.
     if (address == NR11_ADDR || address == NR16_ADDR)
       value &= LENGTH_COUNTER_MASK;
+    written_registers_[address - AUDIO_REG_START] = value;
     audio_registers_.write_register(address, value);
     mixer_.audio_register_write(address, value);
   }
+  update_output(blip_clock_);
 }
 
-const unsigned char* APU::audio_register_read(uint16_t address) const {
+const unsigned char* APU::audio_register_read(uint16_t address) {
   static uint8_t garbage = 0xFF;
+  catch_up();
 
   //If wave ram is enabled, we can only write to the last slot read if wave ram was accessed on exactly this clock.
   //This is mostly just to pass a test ROM, but it's a good idea to do it anyway.
@@ -66,28 +92,312 @@ const unsigned char* APU::audio_register_read(uint16_t address) const {
   return &audio_registers_.read_register(address);
 }
 
+void APU::add_event_sink(AudioEventSink* sink) {
+  if (std::find(event_sinks_.begin(), event_sinks_.end(), sink) == event_sinks_.end()) {
+    event_sinks_.push_back(sink);
+  }
+}
+
+void APU::remove_event_sink(AudioEventSink* sink) {
+  event_sinks_.erase(std::remove(event_sinks_.begin(), event_sinks_.end(), sink), event_sinks_.end());
+}
+
+void APU::log_register_state(AudioEventSink& sink) {
+  write_register_state([this, &sink](uint16_t address, uint8_t value) {
+    sink.write(apu_clock_, address, value);
+  });
+}
+
+void APU::write_register_state(const std::function<void(uint16_t address, uint8_t value)>& write) {
+  catch_up();
+
+  // Power cycling leaves every channel off, so wave RAM can be written and nothing plays until triggered
+  write(NR26_ADDR, 0);
+  if (!master_enabled_) {
+    return;
+  }
+  write(NR26_ADDR, MASTER_ENABLE_BIT);
+  for (uint8_t i = 0; i < WAVE_RAM_SIZE; i++) {
+    write(WAVE_RAM_START + i, audio_registers_.get_WAVE_RAM(i));
+  }
+  for (uint16_t address = AUDIO_REG_START; address < NR26_ADDR; address++) {
+    uint8_t value = written_registers_[address - AUDIO_REG_START];
+    if (address == NR14_ADDR || address == NR19_ADDR || address == NR1E_ADDR || address == NR23_ADDR) {
+      value &= ~TRIGGER_BIT;
+    }
+    write(address, value);
+  }
+}
+
 void APU::tick_frame_sequencer() {
-  frame_sequencer_.tick();
+  catch_up();
+  for (AudioEventSink* sink : event_sinks_) {
+    sink->frame_sequencer(apu_clock_);
+  }
+  mixer_.tick_frame_sequencer();
+  update_output(blip_clock_);
 }
 
 void APU::tick() {
+  if (synthesis_ == AudioSynthesis::None) {
+    // Nothing reads the mix, so the channels only need to be right when the registers are looked at
+    if (event_driven_) {
+      pending_cycles_++;
+    } else {
+      apu_clock_++;
+      mixer_.tick(apu_clock_);
+    }
+    return;
+  }
+
+  if (synthesis_ == AudioSynthesis::BandLimited) {
+    if (event_driven_) {
+      pending_cycles_++;
+      if (++blip_clock_ == blip_frame_end_) {
+        catch_up();
+        read_band_limited_samples();
+      }
+      return;
+    }
+
+    apu_clock_++;
+    if (mixer_.tick(apu_clock_)) {
+      update_output(blip_clock_);
+    }
+    if (++blip_clock_ == blip_frame_end_) {
+      read_band_limited_samples();
+    }
+    return;
+  }
+
   apu_clock_++;
   mixer_.tick(apu_clock_);
 
   sample_counter_ -= 1.0f;
   if (sample_counter_ <= 0.0f) {
 
-    sample_counter_ += M_CYCLES_PER_SAMPLE;
+    sample_counter_ += m_cycles_per_sample_;
     add_samples_to_buffer();
   }
 }
 
-void APU::add_samples_to_buffer() {
-  auto [left, right] = mixer_.output();
+void APU::run(uint32_t m_cycles) {
+  if (synthesis_ == AudioSynthesis::BandLimited && event_driven_) {
+    while (m_cycles > 0) {
+      const uint32_t cycles = std::min(m_cycles, blip_frame_end_ - blip_clock_);
+      pending_cycles_ += cycles;
+      blip_clock_ += cycles;
+      m_cycles -= cycles;
+      if (blip_clock_ == blip_frame_end_) {
+        catch_up();
+        read_band_limited_samples();
+      }
+    }
+    return;
+  }
+  if (synthesis_ == AudioSynthesis::None && event_driven_) {
+    pending_cycles_ += m_cycles;
+    return;
+  }
+  for (; m_cycles > 0; m_cycles--) {
+    tick();
+  }
+}
+
+void APU::set_synthesis(AudioSynthesis synthesis) {
+  if (synthesis == synthesis_) {
+    return;
+  }
+  catch_up();
+  generate_samples();
+
+  synthesis_ = synthesis;
+  blip_buffer_.clear();
+  restart_band_limited();
+}
+
+void APU::set_channel_mute_mask(uint8_t mute_mask) {
+  catch_up();
+  mixer_.set_mute_mask(mute_mask);
+  update_output(blip_clock_);
+}
+
+void APU::set_stem_callback(StemCallback callback) {
+  catch_up();
+  generate_samples();
+
+  on_stems_generated_ = std::move(callback);
+  stem_blip_buffers_.clear();
+  if (on_stems_generated_) {
+    for (uint32_t i = 0; i < AUDIO_STEM_CHANNELS / 2; i++) {
+      stem_blip_buffers_.emplace_back(M_CYCLES_PER_SECOND, blip_buffer_.sample_rate(),
+                                      blip_buffer_.quality());
+    }
+  }
+  blip_buffer_.clear();
+  restart_band_limited();
+}
+
+void APU::set_sample_rate(double sample_rate) {
+  if (!(sample_rate >= MIN_AUDIO_SAMPLE_RATE && sample_rate <= MAX_AUDIO_SAMPLE_RATE)) {
+    throw std::invalid_argument("Audio sample rate out of range: " + std::to_string(sample_rate));
+  }
+  catch_up();
+
+  // The blip buffer's rate can only change between frames, so end this one where it is
+  if (synthesis_ == AudioSynthesis::BandLimited && blip_clock_ > 0) {
+    read_band_limited_samples();
+  }
+  blip_buffer_.set_sample_rate(sample_rate);
+  for (BlipBuffer& stems : stem_blip_buffers_) {
+    stems.set_sample_rate(sample_rate);
+  }
+  blip_frame_end_ = blip_buffer_.clocks_needed(SAMPLE_BUFFER_FRAMES);
+  m_cycles_per_sample_ = static_cast<float>(M_CYCLES_PER_SECOND / sample_rate);
+}
+
+void APU::set_resampler_quality(ResamplerQuality quality) {
+  if (quality == blip_buffer_.quality()) {
+    return;
+  }
+  catch_up();
+  generate_samples();
+
+  blip_buffer_.set_quality(quality);
+  restart_band_limited();
+}
+
+// Starts a new blip buffer frame from an empty buffer, with the current mix as the first step
+void APU::restart_band_limited() {
+  blip_clock_ = 0;
+  blip_frame_end_ = blip_buffer_.clocks_needed(SAMPLE_BUFFER_FRAMES);
+  left_level_ = 0;
+  right_level_ = 0;
+  for (BlipBuffer& stems : stem_blip_buffers_) {
+    if (stems.quality() != blip_buffer_.quality()) {
+      stems.set_quality(blip_buffer_.quality());
+    }
+    stems.clear();
+  }
+  stem_levels_ = {};
+  update_output(blip_clock_);
+}
+
+void APU::set_mixing(AudioMixing mixing) {
+  catch_up();
+  mixing_ = mixing;
+  update_output(blip_clock_);
+}
+
+void APU::set_event_driven(bool event_driven) {
+  catch_up();
+  event_driven_ = event_driven;
+}
+
+// Runs the channels through the ticks they've missed. Between the ticks where a channel steps nothing can
+// change the mix, so the channels are advanced from one step to the next and the mix is only checked there.
+void APU::catch_up() {
+  while (pending_cycles_ > 0) {
+    const uint32_t cycles = std::min(pending_cycles_, mixer_.ticks_until_change());
+    apu_clock_ += cycles;
+    pending_cycles_ -= cycles;
+    if (mixer_.advance(cycles, apu_clock_)) {
+      update_output(blip_clock_ - pending_cycles_ - 1);
+    }
+  }
+}
+
+// The current mix as int16_t levels
+std::pair<int32_t, int32_t> APU::mixed_levels() const {
+  if (mixing_ == AudioMixing::FixedPoint) {
+    return mixer_.fixed_output();
+  }
 
   // Convert float samples (range -1.0 to 1.0) to int16_t (range -32768 to 32767)
-  samples_buffer_.push_back(static_cast<int16_t>(left * SAMPLE_RANGE_MAX));
-  samples_buffer_.push_back(static_cast<int16_t>(right * SAMPLE_RANGE_MAX));
+  const auto [left, right] = mixer_.output();
+  return {static_cast<int32_t>(left * SAMPLE_RANGE_MAX), static_cast<int32_t>(right * SAMPLE_RANGE_MAX)};
+}
+
+// Adds a step at `blip_time` to the blip buffer if the mix changed since the last one
+void APU::update_output(uint32_t blip_time) {
+  if (synthesis_ != AudioSynthesis::BandLimited) {
+    return;
+  }
+
+  const auto [left_level, right_level] = mixed_levels();
+  if (left_level != left_level_ || right_level != right_level_) {
+    blip_buffer_.add_delta(blip_time, left_level - left_level_, right_level - right_level_);
+    left_level_ = left_level;
+    right_level_ = right_level;
+  }
+  if (!stem_blip_buffers_.empty()) {
+    update_stems(blip_time);
+  }
+}
+
+// update_output() for the stems, which can change without the mix changing, e.g. when a channel is panned off
+void APU::update_stems(uint32_t blip_time) {
+  const std::array<int32_t, AUDIO_STEM_CHANNELS> levels = mixer_.stem_levels();
+  for (uint32_t i = 0; i < stem_blip_buffers_.size(); i++) {
+    const int32_t left = levels[i * 2] - stem_levels_[i * 2];
+    const int32_t right = levels[i * 2 + 1] - stem_levels_[i * 2 + 1];
+    if (left != 0 || right != 0) {
+      stem_blip_buffers_[i].add_delta(blip_time, left, right);
+    }
+  }
+  stem_levels_ = levels;
+}
+
+// Ends the blip buffer's frame and passes on what it has, SAMPLE_BUFFER_SIZE at a time
+void APU::read_band_limited_samples() {
+  blip_buffer_.end_frame(blip_clock_);
+  for (BlipBuffer& stems : stem_blip_buffers_) {
+    stems.end_frame(blip_clock_);
+  }
+  blip_clock_ = 0;
+
+  uint32_t available = blip_buffer_.samples_available();
+  while (available > 0) {
+    const uint32_t space = SAMPLE_BUFFER_FRAMES - static_cast<uint32_t>(samples_buffer_.size() / 2);
+    const uint32_t frames = std::min(available, space);
+    const size_t start = samples_buffer_.size();
+    samples_buffer_.resize(start + frames * 2);
+    blip_buffer_.read_samples(&samples_buffer_[start], frames);
+    if (!stem_blip_buffers_.empty()) {
+      read_band_limited_stems(frames);
+    }
+    available -= frames;
+
+    if (samples_buffer_.size() == SAMPLE_BUFFER_SIZE) {
+      generate_samples();
+    }
+  }
+  blip_frame_end_ = blip_buffer_.clocks_needed(SAMPLE_BUFFER_FRAMES);
+}
+
+// The stem blip buffers always have as many samples as blip_buffer_, as they're ended at the same times
+void APU::read_band_limited_stems(uint32_t frames) {
+  std::array<int16_t, SAMPLE_BUFFER_SIZE> pair;
+  const size_t start = stems_buffer_.size();
+  stems_buffer_.resize(start + frames * AUDIO_STEM_CHANNELS);
+  for (uint32_t i = 0; i < stem_blip_buffers_.size(); i++) {
+    stem_blip_buffers_[i].read_samples(pair.data(), frames);
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      stems_buffer_[start + frame * AUDIO_STEM_CHANNELS + i * 2] = pair[frame * 2];
+      stems_buffer_[start + frame * AUDIO_STEM_CHANNELS + i * 2 + 1] = pair[frame * 2 + 1];
+    }
+  }
+}
+
+void APU::add_samples_to_buffer() {
+  const auto [left, right] = mixed_levels();
+  samples_buffer_.push_back(static_cast<int16_t>(left));
+  samples_buffer_.push_back(static_cast<int16_t>(right));
+  if (on_stems_generated_) {
+    for (int32_t level : mixer_.stem_levels()) {
+      stems_buffer_.push_back(static_cast<int16_t>(level));
+    }
+  }
 
   if (samples_buffer_.size() == SAMPLE_BUFFER_SIZE) {
     generate_samples();
@@ -95,8 +405,28 @@ void APU::add_samples_to_buffer() {
 }
 
 void APU::generate_samples() {
+  if (synthesis_ == AudioSynthesis::None) {
+    if (!event_sinks_.empty()) {
+      catch_up();
+      for (AudioEventSink* sink : event_sinks_) {
+        sink->end_frame(apu_clock_, nullptr, 0);
+      }
+    }
+    return;
+  }
+  catch_up();
+  if (synthesis_ == AudioSynthesis::BandLimited && blip_clock_ > 0) {
+    read_band_limited_samples();
+  }
+  for (AudioEventSink* sink : event_sinks_) {
+    sink->end_frame(apu_clock_, samples_buffer_.data(), samples_buffer_.size());
+  }
   on_samples_generated_(samples_buffer_.data(), samples_buffer_.size());
   samples_buffer_.clear();
+  if (on_stems_generated_) {
+    on_stems_generated_(stems_buffer_.data(), static_cast<int>(stems_buffer_.size() / AUDIO_STEM_CHANNELS));
+    stems_buffer_.clear();
+  }
 }
 
 void APU::reset_registers() {
@@ -106,16 +436,16 @@ void APU::reset_registers() {
   uint8_t channel3_length = audio_registers_.get_NR31() & WAVE_LENGTH_MASK;
   uint8_t channel4_length = audio_registers_.get_NR41() & LENGTH_COUNTER_MASK;
 
-  // Reset all registers to 0 using audio_register_write
+  // Reset all registers to 0 using apply_register_write
   for (uint16_t i = AUDIO_REG_START; i < AUDIO_REG_END; i++) {
-    audio_register_write(i, 0);
+    apply_register_write(i, 0);
   }
 
   // Restore the length counter bits
-  audio_register_write(NR11_ADDR, channel1_length);
-  audio_register_write(NR16_ADDR, channel2_length);
-  audio_register_write(NR1B_ADDR, channel3_length);
-  audio_register_write(NR20_ADDR, channel4_length);
+  apply_register_write(NR11_ADDR, channel1_length);
+  apply_register_write(NR16_ADDR, channel2_length);
+  apply_register_write(NR1B_ADDR, channel3_length);
+  apply_register_write(NR20_ADDR, channel4_length);
 
   // Reset NR52 to 0
   audio_registers_.set_NR52_internal(0);
@@ -126,13 +456,32 @@ bool APU::is_length_register(uint16_t address) {
 }
 
 void APU::serialize(SaveStateSerializer& serializer) const {
+  serialize(serializer, synthesis_);
+}
+
+void APU::serialize(SaveStateSerializer& serializer, AudioSynthesis saved_synthesis) const {
   serializer << audio_registers_;
   serializer << master_enabled_;
+  serializer << saved_synthesis;
 }
 
 void APU::deserialize(SaveStateSerializer& serializer) {
+  AudioSynthesis synthesis = synthesis_;
+  deserialize(serializer, synthesis);
+  set_synthesis(synthesis);
+}
+
+void APU::deserialize(SaveStateSerializer& serializer, AudioSynthesis& saved_synthesis) {
   serializer >> audio_registers_;
   serializer >> master_enabled_;
+  // Version 1 states were saved before the mode was, and get the default
+  saved_synthesis = AudioSynthesis::BandLimited;
+  if (serializer.version() >= 2) {
+    serializer >> saved_synthesis;
+    if (saved_synthesis > AudioSynthesis::None) {
+      throw std::runtime_error("Unknown audio synthesis mode in save state");
+    }
+  }
 
   audio_register_write(NR26_ADDR, audio_registers_.read_register(NR26_ADDR));
   for (uint16_t i = AUDIO_REG_START; i < AUDIO_REG_END; i++) {
@@ -1,21 +1,43 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
 #include "audio_constants.h"
 #include "audio_registers.h"
+#include "blip_buffer.h"
 #include "frame_sequencer.h"
 #include "mixer.h"
 #include "stack_vector.h"
 
+class AudioEventSink;
 class SaveStateSerializer;
 
+enum class AudioSynthesis {
+  PointSampled,  // The mix is sampled once per output sample
+  BandLimited,   // Level changes are band-limited steps, see blip_buffer.h
+  None           // No output: registers behave exactly as usual, but nothing is mixed, resampled or passed on
+};
+
+enum class AudioMixing {
+  Float,      // Channels are mixed in float and scaled to int16_t
+  FixedPoint  // Integer levels, volumes and sums, identical on every compiler and platform
+};
+
 class APU {
 public:
+  using StemCallback = std::function<void(const int16_t* stems, int num_frames)>;
+
   APU(std::function<void(const int16_t* samples, int num_samples)> sample_generated_callback);
 
   //Should be called once per m-cycle
   void tick();
 
+  //Same as calling tick() m_cycles times, but with band-limited synthesis it only counts them in one go
+  void run(uint32_t m_cycles);
+
   //Should be called every 2048 m-cycles - or more specifically, when the 10th bit falls on the internal clock
   void tick_frame_sequencer();
 
@@ -24,17 +46,88 @@ public:
 
   //These are obvious, write and read everything from 0xFF10 to 0xFF3F here
   void audio_register_write(uint16_t address, uint8_t value);
-  const unsigned char* audio_register_read(uint16_t address) const;
+  const unsigned char* audio_register_read(uint16_t address);
+
+  //Defaults to BandLimited. Switching flushes the samples generated so far. None is for running without an
+  //audio device: the callback is never called, and the channels are only caught up when a register is
+  //accessed or the frame sequencer ticks. Saved in save states.
+  void set_synthesis(AudioSynthesis synthesis);
+  AudioSynthesis synthesis() const { return synthesis_; }
+
+  //Defaults to AUDIO_SAMPLE_RATE. Any rate from MIN_AUDIO_SAMPLE_RATE to MAX_AUDIO_SAMPLE_RATE, fractions
+  //included, and it can be changed at any time without a glitch, e.g. to follow an audio device's clock.
+  void set_sample_rate(double sample_rate);
+  double sample_rate() const { return blip_buffer_.sample_rate(); }
+
+  //Defaults to Medium. Only affects band-limited synthesis. Switching flushes the samples generated so far.
+  void set_resampler_quality(ResamplerQuality quality);
+  ResamplerQuality resampler_quality() const { return blip_buffer_.quality(); }
+
+  //Defaults to FixedPoint. The two differ by a few LSBs.
+  void set_mixing(AudioMixing mixing);
+  AudioMixing mixing() const { return mixing_; }
+
+  //With band-limited synthesis, tick() only counts cycles, and the channels are caught up to the current
+  //cycle in one go when a register is read or written, the frame sequencer ticks or samples are due. Output
+  //is identical either way. Defaults to true; false steps every channel on every tick().
+  void set_event_driven(bool event_driven);
+
+  //Bit n set mutes channel n + 1 (so 0x0E solos channel 1). Muted channels keep running, so their registers,
+  //NR52 and length counters behave exactly as usual, but they're left out of the mix and the stems, and
+  //nothing is spent on their output. Defaults to 0.
+  void set_channel_mute_mask(uint8_t mute_mask);
+  uint8_t channel_mute_mask() const { return mixer_.mute_mask(); }
+
+  //Called after each sample callback with a stem per channel for the same samples: AUDIO_STEM_CHANNELS
+  //int16_t values per frame, CH1 to CH4, before panning and master volume. Stems are synthesized the same
+  //way as the mix, in fixed point, and cost about as much again. Empty disables them, which is the default.
+  //Setting or clearing the callback flushes the samples generated so far.
+  void set_stem_callback(StemCallback callback);
+
+  //Tells `sink` about every register write, frame sequencer tick and generate_samples(), with apu_clock(),
+  //until it's removed (see audio_event_sink.h). AudioWorker, VGMRecorder and APUTraceWriter are all sinks.
+  //Costs a single branch each while there are none, which is the default.
+  void add_event_sink(AudioEventSink* sink);
+  void remove_event_sink(AudioEventSink* sink);
+
+  //Tells `sink` the writes that take a freshly powered APU to the current register state, e.g. to start a
+  //register log part way through. Nothing is triggered, so channels that are playing stay silent until
+  //they're next triggered. Other sinks aren't told.
+  void log_register_state(AudioEventSink& sink);
+
+  //The writes log_register_state() logs, made through `write` instead
+  void write_register_state(const std::function<void(uint16_t address, uint8_t value)>& write);
+
+  //M-cycles since power on, wrapping every 68 minutes
+  uint32_t apu_clock() {
+    catch_up();
+    return apu_clock_;
+  }
 
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
+  //While an AudioWorker synthesizes for this APU, the APU runs with None, so these save the worker's mode in
+  //place of its own and load the saved one without switching to it.
+  void serialize(SaveStateSerializer& serializer, AudioSynthesis saved_synthesis) const;
+  void deserialize(SaveStateSerializer& serializer, AudioSynthesis& saved_synthesis);
 
 private:
+  void apply_register_write(uint16_t address, uint8_t value);
   void add_samples_to_buffer();
+  std::pair<int32_t, int32_t> mixed_levels() const;
+  void update_output(uint32_t blip_time);
+  void update_stems(uint32_t blip_time);
+  void read_band_limited_samples();
+  void read_band_limited_stems(uint32_t frames);
+  void restart_band_limited();
+  void catch_up();
   void reset_registers();
   bool is_length_register(uint16_t address);
 
   std::function<void(const int16_t* samples, int num_samples)> on_samples_generated_;
+  std::vector<AudioEventSink*> event_sinks_;
+  // NR10 to NR51 as the APU last took them, before the unreadable bits are masked off
+  std::array<uint8_t, AUDIO_REG_END - AUDIO_REG_START + 1> written_registers_{};
 
   FrameSequencer frame_sequencer_;
   AudioRegisters audio_registers_;
@@ -42,9 +135,25 @@ private:
   Mixer mixer_;
   bool master_enabled_ = true;
 
-  constexpr static float M_CYCLES_PER_SAMPLE = 21.845333f;
-  float sample_counter_ = M_CYCLES_PER_SAMPLE;
+  float m_cycles_per_sample_ = static_cast<float>(M_CYCLES_PER_SECOND) / AUDIO_SAMPLE_RATE;
+  float sample_counter_ = m_cycles_per_sample_;
 
   StackVector<int16_t, SAMPLE_BUFFER_SIZE> samples_buffer_;
+  StemCallback on_stems_generated_;
+  StackVector<int16_t, SAMPLE_BUFFER_SIZE / 2 * AUDIO_STEM_CHANNELS> stems_buffer_;
   uint32_t apu_clock_ = 0;
+
+  AudioSynthesis synthesis_ = AudioSynthesis::BandLimited;
+  AudioMixing mixing_ = AudioMixing::FixedPoint;
+  bool event_driven_ = true;
+  uint32_t pending_cycles_ = 0;  // Ticks the channels haven't caught up with yet
+  BlipBuffer blip_buffer_{M_CYCLES_PER_SECOND, AUDIO_SAMPLE_RATE};
+  uint32_t blip_clock_ = 0;      // M-cycles into the blip buffer's frame
+  uint32_t blip_frame_end_ = 0;  // blip_clock_ at which a buffer's worth of samples is ready
+  int32_t left_level_ = 0;       // Mix as of the last delta
+  int32_t right_level_ = 0;
+  // With a stem callback, CH1 and CH2 then CH3 and CH4 as the sides of two more blip buffers, run in step
+  // with blip_buffer_
+  std::vector<BlipBuffer> stem_blip_buffers_;
+  std::array<int32_t, AUDIO_STEM_CHANNELS> stem_levels_{};
 };
@@ -0,0 +1,172 @@
+#include "apu_trace.h"
+#include <bit>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+constexpr char TRACE_MAGIC[8] = {'G', 'B', 'A', 'P', 'U', 'T', 'R', 'C'};
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr size_t TRACE_HEADER_BYTES = sizeof(TRACE_MAGIC) + sizeof(uint32_t) + 4 + sizeof(uint64_t);
+constexpr size_t TRACE_FLUSH_BYTES = 64 * 1024;
+
+// Events are a type byte, the m-cycles since the previous event as a LEB128 varint, then the payload
+void put_u16(std::vector<uint8_t>& buffer, uint16_t value) {
+  buffer.push_back(static_cast<uint8_t>(value));
+  buffer.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put_u64(std::vector<uint8_t>& buffer, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+class TraceCursor {
+public:
+  TraceCursor(const std::vector<uint8_t>& data, size_t offset) : data_(data), offset_(offset) {}
+
+  bool done() const { return offset_ == data_.size(); }
+
+  uint8_t u8() {
+    if (offset_ >= data_.size()) {
+      throw std::runtime_error("APU trace is truncated");
+    }
+    return data_[offset_++];
+  }
+
+  uint16_t u16() {
+    const uint16_t low = u8();
+    return low | (u8() << 8);
+  }
+
+  uint64_t u64() {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+      value |= static_cast<uint64_t>(u8()) << (i * 8);
+    }
+    return value;
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const uint8_t byte = u8();
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    throw std::runtime_error("APU trace has a bad varint");
+  }
+
+private:
+  const std::vector<uint8_t>& data_;
+  size_t offset_;
+};
+}  // namespace
+
+APUTraceWriter::APUTraceWriter(const std::string& path, const APUTraceHeader& header)
+    : file_(path, std::ios::binary | std::ios::trunc) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open APU trace file: " + path);
+  }
+  buffer_.reserve(TRACE_FLUSH_BYTES + 32);
+  buffer_.insert(buffer_.end(), std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC));
+  for (int i = 0; i < 4; i++) {
+    buffer_.push_back(static_cast<uint8_t>(TRACE_VERSION >> (i * 8)));
+  }
+  buffer_.push_back(static_cast<uint8_t>(header.synthesis));
+  buffer_.push_back(static_cast<uint8_t>(header.mixing));
+  buffer_.push_back(static_cast<uint8_t>(header.quality));
+  buffer_.push_back(header.mute_mask);
+  put_u64(buffer_, std::bit_cast<uint64_t>(header.sample_rate));
+}
+
+APUTraceWriter::~APUTraceWriter() {
+  flush();
+}
+
+void APUTraceWriter::end_frame(uint32_t m_cycle, const int16_t* samples, size_t count) {
+  hash_ = hash_pcm(hash_, samples, count);
+  samples_ += count;
+  put(APUTraceEventType::EndFrame, m_cycle, 0, 0);
+  put_u64(buffer_, hash_);
+  put_varint(samples_);
+}
+
+void APUTraceWriter::flush() {
+  file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+  file_.flush();
+  buffer_.clear();
+}
+
+void APUTraceWriter::put(APUTraceEventType type, uint32_t m_cycle, uint16_t address, uint8_t value) {
+  if (buffer_.size() >= TRACE_FLUSH_BYTES) {
+    flush();
+  }
+
+  buffer_.push_back(static_cast<uint8_t>(type));
+  // apu_clock() wraps, the difference doesn't
+  put_varint(m_cycle - last_event_m_cycle_);
+  last_event_m_cycle_ = m_cycle;
+
+  if (type == APUTraceEventType::Write) {
+    put_u16(buffer_, address);
+    buffer_.push_back(value);
+  }
+}
+
+void APUTraceWriter::put_varint(uint64_t value) {
+  while (value >= 0x80) {
+    buffer_.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  buffer_.push_back(static_cast<uint8_t>(value));
+}
+
+APUTraceReader::APUTraceReader(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open APU trace file: " + path);
+  }
+  const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  if (data.size() < TRACE_HEADER_BYTES || std::memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+    throw std::runtime_error("Not an APU trace: " + path);
+  }
+  TraceCursor cursor(data, sizeof(TRACE_MAGIC));
+  const uint32_t version = cursor.u16() | (cursor.u16() << 16);
+  if (version != TRACE_VERSION) {
+    throw std::runtime_error("Unsupported APU trace version " + std::to_string(version) + ": " + path);
+  }
+  header_.synthesis = static_cast<AudioSynthesis>(cursor.u8());
+  header_.mixing = static_cast<AudioMixing>(cursor.u8());
+  header_.quality = static_cast<ResamplerQuality>(cursor.u8());
+  header_.mute_mask = cursor.u8();
+  header_.sample_rate = std::bit_cast<double>(cursor.u64());
+
+  uint64_t m_cycle = 0;
+  while (!cursor.done()) {
+    APUTraceEvent event{};
+    event.type = static_cast<APUTraceEventType>(cursor.u8());
+    m_cycle += cursor.varint();
+    event.m_cycle = m_cycle;
+
+    switch (event.type) {
+      case APUTraceEventType::Write:
+        event.address = cursor.u16();
+        event.value = cursor.u8();
+        break;
+      case APUTraceEventType::FrameSequencer:
+        break;
+      case APUTraceEventType::EndFrame:
+        event.hash = cursor.u64();
+        event.samples = cursor.varint();
+        break;
+      default:
+        throw std::runtime_error("APU trace has an unknown event type: " + path);
+    }
+    events_.push_back(event);
+  }
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "audio_event_sink.h"
+
+enum class AudioSynthesis;
+enum class AudioMixing;
+enum class ResamplerQuality;
+
+// An APU trace is everything an APU was fed from power on, timestamped with apu_clock(): register writes,
+// frame sequencer ticks and generate_samples() calls. Replaying them into a fresh APU gives the same samples
+// without a CPU, so APU changes can be benchmarked and checked alone. Each generate_samples() also logs the
+// hash of every sample produced so far, for the replay to compare against.
+
+enum class APUTraceEventType : uint8_t {
+  Write,           // CPU write to 0xFF10-0xFF3F
+  FrameSequencer,  // tick_frame_sequencer()
+  EndFrame         // generate_samples(). hash and samples cover everything output up to and including it.
+};
+
+struct APUTraceEvent {
+  uint64_t m_cycle;  // apu_clock() at the event, without wrapping
+  uint64_t hash;
+  uint64_t samples;
+  uint16_t address;
+  uint8_t value;
+  APUTraceEventType type;
+};
+
+// The settings the APU was recorded with, which the replay has to use too
+struct APUTraceHeader {
+  AudioSynthesis synthesis;
+  AudioMixing mixing;
+  ResamplerQuality quality;
+  uint8_t mute_mask;
+  double sample_rate;
+};
+
+constexpr uint64_t PCM_HASH_SEED = 0xCBF29CE484222325;
+
+// FNV-1a over each sample, the hash EndFrame events carry
+inline uint64_t hash_pcm(uint64_t hash, const int16_t* samples, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    hash = (hash ^ static_cast<uint16_t>(samples[i])) * 0x100000001B3;
+  }
+  return hash;
+}
+
+// Streams a trace to disk as the APU runs, as one of its event sinks. Throws std::runtime_error if the file
+// can't be opened.
+class APUTraceWriter : public AudioEventSink {
+public:
+  APUTraceWriter(const std::string& path, const APUTraceHeader& header);
+  ~APUTraceWriter();
+
+  APUTraceWriter(const APUTraceWriter&) = delete;
+  APUTraceWriter& operator=(const APUTraceWriter&) = delete;
+
+  // Called by the APU
+  void write(uint32_t m_cycle, uint16_t address, uint8_t value) override {
+    put(APUTraceEventType::Write, m_cycle, address, value);
+  }
+  void frame_sequencer(uint32_t m_cycle) override { put(APUTraceEventType::FrameSequencer, m_cycle, 0, 0); }
+  void end_frame(uint32_t m_cycle, const int16_t* samples, size_t count) override;
+
+  void flush();
+  bool good() const { return file_.good(); }
+
+private:
+  void put(APUTraceEventType type, uint32_t m_cycle, uint16_t address, uint8_t value);
+  void put_varint(uint64_t value);
+
+  std::ofstream file_;
+  std::vector<uint8_t> buffer_;
+  uint32_t last_event_m_cycle_ = 0;
+  uint64_t hash_ = PCM_HASH_SEED;
+  uint64_t samples_ = 0;
+};
+
+// Loads a whole trace into memory. Throws std::runtime_error if it can't be read or isn't a trace.
+class APUTraceReader {
+public:
+  explicit APUTraceReader(const std::string& path);
+
+  const APUTraceHeader& header() const { return header_; }
+  const std::vector<APUTraceEvent>& events() const { return events_; }
+
+private:
+  APUTraceHeader header_;
+  std::vector<APUTraceEvent> events_;
+};
@@ -37,8 +37,8 @@ constexpr uint16_t NR26_ADDR = 0xFF26;  // NR52 - Master Control
 constexpr float PANNING_MULTIPLIER = 0.25f;
 
 // Channel enable/disable values
-constexpr float CHANNEL_ENABLED = 1.0f;
-constexpr float CHANNEL_DISABLED = 0.0f;
+constexpr bool CHANNEL_ENABLED = true;
+constexpr bool CHANNEL_DISABLED = false;
 
 // Noise channel clock shift maximum (values above this disable the channel)
 constexpr uint8_t MAX_NOISE_CLOCK_SHIFT = 14;
@@ -49,7 +49,21 @@ constexpr uint8_t WAVE_RAM_SIZE = 16;
 // Sample buffer size (must be power of 2 for efficiency)
 constexpr uint32_t SAMPLE_BUFFER_SIZE = 128;
 
+// Stems are one per channel, interleaved CH1 to CH4
+constexpr uint32_t AUDIO_STEM_CHANNELS = 4;
+
+// Default output sample rate
+constexpr uint32_t AUDIO_SAMPLE_RATE = 48000;
+
+// Output sample rates APU::set_sample_rate() accepts
+constexpr double MIN_AUDIO_SAMPLE_RATE = 8000.0;
+constexpr double MAX_AUDIO_SAMPLE_RATE = 192000.0;
+
+// Rate APU::tick() is called at
+constexpr uint32_t M_CYCLES_PER_SECOND = 1048576;
+
 // Bit masks for extracting register values
 constexpr uint8_t LENGTH_COUNTER_MASK = 0x3F;  // 6 bits for most length counters
 constexpr uint8_t WAVE_LENGTH_MASK = 0xFF;     // 8 bits for wave channel length
 constexpr uint8_t MASTER_ENABLE_BIT = 0x80;    // Bit 7
+constexpr uint8_t TRIGGER_BIT = 0x80;          // Bit 7 of NRx4
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include "audio_event_sink.h"
+#include "spsc_ring_buffer.h"
+
+// Something the APU's output depends on, at the apu_clock() it happened
+struct AudioEvent {
+  uint32_t m_cycle;
+  uint16_t address;  // 0xFF10 to 0xFF3F for a register write, or one of the AUDIO_EVENT_ values below
+  uint8_t value;
+};
+
+constexpr uint16_t AUDIO_EVENT_FRAME_SEQUENCER = 0x0000;  // tick_frame_sequencer()
+constexpr uint16_t AUDIO_EVENT_END_FRAME = 0x0001;        // generate_samples(), once per frame
+constexpr uint16_t AUDIO_EVENT_SAMPLE_RATE = 0x0002;      // AudioWorker::set_sample_rate()
+
+// The lock-free log an APU appends its events to, as one of its sinks, for an AudioWorker to replay. The
+// worker is only woken at the end of each frame, so a frame's events are handed over in one go.
+class AudioEventLog : public AudioEventSink {
+public:
+  // Events, a few frames' worth for even the busiest music
+  static constexpr size_t CAPACITY = 1 << 14;
+
+  // Emulation thread. If the worker has fallen so far behind that the log is full, waits for it.
+  void push(const AudioEvent& event) {
+    if (!events_.push(event)) {
+      stalls_.fetch_add(1, std::memory_order_relaxed);
+      do {
+        wake();
+        std::this_thread::yield();
+      } while (!events_.push(event));
+    }
+    if (event.address == AUDIO_EVENT_END_FRAME) {
+      wake();
+    }
+  }
+
+  // Emulation thread, as the APU's event sink
+  void write(uint32_t m_cycle, uint16_t address, uint8_t value) override { push({m_cycle, address, value}); }
+  void frame_sequencer(uint32_t m_cycle) override { push({m_cycle, AUDIO_EVENT_FRAME_SEQUENCER, 0}); }
+  void end_frame(uint32_t m_cycle, const int16_t*, size_t) override {
+    push({m_cycle, AUDIO_EVENT_END_FRAME, 0});
+  }
+
+  void wake() {
+    wakeups_.fetch_add(1, std::memory_order_release);
+    wakeups_.notify_one();
+  }
+
+  // Worker thread
+  bool pop(AudioEvent& event) { return events_.pop(event); }
+  uint32_t wakeups() const { return wakeups_.load(std::memory_order_acquire); }
+  void wait(uint32_t wakeups) const { wakeups_.wait(wakeups, std::memory_order_acquire); }
+
+  // Times push() had to wait for the worker
+  uint64_t stalls() const { return stalls_.load(std::memory_order_relaxed); }
+
+private:
+  SPSCRingBuffer<AudioEvent, CAPACITY> events_;
+  std::atomic<uint32_t> wakeups_{0};
+  std::atomic<uint64_t> stalls_{0};
+};
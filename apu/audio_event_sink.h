@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Whatever an APU tells, as it happens, about everything its output depends on, each stamped with the
+// apu_clock() it happened on. Register one with APU::add_event_sink(). AudioWorker's log replays the events
+// on another thread, VGMRecorder logs the writes to a file and APUTraceWriter records all of them.
+class AudioEventSink {
+public:
+  virtual ~AudioEventSink() = default;
+
+  // A CPU write to 0xFF10-0xFF3F, wave RAM included, whether or not the APU takes it
+  virtual void write(uint32_t m_cycle, uint16_t address, uint8_t value) = 0;
+
+  // tick_frame_sequencer()
+  virtual void frame_sequencer(uint32_t m_cycle) {}
+
+  // generate_samples(), with the samples it passed on: none with AudioSynthesis::None
+  virtual void end_frame(uint32_t m_cycle, const int16_t* samples, size_t count) {}
+};
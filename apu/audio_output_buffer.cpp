@@ -0,0 +1,70 @@
+#include "audio_output_buffer.h"
+#include <algorithm>
+
+AudioOutputBuffer::AudioOutputBuffer(double device_sample_rate) : rate_control_(device_sample_rate) {}
+
+void AudioOutputBuffer::push(const int16_t* samples, size_t count) {
+  // Whole stereo frames only, so a partial push can't swap the channels
+  const size_t space = (CAPACITY - ring_.size()) & ~(CHANNELS - 1);
+  const size_t pushed = ring_.push(samples, std::min(count, space));
+  overruns_ += count - pushed;
+}
+
+AudioOutputStatus AudioOutputBuffer::update() {
+  const double current_fill = fill();
+  return {rate_control_.nominal_rate(), rate_control_.update(current_fill), current_fill, underruns(),
+          overruns_};
+}
+
+void AudioOutputBuffer::pull(int16_t* out, size_t count) {
+  if (fade_out_requested_.load(std::memory_order_acquire) && !faded_out_) {
+    // Ramp from the last sample played down to zero
+    const int32_t frames = static_cast<int32_t>(count / CHANNELS);
+    for (int32_t frame = 0; frame < frames; frame++) {
+      for (size_t channel = 0; channel < CHANNELS; channel++) {
+        const int32_t level = last_frame_[channel] * (frames - frame) / frames;
+        out[frame * CHANNELS + channel] = static_cast<int16_t>(level);
+      }
+    }
+    faded_out_ = true;
+    return;
+  }
+
+  if (faded_out_) {
+    std::fill(out, out + count, 0);
+    return;
+  }
+  if (!primed_ && fill() < AudioRateControl::TARGET_FILL) {
+    hold(out, 0, count);
+    return;
+  }
+  primed_ = true;
+
+  const size_t popped = ring_.pop(out, count);
+  if (popped >= CHANNELS) {
+    std::copy(out + popped - CHANNELS, out + popped, last_frame_);
+  }
+  if (popped < count) {
+    hold(out, popped, count);
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+    primed_ = false;
+  }
+}
+
+// Repeats the last sample played, rather than dropping to zero which would click
+void AudioOutputBuffer::hold(int16_t* out, size_t start, size_t end) const {
+  for (size_t i = start; i < end; i++) {
+    out[i] = last_frame_[i % CHANNELS];
+  }
+}
+
+void AudioOutputBuffer::clear() {
+  int16_t discard[CHANNELS * 64];
+  while (ring_.pop(discard, std::size(discard)) > 0) {}
+  rate_control_.reset();
+  fade_out_requested_.store(false, std::memory_order_release);
+  primed_ = false;
+  faded_out_ = false;
+  last_frame_[0] = 0;
+  last_frame_[1] = 0;
+}
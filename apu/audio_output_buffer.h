@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "audio_rate_control.h"
+#include "spsc_ring_buffer.h"
+
+// What an audio sink reports back to the emulation thread once per frame
+struct AudioOutputStatus {
+  double device_sample_rate;  // Rate the device plays at
+  double sample_rate;         // Rate the APU should generate at
+  double fill;                // How full the sink's buffer is, 0 to 1
+  uint64_t underruns;         // Times the device asked for samples the buffer didn't have
+  uint64_t overruns;          // Samples dropped because the buffer was full
+};
+
+// The samples between the emulation thread and an audio device that pulls them from its own thread. Samples
+// go through a preallocated lock-free ring, so neither side allocates or locks, and the emulation thread
+// steers the APU's rate with AudioRateControl to keep the ring half full.
+//
+// The device gets the last sample held until the ring first reaches half full, and again after an underrun
+// until it refills, so a late frame costs one gap rather than a run of crackles.
+class AudioOutputBuffer {
+public:
+  // Interleaved stereo int16_t samples, ~85 ms at 48 kHz
+  static constexpr size_t CAPACITY = 8192;
+
+  explicit AudioOutputBuffer(double device_sample_rate);
+
+  // Emulation thread. Samples that don't fit are dropped and counted as overruns.
+  void push(const int16_t* samples, size_t count);
+  // Emulation thread, once per frame. Updates the rate control from the current fill level.
+  AudioOutputStatus update();
+
+  // Audio thread. Always fills `out` completely, with silence or the last sample held where it has to.
+  void pull(int16_t* out, size_t count);
+
+  // Fades the output out over the next pull() and then plays silence until clear()
+  void fade_out() { fade_out_requested_.store(true, std::memory_order_release); }
+
+  // Only while the device isn't pulling, e.g. paused or locked. Empties the ring and restarts the rate
+  // control.
+  void clear();
+
+  // Any thread
+  double fill() const { return static_cast<double>(ring_.size()) / CAPACITY; }
+  size_t size() const { return ring_.size(); }
+  uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr size_t CHANNELS = 2;
+
+  void hold(int16_t* out, size_t start, size_t end) const;
+
+  SPSCRingBuffer<int16_t, CAPACITY> ring_;
+  AudioRateControl rate_control_;
+  std::atomic<uint64_t> underruns_{0};
+  std::atomic<bool> fade_out_requested_{false};
+  uint64_t overruns_ = 0;
+
+  // Audio thread only
+  bool primed_ = false;
+  bool faded_out_ = false;
+  int16_t last_frame_[CHANNELS] = {0, 0};
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <algorithm>
+
+// Keeps an audio output buffer near half full by nudging the rate the APU generates samples at. The host's
+// audio clock and the emulator's frame pacing never agree exactly, so at a fixed rate the buffer slowly
+// drains (and underruns) or fills (and drops samples). Here the rate moves with the buffer's fill level, at
+// most MAX_ADJUSTMENT either way: at 0.5% the pitch change is under 9 cents, which can't be heard, and it
+// covers far more drift than real clocks have.
+//
+// The fill level arrives in blocks as the device pulls samples, so it's smoothed before it moves the rate.
+// The control is proportional-integral: the proportional term reacts to the fill level straight away and the
+// integral term learns the steady clock mismatch, so the buffer settles back at half full instead of sitting
+// off it by the mismatch. Both are in units of MAX_ADJUSTMENT and the gains assume one update() per frame.
+class AudioRateControl {
+public:
+  static constexpr double MAX_ADJUSTMENT = 0.005;
+  static constexpr double TARGET_FILL = 0.5;
+  static constexpr double FILL_SMOOTHING = 0.05;  // Fraction of each new reading taken into the smoothed fill
+  static constexpr double PROPORTIONAL_GAIN = 1.0;
+  // Per update, about critically damped at 60 updates a second
+  static constexpr double INTEGRAL_GAIN = 0.0005;
+
+  explicit AudioRateControl(double nominal_rate) : nominal_rate_(nominal_rate), rate_(nominal_rate) {}
+
+  // Takes the buffer's fill level, from 0 (empty) to 1 (full), and returns the rate to generate at
+  double update(double fill) {
+    smoothed_fill_ += (std::clamp(fill, 0.0, 1.0) - smoothed_fill_) * FILL_SMOOTHING;
+    const double error = (TARGET_FILL - smoothed_fill_) / TARGET_FILL;
+    integral_ = std::clamp(integral_ + error * INTEGRAL_GAIN, -1.0, 1.0);
+    const double adjustment = std::clamp(error * PROPORTIONAL_GAIN + integral_, -1.0, 1.0);
+    rate_ = nominal_rate_ * (1.0 + MAX_ADJUSTMENT * adjustment);
+    return rate_;
+  }
+
+  // Starts again from the nominal rate, e.g. after the buffer was cleared
+  void reset() {
+    smoothed_fill_ = TARGET_FILL;
+    integral_ = 0.0;
+    rate_ = nominal_rate_;
+  }
+
+  double nominal_rate() const { return nominal_rate_; }
+  double rate() const { return rate_; }
+  double smoothed_fill() const { return smoothed_fill_; }
+
+private:
+  double nominal_rate_;
+  double rate_;
+  double smoothed_fill_ = TARGET_FILL;
+  double integral_ = 0.0;
+};
@@ -0,0 +1,108 @@
+#include "audio_worker.h"
+#include <stdexcept>
+#include <string>
+
+AudioWorker::AudioWorker(APU& apu, SampleCallback sample_generated_callback)
+    : apu_(apu),
+      on_samples_generated_(std::move(sample_generated_callback)),
+      synthesis_(apu.synthesis()),
+      sample_rate_(apu.sample_rate()) {
+  start();
+}
+
+AudioWorker::~AudioWorker() {
+  stop();
+  apu_.set_synthesis(synthesis_);
+  apu_.set_sample_rate(sample_rate());
+}
+
+void AudioWorker::set_sample_rate(double sample_rate) {
+  if (!(sample_rate >= MIN_AUDIO_SAMPLE_RATE && sample_rate <= MAX_AUDIO_SAMPLE_RATE)) {
+    throw std::invalid_argument("Audio sample rate out of range: " + std::to_string(sample_rate));
+  }
+  if (sample_rate != this->sample_rate()) {
+    sample_rate_.store(sample_rate, std::memory_order_relaxed);
+    log_.push({apu_.apu_clock(), AUDIO_EVENT_SAMPLE_RATE, 0});
+  }
+}
+
+void AudioWorker::resync() {
+  resync(synthesis_);
+}
+
+void AudioWorker::resync(AudioSynthesis synthesis) {
+  stop();
+  synthesis_ = synthesis;
+  start();
+}
+
+void AudioWorker::start() {
+  // Anything the APU has buffered goes out through its own callback before the worker takes over. Done again
+  // on resync(), so nothing that replaced the APU's state can leave both of them synthesizing.
+  apu_.set_synthesis(AudioSynthesis::None);
+
+  synthesizer_ = std::make_unique<APU>(on_samples_generated_);
+  synthesizer_->set_synthesis(synthesis_);
+  synthesizer_->set_sample_rate(sample_rate());
+  synthesizer_->set_resampler_quality(apu_.resampler_quality());
+  synthesizer_->set_mixing(apu_.mixing());
+  synthesizer_->set_channel_mute_mask(apu_.channel_mute_mask());
+
+  // At power on the two are already the same
+  m_cycle_ = apu_.apu_clock();
+  if (m_cycle_ != 0) {
+    apu_.write_register_state([this](uint16_t address, uint8_t value) {
+      synthesizer_->audio_register_write(address, value);
+    });
+  }
+
+  running_.store(true, std::memory_order_release);
+  apu_.add_event_sink(&log_);
+  thread_ = std::thread(&AudioWorker::run, this);
+}
+
+// Logs the end of a frame so the worker plays out everything up to now, then waits for it to finish
+void AudioWorker::stop() {
+  apu_.generate_samples();
+  apu_.remove_event_sink(&log_);
+  running_.store(false, std::memory_order_release);
+  log_.wake();
+  thread_.join();
+  synthesizer_.reset();
+}
+
+void AudioWorker::run() {
+  while (running_.load(std::memory_order_acquire)) {
+    // Read this before checking for events so a wake up between the check and the wait isn't lost
+    const uint32_t wakeups = log_.wakeups();
+    if (!replay_pending()) {
+      log_.wait(wakeups);
+    }
+  }
+
+  // Everything logged before stop() is played out
+  while (replay_pending()) {
+  }
+}
+
+bool AudioWorker::replay_pending() {
+  bool replayed = false;
+  AudioEvent event;
+  while (log_.pop(event)) {
+    synthesizer_->run(event.m_cycle - m_cycle_);
+    m_cycle_ = event.m_cycle;
+
+    if (event.address == AUDIO_EVENT_FRAME_SEQUENCER) {
+      synthesizer_->tick_frame_sequencer();
+    } else if (event.address == AUDIO_EVENT_END_FRAME) {
+      synthesizer_->generate_samples();
+    } else if (event.address == AUDIO_EVENT_SAMPLE_RATE) {
+      // The latest rate, which is this one unless it has been changed again since
+      synthesizer_->set_sample_rate(sample_rate());
+    } else {
+      synthesizer_->audio_register_write(event.address, event.value);
+    }
+    replayed = true;
+  }
+  return replayed;
+}
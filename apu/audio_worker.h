@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "apu.h"
+#include "audio_event_log.h"
+
+// Moves an APU's synthesis onto a thread of its own, so the emulation thread only keeps its registers up to
+// date.
+//
+// The APU on the emulation thread becomes a status model: it runs with AudioSynthesis::None, so its channels
+// are only caught up when a register is read or written or the frame sequencer ticks. That keeps NR52, wave
+// RAM and every other readable register exactly as before, for a fraction of the cost. An AudioEventLog,
+// added as one of its event sinks, takes every register write, frame sequencer tick and generate_samples()
+// with the m-cycle it happened on. The worker replays the log through an APU of its own, which synthesizes the samples
+// and calls the sample callback from the worker thread.
+//
+// The same writes at the same m-cycles make the same samples, so a worker attached at power on sounds exactly
+// like the APU would have. Attached later, or after resync(), the worker starts from the register state the
+// way APU::log_register_state() does: channels that are already playing stay silent until next triggered.
+class AudioWorker {
+public:
+  using SampleCallback = std::function<void(const int16_t* samples, int num_samples)>;
+
+  // Takes over `apu` until destroyed. The worker synthesizes the way `apu` was set up to: synthesis, sample
+  // rate, resampler quality, mixing and mute mask. Stems aren't passed on.
+  AudioWorker(APU& apu, SampleCallback sample_generated_callback);
+  ~AudioWorker();  // Plays out everything logged and hands synthesis back to the APU
+
+  AudioWorker(const AudioWorker&) = delete;
+  AudioWorker& operator=(const AudioWorker&) = delete;
+
+  // Emulation thread. Takes effect from the APU's current m-cycle, like APU::set_sample_rate().
+  void set_sample_rate(double sample_rate);
+  double sample_rate() const { return sample_rate_.load(std::memory_order_relaxed); }
+
+  // Starts the worker again from the APU's register state, after it was replaced, e.g. by loading a state.
+  // Given a synthesis mode, e.g. the one the state was saved with, the worker synthesizes that way from then
+  // on and hands it back to the APU when destroyed. The APU stays on AudioSynthesis::None either way.
+  void resync();
+  void resync(AudioSynthesis synthesis);
+
+  // The mode the worker synthesizes with
+  AudioSynthesis synthesis() const { return synthesis_; }
+
+  // Times the emulation thread had to wait because the worker fell a log's worth of events behind
+  uint64_t stalls() const { return log_.stalls(); }
+
+private:
+  void start();
+  void stop();
+  void run();
+  bool replay_pending();
+
+  APU& apu_;
+  SampleCallback on_samples_generated_;
+  AudioSynthesis synthesis_;  // The APU's own, to hand back
+  AudioEventLog log_;
+  std::atomic<double> sample_rate_;
+  std::atomic<bool> running_{false};
+
+  // Owned by the worker while it runs
+  std::unique_ptr<APU> synthesizer_;
+  uint32_t m_cycle_ = 0;  // The APU's m-cycle the synthesizer has been run to
+
+  std::thread thread_;
+};
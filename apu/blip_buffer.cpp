@@ -0,0 +1,118 @@
+#include "blip_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+struct KernelPreset {
+  uint32_t taps;
+  // Cutoff of the step's low pass, as a fraction of the output rate. Set below Nyquist by about half the
+  // Blackman window's transition band, so what's left above Nyquist is in the stopband rather than folding
+  // back. Unused by the linear kernel.
+  double cutoff;
+};
+
+// Indexed by ResamplerQuality
+constexpr KernelPreset KERNEL_PRESETS[] = {
+    {4, 0.0},                // Linear, two taps padded to a whole vector
+    {8, 0.5 - 2.0 / 8},      // Low, trading some aliasing for a less muffled top end
+    {16, 0.5 - 3.0 / 16},    // Medium
+    {32, 0.5 - 3.0 / 32},    // High
+};
+
+constexpr double PI = 3.14159265358979323846;
+constexpr int32_t SAMPLE_MIN = -32768;
+constexpr int32_t SAMPLE_MAX = 32767;
+
+double blackman(double x) {
+  return 0.42 + 0.5 * std::cos(PI * x) + 0.08 * std::cos(2.0 * PI * x);
+}
+}  // namespace
+
+BlipBuffer::BlipBuffer(uint32_t clock_rate, double sample_rate, ResamplerQuality quality)
+    : clock_rate_(clock_rate), quality_(quality) {
+  set_sample_rate(sample_rate);
+  build_kernels();
+}
+
+// Each phase is the impulse of a step landing `phase / PHASES` of a sample after the first tap's sample,
+// delayed by half the kernel. Taps are rounded to integers that sum exactly to one, so a step integrates to
+// exactly its size and levels never drift.
+void BlipBuffer::build_kernels() {
+  const KernelPreset& preset = KERNEL_PRESETS[static_cast<size_t>(quality_)];
+  taps_ = preset.taps;
+  kernels_.assign(PHASES * taps_, 0);
+
+  const double half = taps_ / 2.0;
+  for (uint32_t phase = 0; phase < PHASES; phase++) {
+    std::array<double, MAX_TAPS> taps;
+    double sum = 0.0;
+    for (uint32_t tap = 0; tap < taps_; tap++) {
+      const double x = tap + 1.0 - half - static_cast<double>(phase) / PHASES;
+      if (quality_ == ResamplerQuality::Linear) {
+        taps[tap] = std::max(0.0, 1.0 - std::abs(x));
+      } else {
+        const double angle = 2.0 * PI * preset.cutoff * x;
+        const double sinc = x == 0.0 ? 1.0 : std::sin(angle) / angle;
+        taps[tap] = sinc * blackman(x / half);
+      }
+      sum += taps[tap];
+    }
+
+    int16_t* kernel = &kernels_[phase * taps_];
+    int32_t total = 0;
+    for (uint32_t tap = 0; tap < taps_; tap++) {
+      kernel[tap] = static_cast<int16_t>(std::lround(taps[tap] / sum * (1 << KERNEL_BITS)));
+      total += kernel[tap];
+    }
+    *std::max_element(kernel, kernel + taps_) += (1 << KERNEL_BITS) - total;
+  }
+}
+
+void BlipBuffer::end_frame(uint32_t time) {
+  offset_ += time * factor_;
+}
+
+void BlipBuffer::set_sample_rate(double sample_rate) {
+  sample_rate_ = sample_rate;
+  factor_ = static_cast<uint64_t>(std::llround(sample_rate * (1ull << FRACTION_BITS) / clock_rate_));
+}
+
+void BlipBuffer::set_quality(ResamplerQuality quality) {
+  quality_ = quality;
+  build_kernels();
+  clear();
+}
+
+uint32_t BlipBuffer::clocks_needed(uint32_t samples) const {
+  const uint64_t needed = static_cast<uint64_t>(samples) << FRACTION_BITS;
+  if (offset_ >= needed) {
+    return 0;
+  }
+  return static_cast<uint32_t>((needed - offset_ + factor_ - 1) / factor_);
+}
+
+void BlipBuffer::read_samples(int16_t* out, uint32_t samples) {
+  for (uint32_t i = 0; i < samples; i++) {
+    left_sum_ += left_[i];
+    right_sum_ += right_[i];
+    out[i * 2] = static_cast<int16_t>(std::clamp(left_sum_ >> KERNEL_BITS, SAMPLE_MIN, SAMPLE_MAX));
+    out[i * 2 + 1] = static_cast<int16_t>(std::clamp(right_sum_ >> KERNEL_BITS, SAMPLE_MIN, SAMPLE_MAX));
+  }
+
+  // Deltas reach at most taps_ samples past the end of the frame
+  const uint32_t remaining = samples_available() - samples + taps_ + 1;
+  std::memmove(left_.data(), &left_[samples], remaining * sizeof(int32_t));
+  std::memmove(right_.data(), &right_[samples], remaining * sizeof(int32_t));
+  std::fill(&left_[remaining], &left_[remaining + samples], 0);
+  std::fill(&right_[remaining], &right_[remaining + samples], 0);
+  offset_ -= static_cast<uint64_t>(samples) << FRACTION_BITS;
+}
+
+void BlipBuffer::clear() {
+  offset_ = 0;
+  left_sum_ = 0;
+  right_sum_ = 0;
+  left_.fill(0);
+  right_.fill(0);
+}
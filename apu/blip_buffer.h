@@ -0,0 +1,133 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BLIP_BUFFER_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define BLIP_BUFFER_NEON
+#endif
+
+// Kernel used to spread each step over the output samples. Longer kernels cut off closer to Nyquist and
+// alias less, and cost more per step.
+enum class ResamplerQuality {
+  Linear,  // Steps are linearly interpolated between two samples
+  Low,     // 8-tap windowed sinc
+  Medium,  // 16-tap windowed sinc
+  High     // 32-tap windowed sinc
+};
+
+// Band-limited step (BLEP) synthesis. Output level changes are added as timestamped deltas, each spread over
+// taps() output samples by a windowed sinc for the sub-sample phase it lands on. Reading integrates the
+// deltas back into levels, so the output is the band-limited version of the level at the input clock rate
+// without evaluating anything between changes. This makes it a polyphase resampler from the input clock to
+// any output rate, which only does work where the input changes.
+//
+// Time is counted in input clocks from the start of the current frame. A frame can be ended at any point,
+// which makes its samples readable; the fractional sample left over carries into the next frame.
+class BlipBuffer {
+public:
+  static constexpr uint32_t MAX_TAPS = 32;
+  // Samples a single frame may span. APU ends frames every SAMPLE_BUFFER_SIZE / 2 samples.
+  static constexpr uint32_t MAX_FRAME_SAMPLES = 512;
+
+  BlipBuffer(uint32_t clock_rate, double sample_rate, ResamplerQuality quality = ResamplerQuality::Medium);
+
+  // A change in level of `left` / `right` at `time` clocks into the current frame
+  void add_delta(uint32_t time, int32_t left, int32_t right) {
+    const uint64_t position = offset_ + time * factor_;
+    const uint32_t index = static_cast<uint32_t>(position >> FRACTION_BITS);
+    const int16_t* kernel = &kernels_[((position >> (FRACTION_BITS - PHASE_BITS)) & (PHASES - 1)) * taps_];
+    add_kernel(kernel, left, right, &left_[index], &right_[index]);
+  }
+
+  // Ends the current frame `time` clocks in. The next frame starts at time 0.
+  void end_frame(uint32_t time);
+
+  // Takes effect from the start of the next frame, so only call it between end_frame() and add_delta()
+  void set_sample_rate(double sample_rate);
+  double sample_rate() const { return sample_rate_; }
+
+  // Rebuilds the kernels. Clears the buffer.
+  void set_quality(ResamplerQuality quality);
+  ResamplerQuality quality() const { return quality_; }
+
+  // Samples each step is spread over. Output is delayed by half this.
+  uint32_t taps() const { return taps_; }
+
+  // Samples that can be read
+  uint32_t samples_available() const { return static_cast<uint32_t>(offset_ >> FRACTION_BITS); }
+
+  // Clocks the current frame must run for before `samples` samples are available
+  uint32_t clocks_needed(uint32_t samples) const;
+
+  // Writes `samples` interleaved stereo samples to `out` and removes them from the buffer
+  void read_samples(int16_t* out, uint32_t samples);
+
+  void clear();
+
+private:
+  static constexpr uint32_t FRACTION_BITS = 32;
+  static constexpr uint32_t PHASE_BITS = 9;
+  static constexpr uint32_t PHASES = 1 << PHASE_BITS;
+  static constexpr uint32_t KERNEL_BITS = 13;  // Every phase of the kernel sums to 1 << KERNEL_BITS
+  static constexpr uint32_t BUFFER_SIZE = MAX_FRAME_SAMPLES + MAX_TAPS + 1;
+  static constexpr uint32_t TAPS_PER_VECTOR = 4;  // Every kernel is a multiple of this
+
+  // out[tap] += kernel[tap] * delta, for both sides
+  [[gnu::always_inline]] void add_kernel(const int16_t* kernel, int32_t left, int32_t right,
+                                         int32_t* out_left, int32_t* out_right) const {
+#if defined(BLIP_BUFFER_SSE2)
+    // SSE2 has no 32-bit multiply that keeps the low half, so even and odd lanes are multiplied separately
+    const __m128i left_delta = _mm_set1_epi32(left);
+    const __m128i right_delta = _mm_set1_epi32(right);
+    const auto multiply = [](__m128i taps, __m128i delta) {
+      const __m128i even = _mm_mul_epu32(taps, delta);
+      const __m128i odd = _mm_mul_epu32(_mm_srli_epi64(taps, 32), delta);
+      return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                                _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    };
+    for (uint32_t tap = 0; tap < taps_; tap += TAPS_PER_VECTOR) {
+      const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(kernel + tap));
+      const __m128i taps = _mm_srai_epi32(_mm_unpacklo_epi16(packed, packed), 16);
+      __m128i* out_l = reinterpret_cast<__m128i*>(out_left + tap);
+      __m128i* out_r = reinterpret_cast<__m128i*>(out_right + tap);
+      _mm_storeu_si128(out_l, _mm_add_epi32(_mm_loadu_si128(out_l), multiply(taps, left_delta)));
+      _mm_storeu_si128(out_r, _mm_add_epi32(_mm_loadu_si128(out_r), multiply(taps, right_delta)));
+    }
+#elif defined(BLIP_BUFFER_NEON)
+    for (uint32_t tap = 0; tap < taps_; tap += TAPS_PER_VECTOR) {
+      const int32x4_t taps = vmovl_s16(vld1_s16(kernel + tap));
+      vst1q_s32(out_left + tap, vmlaq_n_s32(vld1q_s32(out_left + tap), taps, left));
+      vst1q_s32(out_right + tap, vmlaq_n_s32(vld1q_s32(out_right + tap), taps, right));
+    }
+#else
+    for (uint32_t tap = 0; tap < taps_; tap++) {
+      out_left[tap] += left * kernel[tap];
+      out_right[tap] += right * kernel[tap];
+    }
+#endif
+  }
+
+  void build_kernels();
+
+  uint32_t clock_rate_;
+  double sample_rate_;
+  ResamplerQuality quality_;
+  uint32_t taps_ = 0;
+
+  // Output samples per input clock, 32.32 fixed point
+  uint64_t factor_;
+  // Position of time 0 of the current frame, 32.32 fixed point, counted from the first unread sample
+  uint64_t offset_ = 0;
+  int32_t left_sum_ = 0;
+  int32_t right_sum_ = 0;
+
+  std::vector<int16_t> kernels_;  // PHASES kernels of taps_ each
+  std::array<int32_t, BUFFER_SIZE> left_{};
+  std::array<int32_t, BUFFER_SIZE> right_{};
+};
@@ -5,17 +5,17 @@
 #include "audio_registers.h"
 #include "dac.h"
 #include "frame_sequencer.h"
+#include "length_timer.h"
 
 template <typename Parent, typename Traits>
 class ChannelBase {
 public:
   ChannelBase(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers)
       : audio_registers_(audio_registers),
-        length_timer_(frame_sequencer, [this]() { length_expired(); }),
-        dac_(audio_registers, frame_sequencer) {
-    frame_sequencer.add_length_timer(&length_timer_);
-  }
+        length_timer_(frame_sequencer, *this),
+        dac_(audio_registers) {}
 
+  // Called by the length timer
   void length_expired() {
     disable_channel();
     if constexpr (std::is_same_v<typename Traits::DACType, WaveRAMDAC>) {
@@ -27,20 +27,68 @@ public:
 
   void master_enable() { dac_.master_enable(); }
 
+  // Frame sequencer clocks, see FrameSequencer::tick(). Only channel 1 sweeps, and channel 3 has no envelope.
+  void tick_length() { length_timer_.tick(); }
+  void tick_sweep() {}
+  void tick_envelope() {
+    if constexpr (!std::is_same_v<typename Traits::DACType, WaveRAMDAC>) {
+      dac_.tick_envelope();
+    }
+  }
+
   [[gnu::always_inline]] std::pair<float, float> output() const {
     const float output = dac_.output() * enabled_ * length_timer_.should_play() * dac_.enabled();
-    return {output * left_enabled_, output * right_enabled_};
+    return {output * (left_enabled_ * PANNING_MULTIPLIER), output * (right_enabled_ * PANNING_MULTIPLIER)};
+  }
+
+  // output() in fixed point: -15 to 15 per side, before the PANNING_MULTIPLIER
+  [[gnu::always_inline]] std::pair<int32_t, int32_t> fixed_output() const {
+    const int32_t output = fixed_level();
+    return {left_enabled_ ? output : 0, right_enabled_ ? output : 0};
+  }
+
+  // The channel's level before panning, -15 to 15
+  [[gnu::always_inline]] int32_t fixed_level() const {
+    const bool playing = enabled_ && length_timer_.should_play() && dac_.enabled();
+    return playing ? dac_.fixed_output() : 0;
+  }
+
+  // Returns true if output() may have changed
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) {
+    const bool stepped = dac_.tick(apu_clock);
+
+    if (!enabled_)
+      return false;
+
+    if (!dac_.enabled()) {
+      disable_channel();
+      return true;
+    }
+    return stepped;
+  }
+
+  // Ticks until tick() could next return true
+  uint32_t ticks_until_change() const {
+    if (!enabled_)
+      return UINT32_MAX;
+    if (!dac_.enabled())
+      return 1;
+    return dac_.ticks_until_step();
   }
 
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) {
-    dac_.tick(apu_clock);
+  // Same as calling tick() `ticks` times, the last with `apu_clock`, as long as `ticks` is no more than
+  // ticks_until_change(). Returns what the last tick() would have.
+  bool advance(uint32_t ticks, uint32_t apu_clock) {
+    const bool stepped = dac_.advance(ticks, apu_clock);
 
     if (!enabled_)
-      return;
+      return false;
 
     if (!dac_.enabled()) {
       disable_channel();
+      return true;
     }
+    return stepped;
   }
 
   void disable_channel() {
@@ -54,10 +102,10 @@ public:
   }
 
 protected:
-  float enabled_ = CHANNEL_DISABLED;
-  float left_enabled_ = CHANNEL_DISABLED;
-  float right_enabled_ = CHANNEL_DISABLED;
+  bool enabled_ = CHANNEL_DISABLED;
+  bool left_enabled_ = CHANNEL_DISABLED;
+  bool right_enabled_ = CHANNEL_DISABLED;
   AudioRegisters& audio_registers_;
-  typename Traits::LengthTimerType length_timer_;
+  typename Traits::template LengthTimerType<ChannelBase> length_timer_;
   typename Traits::DACType dac_;
 };
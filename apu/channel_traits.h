@@ -16,7 +16,8 @@ struct Channel1Traits {
   static constexpr uint8_t PANNING_LEFT_BIT = 4;             // NR51 bit 4
   static constexpr uint8_t PANNING_RIGHT_BIT = 0;            // NR51 bit 0
   static constexpr uint16_t NR52_BIT = 0;                    // NR52 bit 0
-  using LengthTimerType = LengthTimer;
+  template <typename Channel>
+  using LengthTimerType = LengthTimer<Channel>;
   using DACType = DAC<WaveDuty>;
 };
 
@@ -29,18 +30,21 @@ struct Channel2Traits {
   static constexpr uint8_t PANNING_LEFT_BIT = 5;             // NR51 bit 5
   static constexpr uint8_t PANNING_RIGHT_BIT = 1;            // NR51 bit 1
   static constexpr uint16_t NR52_BIT = 1;                    // NR52 bit 1
-  using LengthTimerType = LengthTimer;
+  template <typename Channel>
+  using LengthTimerType = LengthTimer<Channel>;
   using DACType = DAC<WaveDuty>;
 };
 
 struct Channel3Traits {
   static constexpr uint16_t NR52_BIT = 2;  // NR52 bit 2
-  using LengthTimerType = LengthTimerChannel3;
+  template <typename Channel>
+  using LengthTimerType = LengthTimerChannel3<Channel>;
   using DACType = WaveRAMDAC;
 };
 
 struct Channel4Traits {
   static constexpr uint16_t NR52_BIT = 3;  // NR52 bit 3
-  using LengthTimerType = LengthTimer;
+  template <typename Channel>
+  using LengthTimerType = LengthTimer<Channel>;
   using DACType = DAC<LFSR>;
 };
\ No newline at end of file
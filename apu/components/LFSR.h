@@ -6,15 +6,24 @@
 class LFSR {
 public:
   LFSR();
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) {
+  // Returns true if the LFSR shifted
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) {
     if (timer_.tick(apu_clock)) {
-      bool feedback = ((lfsr_ & 1) ^ (lfsr_ >> 1)) & 1;
-      lfsr_ = (lfsr_ >> 1) | (feedback << 14);
-      if (width_) {
-        lfsr_ &= ~(1 << 6);
-        lfsr_ |= (feedback << 6);
-      }
+      shift();
+      return true;
     }
+    return false;
+  }
+
+  uint32_t ticks_until_step() const { return timer_.ticks_until_trigger(); }
+
+  // Same as calling tick() `ticks` times, returns true if any of them shifted
+  bool advance(uint32_t ticks) {
+    const uint32_t shifts = timer_.advance(ticks);
+    for (uint32_t i = 0; i < shifts; i++) {
+      shift();
+    }
+    return shifts > 0;
   }
   uint8_t get_output() const;
 
@@ -24,6 +33,15 @@ public:
   void master_enable();
 
 private:
+  [[gnu::always_inline]] void shift() {
+    bool feedback = ((lfsr_ & 1) ^ (lfsr_ >> 1)) & 1;
+    lfsr_ = (lfsr_ >> 1) | (feedback << 14);
+    if (width_) {
+      lfsr_ &= ~(1 << 6);
+      lfsr_ |= (feedback << 6);
+    }
+  }
+
   FrequencyTimerChannel4 timer_;
   uint16_t lfsr_ = 0xFFFF;
   bool width_ = false;
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
 
+// The timers count down 4 t-cycles per tick() and trigger on the tick that takes them to zero or below, then
+// reload. advance() does the same for many ticks at once: once a timer has been given a period it triggers
+// every `counter_refresh_` t-cycles, so that's arithmetic. Before then (a zero period, or a counter that
+// wrapped) it falls back to ticking, skipping the stretches where nothing can trigger.
+
 template <uint16_t frequencyShift>
 class FrequencyTimerInternal {
 public:
@@ -20,6 +26,44 @@ public:
     return triggered;
   }
 
+  // Ticks until tick() could next trigger, at least 1
+  uint32_t ticks_until_trigger() const { return std::max(1, (counter_ + 3) / 4); }
+
+  // Same as calling tick() `ticks` times. Returns how many of them triggered, and for the last one that did,
+  // which tick it was (1-based) and what tick() returned.
+  uint32_t advance(uint32_t ticks, uint32_t& last_tick, int8_t& last_triggered) {
+    if (counter_refresh_ >= 4 && counter_ >= 1) {
+      const uint32_t t_cycles = ticks * 4;
+      if (counter_ > t_cycles) {
+        counter_ -= t_cycles;
+        return 0;
+      }
+      // Triggers land on t-cycles counter_, counter_ + counter_refresh_, ...
+      const uint32_t triggers = (t_cycles - counter_) / counter_refresh_ + 1;
+      const uint32_t last_t_cycle = counter_ + (triggers - 1) * counter_refresh_;
+      last_tick = (last_t_cycle + 3) / 4;
+      last_triggered = static_cast<int8_t>((last_t_cycle - 1) % 4);
+      counter_ = static_cast<uint16_t>(counter_ + triggers * counter_refresh_ - t_cycles);
+      return triggers;
+    }
+
+    uint32_t triggers = 0;
+    for (uint32_t tick_index = 1; tick_index <= ticks; tick_index++) {
+      if (counter_ > 4) {
+        const uint32_t skip = std::min<uint32_t>(ticks - tick_index, (counter_ - 5) / 4);
+        counter_ -= skip * 4;
+        tick_index += skip;
+      }
+      const int8_t triggered = tick(0);
+      if (triggered >= 0) {
+        triggers++;
+        last_tick = tick_index;
+        last_triggered = triggered;
+      }
+    }
+    return triggers;
+  }
+
 private:
   uint16_t frequency_ = 0;
   uint16_t counter_ = 0;
@@ -40,6 +84,34 @@ public:
   }
   void reset_counter();
 
+  // As FrequencyTimerInternal
+  uint32_t ticks_until_trigger() const { return std::max(1, (counter_ + 3) / 4); }
+
+  // Same as calling tick() `ticks` times, returns how many of them triggered
+  uint32_t advance(uint32_t ticks) {
+    if (counter_refresh_ >= 4 && counter_ >= 1) {
+      const uint32_t t_cycles = ticks * 4;
+      if (counter_ > t_cycles) {
+        counter_ -= t_cycles;
+        return 0;
+      }
+      const uint32_t triggers = (t_cycles - counter_) / counter_refresh_ + 1;
+      counter_ = static_cast<uint16_t>(counter_ + triggers * counter_refresh_ - t_cycles);
+      return triggers;
+    }
+
+    uint32_t triggers = 0;
+    for (uint32_t tick_index = 1; tick_index <= ticks; tick_index++) {
+      if (counter_ > 4) {
+        const uint32_t skip = std::min<uint32_t>(ticks - tick_index, (counter_ - 5) / 4);
+        counter_ -= skip * 4;
+        tick_index += skip;
+      }
+      triggers += tick(0);
+    }
+    return triggers;
+  }
+
 private:
   uint8_t shift_ = 0;
   uint8_t divisor_ = 0;
@@ -1,15 +1,15 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
 #include "audio_constants.h"
+#include "frame_sequencer.h"
 
-class FrameSequencer;
-
-template <uint32_t BASE_LENGTH>
+// Calls Channel::length_expired() on the channel that owns it when the length runs out
+template <uint32_t BASE_LENGTH, typename Channel>
 class LengthTimerInternal {
 public:
-  LengthTimerInternal(FrameSequencer& frame_sequencer, std::function<void()> length_expired_callback);
+  LengthTimerInternal(FrameSequencer& frame_sequencer, Channel& channel)
+      : frame_sequencer_(frame_sequencer), channel_(channel) {}
 
   [[gnu::always_inline]] void tick() {
     if (timer_ == 0 || !enabled_) {
@@ -19,28 +19,52 @@ public:
     timer_--;
 
     if (timer_ == 0) {
-      length_expired_callback_();
+      channel_.length_expired();
       should_play_ = CHANNEL_DISABLED;
     }
   }
 
-  void set_length(uint16_t length_register);
-  void enable(bool enabled);
+  void set_length(uint16_t length_register) {
+    length_register_ = length_register;
+    timer_ = BASE_LENGTH - length_register;
+  }
+
+  void enable(bool enabled) {
+    bool previous_enabled_ = enabled_;
+    enabled_ = enabled;
+    if (enabled) {
+      start();
+      if (!previous_enabled_ && !frame_sequencer_.next_step_is_length_counter()) {
+        tick();
+      }
+    } else {
+      should_play_ = CHANNEL_ENABLED;
+    }
+  }
 
-  void trigger();
+  void trigger() {
+    if (timer_ == 0) {
+      timer_ = BASE_LENGTH;
+      if (!frame_sequencer_.next_step_is_length_counter()) {
+        tick();
+      }
+    }
+  }
 
-  [[gnu::always_inline]] float should_play() const { return should_play_; }
+  [[gnu::always_inline]] bool should_play() const { return should_play_; }
 
 private:
-  void start();
+  void start() { should_play_ = CHANNEL_ENABLED; }
 
   bool enabled_ = false;
-  float should_play_ = CHANNEL_DISABLED;
+  bool should_play_ = CHANNEL_DISABLED;
   uint16_t timer_ = 0;
   uint16_t length_register_ = 0;
   FrameSequencer& frame_sequencer_;
-  std::function<void()> length_expired_callback_;
+  Channel& channel_;
 };
 
-using LengthTimer = LengthTimerInternal<64>;
-using LengthTimerChannel3 = LengthTimerInternal<256>;
\ No newline at end of file
+template <typename Channel>
+using LengthTimer = LengthTimerInternal<64, Channel>;
+template <typename Channel>
+using LengthTimerChannel3 = LengthTimerInternal<256, Channel>;
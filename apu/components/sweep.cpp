@@ -1,5 +1,7 @@
 #include "sweep.h"
 #include "audio_registers.h"
+#include "channel_traits.h"
+#include "square_wave_channel.h"
 
 // Sweep frequency overflow threshold
 constexpr uint16_t MAX_FREQUENCY = 2047;
@@ -7,11 +9,14 @@ constexpr uint16_t MAX_FREQUENCY = 2047;
 // Sweep timer reload value when pace is 0
 constexpr uint8_t SWEEP_TIMER_RELOAD = 8;
 
-Sweep::Sweep(AudioRegisters& audio_registers) : audio_registers_(audio_registers) {}
+template <typename Channel>
+Sweep<Channel>::Sweep(AudioRegisters& audio_registers, Channel& channel)
+    : audio_registers_(audio_registers), channel_(channel) {}
 
-void Sweep::configure(uint8_t pace, bool negate, uint8_t shift) {
+template <typename Channel>
+void Sweep<Channel>::configure(uint8_t pace, bool negate, uint8_t shift) {
   if (negate_ && !negate && calculation_count_ != 0) {
-    overflow_callback_();
+    channel_.sweep_overflow();
   }
 
   calculation_count_ = 0;
@@ -20,15 +25,8 @@ void Sweep::configure(uint8_t pace, bool negate, uint8_t shift) {
   shift_ = shift;
 }
 
-void Sweep::set_overflow_callback(std::function<void()> callback) {
-  overflow_callback_ = callback;
-}
-
-void Sweep::set_frequency_update_callback(std::function<void(uint16_t)> callback) {
-  frequency_update_callback_ = callback;
-}
-
-void Sweep::tick() {
+template <typename Channel>
+void Sweep<Channel>::tick() {
   if (!enabled_) {
     return;
   }
@@ -58,7 +56,8 @@ void Sweep::tick() {
   }
 }
 
-void Sweep::trigger(uint16_t initial_frequency) {
+template <typename Channel>
+void Sweep<Channel>::trigger(uint16_t initial_frequency) {
   shadow_frequency_ = initial_frequency;
   timer_ = pace_ ? pace_ : SWEEP_TIMER_RELOAD;
   enabled_ = (pace_ > 0 || shift_ > 0);
@@ -68,7 +67,8 @@ void Sweep::trigger(uint16_t initial_frequency) {
   }
 }
 
-uint16_t Sweep::calculate_new_frequency() {
+template <typename Channel>
+uint16_t Sweep<Channel>::calculate_new_frequency() {
   calculation_count_++;
   const uint16_t delta = shadow_frequency_ >> shift_;
 
@@ -79,7 +79,8 @@ uint16_t Sweep::calculate_new_frequency() {
   }
 }
 
-bool Sweep::check_overflow(uint16_t frequency) {
+template <typename Channel>
+bool Sweep<Channel>::check_overflow(uint16_t frequency) {
   if (negate_) {
     return false;
   }
@@ -89,18 +90,20 @@ bool Sweep::check_overflow(uint16_t frequency) {
     return false;
 
   enabled_ = false;
-  overflow_callback_();
+  channel_.sweep_overflow();
 
   return true;
 }
 
-void Sweep::write_frequency_to_registers(uint16_t frequency) {
+template <typename Channel>
+void Sweep<Channel>::write_frequency_to_registers(uint16_t frequency) {
   // Write directly to audio registers
   audio_registers_.set_NR13(frequency & 0xFF);
   audio_registers_.set_NR14((audio_registers_.get_NR14() & 0xF8) | ((frequency >> 8) & 0x07));
 
-  // Call the frequency update callback to update the DAC directly
-  if (frequency_update_callback_) {
-    frequency_update_callback_(frequency);
-  }
+  // Update the DAC directly
+  channel_.sweep_frequency_update(frequency);
 }
+
+template class Sweep<SquareWaveChannel<Channel1Traits>>;
+template class Sweep<SquareWaveChannel<Channel2Traits>>;
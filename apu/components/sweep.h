@@ -1,18 +1,17 @@
 #pragma once
 
 #include <cstdint>
-#include <functional>
 
 class AudioRegisters;
 
+// Calls Channel::sweep_overflow() and Channel::sweep_frequency_update() on the channel that owns it
+template <typename Channel>
 class Sweep {
 public:
-  Sweep(AudioRegisters& audio_registers);
+  Sweep(AudioRegisters& audio_registers, Channel& channel);
   void configure(uint8_t pace, bool negate, uint8_t shift);
   void tick();
   void trigger(uint16_t initial_frequency);
-  void set_overflow_callback(std::function<void()> callback);
-  void set_frequency_update_callback(std::function<void(uint16_t)> callback);
 
 private:
   uint16_t calculate_new_frequency();
@@ -20,8 +19,7 @@ private:
   bool check_overflow(uint16_t frequency);
 
   AudioRegisters& audio_registers_;
-  std::function<void()> overflow_callback_;
-  std::function<void(uint16_t)> frequency_update_callback_;
+  Channel& channel_;
   uint16_t shadow_frequency_ = 0;
   uint32_t calculation_count_ = 0;
   uint8_t pace_ = 0;
@@ -8,11 +8,24 @@ class WaveDuty {
 public:
   WaveDuty();
 
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) {
+  // Returns true if the duty position moved
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) {
     int8_t triggered = timer_.tick(apu_clock);
     if (triggered >= 0) {
       duty_position_ = (duty_position_ + 1) % 8;
     }
+    return triggered >= 0;
+  }
+
+  uint32_t ticks_until_step() const { return timer_.ticks_until_trigger(); }
+
+  // Same as calling tick() `ticks` times, returns true if any of them moved the duty position
+  bool advance(uint32_t ticks) {
+    uint32_t last_tick;
+    int8_t last_triggered;
+    const uint32_t steps = timer_.advance(ticks, last_tick, last_triggered);
+    duty_position_ = static_cast<uint8_t>((duty_position_ + steps) % 8);
+    return steps > 0;
   }
 
   void set_frequency_low(uint8_t value);
@@ -12,9 +12,10 @@ public:
   void set_frequency_low(uint8_t value);
   void set_frequency_high(uint8_t value);
 
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) {
+  // Returns true if a new sample was loaded
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) {
     if (!enabled_) {
-      return;
+      return false;
     }
     int8_t triggered = timer_.tick(apu_clock);
 
@@ -22,6 +23,25 @@ public:
       ram_position_ = (ram_position_ + 1) % 32;
       load_sample(apu_clock - (4 - (triggered + 1)));
     }
+    return triggered >= 0;
+  }
+
+  uint32_t ticks_until_step() const { return enabled_ ? timer_.ticks_until_trigger() : UINT32_MAX; }
+
+  // Same as calling tick() `ticks` times, the last with `apu_clock`. Returns true if any of them loaded a
+  // sample. Only the last load is made, as each one replaces the one before.
+  bool advance(uint32_t ticks, uint32_t apu_clock) {
+    if (!enabled_) {
+      return false;
+    }
+    uint32_t last_tick;
+    int8_t last_triggered;
+    const uint32_t steps = timer_.advance(ticks, last_tick, last_triggered);
+    if (steps > 0) {
+      ram_position_ = static_cast<uint8_t>((ram_position_ + steps) % 32);
+      load_sample(apu_clock - (ticks - last_tick) - (4 - (last_triggered + 1)));
+    }
+    return steps > 0;
   }
 
   void set_volume(uint8_t volume);
@@ -1,12 +1,15 @@
 #include "dac.h"
+#include <array>
 #include "LFSR.h"
 #include "audio_constants.h"
-#include "frame_sequencer.h"
 #include "wave_duty.h"
 
 // DAC output normalization constant
 constexpr float DAC_NORMALIZATION = 7.5f;
 
+// DAC input to fixed-point output, the same line as the float output scaled by DAC_NORMALIZATION * 2
+constexpr std::array<int8_t, 16> DAC_LEVELS = {-15, -13, -11, -9, -7, -5, -3, -1, 1, 3, 5, 7, 9, 11, 13, 15};
+
 template <typename Frequency>
 void DAC<Frequency>::enabled(bool enabled) {
   enabled_ = enabled ? CHANNEL_ENABLED : CHANNEL_DISABLED;
@@ -14,9 +17,7 @@ void DAC<Frequency>::enabled(bool enabled) {
 
 // Template implementations
 template <typename Frequency>
-DAC<Frequency>::DAC(AudioRegisters& audio_registers, FrameSequencer& frame_sequencer) : envelope_() {
-  frame_sequencer.add_envelope(&envelope_);
-}
+DAC<Frequency>::DAC(AudioRegisters& audio_registers) : envelope_() {}
 
 template <typename Frequency>
 void DAC<Frequency>::set_LFSR(uint8_t clock_shift, uint8_t width, uint8_t divider) {
@@ -77,12 +78,16 @@ float DAC<Frequency>::output() const {
   return (static_cast<float>(input) / DAC_NORMALIZATION) - 1.0f;
 }
 
+template <typename Frequency>
+int32_t DAC<Frequency>::fixed_output() const {
+  return DAC_LEVELS[duty_.get_output() * envelope_.output_volume()];
+}
+
 // Explicit template instantiation
 template class DAC<WaveDuty>;
 template class DAC<LFSR>;
 
-WaveRAMDAC::WaveRAMDAC(AudioRegisters& audio_registers, FrameSequencer& frame_sequencer)
-    : wave_ram_(audio_registers) {}
+WaveRAMDAC::WaveRAMDAC(AudioRegisters& audio_registers) : wave_ram_(audio_registers) {}
 
 void WaveRAMDAC::set_volume(uint8_t volume) {
   wave_ram_.set_volume(volume);
@@ -92,6 +97,10 @@ float WaveRAMDAC::output() const {
   return (static_cast<float>(wave_ram_.output()) / DAC_NORMALIZATION) - 1.0f;
 }
 
+int32_t WaveRAMDAC::fixed_output() const {
+  return DAC_LEVELS[wave_ram_.output()];
+}
+
 void WaveRAMDAC::set_frequency_low(uint8_t value) {
   wave_ram_.set_frequency_low(value);
 }
@@ -4,19 +4,22 @@
 #include "envelope.h"
 #include "wave_ram.h"
 
-class FrameSequencer;
 class AudioRegisters;
 
 template <typename Frequency>
 class DAC {
 public:
-  DAC(AudioRegisters& audio_registers, FrameSequencer& frame_sequencer);
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) { duty_.tick(apu_clock); }
+  explicit DAC(AudioRegisters& audio_registers);
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) { return duty_.tick(apu_clock); }
+  uint32_t ticks_until_step() const { return duty_.ticks_until_step(); }
+  bool advance(uint32_t ticks, uint32_t apu_clock) { return duty_.advance(ticks); }
 
   float output() const;
+  // output() in fixed point, from -15 to 15
+  int32_t fixed_output() const;
 
   void enabled(bool enabled);
-  [[gnu::always_inline]] float enabled() const { return enabled_; }
+  [[gnu::always_inline]] bool enabled() const { return enabled_; }
 
   //Enables
   void trigger();
@@ -30,6 +33,7 @@ public:
 
   //Envelope
   void set_envelope(uint8_t volume, bool envelope_direction, uint8_t sweep_pace);
+  void tick_envelope() { envelope_.tick(); }
 
   //Frequency Forwarding
   uint16_t get_frequency() const;
@@ -37,7 +41,7 @@ public:
   void set_frequency_high(uint8_t value);
 
 private:
-  float enabled_ = CHANNEL_DISABLED;
+  bool enabled_ = CHANNEL_DISABLED;
   Frequency duty_;
 
   Envelope envelope_;
@@ -46,14 +50,18 @@ private:
 
 class WaveRAMDAC {
 public:
-  WaveRAMDAC(AudioRegisters& audio_registers, FrameSequencer& frame_sequencer);
+  explicit WaveRAMDAC(AudioRegisters& audio_registers);
   float output() const;
+  // output() in fixed point, from -15 to 15
+  int32_t fixed_output() const;
   void set_frequency_low(uint8_t value);
   void set_frequency_high(uint8_t value);
 
   void enabled(bool enabled);
-  [[gnu::always_inline]] float enabled() const { return enabled_; }
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) { wave_ram_.tick(apu_clock); }
+  [[gnu::always_inline]] bool enabled() const { return enabled_; }
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) { return wave_ram_.tick(apu_clock); }
+  uint32_t ticks_until_step() const { return wave_ram_.ticks_until_step(); }
+  bool advance(uint32_t ticks, uint32_t apu_clock) { return wave_ram_.advance(ticks, apu_clock); }
 
   void set_volume(uint8_t volume);
   void master_enable();
@@ -64,6 +72,6 @@ public:
   uint16_t get_timer_counter() const;
 
 private:
-  float enabled_ = CHANNEL_DISABLED;
+  bool enabled_ = CHANNEL_DISABLED;
   WaveRAM wave_ram_;
 };
\ No newline at end of file
@@ -1,40 +1,37 @@
 #pragma once
 
 #include <cstdint>
-#include "length_timer.h"
-#include "stack_vector.h"
-
-class Envelope;
-
-class Sweep;
 
 class FrameSequencer {
 public:
   FrameSequencer() = default;
-  void tick();
-  void reset();
-
-  bool next_step_is_length_counter() const;
-
-  void add_envelope(Envelope* envelope);
 
-  template <typename T>
-  void add_length_timer(T* length_timer) {
-    if constexpr (std::is_same_v<T, LengthTimer>) {
-      length_counters_.push_back(length_timer);
-    } else if constexpr (std::is_same_v<T, LengthTimerChannel3>) {
-      length_counter_channel_3_.push_back(length_timer);
+  // Clocks the length counters, sweep and envelopes of `channels` for the current step. Each channel has
+  // tick_length(), tick_sweep() and tick_envelope(), called directly, which do nothing where the channel
+  // doesn't have that unit.
+  template <typename... Channels>
+  void tick(Channels&... channels) {
+    switch (step_) {
+      case 0:
+      case 4:
+        (channels.tick_length(), ...);
+        break;
+      case 2:
+      case 6:
+        (channels.tick_length(), ...);
+        (channels.tick_sweep(), ...);
+        break;
+      case 7:
+        (channels.tick_envelope(), ...);
+        break;
     }
+    step_ = (step_ + 1) % 8;
   }
-  void add_sweep(Sweep* sweep);
+
+  void reset();
+
+  bool next_step_is_length_counter() const;
 
 private:
-  template <typename T>
-  void run_step(const T& v);
   uint8_t step_ = 0;
-
-  StackVector<LengthTimer*, 3> length_counters_;
-  StackVector<LengthTimerChannel3*, 1> length_counter_channel_3_;
-  StackVector<Envelope*, 3> envelopes_;
-  StackVector<Sweep*, 1> sweeps_;
 };
@@ -1,16 +1,38 @@
 #include "mixer.h"
+#include <array>
 #include "audio_constants.h"
 
+namespace {
+constexpr int32_t SAMPLE_MAX = 32767;
+constexpr int32_t MAX_CHANNEL_SUM = 60;  // Four channels at 15
+
+// Gain for each NR50 volume: volume / 7 of SAMPLE_MAX / MAX_CHANNEL_SUM, so four channels at 15 and full
+// volume come out at SAMPLE_MAX
+constexpr std::array<int32_t, 8> FIXED_GAINS = [] {
+  std::array<int32_t, 8> gains{};
+  for (int32_t volume = 0; volume < 8; volume++) {
+    const int32_t divisor = 7 * MAX_CHANNEL_SUM;
+    gains[volume] = (volume * (SAMPLE_MAX << Mixer::FIXED_GAIN_BITS) + divisor / 2) / divisor;
+  }
+  return gains;
+}();
+}  // namespace
+
 Mixer::Mixer(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers)
-    : channel1_(frame_sequencer, audio_registers),
+    : frame_sequencer_(frame_sequencer),
+      channel1_(frame_sequencer, audio_registers),
       channel2_(frame_sequencer, audio_registers),
       channel3_(frame_sequencer, audio_registers),
-      channel4_(frame_sequencer, audio_registers) {}
+      channel4_(frame_sequencer, audio_registers),
+      left_gain_(FIXED_GAINS[7]),
+      right_gain_(FIXED_GAINS[7]) {}
 
 void Mixer::audio_register_write(uint16_t address, uint8_t value) {
   if (address == NR24_ADDR) {                                      // NR50 - Master Volume
     left_volume_ = static_cast<float>((value >> 4) & 0x7) / 7.0f;  // Bits 6-4
     right_volume_ = static_cast<float>(value & 0x7) / 7.0f;        // Bits 2-0
+    left_gain_ = FIXED_GAINS[(value >> 4) & 0x7];
+    right_gain_ = FIXED_GAINS[value & 0x7];
   }
 
   channel1_.audio_register_write(address, value);
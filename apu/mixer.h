@@ -1,5 +1,7 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <utility>
 #include "channel_traits.h"
@@ -12,17 +14,28 @@ class AudioRegisters;
 
 class Mixer {
 public:
+  static constexpr uint32_t FIXED_GAIN_BITS = 8;  // Fraction bits of the fixed_output() volume gains
+  static constexpr int32_t STEM_GAIN = 32767 / 15;  // A channel's level at 15 is a full scale stem
+
   Mixer(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers);
 
   void audio_register_write(uint16_t address, uint8_t value);
   void master_enable();
   const WaveChannel& channel3() const;
 
+  // Steps the frame sequencer over the four channels
+  void tick_frame_sequencer() { frame_sequencer_.tick(channel1_, channel2_, channel3_, channel4_); }
+
+  // Bit n set mutes channel n + 1. Muted channels are left out of the mix without their outputs being
+  // evaluated, and their steps don't count as changes to it, but they run exactly as usual otherwise.
+  void set_mute_mask(uint8_t mute_mask) { mute_mask_ = mute_mask & ALL_CHANNELS; }
+  uint8_t mute_mask() const { return mute_mask_; }
+
   std::pair<float, float> output() const {
-    const auto [left1, right1] = channel1_.output();
-    const auto [left2, right2] = channel2_.output();
-    const auto [left3, right3] = channel3_.output();
-    const auto [left4, right4] = channel4_.output();
+    const auto [left1, right1] = muted(0) ? std::pair<float, float>{} : channel1_.output();
+    const auto [left2, right2] = muted(1) ? std::pair<float, float>{} : channel2_.output();
+    const auto [left3, right3] = muted(2) ? std::pair<float, float>{} : channel3_.output();
+    const auto [left4, right4] = muted(3) ? std::pair<float, float>{} : channel4_.output();
 
     const float left = (left1 + left2 + left3 + left4) * left_volume_;
     const float right = (right1 + right2 + right3 + right4) * right_volume_;
@@ -30,14 +43,66 @@ public:
     return {left, right};
   }
 
-  [[gnu::always_inline]] void tick(uint32_t apu_clock) {
-    channel1_.tick(apu_clock);
-    channel2_.tick(apu_clock);
-    channel3_.tick(apu_clock);
-    channel4_.tick(apu_clock);
+  // output() in fixed point, scaled to int16_t. The sum of the channels' fixed outputs, -60 to 60, is
+  // multiplied by a per-volume gain that maps full volume to 32767, so nothing here depends on floats.
+  std::pair<int32_t, int32_t> fixed_output() const {
+    const auto [left1, right1] = muted(0) ? std::pair<int32_t, int32_t>{} : channel1_.fixed_output();
+    const auto [left2, right2] = muted(1) ? std::pair<int32_t, int32_t>{} : channel2_.fixed_output();
+    const auto [left3, right3] = muted(2) ? std::pair<int32_t, int32_t>{} : channel3_.fixed_output();
+    const auto [left4, right4] = muted(3) ? std::pair<int32_t, int32_t>{} : channel4_.fixed_output();
+
+    const int32_t left = ((left1 + left2 + left3 + left4) * left_gain_) >> FIXED_GAIN_BITS;
+    const int32_t right = ((right1 + right2 + right3 + right4) * right_gain_) >> FIXED_GAIN_BITS;
+
+    return {left, right};
+  }
+
+  // Each channel's level before panning and volume, scaled to int16_t. Muted channels are silent.
+  std::array<int32_t, 4> stem_levels() const {
+    return {(muted(0) ? 0 : channel1_.fixed_level()) * STEM_GAIN,
+            (muted(1) ? 0 : channel2_.fixed_level()) * STEM_GAIN,
+            (muted(2) ? 0 : channel3_.fixed_level()) * STEM_GAIN,
+            (muted(3) ? 0 : channel4_.fixed_level()) * STEM_GAIN};
+  }
+
+  // Returns true if output() may have changed
+  [[gnu::always_inline]] bool tick(uint32_t apu_clock) {
+    const bool changed1 = channel1_.tick(apu_clock);
+    const bool changed2 = channel2_.tick(apu_clock);
+    const bool changed3 = channel3_.tick(apu_clock);
+    const bool changed4 = channel4_.tick(apu_clock);
+    return audible_changes(changed1, changed2, changed3, changed4);
+  }
+
+  // Ticks until tick() could next return true
+  uint32_t ticks_until_change() const {
+    return std::min({channel1_.ticks_until_change(), channel2_.ticks_until_change(),
+                     channel3_.ticks_until_change(), channel4_.ticks_until_change()});
+  }
+
+  // Same as calling tick() `ticks` times, the last with `apu_clock`, as long as `ticks` is no more than
+  // ticks_until_change(). Returns what the last tick() would have.
+  bool advance(uint32_t ticks, uint32_t apu_clock) {
+    const bool changed1 = channel1_.advance(ticks, apu_clock);
+    const bool changed2 = channel2_.advance(ticks, apu_clock);
+    const bool changed3 = channel3_.advance(ticks, apu_clock);
+    const bool changed4 = channel4_.advance(ticks, apu_clock);
+    return audible_changes(changed1, changed2, changed3, changed4);
   }
 
 private:
+  static constexpr uint8_t ALL_CHANNELS = 0x0F;
+
+  [[gnu::always_inline]] bool muted(uint8_t index) const { return mute_mask_ & (1 << index); }
+
+  // Whether any unmuted channel changed
+  [[gnu::always_inline]] bool audible_changes(bool changed1, bool changed2, bool changed3,
+                                              bool changed4) const {
+    const uint8_t changed = changed1 | changed2 << 1 | changed3 << 2 | changed4 << 3;
+    return (changed & ~mute_mask_) != 0;
+  }
+
+  FrameSequencer& frame_sequencer_;
   SquareWaveChannel<Channel1Traits> channel1_;
   SquareWaveChannel<Channel2Traits> channel2_;
   WaveChannel channel3_;
@@ -45,4 +110,7 @@ private:
 
   float left_volume_ = 1.0f;   // NR50 bits 6-4
   float right_volume_ = 1.0f;  // NR50 bits 2-0
+  int32_t left_gain_;          // left_volume_ for fixed_output(), see FIXED_GAINS
+  int32_t right_gain_;
+  uint8_t mute_mask_ = 0;
 };
\ No newline at end of file
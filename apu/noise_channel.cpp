@@ -11,8 +11,8 @@ void NoiseChannel::audio_register_write(uint16_t address, uint8_t value) {
     case NR25_ADDR: {
       bool left_enabled = (value & 0x08) != 0;
       bool right_enabled = (value & 0x80) != 0;
-      left_enabled_ = static_cast<float>(left_enabled) * PANNING_MULTIPLIER;
-      right_enabled_ = static_cast<float>(right_enabled) * PANNING_MULTIPLIER;
+      left_enabled_ = left_enabled;
+      right_enabled_ = right_enabled;
     } break;
     case NR20_ADDR:
       length_timer_.set_length(value & LENGTH_COUNTER_MASK);
@@ -3,24 +3,11 @@
 #include "audio_registers.h"
 #include "channel_traits.h"
 #include "frame_sequencer.h"
-#include "length_timer.h"
 
 template <typename Traits>
 SquareWaveChannel<Traits>::SquareWaveChannel(FrameSequencer& frame_sequencer, AudioRegisters& audio_registers)
     : ChannelBase<SquareWaveChannel<Traits>, Traits>(frame_sequencer, audio_registers),
-      sweep_(audio_registers) {
-
-  if constexpr (Traits::HAS_SWEEP) {
-    frame_sequencer.add_sweep(&sweep_);
-    // Set up callback for sweep overflow to disable channel
-    sweep_.set_overflow_callback([this]() { disable_channel(); });
-    // Set up callback for frequency updates to update DAC directly
-    sweep_.set_frequency_update_callback([this](uint16_t frequency) {
-      dac_.set_frequency_low(frequency & 0xFF);
-      dac_.set_frequency_high((frequency >> 8) & 0x07);
-    });
-  }
-}
+      sweep_(audio_registers, *this) {}
 
 template <typename Traits>
 void SquareWaveChannel<Traits>::audio_register_write(uint16_t address, uint8_t value) {
@@ -69,8 +56,8 @@ void SquareWaveChannel<Traits>::audio_register_write(uint16_t address, uint8_t v
     case NR25_ADDR: {
       bool left_enabled = (value >> Traits::PANNING_LEFT_BIT) & 1;
       bool right_enabled = (value >> Traits::PANNING_RIGHT_BIT) & 1;
-      left_enabled_ = static_cast<float>(left_enabled) * PANNING_MULTIPLIER;
-      right_enabled_ = static_cast<float>(right_enabled) * PANNING_MULTIPLIER;
+      left_enabled_ = left_enabled;
+      right_enabled_ = right_enabled;
     } break;
   }
 }
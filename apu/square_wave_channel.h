@@ -15,7 +15,23 @@ public:
 
   void audio_register_write(uint16_t address, uint8_t value);
 
+  // Frame sequencer clock, hides ChannelBase's as only channel 1 sweeps
+  void tick_sweep() {
+    if constexpr (Traits::HAS_SWEEP) {
+      sweep_.tick();
+    }
+  }
+
 private:
+  friend class Sweep<SquareWaveChannel>;
+
+  // Called by the sweep
+  void sweep_overflow() { disable_channel(); }
+  void sweep_frequency_update(uint16_t frequency) {
+    dac_.set_frequency_low(frequency & 0xFF);
+    dac_.set_frequency_high((frequency >> 8) & 0x07);
+  }
+
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::disable_channel;
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::enable_channel;
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::audio_registers_;
@@ -25,5 +41,5 @@ private:
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::length_timer_;
   using ChannelBase<SquareWaveChannel<Traits>, Traits>::dac_;
 
-  Sweep sweep_;
+  Sweep<SquareWaveChannel> sweep_;
 };
@@ -41,8 +41,8 @@ void WaveChannel::audio_register_write(uint16_t address, uint8_t value) {
     case NR25_ADDR: {
       const bool left_enabled = (value >> 6) & 1;
       const bool right_enabled = (value >> 2) & 1;
-      left_enabled_ = static_cast<float>(left_enabled) * PANNING_MULTIPLIER;
-      right_enabled_ = static_cast<float>(right_enabled) * PANNING_MULTIPLIER;
+      left_enabled_ = left_enabled;
+      right_enabled_ = right_enabled;
     } break;
   }
 }
@@ -1,6 +1,8 @@
 #pragma once
 
+template <typename Bridge>
 class PPU;
+struct BusPPUBridge;
 class APU;
 class Timer;
 class HardwareRegisters;
@@ -11,7 +13,10 @@ template <typename Bus>
 class CPU;
 
 struct Bus {
-  PPU* ppu_;
+  using PPUType = PPU<BusPPUBridge>;
+  static constexpr bool HAS_PPU = true;
+
+  PPUType* ppu_;
   APU* apu_;
   CPU<Bus>* cpu_;
   Timer* timer_;
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "OSBridge.h"
+#include "bus.h"
+#include "cpu.h"
+#include "pixel_conversion.h"
+
+// The PPU's bridge in the full emulator. Unlike PPUBridge it calls straight into the CPU, so the calls the PPU
+// makes every m-cycle (STAT interrupts, the halt check, OAM DMA reads) inline into PPU::tick. Only the once a
+// frame calls go through the frontend's std::functions.
+struct BusPPUBridge {
+  CPU<Bus>* cpu_;
+  const OSBridge* os_bridge_;
+
+  void trigger_vblank_interrupt() { cpu_->hardware_registers().trigger_vblank_interrupt(); }
+  void trigger_lcd_stat_interrupt() { cpu_->hardware_registers().trigger_lcd_stat_interrupt(); }
+  void blit_screen(const void* pixels, size_t pitch) const { os_bridge_->blit_screen(pixels, pitch); }
+  bool is_halted() const { return cpu_->is_halted(); }
+  const uint8_t* read_memory(uint16_t address) { return cpu_->memory_bridge().read(address); }
+
+  FrameDestination acquire_frame() const {
+    return os_bridge_->acquire_frame ? os_bridge_->acquire_frame() : FrameDestination{};
+  }
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <utility>
+#include "spsc_ring_buffer.h"
+
+// A writer thread fed fixed-size blocks through a lock-free queue, so the emulation thread never waits on the
+// disk. CaptureSink, StemWriter and VGMRecorder each copy what they record into blocks and write them out
+// through one of these.
+//
+// If the writer falls so far behind that the queue fills, the recording fails: push() refuses the block,
+// the owner calls fail() and stops accepting anything, failed() is set and the error is printed. Everything
+// queued before that is still written.
+template <typename Block, size_t QUEUE_SIZE>
+class BlockWriter {
+public:
+  using WriteBlock = std::function<void(const Block& block)>;
+
+  // `name` starts the error, e.g. "VGM log". write_block and finish are called on the writer thread: each
+  // block in the order it was pushed, then finish once everything pushed before the destructor is written.
+  BlockWriter(std::string name, WriteBlock write_block, std::function<void()> finish)
+      : name_(std::move(name)), write_block_(std::move(write_block)), finish_(std::move(finish)) {}
+
+  // Writes out everything pushed and calls finish. Declare the writer after whatever write_block and finish
+  // use, so it is destroyed first.
+  ~BlockWriter() {
+    if (thread_.joinable()) {
+      running_.store(false, std::memory_order_release);
+      wake();
+      thread_.join();
+    }
+  }
+
+  BlockWriter(const BlockWriter&) = delete;
+  BlockWriter& operator=(const BlockWriter&) = delete;
+
+  // Starts the writer thread, once the owner has set up everything it writes to
+  void start() { thread_ = std::thread(&BlockWriter::run, this); }
+
+  // Emulation thread side. Queues a copy of `block`, returning false if the queue is full. The writer only
+  // looks for blocks once woken, so a batch can be pushed and handed over in one go.
+  bool push(const Block& block) { return blocks_.push(block); }
+  void wake() {
+    wakeups_.fetch_add(1, std::memory_order_release);
+    wakeups_.notify_one();
+  }
+
+  void fail(const std::string& reason) {
+    error_ = name_ + " stopped, the writer fell behind: " + reason;
+    std::cerr << error_ << std::endl;
+    failed_.store(true, std::memory_order_release);
+  }
+
+  bool failed() const { return failed_.load(std::memory_order_acquire); }
+  const std::string& error() const { return error_; }
+
+private:
+  void run() {
+    while (running_.load(std::memory_order_acquire)) {
+      // Read this before checking for blocks so a wake up between the check and the wait isn't lost
+      const uint32_t wakeups = wakeups_.load(std::memory_order_acquire);
+      if (!write_pending()) {
+        wakeups_.wait(wakeups, std::memory_order_acquire);
+      }
+    }
+
+    // Everything pushed before the destructor is written out
+    while (write_pending()) {
+    }
+    finish_();
+  }
+
+  bool write_pending() {
+    bool wrote = false;
+    Block block;
+    while (blocks_.pop(block)) {
+      write_block_(block);
+      wrote = true;
+    }
+    return wrote;
+  }
+
+  // Shared
+  SPSCRingBuffer<Block, QUEUE_SIZE> blocks_;
+  std::atomic<uint32_t> wakeups_{0};
+  std::atomic<bool> running_{true};
+  std::atomic<bool> failed_{false};
+
+  // Owned by the emulation thread
+  const std::string name_;
+  std::string error_;
+
+  // Owned by the writer
+  WriteBlock write_block_;
+  std::function<void()> finish_;
+
+  std::thread thread_;
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <inttypes.h>
+
+// Frame size, the Game Boy's screen
+constexpr uint32_t CAPTURE_WIDTH = 160;
+constexpr uint32_t CAPTURE_HEIGHT = 144;
+constexpr uint32_t CAPTURE_PIXELS = CAPTURE_WIDTH * CAPTURE_HEIGHT;
+
+// Emulated time. One frame is 70224 t-cycles, so the video runs at 1048576 / 17556 (~59.73) fps.
+constexpr uint64_t CAPTURE_M_CYCLES_PER_SECOND = 1048576;
+constexpr uint64_t CAPTURE_M_CYCLES_PER_FRAME = 17556;
+
+// Queue sizes (powers of two). 128 frames and 4096 audio blocks are each a couple of seconds of emulation.
+constexpr size_t CAPTURE_FRAME_POOL_SIZE = 128;
+constexpr size_t CAPTURE_FRAME_QUEUE_SIZE = 256;  // Frames and repeats of the previous frame
+constexpr size_t CAPTURE_AUDIO_QUEUE_SIZE = 4096;
+constexpr size_t CAPTURE_AUDIO_BLOCK_SAMPLES = 128;  // int16 values, the APU hands over at most this many at once
+// VGM register logs. A register write is 3 bytes, so the writer can fall about 90000 writes (minutes of
+// music) behind before the queue fills.
+constexpr size_t CAPTURE_VGM_QUEUE_SIZE = 64;
+constexpr size_t CAPTURE_VGM_BLOCK_BYTES = 4096;
+// Per-channel stems, queued as they come from the APU, at most 64 frames of 4 channels at once. 2048 blocks
+// are a couple of seconds of emulation.
+constexpr size_t CAPTURE_STEM_QUEUE_SIZE = 2048;
+constexpr size_t CAPTURE_STEM_BLOCK_FRAMES = 64;
+constexpr uint16_t CAPTURE_STEM_CHANNELS = 4;
+
+// Audio format
+constexpr uint16_t CAPTURE_AUDIO_CHANNELS = 2;
+constexpr uint16_t CAPTURE_AUDIO_BITS_PER_SAMPLE = 16;
@@ -0,0 +1,130 @@
+#include "capture_sink.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace {
+constexpr uint64_t FRAME_RATE_GCD = std::gcd(CAPTURE_M_CYCLES_PER_SECOND, CAPTURE_M_CYCLES_PER_FRAME);
+}  // namespace
+
+CaptureSink::CaptureSink(const CaptureSettings& settings)
+    : frame_pool_(std::make_unique<std::array<std::array<uint32_t, CAPTURE_PIXELS>, CAPTURE_FRAME_POOL_SIZE>>()),
+      video_(settings.video_path, settings.video_format, CAPTURE_WIDTH, CAPTURE_HEIGHT,
+             CAPTURE_M_CYCLES_PER_SECOND / FRAME_RATE_GCD, CAPTURE_M_CYCLES_PER_FRAME / FRAME_RATE_GCD),
+      video_writer_("Capture", [this](const FrameRecord& record) { write_frame(record); },
+                    [this] { finish_video(); }),
+      audio_writer_("Capture", [this](const AudioBlock& block) { write_audio(block); },
+                    [this] { finish_audio(); }) {
+  if (!settings.audio_path.empty()) {
+    wav_ = std::make_unique<WAVWriter>(settings.audio_path, settings.audio_sample_rate, CAPTURE_AUDIO_CHANNELS);
+  }
+  for (uint16_t i = 0; i < CAPTURE_FRAME_POOL_SIZE; i++) {
+    free_frames_.push(i);
+  }
+
+  video_writer_.start();
+  if (wav_) {
+    audio_writer_.start();
+  }
+}
+
+CaptureSink::~CaptureSink() = default;
+
+void CaptureSink::push_frame(const uint32_t* pixels, size_t pitch, uint64_t m_cycle, uint64_t hash) {
+  if (failed()) {
+    return;
+  }
+  if (hash != 0 && hash == last_hash_) {
+    push_repeat(m_cycle);
+    return;
+  }
+
+  uint16_t index;
+  if (!free_frames_.pop(index)) {
+    video_writer_.fail("all " + std::to_string(CAPTURE_FRAME_POOL_SIZE) +
+                       " queued frames are waiting to be written");
+    return;
+  }
+  uint32_t* frame = (*frame_pool_)[index].data();
+  for (uint32_t y = 0; y < CAPTURE_HEIGHT; y++) {
+    std::memcpy(frame + (y * CAPTURE_WIDTH), reinterpret_cast<const uint8_t*>(pixels) + (y * pitch),
+                CAPTURE_WIDTH * sizeof(uint32_t));
+  }
+  if (!video_writer_.push({m_cycle, index})) {
+    video_writer_.fail("the frame queue is full");
+    return;
+  }
+  last_hash_ = hash;
+  video_writer_.wake();
+}
+
+void CaptureSink::push_repeat(uint64_t m_cycle) {
+  if (failed()) {
+    return;
+  }
+  if (!video_writer_.push({m_cycle, REPEAT_FRAME})) {
+    video_writer_.fail("the frame queue is full");
+    return;
+  }
+  video_writer_.wake();
+}
+
+void CaptureSink::push_audio(const int16_t* samples, size_t count) {
+  if (failed() || !wav_) {
+    return;
+  }
+  AudioBlock block;
+  while (count > 0) {
+    block.count = static_cast<uint16_t>(std::min(count, CAPTURE_AUDIO_BLOCK_SAMPLES));
+    std::memcpy(block.samples.data(), samples, block.count * sizeof(int16_t));
+    if (!audio_writer_.push(block)) {
+      audio_writer_.fail("the audio queue is full");
+      return;
+    }
+    samples += block.count;
+    count -= block.count;
+  }
+  audio_writer_.wake();
+}
+
+void CaptureSink::finish(uint64_t m_cycle) {
+  push_repeat(m_cycle);
+}
+
+void CaptureSink::write_audio(const AudioBlock& block) {
+  wav_->write_samples(block.samples.data(), block.count);
+}
+
+void CaptureSink::finish_video() {
+  if (!video_.good()) {
+    std::cerr << "Capture: writing the video to disk failed, the file is incomplete" << std::endl;
+  }
+}
+
+void CaptureSink::finish_audio() {
+  wav_->finish();
+  if (!wav_->good()) {
+    std::cerr << "Capture: writing the audio to disk failed, the file is incomplete" << std::endl;
+  }
+}
+
+// Frame n covers m-cycles [n, n + 1) * CAPTURE_M_CYCLES_PER_FRAME, and any slots skipped over repeat the frame
+// before. Frames always finish at least a frame apart, but if one does land in a slot that has already been
+// written it is still written rather than dropped.
+void CaptureSink::write_frame(const FrameRecord& record) {
+  const uint64_t slot = record.m_cycle / CAPTURE_M_CYCLES_PER_FRAME;
+  while (video_.frames_written() < slot) {
+    video_.repeat_frame();
+    frames_repeated_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  if (record.pool_index != REPEAT_FRAME) {
+    video_.write_frame((*frame_pool_)[record.pool_index].data());
+    free_frames_.push(record.pool_index);
+  } else if (video_.frames_written() == slot) {
+    video_.repeat_frame();
+    frames_repeated_.fetch_add(1, std::memory_order_relaxed);
+  }
+  frames_written_.store(video_.frames_written(), std::memory_order_relaxed);
+}
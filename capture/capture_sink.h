@@ -0,0 +1,90 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "block_writer.h"
+#include "capture_constants.h"
+#include "spsc_ring_buffer.h"
+#include "video_writer.h"
+#include "wav_writer.h"
+
+struct CaptureSettings {
+  std::string video_path;
+  std::string audio_path;  // Empty for video only
+  CaptureVideoFormat video_format = CaptureVideoFormat::Y4M;
+  uint32_t audio_sample_rate = 0;
+};
+
+// Records frames and audio to disk without ever blocking the emulation thread. Frames are copied into a fixed
+// pool and audio into fixed blocks, and each is handed to a BlockWriter of its own.
+//
+// Frames are placed on the video timeline by the emulated m-cycle they finished on, not by wall time: a gap
+// (LCD off, skipped frames) is filled by repeating the previous frame, so the video always lines up with the
+// audio, which the APU produces at a fixed rate of emulated time.
+//
+// If a writer falls behind and its queue fills up, the capture fails: nothing more is accepted, failed() is
+// set and an error is printed. Everything queued before that is still written.
+class CaptureSink {
+public:
+  // Throws std::runtime_error if a file can't be opened
+  explicit CaptureSink(const CaptureSettings& settings);
+  ~CaptureSink();  // Writes out everything queued and finishes the files
+
+  CaptureSink(const CaptureSink&) = delete;
+  CaptureSink& operator=(const CaptureSink&) = delete;
+
+  // Emulation thread side. m_cycle counts from the start of the capture. A frame with the same non-zero hash
+  // as the previous one is recorded as a repeat, without copying or encoding it.
+  void push_frame(const uint32_t* pixels, size_t pitch, uint64_t m_cycle, uint64_t hash);
+  void push_repeat(uint64_t m_cycle);
+  void push_audio(const int16_t* samples, size_t count);
+
+  // Pads the video out to cover `m_cycle`, so it is as long as the audio. Call before destroying the sink.
+  void finish(uint64_t m_cycle);
+
+  bool failed() const { return video_writer_.failed() || audio_writer_.failed(); }
+  const std::string& error() const {
+    return video_writer_.failed() ? video_writer_.error() : audio_writer_.error();
+  }
+
+  // Writer side counters, approximate while capturing
+  uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+  uint64_t frames_repeated() const { return frames_repeated_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr uint16_t REPEAT_FRAME = UINT16_MAX;
+
+  struct FrameRecord {
+    uint64_t m_cycle = 0;
+    uint16_t pool_index = REPEAT_FRAME;
+  };
+
+  struct AudioBlock {
+    std::array<int16_t, CAPTURE_AUDIO_BLOCK_SAMPLES> samples;
+    uint16_t count = 0;
+  };
+
+  void write_frame(const FrameRecord& record);
+  void write_audio(const AudioBlock& block);
+  void finish_video();
+  void finish_audio();
+
+  // Shared
+  std::unique_ptr<std::array<std::array<uint32_t, CAPTURE_PIXELS>, CAPTURE_FRAME_POOL_SIZE>> frame_pool_;
+  SPSCRingBuffer<uint16_t, CAPTURE_FRAME_POOL_SIZE> free_frames_;  // Video writer -> emulation thread
+  std::atomic<uint64_t> frames_written_{0};
+  std::atomic<uint64_t> frames_repeated_{0};
+
+  // Owned by the emulation thread
+  uint64_t last_hash_ = 0;
+
+  // Owned by the writers
+  VideoWriter video_;
+  std::unique_ptr<WAVWriter> wav_;
+
+  BlockWriter<FrameRecord, CAPTURE_FRAME_QUEUE_SIZE> video_writer_;  // Frames and repeats
+  BlockWriter<AudioBlock, CAPTURE_AUDIO_QUEUE_SIZE> audio_writer_;
+};
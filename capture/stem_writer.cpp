@@ -0,0 +1,55 @@
+#include "stem_writer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StemWriter::StemWriter(const std::string& path_prefix, uint32_t sample_rate)
+    : writer_("Stem recording", [this](const Block& block) { write_block(block); }, [this] { finish(); }) {
+  for (uint16_t channel = 0; channel < CAPTURE_STEM_CHANNELS; channel++) {
+    const std::string path = path_prefix + "-ch" + std::to_string(channel + 1) + ".wav";
+    wavs_[channel] = std::make_unique<WAVWriter>(path, sample_rate, 1);
+  }
+  writer_.start();
+}
+
+StemWriter::~StemWriter() = default;
+
+void StemWriter::push(const int16_t* stems, size_t frames) {
+  if (failed()) {
+    return;
+  }
+  Block block;
+  while (frames > 0) {
+    block.frames = static_cast<uint16_t>(std::min(frames, CAPTURE_STEM_BLOCK_FRAMES));
+    std::memcpy(block.stems.data(), stems, block.frames * CAPTURE_STEM_CHANNELS * sizeof(int16_t));
+    if (!writer_.push(block)) {
+      writer_.fail("the stem queue is full");
+      return;
+    }
+    stems += block.frames * CAPTURE_STEM_CHANNELS;
+    frames -= block.frames;
+  }
+  writer_.wake();
+}
+
+void StemWriter::write_block(const Block& block) {
+  std::array<int16_t, CAPTURE_STEM_BLOCK_FRAMES> samples;
+  for (uint16_t channel = 0; channel < CAPTURE_STEM_CHANNELS; channel++) {
+    for (uint16_t frame = 0; frame < block.frames; frame++) {
+      samples[frame] = block.stems[frame * CAPTURE_STEM_CHANNELS + channel];
+    }
+    wavs_[channel]->write_samples(samples.data(), block.frames);
+  }
+  frames_written_.fetch_add(block.frames, std::memory_order_relaxed);
+}
+
+void StemWriter::finish() {
+  bool good = true;
+  for (std::unique_ptr<WAVWriter>& wav : wavs_) {
+    wav->finish();
+    good &= wav->good();
+  }
+  if (!good) {
+    std::cerr << "Stems: writing to disk failed, the files are incomplete" << std::endl;
+  }
+}
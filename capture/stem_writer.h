@@ -0,0 +1,51 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include "block_writer.h"
+#include "capture_constants.h"
+#include "wav_writer.h"
+
+// Records the APU's per-channel stems to a mono WAV per channel, <prefix>-ch1.wav to <prefix>-ch4.wav, for
+// comparing a single channel between builds or against another emulator.
+//
+// Stems are copied into fixed blocks on the emulation thread and handed to a BlockWriter, whose thread splits
+// them into the four files. If the writer falls behind and the queue fills, the recording fails like
+// CaptureSink: nothing more is accepted, failed() is set and an error is printed.
+class StemWriter {
+public:
+  // Throws std::runtime_error if a file can't be opened
+  StemWriter(const std::string& path_prefix, uint32_t sample_rate);
+  ~StemWriter();  // Writes out everything queued and finishes the files
+
+  StemWriter(const StemWriter&) = delete;
+  StemWriter& operator=(const StemWriter&) = delete;
+
+  // Emulation thread side. CAPTURE_STEM_CHANNELS values per frame, as APU::StemCallback hands them over.
+  void push(const int16_t* stems, size_t frames);
+
+  bool failed() const { return writer_.failed(); }
+  const std::string& error() const { return writer_.error(); }
+
+  // Writer side counter, approximate while recording
+  uint64_t frames_written() const { return frames_written_.load(std::memory_order_relaxed); }
+
+private:
+  struct Block {
+    std::array<int16_t, CAPTURE_STEM_BLOCK_FRAMES * CAPTURE_STEM_CHANNELS> stems;
+    uint16_t frames = 0;
+  };
+
+  void write_block(const Block& block);
+  void finish();
+
+  std::atomic<uint64_t> frames_written_{0};
+
+  // Owned by the writer
+  std::array<std::unique_ptr<WAVWriter>, CAPTURE_STEM_CHANNELS> wavs_;
+
+  BlockWriter<Block, CAPTURE_STEM_QUEUE_SIZE> writer_;
+};
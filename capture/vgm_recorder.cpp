@@ -0,0 +1,142 @@
+#include "vgm_recorder.h"
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+// Layout and commands from the VGM 1.61 specification
+namespace {
+constexpr uint64_t VGM_SAMPLE_RATE = 44100;
+constexpr uint32_t VGM_VERSION = 0x161;
+constexpr uint32_t VGM_HEADER_BYTES = 0x100;
+constexpr uint32_t VGM_EOF_OFFSET = 0x04;  // Header fields, by their offset
+constexpr uint32_t VGM_VERSION_OFFSET = 0x08;
+constexpr uint32_t VGM_TOTAL_SAMPLES_OFFSET = 0x18;
+constexpr uint32_t VGM_DATA_OFFSET = 0x34;  // Relative to itself
+constexpr uint32_t VGM_GB_DMG_CLOCK_OFFSET = 0x80;
+constexpr uint32_t GB_DMG_CLOCK = 4194304;
+
+constexpr uint8_t VGM_GB_DMG_WRITE = 0xB3;  // Register (from 0xFF10), value
+constexpr uint8_t VGM_WAIT = 0x61;          // 16-bit sample count
+constexpr uint8_t VGM_WAIT_60TH = 0x62;     // 735 samples
+constexpr uint8_t VGM_WAIT_50TH = 0x63;     // 882 samples
+constexpr uint8_t VGM_WAIT_SHORT = 0x70;    // 0x70 + n waits n + 1 samples, up to 16
+constexpr uint8_t VGM_END = 0x66;
+constexpr uint64_t VGM_WAIT_60TH_SAMPLES = 735;
+constexpr uint64_t VGM_WAIT_50TH_SAMPLES = 882;
+constexpr uint64_t VGM_WAIT_SHORT_MAX = 16;
+constexpr uint64_t VGM_WAIT_MAX = 0xFFFF;
+
+constexpr uint16_t VGM_FIRST_REGISTER = 0xFF10;
+constexpr uint16_t VGM_LAST_REGISTER = 0xFF3F;
+constexpr size_t VGM_LONGEST_COMMAND = 3;
+
+void put_u32(uint8_t* bytes, uint32_t value) {
+  for (uint32_t i = 0; i < 4; i++) {
+    bytes[i] = static_cast<uint8_t>(value >> (i * 8));
+  }
+}
+}  // namespace
+
+VGMRecorder::VGMRecorder(const std::string& path, uint32_t start_m_cycle)
+    : last_m_cycle_(start_m_cycle),
+      file_(path, std::ios::binary | std::ios::trunc),
+      writer_("VGM log", [this](const Block& block) { write_block(block); }, [this] { finish_file(); }) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open VGM file: " + path);
+  }
+  // The lengths are filled in at the end
+  write_header(0);
+  writer_.start();
+}
+
+// The writer is destroyed first, and writes out this last block
+VGMRecorder::~VGMRecorder() {
+  if (!failed() && block_.size > 0) {
+    push_block();
+  }
+}
+
+void VGMRecorder::write(uint32_t m_cycle, uint16_t address, uint8_t value) {
+  if (failed() || address < VGM_FIRST_REGISTER || address > VGM_LAST_REGISTER) {
+    return;
+  }
+  wait_until(m_cycle);
+  reserve(VGM_LONGEST_COMMAND);
+  block_.data[block_.size++] = VGM_GB_DMG_WRITE;
+  block_.data[block_.size++] = static_cast<uint8_t>(address - VGM_FIRST_REGISTER);
+  block_.data[block_.size++] = value;
+}
+
+void VGMRecorder::finish(uint32_t m_cycle) {
+  if (!failed()) {
+    wait_until(m_cycle);
+  }
+}
+
+// Waits from the last command to the sample m_cycle falls in, using the shortest commands that add up to it
+void VGMRecorder::wait_until(uint32_t m_cycle) {
+  m_cycles_ += static_cast<uint32_t>(m_cycle - last_m_cycle_);
+  last_m_cycle_ = m_cycle;
+
+  const uint64_t sample = m_cycles_ * VGM_SAMPLE_RATE / (GB_DMG_CLOCK / 4);
+  while (samples_ < sample && !failed()) {
+    const uint64_t wait = std::min(sample - samples_, VGM_WAIT_MAX);
+    reserve(VGM_LONGEST_COMMAND);
+    if (wait == VGM_WAIT_60TH_SAMPLES) {
+      block_.data[block_.size++] = VGM_WAIT_60TH;
+    } else if (wait == VGM_WAIT_50TH_SAMPLES) {
+      block_.data[block_.size++] = VGM_WAIT_50TH;
+    } else if (wait <= VGM_WAIT_SHORT_MAX) {
+      block_.data[block_.size++] = static_cast<uint8_t>(VGM_WAIT_SHORT + wait - 1);
+    } else {
+      block_.data[block_.size++] = VGM_WAIT;
+      block_.data[block_.size++] = static_cast<uint8_t>(wait);
+      block_.data[block_.size++] = static_cast<uint8_t>(wait >> 8);
+    }
+    samples_ += wait;
+  }
+}
+
+// Makes room in the current block for a command of `bytes`, handing the block to the writer if it's full
+void VGMRecorder::reserve(size_t bytes) {
+  if (block_.size + bytes > block_.data.size()) {
+    push_block();
+  }
+}
+
+void VGMRecorder::push_block() {
+  if (!writer_.push(block_)) {
+    writer_.fail("all " + std::to_string(CAPTURE_VGM_QUEUE_SIZE) +
+                 " queued blocks are waiting to be written");
+  }
+  block_.size = 0;
+  writer_.wake();
+}
+
+void VGMRecorder::write_block(const Block& block) {
+  file_.write(reinterpret_cast<const char*>(block.data.data()), block.size);
+  data_bytes_ += block.size;
+}
+
+// Once everything is written. samples_ is only read here, after the emulation thread has stopped.
+void VGMRecorder::finish_file() {
+  file_.put(static_cast<char>(VGM_END));
+  data_bytes_++;
+  file_.seekp(0);
+  write_header(static_cast<uint32_t>(samples_));
+  file_.flush();
+  if (!file_.good()) {
+    std::cerr << "VGM log: writing to disk failed, the file is incomplete" << std::endl;
+  }
+}
+
+void VGMRecorder::write_header(uint32_t total_samples) {
+  std::array<uint8_t, VGM_HEADER_BYTES> header{};
+  std::copy_n("Vgm ", 4, header.begin());
+  put_u32(&header[VGM_EOF_OFFSET], static_cast<uint32_t>(VGM_HEADER_BYTES + data_bytes_ - VGM_EOF_OFFSET));
+  put_u32(&header[VGM_VERSION_OFFSET], VGM_VERSION);
+  put_u32(&header[VGM_TOTAL_SAMPLES_OFFSET], total_samples);
+  put_u32(&header[VGM_DATA_OFFSET], VGM_HEADER_BYTES - VGM_DATA_OFFSET);
+  put_u32(&header[VGM_GB_DMG_CLOCK_OFFSET], GB_DMG_CLOCK);
+  file_.write(reinterpret_cast<const char*>(header.data()), header.size());
+}
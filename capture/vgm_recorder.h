@@ -0,0 +1,65 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include <fstream>
+#include <string>
+#include "audio_event_sink.h"
+#include "block_writer.h"
+#include "capture_constants.h"
+
+// Logs APU register writes to a VGM 1.61 file as Game Boy DMG commands, so a game's music can be played back,
+// analysed or diffed without recording any PCM.
+//
+// VGM times everything in samples at 44100 Hz. Each write is placed at the sample its m-cycle falls in,
+// counted from the start of the log, so writes less than a sample (~24 m-cycles) apart end up together but
+// the timing never drifts. Commands are encoded into fixed blocks on the emulation thread and handed to a
+// BlockWriter, so the emulation thread never touches the file. If the writer falls that far behind the queue
+// fills, and the log stops there and fails, like CaptureSink.
+class VGMRecorder : public AudioEventSink {
+public:
+  // Throws std::runtime_error if the file can't be opened. start_m_cycle is VGM time 0, on APU::apu_clock().
+  VGMRecorder(const std::string& path, uint32_t start_m_cycle);
+  ~VGMRecorder();  // Writes out everything logged and finishes the file
+
+  VGMRecorder(const VGMRecorder&) = delete;
+  VGMRecorder& operator=(const VGMRecorder&) = delete;
+
+  // Emulation thread side, as an event sink of the APU's. m_cycle is APU::apu_clock(), which may wrap.
+  // Addresses are 0xFF10 to 0xFF3F.
+  void write(uint32_t m_cycle, uint16_t address, uint8_t value) override;
+
+  // Waits out the log to `m_cycle`, so it is as long as the recording. Call before destroying the recorder.
+  void finish(uint32_t m_cycle);
+
+  bool failed() const { return writer_.failed(); }
+  const std::string& error() const { return writer_.error(); }
+
+  // Length of the log so far, in 44100 Hz samples
+  uint64_t samples() const { return samples_; }
+
+private:
+  struct Block {
+    std::array<uint8_t, CAPTURE_VGM_BLOCK_BYTES> data;
+    uint16_t size = 0;
+  };
+
+  void wait_until(uint32_t m_cycle);
+  void reserve(size_t bytes);
+  void push_block();
+  void write_block(const Block& block);
+  void finish_file();
+  void write_header(uint32_t total_samples);
+
+  // Owned by the emulation thread, until the destructor stops the writer
+  uint32_t last_m_cycle_;
+  uint64_t m_cycles_ = 0;  // Since the start of the log
+  uint64_t samples_ = 0;   // Waited so far
+  Block block_;
+
+  // Owned by the writer once it starts
+  std::ofstream file_;
+  uint64_t data_bytes_ = 0;
+
+  BlockWriter<Block, CAPTURE_VGM_QUEUE_SIZE> writer_;
+};
@@ -0,0 +1,78 @@
+#include "video_writer.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+constexpr char Y4M_FRAME_HEADER[] = "FRAME\n";
+constexpr uint32_t Y4M_PLANES = 3;
+constexpr uint32_t RGB_BYTES_PER_PIXEL = 3;
+
+// BT.601 full range, in 8.8 fixed point
+constexpr int32_t Y_R = 77, Y_G = 150, Y_B = 29;
+constexpr int32_t U_R = -43, U_G = -85, U_B = 128;
+constexpr int32_t V_R = 128, V_G = -107, V_B = -21;
+constexpr int32_t CHROMA_OFFSET = 128;
+constexpr int32_t ROUNDING = 128;
+
+uint8_t clamp_byte(int32_t value) {
+  return static_cast<uint8_t>(value < 0 ? 0 : (value > 255 ? 255 : value));
+}
+}  // namespace
+
+VideoWriter::VideoWriter(const std::string& path, CaptureVideoFormat format, uint32_t width, uint32_t height,
+                         uint64_t frame_rate_numerator, uint64_t frame_rate_denominator)
+    : file_(path, std::ios::binary | std::ios::trunc), format_(format), pixel_count_(width * height) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open capture video file: " + path);
+  }
+
+  if (format_ == CaptureVideoFormat::Y4M) {
+    file_ << "YUV4MPEG2 W" << width << " H" << height << " F" << frame_rate_numerator << ":"
+          << frame_rate_denominator << " Ip A1:1 C444 XCOLORRANGE=FULL\n";
+    encoded_.assign(pixel_count_ * Y4M_PLANES, 0);
+    // Black, so a repeat before the first frame is valid
+    std::fill(encoded_.begin() + pixel_count_, encoded_.end(), CHROMA_OFFSET);
+  } else {
+    encoded_.assign(pixel_count_ * RGB_BYTES_PER_PIXEL, 0);
+  }
+}
+
+void VideoWriter::write_frame(const uint32_t* pixels) {
+  if (format_ == CaptureVideoFormat::Y4M) {
+    encode_y4m(pixels);
+  } else {
+    encode_rgb(pixels);
+  }
+  repeat_frame();
+}
+
+void VideoWriter::repeat_frame() {
+  if (format_ == CaptureVideoFormat::Y4M) {
+    file_.write(Y4M_FRAME_HEADER, sizeof(Y4M_FRAME_HEADER) - 1);
+  }
+  file_.write(reinterpret_cast<const char*>(encoded_.data()), static_cast<std::streamsize>(encoded_.size()));
+  frames_written_++;
+}
+
+void VideoWriter::encode_y4m(const uint32_t* pixels) {
+  uint8_t* y_plane = encoded_.data();
+  uint8_t* u_plane = y_plane + pixel_count_;
+  uint8_t* v_plane = u_plane + pixel_count_;
+  for (uint32_t i = 0; i < pixel_count_; i++) {
+    const int32_t r = (pixels[i] >> 16) & 0xFF;
+    const int32_t g = (pixels[i] >> 8) & 0xFF;
+    const int32_t b = pixels[i] & 0xFF;
+    y_plane[i] = clamp_byte(((Y_R * r) + (Y_G * g) + (Y_B * b) + ROUNDING) >> 8);
+    u_plane[i] = clamp_byte((((U_R * r) + (U_G * g) + (U_B * b) + ROUNDING) >> 8) + CHROMA_OFFSET);
+    v_plane[i] = clamp_byte((((V_R * r) + (V_G * g) + (V_B * b) + ROUNDING) >> 8) + CHROMA_OFFSET);
+  }
+}
+
+void VideoWriter::encode_rgb(const uint32_t* pixels) {
+  uint8_t* out = encoded_.data();
+  for (uint32_t i = 0; i < pixel_count_; i++) {
+    *out++ = static_cast<uint8_t>(pixels[i] >> 16);
+    *out++ = static_cast<uint8_t>(pixels[i] >> 8);
+    *out++ = static_cast<uint8_t>(pixels[i]);
+  }
+}
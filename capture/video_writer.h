@@ -0,0 +1,33 @@
+#pragma once
+
+#include <inttypes.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+enum class CaptureVideoFormat : uint8_t {
+  Y4M,    // YUV4MPEG2, 4:4:4 full range, playable and encodable by ffmpeg/mpv directly
+  RawRGB  // Headerless RGB24 frames, e.g. ffmpeg -f rawvideo -pixel_format rgb24 -video_size 160x144
+};
+
+// Writes ARGB8888 frames as Y4M or raw RGB. An encoded frame is kept so repeats are written without encoding.
+class VideoWriter {
+public:
+  VideoWriter(const std::string& path, CaptureVideoFormat format, uint32_t width, uint32_t height,
+              uint64_t frame_rate_numerator, uint64_t frame_rate_denominator);
+
+  void write_frame(const uint32_t* pixels);
+  void repeat_frame();  // Writes the last frame again, or a black frame if there hasn't been one
+  uint64_t frames_written() const { return frames_written_; }
+  bool good() const { return file_.good(); }
+
+private:
+  void encode_y4m(const uint32_t* pixels);
+  void encode_rgb(const uint32_t* pixels);
+
+  std::ofstream file_;
+  CaptureVideoFormat format_;
+  uint32_t pixel_count_;
+  std::vector<uint8_t> encoded_;
+  uint64_t frames_written_ = 0;
+};
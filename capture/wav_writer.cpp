@@ -0,0 +1,73 @@
+#include "wav_writer.h"
+#include <stdexcept>
+#include "capture_constants.h"
+
+namespace {
+constexpr uint32_t WAV_HEADER_BYTES = 44;
+constexpr uint32_t WAV_FMT_CHUNK_BYTES = 16;
+constexpr uint16_t WAV_FORMAT_PCM = 1;
+constexpr uint64_t WAV_MAX_DATA_BYTES = 0xFFFFFFFF - WAV_HEADER_BYTES;
+
+void write_u16(std::ofstream& file, uint16_t value) {
+  const char bytes[] = {static_cast<char>(value), static_cast<char>(value >> 8)};
+  file.write(bytes, sizeof(bytes));
+}
+
+void write_u32(std::ofstream& file, uint32_t value) {
+  const char bytes[] = {static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16),
+                        static_cast<char>(value >> 24)};
+  file.write(bytes, sizeof(bytes));
+}
+}  // namespace
+
+WAVWriter::WAVWriter(const std::string& path, uint32_t sample_rate, uint16_t channels)
+    : file_(path, std::ios::binary | std::ios::trunc), sample_rate_(sample_rate), channels_(channels) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open capture audio file: " + path);
+  }
+  write_header();
+}
+
+WAVWriter::~WAVWriter() {
+  finish();
+}
+
+void WAVWriter::write_samples(const int16_t* samples, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    write_u16(file_, static_cast<uint16_t>(samples[i]));
+  }
+  samples_written_ += count;
+}
+
+void WAVWriter::finish() {
+  if (finished_) {
+    return;
+  }
+  finished_ = true;
+  file_.seekp(0);
+  write_header();
+  file_.flush();
+}
+
+// Sizes saturate rather than wrap past 4GB (about 6 hours), which players treat as "read to the end"
+void WAVWriter::write_header() {
+  const uint16_t bytes_per_sample = CAPTURE_AUDIO_BITS_PER_SAMPLE / 8;
+  uint64_t data_bytes = samples_written_ * bytes_per_sample;
+  if (data_bytes > WAV_MAX_DATA_BYTES) {
+    data_bytes = WAV_MAX_DATA_BYTES;
+  }
+
+  file_.write("RIFF", 4);
+  write_u32(file_, static_cast<uint32_t>(data_bytes + WAV_HEADER_BYTES - 8));
+  file_.write("WAVE", 4);
+  file_.write("fmt ", 4);
+  write_u32(file_, WAV_FMT_CHUNK_BYTES);
+  write_u16(file_, WAV_FORMAT_PCM);
+  write_u16(file_, channels_);
+  write_u32(file_, sample_rate_);
+  write_u32(file_, sample_rate_ * channels_ * bytes_per_sample);
+  write_u16(file_, static_cast<uint16_t>(channels_ * bytes_per_sample));
+  write_u16(file_, CAPTURE_AUDIO_BITS_PER_SAMPLE);
+  file_.write("data", 4);
+  write_u32(file_, static_cast<uint32_t>(data_bytes));
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <inttypes.h>
+#include <fstream>
+#include <string>
+
+// 16-bit PCM WAV. The sizes in the header are filled in by finish(), or the destructor.
+class WAVWriter {
+public:
+  WAVWriter(const std::string& path, uint32_t sample_rate, uint16_t channels);
+  ~WAVWriter();
+
+  void write_samples(const int16_t* samples, size_t count);  // count is in int16 values, not frames
+  void finish();
+  uint64_t samples_written() const { return samples_written_; }
+  bool good() const { return file_.good(); }
+
+private:
+  void write_header();
+
+  std::ofstream file_;
+  uint32_t sample_rate_;
+  uint16_t channels_;
+  uint64_t samples_written_ = 0;
+  bool finished_ = false;
+};
@@ -9,7 +9,7 @@ Timer::Timer(HardwareRegisters& registers) : registers_(registers) {
   update_div();
 }
 
-void Timer::tick() {
+bool Timer::tick() {
   tima_written_this_cycle_ = false;
   if (trigger_tima_next_cycle_) {
     trigger_tima();
@@ -22,13 +22,7 @@ void Timer::tick() {
   check_tima_trigger(internal_clock_ - 1);
 
   // APU FrameSequencer runs every 8192 t-cycles (2048 m-cycles)
-  if (bit_fallen(internal_clock_ - 1, internal_clock_, TimerConstants::APU_FRAME_SEQUENCER_BIT)) {
-    apu_callback_();
-  }
-}
-
-void Timer::set_apu_callback(const std::function<void()>& callback) {
-  apu_callback_ = callback;
+  return bit_fallen(internal_clock_ - 1, internal_clock_, TimerConstants::APU_FRAME_SEQUENCER_BIT);
 }
 
 void Timer::check_tima_trigger(uint16_t previous_internal_clock) {
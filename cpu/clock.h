@@ -2,7 +2,6 @@
 
 #include <inttypes.h>
 #include <array>
-#include <functional>
 #include "hardware_registers.h"
 
 class SaveStateSerializer;
@@ -19,7 +18,8 @@ constexpr uint8_t TAC_FREQUENCY_MASK = 0x03;      // Lower 2 bits select frequen
 class Timer {
 public:
   Timer(HardwareRegisters& registers);
-  void tick();
+  // Returns true when the APU's frame sequencer is due a tick
+  bool tick();
   void write_div();
 
   void write_tma(uint8_t value);
@@ -28,8 +28,6 @@ public:
 
   const uint8_t* get_div() const;
 
-  void set_apu_callback(const std::function<void()>& callback);
-
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
@@ -47,6 +45,4 @@ private:
   uint8_t div_ = 0;
   bool tima_written_this_cycle_ = false;
   bool trigger_tima_next_cycle_ = false;
-
-  std::function<void()> apu_callback_;
 };
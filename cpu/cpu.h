@@ -11,14 +11,13 @@
 #include "stack.h"
 
 class ROMLoader;
-class PPU;
 class APU;
 class SaveStateSerializer;
 
 template <typename Bus>
 class CPU {
 public:
-  CPU(ROMLoader& loader, PPU& ppu, APU& apu, Bus& bus);
+  CPU(ROMLoader& loader, typename Bus::PPUType& ppu, APU& apu, Bus& bus);
   void run_single_instruction();
 
   void tick();
@@ -32,6 +31,9 @@ public:
   void update_joypad_state(JoypadState& joypad_state);
   bool is_halted() const { return interrupts_.halt_state() == HALT; }
 
+  // M-cycles emulated since power on (not saved in save states)
+  uint64_t m_cycles() const { return m_cycles_; }
+
   // Accessors
   CPURegisters& registers() { return registers_; }
   MemoryController& mc() { return mc_; }
@@ -56,10 +58,11 @@ private:
   InterruptController<Bus> interrupts_;
   Stack<Bus> stack_;
   Joypad joypad_;
-  PPU& ppu_;
+  typename Bus::PPUType& ppu_;
   APU& apu_;
 
   FirstLevelMemoryBridge<Bus> memory_bridge_;
+  uint64_t m_cycles_ = 0;
 };
 
 #include "cpu.inc"
\ No newline at end of file
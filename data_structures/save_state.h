@@ -11,7 +11,10 @@
 class SaveStateSerializer;
 
 namespace {
-constexpr uint32_t SERIALIZER_VERSION = 1;
+constexpr uint32_t SERIALIZER_VERSION = 3;
+// Oldest save state that still loads. Version 1 states have no APU synthesis mode, and versions 1 and 2 no
+// pixel FIFO state.
+constexpr uint32_t MIN_SERIALIZER_VERSION = 1;
 
 template <typename T>
 concept IsNotPointer = !std::is_pointer_v<T>;
@@ -78,6 +81,11 @@ public:
   // Check if the serializer is in a valid state
   bool is_valid() const { return stream_.is_open() && stream_.good(); }
 
+  // Version of the state being read, for anything that has to load older states. Set it once read from the
+  // file. Defaults to SERIALIZER_VERSION.
+  uint32_t version() const { return version_; }
+  void set_version(uint32_t version) { version_ = version; }
+
   template <typename T>
   void print_index() {
     if (false)
@@ -195,4 +203,5 @@ public:
 private:
   std::fstream stream_;
   bool for_reading_;
+  uint32_t version_ = SERIALIZER_VERSION;
 };
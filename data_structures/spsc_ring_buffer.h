@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Lock-free single producer, single consumer ring buffer. push() must only be called from one thread and
+// pop() from one (other) thread. N must be a power of two.
+template <typename T, size_t N>
+class SPSCRingBuffer {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SPSCRingBuffer capacity must be a power of two");
+
+public:
+  // Returns false if the buffer is full
+  bool push(const T& value) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (head - cached_tail_ == N) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      if (head - cached_tail_ == N) {
+        return false;
+      }
+    }
+
+    data_[head & MASK] = value;
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Returns false if the buffer is empty
+  bool pop(T& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail == cached_head_) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      if (tail == cached_head_) {
+        return false;
+      }
+    }
+
+    value = data_[tail & MASK];
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Pushes as many of `count` values as fit. Returns how many that was.
+  size_t push(const T* values, size_t count) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (N - (head - cached_tail_) < count) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+    }
+    count = std::min(count, N - (head - cached_tail_));
+
+    const size_t start = head & MASK;
+    const size_t first = std::min(count, N - start);
+    std::copy(values, values + first, data_.begin() + start);
+    std::copy(values + first, values + count, data_.begin());
+    head_.store(head + count, std::memory_order_release);
+    return count;
+  }
+
+  // Pops up to `count` values into `values`. Returns how many there were.
+  size_t pop(T* values, size_t count) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (cached_head_ - tail < count) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+    }
+    count = std::min(count, cached_head_ - tail);
+
+    const size_t start = tail & MASK;
+    const size_t first = std::min(count, N - start);
+    std::copy(data_.begin() + start, data_.begin() + start + first, values);
+    std::copy(data_.begin(), data_.begin() + (count - first), values + first);
+    tail_.store(tail + count, std::memory_order_release);
+    return count;
+  }
+
+  // Approximate when called from a thread that is neither pushing nor popping
+  size_t size() const { return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire); }
+  bool empty() const { return size() == 0; }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  static constexpr size_t MASK = N - 1;
+
+  // Producer and consumer indices live on separate cache lines so the two threads don't fight over them
+  alignas(64) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;  // Producer's last view of tail_
+  alignas(64) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;  // Consumer's last view of head_
+  alignas(64) std::array<T, N> data_;
+};
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer for handing whole frames from one producer thread to one consumer thread. The
+// producer always has a buffer to write into, and the consumer always sees the newest complete one.
+template <typename T>
+class TripleBuffer {
+public:
+  // Producer side: the buffer being written, then publish() to hand it over
+  T& back() { return buffers_[back_]; }
+  void publish() { back_ = middle_.exchange(back_ | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK; }
+
+  // Consumer side: update() swaps in the newest published buffer, returning false if there wasn't one
+  bool update() {
+    if ((middle_.load(std::memory_order_relaxed) & FRESH_BIT) == 0) {
+      return false;
+    }
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & INDEX_MASK;
+    return true;
+  }
+  T& front() { return buffers_[front_]; }
+  const T& front() const { return buffers_[front_]; }
+
+  // Only safe while neither side is in use
+  std::array<T, 3>& buffers() { return buffers_; }
+
+private:
+  static constexpr uint8_t FRESH_BIT = 0x4;
+  static constexpr uint8_t INDEX_MASK = 0x3;
+
+  std::array<T, 3> buffers_;
+  uint8_t back_ = 0;
+  uint8_t front_ = 1;
+  alignas(64) std::atomic<uint8_t> middle_{2};
+};
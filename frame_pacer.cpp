@@ -0,0 +1,108 @@
+#include "frame_pacer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <thread>
+
+#if defined(__linux__) || defined(__FreeBSD__)
+#include <time.h>
+#define FRAME_PACER_CLOCK_NANOSLEEP
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+
+using namespace std::chrono;
+
+FramePacer::FramePacer(nanoseconds frame_duration, nanoseconds spin_margin)
+    : frame_duration_(frame_duration), spin_margin_(spin_margin) {
+#if defined(_WIN32)
+  // High resolution timers need Windows 10 1803, older versions get a normal one and wake up to a timer tick
+  // late, which the spin margin has to cover
+  timer_ = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+  if (!timer_) {
+    timer_ = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+  }
+#endif
+}
+
+FramePacer::~FramePacer() {
+#if defined(_WIN32)
+  if (timer_) {
+    CloseHandle(timer_);
+  }
+#endif
+}
+
+bool FramePacer::wait() {
+  const Clock::time_point start = Clock::now();
+  deadline_ += frame_duration_;
+  stats_.frames++;
+
+  if (start >= deadline_) {
+    deadline_ = start;
+    stats_.late_frames++;
+    last_release_on_time_ = false;
+    return true;
+  }
+
+  const Clock::time_point wake_time = deadline_ - spin_margin_;
+  if (start < wake_time) {
+    sleep_until(wake_time);
+  }
+  const Clock::time_point woke = Clock::now();
+  if (woke > deadline_) {
+    stats_.overslept_frames++;
+  }
+  while (Clock::now() < deadline_) {}
+  const Clock::time_point released = Clock::now();
+
+  stats_.waited += released - start;
+  stats_.spun += released - std::min(std::max(woke, start), released);
+  stats_.max_lateness = std::max(stats_.max_lateness, duration_cast<nanoseconds>(released - deadline_));
+  if (last_release_on_time_) {
+    const double error = static_cast<double>((released - last_release_ - frame_duration_).count());
+    interval_error_squares_ += error * error;
+    intervals_++;
+  }
+  last_release_ = released;
+  last_release_on_time_ = true;
+  return false;
+}
+
+void FramePacer::sleep_until(Clock::time_point time) {
+#if defined(FRAME_PACER_CLOCK_NANOSLEEP)
+  // steady_clock is CLOCK_MONOTONIC here, so its time points can be used as absolute deadlines directly
+  const nanoseconds since_epoch = time.time_since_epoch();
+  timespec deadline;
+  deadline.tv_sec = static_cast<time_t>(duration_cast<seconds>(since_epoch).count());
+  deadline.tv_nsec = static_cast<long>((since_epoch % seconds(1)).count());
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, nullptr) == EINTR) {}
+#elif defined(_WIN32)
+  const nanoseconds remaining = time - Clock::now();
+  if (!timer_ || remaining <= nanoseconds(0)) {
+    return;
+  }
+  LARGE_INTEGER due;
+  due.QuadPart = -static_cast<LONGLONG>(remaining.count() / 100);  // Relative, in 100 ns units
+  if (SetWaitableTimer(timer_, &due, 0, nullptr, nullptr, FALSE)) {
+    WaitForSingleObject(timer_, INFINITE);
+  }
+#else
+  std::this_thread::sleep_until(time);
+#endif
+}
+
+PacingStats FramePacer::take_stats() {
+  PacingStats stats = stats_;
+  if (intervals_ > 0) {
+    stats.jitter = nanoseconds(std::llround(std::sqrt(interval_error_squares_ / intervals_)));
+  }
+  stats_ = PacingStats();
+  interval_error_squares_ = 0.0;
+  intervals_ = 0;
+  return stats;
+}
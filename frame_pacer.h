@@ -0,0 +1,73 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// What the main loop paces frames against
+enum class PacingClock : uint8_t {
+  Wall,  // A fixed 59.73 Hz by the host's monotonic clock
+  Audio  // The audio device's clock: frames speed up or slow down (by at most 0.5%) to keep its buffer half
+         // full, and the APU stays at the device's rate
+};
+
+// How well frames were paced since the last FramePacer::take_stats()
+struct PacingStats {
+  uint32_t frames = 0;
+  uint32_t late_frames = 0;       // Reached wait() after their deadline, so weren't paced at all
+  uint32_t overslept_frames = 0;  // Woke from sleep after their deadline: the spin margin is too small
+  std::chrono::nanoseconds waited{0};        // Sleeping and spinning
+  std::chrono::nanoseconds spun{0};          // Spinning only
+  std::chrono::nanoseconds max_lateness{0};  // Furthest past its deadline a paced frame was released
+  std::chrono::nanoseconds jitter{0};        // RMS error of the time between releases, against frame_duration
+};
+
+// Holds each frame until its deadline. Deadlines are absolute, one frame duration apart, so errors don't
+// accumulate. It sleeps until spin_margin before the deadline and spins the rest, which keeps the release
+// time as precise as spinning the whole frame while leaving the core idle for almost all of it.
+//
+// Sleeps use clock_nanosleep() with absolute times where it's available, a high-resolution waitable timer on
+// Windows, and std::this_thread::sleep_until() elsewhere.
+class FramePacer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  // Covers the usual wake-up latency of a sleeping thread with room to spare
+  static constexpr std::chrono::nanoseconds DEFAULT_SPIN_MARGIN = std::chrono::microseconds(300);
+
+  explicit FramePacer(std::chrono::nanoseconds frame_duration,
+                      std::chrono::nanoseconds spin_margin = DEFAULT_SPIN_MARGIN);
+  ~FramePacer();
+  FramePacer(const FramePacer&) = delete;
+  FramePacer& operator=(const FramePacer&) = delete;
+
+  // Waits until the current frame's deadline. Returns true if it had already passed, in which case the next
+  // deadline is a frame from now rather than trying to catch up.
+  bool wait();
+
+  // Take effect from the next deadline. A margin of zero sleeps all the way to the deadline, and a margin of
+  // at least the frame duration spins the whole frame.
+  void set_frame_duration(std::chrono::nanoseconds frame_duration) { frame_duration_ = frame_duration; }
+  void set_spin_margin(std::chrono::nanoseconds spin_margin) { spin_margin_ = spin_margin; }
+  std::chrono::nanoseconds frame_duration() const { return frame_duration_; }
+  std::chrono::nanoseconds spin_margin() const { return spin_margin_; }
+
+  // Stats since the last call
+  PacingStats take_stats();
+
+private:
+  void sleep_until(Clock::time_point time);
+
+  std::chrono::nanoseconds frame_duration_;
+  std::chrono::nanoseconds spin_margin_;
+  Clock::time_point deadline_ = Clock::now();
+  Clock::time_point last_release_;
+  bool last_release_on_time_ = false;
+
+  PacingStats stats_;
+  double interval_error_squares_ = 0.0;  // Sum of squared interval errors in ns^2, for the jitter
+  uint32_t intervals_ = 0;
+
+#if defined(_WIN32)
+  void* timer_ = nullptr;
+#endif
+};
@@ -0,0 +1,28 @@
+#pragma once
+
+class APU;
+class Timer;
+class HardwareRegisters;
+class Joypad;
+class MemoryController;
+
+template <typename Bus>
+class CPU;
+
+// Takes the PPU's place in CPU<GBSBus>. There's nothing in it: the CPU never ticks it, and with HAS_PPU false
+// the memory map leaves VRAM, OAM and 0xFF40-0xFF6C (OAM DMA included) unmapped.
+struct NoPPU {};
+
+// The Bus for GBSPlayer, which only has the CPU, timer and APU
+struct GBSBus {
+  using PPUType = NoPPU;
+  static constexpr bool HAS_PPU = false;
+
+  PPUType* ppu_;
+  APU* apu_;
+  CPU<GBSBus>* cpu_;
+  Timer* timer_;
+  HardwareRegisters* hw_registers_;
+  MemoryController* memory_controller_;
+  Joypad* joypad_;
+};
@@ -0,0 +1,82 @@
+#include "gbs_file.h"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+constexpr char GBS_MAGIC[3] = {'G', 'B', 'S'};
+constexpr uint8_t GBS_VERSION = 1;
+constexpr size_t GBS_HEADER_SIZE = 0x70;
+constexpr size_t GBS_STRING_LENGTH = 32;
+
+// The driver's code starts after the interrupt vectors and the cartridge header, which the player fills in
+constexpr uint16_t MIN_LOAD_ADDRESS = 0x0400;
+constexpr uint16_t MAX_LOAD_ADDRESS = 0x7FFF;
+
+constexpr uint8_t TAC_TIMER_ENABLE = 0x04;
+constexpr uint8_t TAC_DOUBLE_SPEED = 0x80;
+
+uint16_t read_u16(const std::vector<uint8_t>& bytes, size_t offset) {
+  return bytes[offset] | (bytes[offset + 1] << 8);
+}
+
+std::string read_string(const std::vector<uint8_t>& bytes, size_t offset) {
+  const char* text = reinterpret_cast<const char*>(bytes.data() + offset);
+  return std::string(text, strnlen(text, GBS_STRING_LENGTH));
+}
+}  // namespace
+
+GBSFile::GBSFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open GBS file: " + path);
+  }
+  parse(std::vector<uint8_t>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>()));
+}
+
+GBSFile::GBSFile(std::vector<uint8_t> bytes) {
+  parse(bytes);
+}
+
+bool GBSFile::uses_timer() const {
+  return header_.timer_control & TAC_TIMER_ENABLE;
+}
+
+bool GBSFile::wants_double_speed() const {
+  return header_.timer_control & TAC_DOUBLE_SPEED;
+}
+
+void GBSFile::parse(const std::vector<uint8_t>& bytes) {
+  if (bytes.size() < GBS_HEADER_SIZE || std::memcmp(bytes.data(), GBS_MAGIC, sizeof(GBS_MAGIC)) != 0) {
+    throw std::runtime_error("Not a GBS file");
+  }
+
+  header_.version = bytes[0x03];
+  header_.song_count = bytes[0x04];
+  header_.first_song = bytes[0x05];
+  header_.load_address = read_u16(bytes, 0x06);
+  header_.init_address = read_u16(bytes, 0x08);
+  header_.play_address = read_u16(bytes, 0x0A);
+  header_.stack_pointer = read_u16(bytes, 0x0C);
+  header_.timer_modulo = bytes[0x0E];
+  header_.timer_control = bytes[0x0F];
+  header_.title = read_string(bytes, 0x10);
+  header_.author = read_string(bytes, 0x30);
+  header_.copyright = read_string(bytes, 0x50);
+
+  if (header_.version != GBS_VERSION) {
+    throw std::runtime_error("Unsupported GBS version " + std::to_string(header_.version));
+  }
+  if (header_.song_count == 0) {
+    throw std::runtime_error("GBS file has no songs");
+  }
+  if (header_.load_address < MIN_LOAD_ADDRESS || header_.load_address > MAX_LOAD_ADDRESS) {
+    throw std::runtime_error("GBS load address out of range: " + std::to_string(header_.load_address));
+  }
+  if (bytes.size() == GBS_HEADER_SIZE) {
+    throw std::runtime_error("GBS file has no code");
+  }
+
+  data_.assign(bytes.begin() + GBS_HEADER_SIZE, bytes.end());
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <inttypes.h>
+#include <string>
+#include <vector>
+
+// The 0x70 byte header at the start of a GBS file, with the addresses of the rip's driver
+struct GBSHeader {
+  uint8_t version;
+  uint8_t song_count;
+  uint8_t first_song;  // 1 based
+  uint16_t load_address;
+  uint16_t init_address;  // Called with the song number, 0 based, in A
+  uint16_t play_address;  // Called at the timer or VBlank rate, see uses_timer()
+  uint16_t stack_pointer;
+  uint8_t timer_modulo;
+  uint8_t timer_control;
+  std::string title;
+  std::string author;
+  std::string copyright;
+};
+
+// A GBS music rip: the sound driver and music data from a game, loaded at header().load_address, without the
+// rest of the game. Throws std::runtime_error if the file can't be read or isn't a GBS.
+class GBSFile {
+public:
+  explicit GBSFile(const std::string& path);
+  explicit GBSFile(std::vector<uint8_t> bytes);
+
+  const GBSHeader& header() const { return header_; }
+  const std::vector<uint8_t>& data() const { return data_; }
+
+  // PLAY runs off the timer interrupt, set up from timer_modulo/timer_control, rather than once per VBlank
+  bool uses_timer() const;
+  // Bit 7 of timer_control asks for CGB double speed, which this emulator doesn't have
+  bool wants_double_speed() const;
+
+private:
+  void parse(const std::vector<uint8_t>& bytes);
+
+  GBSHeader header_;
+  std::vector<uint8_t> data_;
+};
@@ -0,0 +1,149 @@
+#include "gbs_player.h"
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+#include "constants.h"
+#include "rom_header.h"
+
+namespace {
+constexpr uint64_t M_CYCLES_PER_FRAME = 17556;
+constexpr size_t ROM_BANK_SIZE = MemoryControllerConstants::ROM_BANK_SIZE;
+
+// Bank numbers written to 0x2000-0x3FFF only reach 32 banks on MBC1
+constexpr size_t MAX_ROM_BANKS = 32;
+constexpr uint8_t CART_TYPE_MBC1_RAM = 0x02;
+constexpr uint8_t RAM_SIZE_8KB = 0x02;
+constexpr uint8_t RAM_ENABLE_VALUE = 0x0A;
+constexpr uint8_t EMPTY_ROM = 0xFF;
+
+// Where the player's own code goes, between the interrupt vectors and the cartridge header
+constexpr uint16_t PLAY_HANDLER_ADDRESS = 0x0070;
+constexpr uint16_t ENTRY_ADDRESS = 0x0080;
+
+constexpr uint8_t TAC_WRITE_MASK = 0x07;
+
+// The opcodes the player's code is built from
+constexpr uint8_t OP_NOP = 0x00;
+constexpr uint8_t OP_LD_SP_NN = 0x31;
+constexpr uint8_t OP_LD_A_N = 0x3E;
+constexpr uint8_t OP_LD_NN_A = 0xEA;
+constexpr uint8_t OP_LDH_N_A = 0xE0;
+constexpr uint8_t OP_XOR_A = 0xAF;
+constexpr uint8_t OP_JP_NN = 0xC3;
+constexpr uint8_t OP_JR_N = 0x18;
+constexpr uint8_t OP_CALL_NN = 0xCD;
+constexpr uint8_t OP_RETI = 0xD9;
+constexpr uint8_t OP_PUSH_AF = 0xF5;
+constexpr uint8_t OP_PUSH_BC = 0xC5;
+constexpr uint8_t OP_PUSH_DE = 0xD5;
+constexpr uint8_t OP_PUSH_HL = 0xE5;
+constexpr uint8_t OP_POP_AF = 0xF1;
+constexpr uint8_t OP_POP_BC = 0xC1;
+constexpr uint8_t OP_POP_DE = 0xD1;
+constexpr uint8_t OP_POP_HL = 0xE1;
+constexpr uint8_t OP_DI = 0xF3;
+constexpr uint8_t OP_EI = 0xFB;
+constexpr uint8_t OP_HALT = 0x76;
+
+constexpr uint8_t low(uint16_t value) {
+  return static_cast<uint8_t>(value);
+}
+
+constexpr uint8_t high(uint16_t value) {
+  return static_cast<uint8_t>(value >> 8);
+}
+
+std::vector<unsigned char> build_rom_image(const GBSFile& file, uint8_t song) {
+  const GBSHeader& header = file.header();
+  if (song >= header.song_count) {
+    throw std::invalid_argument("GBS file has " + std::to_string(header.song_count) + " songs, no song " +
+                                std::to_string(song + 1));
+  }
+
+  const size_t end = header.load_address + file.data().size();
+  const size_t banks = std::max<size_t>(2, std::bit_ceil((end + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE));
+  if (banks > MAX_ROM_BANKS) {
+    throw std::runtime_error("GBS file is too big to play: " + std::to_string(end) + " bytes");
+  }
+
+  std::vector<unsigned char> image(banks * ROM_BANK_SIZE, EMPTY_ROM);
+  std::copy(file.data().begin(), file.data().end(), image.begin() + header.load_address);
+  const auto put = [&image](uint16_t address, std::initializer_list<uint8_t> code) {
+    std::copy(code.begin(), code.end(), image.begin() + address);
+  };
+
+  for (uint16_t rst = 0; rst < VBLANK_VECTOR; rst += 8) {
+    const uint16_t target = header.load_address + rst;
+    put(rst, {OP_JP_NN, low(target), high(target)});
+  }
+  put(VBLANK_VECTOR, {OP_JP_NN, low(PLAY_HANDLER_ADDRESS), high(PLAY_HANDLER_ADDRESS)});
+  put(LCD_STAT_VECTOR, {OP_RETI});
+  put(TIMER_VECTOR, {OP_JP_NN, low(PLAY_HANDLER_ADDRESS), high(PLAY_HANDLER_ADDRESS)});
+  put(SERIAL_VECTOR, {OP_RETI});
+  put(JOYPAD_VECTOR, {OP_RETI});
+
+  // PLAY is free to use every register
+  put(PLAY_HANDLER_ADDRESS, {OP_PUSH_AF, OP_PUSH_BC, OP_PUSH_DE, OP_PUSH_HL,
+                             OP_CALL_NN, low(header.play_address), high(header.play_address),
+                             OP_POP_HL, OP_POP_DE, OP_POP_BC, OP_POP_AF, OP_RETI});
+
+  const uint8_t interrupt = file.uses_timer() ? TIMER_INTERRUPT_FLAG : VBLANK_INTERRUPT_FLAG;
+  const uint8_t timer_control = header.timer_control & TAC_WRITE_MASK;
+  put(ENTRY_ADDRESS, {OP_DI,
+                      OP_LD_SP_NN, low(header.stack_pointer), high(header.stack_pointer),
+                      OP_LD_A_N, RAM_ENABLE_VALUE,
+                      OP_LD_NN_A, 0x00, 0x00,
+                      OP_LD_A_N, header.timer_modulo,
+                      OP_LDH_N_A, 0x06,  // TMA
+                      OP_LDH_N_A, 0x05,  // TIMA, so the first period is a whole one
+                      OP_LD_A_N, timer_control,
+                      OP_LDH_N_A, 0x07,  // TAC
+                      OP_LD_A_N, song,
+                      OP_CALL_NN, low(header.init_address), high(header.init_address),
+                      OP_LD_A_N, interrupt,
+                      OP_LDH_N_A, 0xFF,  // IE
+                      OP_XOR_A,
+                      OP_LDH_N_A, 0x0F,  // IF
+                      OP_EI,
+                      OP_HALT,
+                      OP_JR_N, 0xFD});  // Back to the HALT
+
+  ROMHeader cart_header{};
+  cart_header.entry_code[0] = OP_NOP;
+  cart_header.entry_code[1] = static_cast<char>(OP_JP_NN);
+  cart_header.entry_code[2] = low(ENTRY_ADDRESS);
+  cart_header.entry_code[3] = high(ENTRY_ADDRESS);
+  cart_header.cart_type = CART_TYPE_MBC1_RAM;
+  cart_header.rom_size = static_cast<char>(std::countr_zero(banks) - 1);
+  cart_header.ram_size = RAM_SIZE_8KB;
+  std::memcpy(image.data() + ROM_START, &cart_header, sizeof(cart_header));
+  return image;
+}
+}  // namespace
+
+GBSPlayer::GBSPlayer(const GBSFile& file, uint8_t song,
+                     std::function<void(const int16_t* samples, int num_samples)> sample_generated_callback)
+    : loader_(build_rom_image(file, song)),
+      apu_(std::move(sample_generated_callback)),
+      cpu_(loader_, no_ppu_, apu_, bus_),
+      raise_vblank_(!file.uses_timer()),
+      next_frame_m_cycle_(M_CYCLES_PER_FRAME) {}
+
+void GBSPlayer::run(uint64_t m_cycles) {
+  const uint64_t end = cpu_.m_cycles() + m_cycles;
+  while (cpu_.m_cycles() < end) {
+    cpu_.run_single_instruction();
+
+    if (cpu_.m_cycles() >= next_frame_m_cycle_) {
+      next_frame_m_cycle_ += M_CYCLES_PER_FRAME;
+      if (raise_vblank_) {
+        cpu_.hardware_registers().trigger_vblank_interrupt();
+      }
+      apu_.generate_samples();
+    }
+  }
+  apu_.generate_samples();
+}
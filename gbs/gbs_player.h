@@ -0,0 +1,39 @@
+#pragma once
+
+#include <inttypes.h>
+#include <functional>
+#include "apu.h"
+#include "cpu.h"
+#include "gbs_bus.h"
+#include "gbs_file.h"
+#include "rom_loader.h"
+
+// Plays a GBS rip on the CPU, timer and APU alone, with no PPU at all (see GBSBus).
+//
+// The rip is mapped into an MBC1 cartridge image at its load address. The bytes below that get a small
+// driver, the way hardware GBS players do it: the RST vectors jump to the rip's own at load_address + n,
+// the entry point sets up the stack, cartridge RAM and timer, calls INIT with the song in A, enables the
+// VBlank or timer interrupt and HALTs, and that interrupt calls PLAY. With no LCD to raise VBlank, the player
+// raises it every 17556 m-cycles itself.
+class GBSPlayer {
+public:
+  // song is 0 based. Throws std::invalid_argument if the rip has no such song, std::runtime_error if it's
+  // bigger than the 512 KB an MBC1 bank number written to 0x2000 can reach.
+  GBSPlayer(const GBSFile& file, uint8_t song,
+            std::function<void(const int16_t* samples, int num_samples)> sample_generated_callback);
+
+  // Emulates at least m_cycles, generating samples once per frame's worth and at the end
+  void run(uint64_t m_cycles);
+
+  CPU<GBSBus>& cpu() { return cpu_; }
+  APU& apu() { return apu_; }
+
+private:
+  ROMLoader loader_;
+  NoPPU no_ppu_;
+  APU apu_;
+  GBSBus bus_{};
+  CPU<GBSBus> cpu_;
+  bool raise_vblank_;
+  uint64_t next_frame_m_cycle_;
+};
@@ -1,9 +1,11 @@
 #include "main_loop.h"
 #include <chrono>
+#include <cmath>
 #include <iostream>
+#include <stdexcept>
+#include "audio_constants.h"
 #include "OSBridge.h"
 #include "joypad_state.h"
-#include "ppu_bridge.h"
 #include "rom_loader.h"
 
 using namespace std::chrono;
@@ -12,18 +14,34 @@ using namespace std::chrono;
 namespace {
 constexpr std::chrono::microseconds TARGET_FRAME_DURATION_MICROSECONDS(
     16740);                                         // Game Boy runs at 59.73 Hz (16.74ms)
+constexpr uint32_t M_CYCLES_PER_FRAME = 17556;
+// Exactly one frame of emulated time, which PacingClock::Audio scales
+constexpr duration<double> EMULATED_FRAME_DURATION(static_cast<double>(M_CYCLES_PER_FRAME) /
+                                                   M_CYCLES_PER_SECOND);
 constexpr uint32_t FPS_MEASUREMENT_INTERVAL = 300;  // Measure FPS every 300 frames
+constexpr uint8_t MAX_AUTO_FRAME_SKIP = 4;          // Always present at least one frame in every 5
 }  // namespace
 
 MainLoop::MainLoop(ROMLoader& loader, OSBridge& os_bridge)
     : cpu_(loader, ppu_, apu_, bus_),
-      ppu_bridge_({[&]() { cpu_.hardware_registers().trigger_vblank_interrupt(); },
-                   [&]() { cpu_.hardware_registers().trigger_lcd_stat_interrupt(); }, os_bridge.blit_screen,
-                   [&]() { return cpu_.is_halted(); },
-                   [&](uint16_t address) -> const uint8_t* { return cpu_.memory_bridge().read(address); }}),
-      ppu_(ppu_bridge_, loader.has_boot_rom()),
-      apu_(os_bridge.on_audio_generated),
-      os_bridge_(os_bridge) {}
+      ppu_(BusPPUBridge{&cpu_, &os_bridge_}, loader.has_boot_rom()),
+      apu_([this](const int16_t* samples, int num_samples) { on_audio_generated(samples, num_samples); }),
+      pacer_(TARGET_FRAME_DURATION_MICROSECONDS),
+      os_bridge_(os_bridge),
+      frontend_blit_screen_(os_bridge.blit_screen),
+      has_boot_rom_(loader.has_boot_rom()) {
+  // Frames pass through here on the way to the frontend so they can be captured
+  os_bridge_.blit_screen = [this](const void* pixels, size_t pitch) { on_blit_screen(pixels, pitch); };
+}
+
+MainLoop::~MainLoop() {
+  set_audio_thread(false);
+  stop_capture();
+  stop_stem_capture();
+  stop_vgm_log();
+  stop_ppu_trace();
+  stop_apu_trace();
+}
 
 bool MainLoop::run(JoypadState& joypad_state) {
   cpu_.update_joypad_state(joypad_state);
@@ -31,10 +49,28 @@ bool MainLoop::run(JoypadState& joypad_state) {
 
   if (ppu_.frame_completed()) {
     apu_.generate_samples();
+    update_audio_output();
 
-    auto current_time = steady_clock::now();
-    busy_wait(current_time);
-    os_bridge_.present_frame();
+    const bool behind = pacer_.wait();
+    if (ppu_.frame_rendered() && !ppu_.frame_duplicate()) {
+      os_bridge_.present_frame();
+    }
+    if (capture_) {
+      if (ppu_.frame_rendered() && ppu_.frame_duplicate()) {
+        capture_->push_repeat(capture_m_cycle());
+      }
+      if (capture_->failed()) {
+        capture_error_ = capture_->error();
+        stop_capture();
+      }
+    }
+    if (stem_writer_ && stem_writer_->failed()) {
+      capture_error_ = stem_writer_->error();
+      stop_stem_capture();
+    }
+    if (frame_skip_mode_ == FrameSkipMode::Auto) {
+      update_auto_frame_skip(behind);
+    }
     frame_count_++;
 
     if (frame_count_ == FPS_MEASUREMENT_INTERVAL)
@@ -54,6 +90,192 @@ CPU<Bus>& MainLoop::cpu() {
   return cpu_;
 }
 
+Bus::PPUType& MainLoop::ppu() {
+  return ppu_;
+}
+
+APU& MainLoop::apu() {
+  return apu_;
+}
+
+void MainLoop::set_frame_skip(FrameSkipMode mode, uint8_t frames) {
+  frame_skip_mode_ = mode;
+  consecutive_skipped_frames_ = 0;
+  ppu_.set_frame_skip(mode == FrameSkipMode::Fixed ? frames : 0);
+}
+
+void MainLoop::set_frame_pacing(PacingClock clock, nanoseconds spin_margin) {
+  pacing_clock_ = clock;
+  pacer_.set_spin_margin(spin_margin);
+  pacer_.set_frame_duration(TARGET_FRAME_DURATION_MICROSECONDS);
+}
+
+// Keeps the audio device's buffer half full, either by nudging the APU's rate or, when pacing by the audio
+// clock, by nudging the frame rate with the APU left at the device's rate
+void MainLoop::update_audio_output() {
+  if (!os_bridge_.audio_output_status) {
+    return;
+  }
+  audio_output_status_ = os_bridge_.audio_output_status();
+  const AudioOutputStatus& audio = *audio_output_status_;
+
+  if (pacing_clock_ == PacingClock::Audio) {
+    const double speed = audio.sample_rate / audio.device_sample_rate;
+    pacer_.set_frame_duration(duration_cast<nanoseconds>(EMULATED_FRAME_DURATION / speed));
+    if (!recording_audio() && apu_sample_rate() != audio.device_sample_rate) {
+      set_apu_sample_rate(audio.device_sample_rate);
+    }
+  } else if (!recording_audio()) {
+    // Captures are written at a single rate, so the rate is left alone while recording
+    set_apu_sample_rate(audio.sample_rate);
+  }
+}
+
+double MainLoop::apu_sample_rate() const {
+  return audio_worker_ ? audio_worker_->sample_rate() : apu_.sample_rate();
+}
+
+void MainLoop::set_apu_sample_rate(double sample_rate) {
+  if (audio_worker_) {
+    audio_worker_->set_sample_rate(sample_rate);
+  } else {
+    apu_.set_sample_rate(sample_rate);
+  }
+}
+
+void MainLoop::set_audio_thread(bool enabled) {
+  if (!enabled) {
+    audio_worker_.reset();
+    return;
+  }
+  if (recording_audio()) {
+    throw std::runtime_error("The audio thread can't be used while capturing");
+  }
+  if (!audio_worker_) {
+    audio_worker_ = std::make_unique<AudioWorker>(
+        apu_, [this](const int16_t* samples, int num_samples) { on_audio_generated(samples, num_samples); });
+  }
+}
+
+void MainLoop::start_capture(const CaptureSettings& settings) {
+  stop_capture();
+  if (audio_worker_) {
+    throw std::runtime_error("Capture needs the audio to be synthesized on the emulation thread");
+  }
+  if (ppu_.pixel_format() != PixelFormat::ARGB8888) {
+    throw std::runtime_error("Capture needs the PPU to output PixelFormat::ARGB8888");
+  }
+
+  CaptureSettings capture_settings = settings;
+  capture_settings.audio_sample_rate = static_cast<uint32_t>(std::lround(apu_.sample_rate()));
+  capture_ = std::make_unique<CaptureSink>(capture_settings);
+  capture_start_m_cycle_ = cpu_.m_cycles();
+  capture_error_.clear();
+}
+
+void MainLoop::stop_capture() {
+  if (capture_) {
+    capture_->finish(capture_m_cycle());
+    capture_.reset();
+  }
+}
+
+void MainLoop::start_stem_capture(const std::string& path_prefix) {
+  stop_stem_capture();
+  if (audio_worker_) {
+    throw std::runtime_error("Stem capture needs the audio to be synthesized on the emulation thread");
+  }
+  const uint32_t sample_rate = static_cast<uint32_t>(std::lround(apu_.sample_rate()));
+  stem_writer_ = std::make_unique<StemWriter>(path_prefix, sample_rate);
+  capture_error_.clear();
+  apu_.set_stem_callback([writer = stem_writer_.get()](const int16_t* stems, int num_frames) {
+    writer->push(stems, static_cast<size_t>(num_frames));
+  });
+}
+
+void MainLoop::stop_stem_capture() {
+  if (stem_writer_) {
+    apu_.set_stem_callback(nullptr);
+    stem_writer_.reset();
+  }
+}
+
+void MainLoop::start_vgm_log(const std::string& path) {
+  stop_vgm_log();
+  vgm_recorder_ = std::make_unique<VGMRecorder>(path, apu_.apu_clock());
+  apu_.log_register_state(*vgm_recorder_);
+  apu_.add_event_sink(vgm_recorder_.get());
+}
+
+void MainLoop::stop_vgm_log() {
+  if (vgm_recorder_) {
+    apu_.remove_event_sink(vgm_recorder_.get());
+    vgm_recorder_->finish(apu_.apu_clock());
+    vgm_recorder_.reset();
+  }
+}
+
+void MainLoop::start_ppu_trace(const std::string& path) {
+  if (cpu_.m_cycles() != 0) {
+    throw std::runtime_error("PPU traces have to start from power on");
+  }
+  ppu_trace_ = std::make_unique<PPUTraceWriter>(
+      path, PPUTraceHeader{has_boot_rom_, ppu_.backend(), ppu_.pixel_format()});
+  ppu_.set_trace_writer(ppu_trace_.get());
+}
+
+void MainLoop::stop_ppu_trace() {
+  if (ppu_trace_) {
+    ppu_.set_trace_writer(nullptr);
+    ppu_trace_.reset();
+  }
+}
+
+void MainLoop::start_apu_trace(const std::string& path) {
+  if (cpu_.m_cycles() != 0) {
+    throw std::runtime_error("APU traces have to start from power on");
+  }
+  if (audio_worker_) {
+    throw std::runtime_error("APU traces need the audio to be synthesized on the emulation thread");
+  }
+  const APUTraceHeader header{apu_.synthesis(), apu_.mixing(), apu_.resampler_quality(),
+                              apu_.channel_mute_mask(), apu_.sample_rate()};
+  apu_trace_ = std::make_unique<APUTraceWriter>(path, header);
+  apu_.add_event_sink(apu_trace_.get());
+}
+
+void MainLoop::stop_apu_trace() {
+  if (apu_trace_) {
+    // The last samples are hashed too
+    apu_.generate_samples();
+    apu_.remove_event_sink(apu_trace_.get());
+    apu_trace_.reset();
+  }
+}
+
+void MainLoop::on_audio_generated(const int16_t* samples, int num_samples) {
+  if (capture_) {
+    capture_->push_audio(samples, static_cast<size_t>(num_samples));
+  }
+  os_bridge_.on_audio_generated(samples, num_samples);
+}
+
+void MainLoop::on_blit_screen(const void* pixels, size_t pitch) {
+  if (capture_) {
+    capture_->push_frame(static_cast<const uint32_t*>(pixels), pitch, capture_m_cycle(), ppu_.frame_hash());
+  }
+  frontend_blit_screen_(pixels, pitch);
+}
+
+void MainLoop::update_auto_frame_skip(bool behind) {
+  if (behind && consecutive_skipped_frames_ < MAX_AUTO_FRAME_SKIP) {
+    consecutive_skipped_frames_++;
+    ppu_.skip_next_frame();
+  } else {
+    consecutive_skipped_frames_ = 0;
+  }
+}
+
 void MainLoop::calculate_fps() {
   auto current_time = steady_clock::now();
   auto total_elapsed_time = current_time - last_fps_time_;
@@ -61,42 +283,49 @@ void MainLoop::calculate_fps() {
       static_cast<double>(frame_count_) / duration_cast<duration<double>>(total_elapsed_time).count();
 
   // Calculate theoretical FPS without sleep limiting
-  auto actual_render_time = total_elapsed_time - total_sleep_time_;
+  const PacingStats pacing = pacer_.take_stats();
+  auto actual_render_time = total_elapsed_time - pacing.waited;
   auto time_per_frame = actual_render_time / FPS_MEASUREMENT_INTERVAL;
 
   auto theoretical_fps = std::chrono::seconds(1) / time_per_frame;
 
   std::cout << "FPS: " << actual_fps << " (Actual: " << theoretical_fps << ")" << std::endl;
+  std::cout << "Pacing: " << duration_cast<microseconds>(pacing.jitter).count() << " us jitter, "
+            << duration_cast<microseconds>(pacing.max_lateness).count() << " us latest, "
+            << duration_cast<microseconds>(pacing.spun).count() / FPS_MEASUREMENT_INTERVAL
+            << " us spun per frame, " << pacing.late_frames << " late, " << pacing.overslept_frames
+            << " overslept" << std::endl;
+  if (audio_output_status_) {
+    const AudioOutputStatus& audio = *audio_output_status_;
+    std::cout << "Audio: " << static_cast<int>(audio.fill * 100) << "% buffered at " << audio.sample_rate
+              << " Hz, " << audio.underruns << " underruns, " << audio.overruns << " samples dropped"
+              << std::endl;
+  }
 
   frame_count_ = 0;
   last_fps_time_ = current_time;
-
-  total_sleep_time_ = microseconds(0);  // Reset sleep time for next measurement period
-}
-
-void MainLoop::busy_wait(time_point<steady_clock> current_time) {
-  auto frame_elapsed = current_time - last_present_time_;
-
-  if (frame_elapsed < TARGET_FRAME_DURATION_MICROSECONDS) {
-    auto sleep_duration = TARGET_FRAME_DURATION_MICROSECONDS - frame_elapsed;
-    auto end = current_time + sleep_duration;
-    total_sleep_time_ += duration_cast<microseconds>(sleep_duration);
-
-    while (steady_clock::now() < end) {}
-    last_present_time_ += TARGET_FRAME_DURATION_MICROSECONDS;
-  } else {
-    last_present_time_ = current_time;
-  }
 }
 
 void MainLoop::serialize(SaveStateSerializer& serializer) const {
   serializer << cpu_;
-  serializer << apu_;
+  if (audio_worker_) {
+    apu_.serialize(serializer, audio_worker_->synthesis());
+  } else {
+    serializer << apu_;
+  }
   serializer << ppu_;
 }
 
+// With the audio worker attached the APU stays on AudioSynthesis::None, and the worker takes the saved mode
 void MainLoop::deserialize(SaveStateSerializer& serializer) {
   serializer >> cpu_;
-  serializer >> apu_;
-  serializer >> ppu_;
+  if (audio_worker_) {
+    AudioSynthesis synthesis = audio_worker_->synthesis();
+    apu_.deserialize(serializer, synthesis);
+    serializer >> ppu_;
+    audio_worker_->resync(synthesis);
+  } else {
+    serializer >> apu_;
+    serializer >> ppu_;
+  }
 }
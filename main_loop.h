@@ -2,37 +2,123 @@
 
 #include <inttypes.h>
 #include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
 #include "OSBridge.h"
 #include "apu.h"
+#include "apu_trace.h"
+#include "audio_worker.h"
 #include "bus.h"
+#include "bus_ppu_bridge.h"
+#include "capture_sink.h"
 #include "cpu.h"
+#include "frame_pacer.h"
 #include "ppu.h"
-#include "ppu_bridge.h"
+#include "stem_writer.h"
+#include "vgm_recorder.h"
 
 class ROMLoader;
 
+enum class FrameSkipMode : uint8_t {
+  Off,    // Render every frame
+  Fixed,  // Render one frame in every (frames + 1)
+  Auto    // Skip rendering only while the host is behind the 59.73 Hz deadline
+};
+
 class MainLoop {
 public:
   MainLoop(ROMLoader& loader, OSBridge& bridge);
+  ~MainLoop();
   bool run(JoypadState& joypad_state);
   void run_once();
   CPU<Bus>& cpu();
+  Bus::PPUType& ppu();
+  APU& apu();
+
+  //Frames skipped this way still run the full emulation, they are just never composed or presented.
+  void set_frame_skip(FrameSkipMode mode, uint8_t frames = 0);
+
+  //PacingClock::Audio needs the frontend to report its audio output status through the OSBridge, without it
+  //frames are paced by the wall clock. A larger spin margin costs CPU, a smaller one risks waking up late.
+  void set_frame_pacing(PacingClock clock,
+                        std::chrono::nanoseconds spin_margin = FramePacer::DEFAULT_SPIN_MARGIN);
+
+  //Synthesizes audio on a thread of its own, see AudioWorker, which leaves the emulation thread only keeping
+  //the APU's registers up to date. Samples are then passed to the OSBridge from that thread. Can't be used
+  //while capturing, and throws std::runtime_error if a capture, stem capture or APU trace is running.
+  void set_audio_thread(bool enabled);
+  bool audio_thread() const { return audio_worker_ != nullptr; }
+
+  //Records every frame and all audio to disk until stop_capture(), timed by emulated cycles so the two stay in
+  //sync. Frames that are skipped or not drawn are recorded as repeats. Needs PixelFormat::ARGB8888.
+  //Throws std::runtime_error if capture can't start.
+  void start_capture(const CaptureSettings& settings);
+  void stop_capture();
+  bool capturing() const { return capture_ != nullptr; }
+
+  //Records each APU channel, before panning, to its own WAV until stop_stem_capture(), see StemWriter. Can
+  //run alongside start_capture(). Throws std::runtime_error if a file can't be opened.
+  void start_stem_capture(const std::string& path_prefix);
+  void stop_stem_capture();
+  bool capturing_stems() const { return stem_writer_ != nullptr; }
+
+  //Logs every APU register write to a VGM file until stop_vgm_log(), starting with the current register
+  //state. Throws std::runtime_error if the file can't be opened.
+  void start_vgm_log(const std::string& path);
+  void stop_vgm_log();
+  bool vgm_logging() const { return vgm_recorder_ != nullptr; }
+
+  //Logs everything the PPU is fed to a trace for test/ppu_trace_replay until stop_ppu_trace(). Has to be
+  //called before the emulator first runs, as traces start from power on. Throws std::runtime_error otherwise,
+  //or if the file can't be opened.
+  void start_ppu_trace(const std::string& path);
+  void stop_ppu_trace();
+
+  //Logs everything the APU is fed, and hashes of the samples it produces, to a trace for
+  //test/apu_trace_replay until stop_apu_trace(). Has to be called before the emulator first runs, and the
+  //sample rate is held while it's recording. Throws std::runtime_error if it isn't power on, the audio thread
+  //is in use or the file can't be opened.
+  void start_apu_trace(const std::string& path);
+  void stop_apu_trace();
+
+  //Why the last capture or stem capture stopped by itself (the writer fell behind), empty if it didn't
+  const std::string& capture_error() const { return capture_error_; }
 
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
 
 private:
-  void busy_wait(std::chrono::time_point<std::chrono::steady_clock> current_time);
+  void update_audio_output();
+  void update_auto_frame_skip(bool behind);
   void calculate_fps();
+  void on_audio_generated(const int16_t* samples, int num_samples);
+  void on_blit_screen(const void* pixels, size_t pitch);
+  double apu_sample_rate() const;
+  void set_apu_sample_rate(double sample_rate);
+  bool recording_audio() const { return capture_ || stem_writer_ || apu_trace_; }
+  uint64_t capture_m_cycle() const { return cpu_.m_cycles() - capture_start_m_cycle_; }
 
   CPU<Bus> cpu_;
-  PPUBridge ppu_bridge_;
-  PPU ppu_;
+  Bus::PPUType ppu_;
   APU apu_;
   Bus bus_;
-  std::chrono::steady_clock::time_point last_present_time_ = std::chrono::steady_clock::now();
   std::chrono::steady_clock::time_point last_fps_time_ = std::chrono::steady_clock::now();
   uint32_t frame_count_ = 0;
-  std::chrono::microseconds total_sleep_time_ = std::chrono::microseconds(0);
+  FramePacer pacer_;
+  PacingClock pacing_clock_ = PacingClock::Wall;
+  FrameSkipMode frame_skip_mode_ = FrameSkipMode::Off;
+  uint8_t consecutive_skipped_frames_ = 0;
   OSBridge os_bridge_;
+  std::function<void(const void* pixels, size_t pitch)> frontend_blit_screen_;
+  std::unique_ptr<CaptureSink> capture_;
+  uint64_t capture_start_m_cycle_ = 0;
+  std::string capture_error_;
+  std::unique_ptr<PPUTraceWriter> ppu_trace_;
+  std::unique_ptr<APUTraceWriter> apu_trace_;
+  std::unique_ptr<AudioWorker> audio_worker_;
+  std::unique_ptr<StemWriter> stem_writer_;
+  std::unique_ptr<VGMRecorder> vgm_recorder_;
+  std::optional<AudioOutputStatus> audio_output_status_;  // As of the last frame
+  bool has_boot_rom_;
 };
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdint>
+#include <type_traits>
 
 #include "detail/memory_bridge_components.h"
 
@@ -112,6 +113,19 @@ struct PPURegisterHandler {
   void write(uint16_t addr, uint8_t value, Bus* bus) { bus->ppu_->write_ppu_register(addr, value); }
 };
 
+// Open bus, for the PPU's memory and registers on a Bus without a PPU (HAS_PPU false)
+template <typename Bus>
+struct UnmappedHandler {
+  const uint8_t* read(uint16_t addr, Bus* bus) {
+    static const uint8_t open_bus = 0xFF;
+    return &open_bus;
+  }
+  void write(uint16_t addr, uint8_t value, Bus* bus) {}
+};
+
+template <typename Bus, typename Handler>
+using PPUHandler = std::conditional_t<Bus::HAS_PPU, Handler, UnmappedHandler<Bus>>;
+
 template <typename Bus>
 struct BootROMHandler {
   void write(uint16_t addr, uint8_t value, Bus* bus) { bus->memory_controller_->unload_boot_rom(); }
@@ -137,7 +151,7 @@ template <typename Bus>
 using FirstLevelReadHandlers =
     ReadHandlerList<Bus, FirstLevelRangeCallbacks<0x0000, 0x3FFF, ROM0Handler<Bus>>,
                     FirstLevelRangeCallbacks<0x4000, 0x7FFF, ROM1Handler<Bus>>,
-                    FirstLevelRangeCallbacks<0x8000, 0x9FFF, VRAMHandler<Bus>>,
+                    FirstLevelRangeCallbacks<0x8000, 0x9FFF, PPUHandler<Bus, VRAMHandler<Bus>>>,
                     FirstLevelRangeCallbacks<0xA000, 0xBFFF, RAMHandler<Bus>>,
                     FirstLevelRangeCallbacks<0xC000, 0xDFFF, WRAMHandler<Bus>>,
                     FirstLevelRangeCallbacks<0xE000, 0xFDFF, ECHOHandler<Bus>>,
@@ -147,7 +161,7 @@ template <typename Bus>
 using FirstLevelWriteHandlers =
     WriteHandlerList<Bus, FirstLevelRangeCallbacks<0x0000, 0x3FFF, ROM0Handler<Bus>>,
                      FirstLevelRangeCallbacks<0x4000, 0x7FFF, ROM1Handler<Bus>>,
-                     FirstLevelRangeCallbacks<0x8000, 0x9FFF, VRAMHandler<Bus>>,
+                     FirstLevelRangeCallbacks<0x8000, 0x9FFF, PPUHandler<Bus, VRAMHandler<Bus>>>,
                      FirstLevelRangeCallbacks<0xA000, 0xBFFF, RAMHandler<Bus>>,
                      FirstLevelRangeCallbacks<0xC000, 0xDFFF, WRAMHandler<Bus>>,
                      FirstLevelRangeCallbacks<0xE000, 0xFDFF, ECHOHandler<Bus>>,
@@ -155,17 +169,17 @@ using FirstLevelWriteHandlers =
 
 template <typename Bus>
 using SecondLevelReadHandlers = ReadHandlerList<
-    Bus, SecondLevelRangeCallbacks<0xFE00, 0xFE9F, OAMHandler<Bus>>,
+    Bus, SecondLevelRangeCallbacks<0xFE00, 0xFE9F, PPUHandler<Bus, OAMHandler<Bus>>>,
     SecondLevelRangeCallbacks<0xFF80, 0xFFFE, HRAMHandler<Bus>>, AddressCallbacks<0xFF04, DIVHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF10, 0xFF3F, AudioHandler<Bus>>, AddressCallbacks<0xFFFF, IEHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF00, 0xFF03, HardwareRegisterHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF05, 0xFF0F, HardwareRegisterHandler<Bus>>,
-    SecondLevelRangeCallbacks<0xFF40, 0xFF6C, PPURegisterHandler<Bus>>,
+    SecondLevelRangeCallbacks<0xFF40, 0xFF6C, PPUHandler<Bus, PPURegisterHandler<Bus>>>,
     SecondLevelRangeCallbacks<0xFF6D, 0xFF7F, HardwareRegisterHandler<Bus>>>;
 
 template <typename Bus>
 using SecondLevelWriteHandlers = WriteHandlerList<
-    Bus, SecondLevelRangeCallbacks<0xFE00, 0xFE9F, OAMHandler<Bus>>,
+    Bus, SecondLevelRangeCallbacks<0xFE00, 0xFE9F, PPUHandler<Bus, OAMHandler<Bus>>>,
     SecondLevelRangeCallbacks<0xFF80, 0xFFFE, HRAMHandler<Bus>>, AddressCallbacks<0xFFFF, IEHandler<Bus>>,
     AddressCallbacks<0xFF00, HardwareRegisterHandler<Bus>, JoypadNotifyHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF01, 0xFF03, HardwareRegisterHandler<Bus>>,
@@ -174,7 +188,7 @@ using SecondLevelWriteHandlers = WriteHandlerList<
     AddressCallbacks<0xFF07, TacWriteHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF08, 0xFF0F, HardwareRegisterHandler<Bus>>,
     SecondLevelRangeCallbacks<0xFF10, 0xFF3F, AudioHandler<Bus>>,
-    SecondLevelRangeCallbacks<0xFF40, 0xFF6C, PPURegisterHandler<Bus>>,
+    SecondLevelRangeCallbacks<0xFF40, 0xFF6C, PPUHandler<Bus, PPURegisterHandler<Bus>>>,
     SecondLevelRangeCallbacks<0xFF6D, 0xFF7F, HardwareRegisterHandler<Bus>>,
     AddressCallbacks<0xFF50, BootROMHandler<Bus>>>;
 
@@ -1,13 +1,75 @@
 #include "game_screen.h"
+#include <bit>
+#include <cstring>
 #include "ppu_constants.h"
 #include "rgb.h"
 
-void GameScreen::clear(const RGBValue& color) {
-  const uint32_t packed = color.argb;
-  for (uint32_t y = 0; y < SCREEN_HEIGHT; ++y) {
-    for (uint32_t x = 0; x < SCREEN_WIDTH; ++x) {
-      background_pixels_[y][x] = color;
-      pixel_buffer_[(y * SCREEN_WIDTH) + x] = packed;
-    }
+namespace {
+constexpr uint64_t FRAME_HASH_SEED = 0xCBF29CE484222325ULL;
+constexpr uint64_t FRAME_HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+constexpr int FRAME_HASH_ROTATION = 29;
+
+// Rotate and multiply are both invertible, so a changed word always changes the running hash. 20 multiplies a
+// line is cheap next to converting it.
+uint64_t fold_line(uint64_t hash, const uint8_t* line) {
+  for (size_t x = 0; x < SCREEN_WIDTH; x += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, line + x, sizeof(word));
+    hash = std::rotl(hash ^ word, FRAME_HASH_ROTATION) * FRAME_HASH_MULTIPLIER;
+  }
+  return hash;
+}
+}  // namespace
+
+void GameScreen::set_pixel_format(PixelFormat format) {
+  format_ = format;
+  if (format == PixelFormat::Indexed) {
+    output_.clear();
+    output_.shrink_to_fit();
+    return;
+  }
+
+  output_.assign((output_pitch() * SCREEN_HEIGHT) / sizeof(uint32_t), 0);
+  for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+    convert_shades(&shades_[y * SCREEN_WIDTH], reinterpret_cast<uint8_t*>(output_.data()) + (y * output_pitch()),
+                   SCREEN_WIDTH, format_);
+  }
+}
+
+void GameScreen::finish_line(uint32_t y) {
+  const uint8_t* line = &shades_[y * SCREEN_WIDTH];
+  if (y == 0) {
+    line_hash_ = FRAME_HASH_SEED;
+    lines_hashed_ = 0;
   }
-}
\ No newline at end of file
+  line_hash_ = fold_line(line_hash_, line);
+  lines_hashed_++;
+
+  if (destination_.pixels != nullptr) {
+    convert_shades(line, static_cast<uint8_t*>(destination_.pixels) + (y * destination_.pitch), SCREEN_WIDTH,
+                   format_);
+  } else if (format_ != PixelFormat::Indexed) {
+    convert_shades(line, reinterpret_cast<uint8_t*>(output_.data()) + (y * output_pitch()), SCREEN_WIDTH, format_);
+  }
+}
+
+FrameDestination GameScreen::finish_frame() {
+  frame_hash_ = lines_hashed_ == SCREEN_HEIGHT ? line_hash_ : 0;
+  lines_hashed_ = 0;
+
+  if (destination_.pixels != nullptr) {
+    const FrameDestination frame = destination_;
+    destination_ = {};
+    return frame;
+  }
+
+  if (format_ == PixelFormat::Indexed) {
+    return {shades_.data(), SCREEN_WIDTH};
+  }
+  return {output_.data(), output_pitch()};
+}
+
+void GameScreen::clear(uint8_t shade) {
+  background_line_indices_.fill(0);
+  shades_.fill(shade);
+}
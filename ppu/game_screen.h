@@ -2,34 +2,76 @@
 
 #include <inttypes.h>
 #include <array>
+#include <vector>
+#include "pixel_conversion.h"
 #include "ppu_constants.h"
 #include "rgb.h"
 
+// The PPU renders shades (0-3) into an 8-bit buffer. Each finished line is converted into the frontend's pixel
+// format, either into a frontend supplied destination or an internal buffer. With PixelFormat::Indexed and no
+// destination the shade buffer is handed out as is.
 class GameScreen {
 public:
-  [[gnu::always_inline]] inline void draw_background_pixel(uint32_t x, uint32_t y, const RGBValue& color) {
-    background_pixels_[y][x] = color;
-    pixel_buffer_[(y * SCREEN_WIDTH) + x] = color.argb;
+  GameScreen() { set_pixel_format(PixelFormat::ARGB8888); }
+
+  [[gnu::always_inline]] inline void draw_background_pixel(uint32_t x, uint32_t y, uint8_t color_index,
+                                                           uint8_t shade) {
+    background_line_indices_[x] = color_index;
+    shades_[(y * SCREEN_WIDTH) + x] = shade;
+  }
+
+  // A whole line of background/window colour indices
+  [[gnu::always_inline]] inline void draw_background_line(uint32_t y, const uint8_t* color_indices,
+                                                          const std::array<uint8_t, 4>& shades) {
+    uint8_t* line_shades = &shades_[y * SCREEN_WIDTH];
+    for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+      background_line_indices_[x] = color_indices[x];
+      line_shades[x] = shades[color_indices[x]];
+    }
   }
 
-  [[gnu::always_inline]] inline void draw_object_pixel(uint32_t x, uint32_t y, const RGBAValue& color) {
-    if (!color.active)
+  // Must be called after the background pixels for the same line, as object priority checks the BG colour index
+  [[gnu::always_inline]] inline void draw_object_pixel(uint32_t x, uint32_t y, const ObjectPixel& pixel) {
+    if (!pixel.active)
       return;
 
-    const auto& background = background_pixels_[y][x];
-    if (color.priority && background.index != 0)
+    if (pixel.priority && background_line_indices_[x] != 0)
       return;
 
-    pixel_buffer_[(y * SCREEN_WIDTH) + x] = color.argb;
+    shades_[(y * SCREEN_WIDTH) + x] = pixel.shade;
   }
 
-  [[gnu::always_inline]] const uint32_t* pixel_data() const { return pixel_buffer_.data(); }
+  void set_pixel_format(PixelFormat format);
+  PixelFormat pixel_format() const { return format_; }
+
+  // Write the current frame straight into `destination` instead of the internal buffer. Only applies until
+  // finish_frame().
+  void set_destination(const FrameDestination& destination) { destination_ = destination; }
+  bool has_destination() const { return destination_.pixels != nullptr; }
 
-  [[gnu::always_inline]] constexpr static size_t pitch() { return SCREEN_WIDTH * sizeof(uint32_t); }
+  // Converts a finished line into the output pixel format and folds it into the frame hash
+  void finish_line(uint32_t y);
 
-  void clear(const RGBValue& color);
+  // Returns where the finished frame is, and goes back to the internal buffer for the next frame
+  FrameDestination finish_frame();
+
+  // Hash of the shades in the frame last returned by finish_frame(). Identical frames hash the same. 0 if any
+  // of its lines weren't finished (e.g. the LCD was switched on part way through the frame).
+  uint64_t frame_hash() const { return frame_hash_; }
+
+  void clear(uint8_t shade);
 
 private:
-  std::array<std::array<RGBValue, SCREEN_WIDTH>, SCREEN_HEIGHT> background_pixels_;
-  std::array<uint32_t, SCREEN_WIDTH * SCREEN_HEIGHT> pixel_buffer_{};
-};
\ No newline at end of file
+  size_t output_pitch() const { return SCREEN_WIDTH * bytes_per_pixel(format_); }
+
+  PixelFormat format_ = PixelFormat::ARGB8888;
+  std::array<uint8_t, SCREEN_WIDTH> background_line_indices_{};
+  std::array<uint8_t, SCREEN_WIDTH * SCREEN_HEIGHT> shades_{};
+  std::vector<uint32_t> output_;  // Empty for PixelFormat::Indexed
+  FrameDestination destination_;
+
+  // Frame hash, built up one line at a time
+  uint64_t line_hash_ = 0;
+  uint32_t lines_hashed_ = 0;
+  uint64_t frame_hash_ = 0;
+};
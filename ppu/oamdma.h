@@ -1,7 +1,6 @@
 #pragma once
 
 #include <array>
-#include <functional>
 #include <iostream>
 #include "ppu_constants.h"
 #include "save_state.h"
@@ -9,11 +8,11 @@
 class OAMDMA {
 public:
   OAMDMA() = default;
-  OAMDMA(std::function<const uint8_t*(uint16_t)> read_memory, std::array<unsigned char, OAM_SIZE>& oam,
-         uint16_t source_address)
-      : read_memory_(read_memory), oam_(&oam), source_address_(source_address) {}
+  explicit OAMDMA(uint16_t source_address) : source_address_(source_address) {}
 
-  bool tick() {
+  //Bridge is the PPU's bridge, used to read anything outside OAM
+  template <typename Bridge>
+  bool tick(Bridge& bridge, std::array<unsigned char, OAM_SIZE>& oam) {
     if (wait_) {
       wait_--;
       return false;
@@ -25,13 +24,13 @@ public:
     uint16_t address = source_address_ + index_;
 
     if (address >= OAM_BASE_ADDRESS && address <= OAM_END_ADDRESS) {
-      (*oam_)[index_] = (*oam_)[address - OAM_BASE_ADDRESS];
+      oam[index_] = oam[address - OAM_BASE_ADDRESS];
     } else {
-      (*oam_)[index_] = *read_memory_(address);
+      oam[index_] = *bridge.read_memory(address);
     }
 
     index_++;
-    return index_ == oam_->size();
+    return index_ == oam.size();
   }
 
   bool running() const { return wait_ == 0; }
@@ -48,15 +47,7 @@ public:
     serializer >> wait_;
   }
 
-  void restore_pointers(std::function<const uint8_t*(uint16_t)> read_memory,
-                        std::array<unsigned char, OAM_SIZE>& oam) {
-    read_memory_ = read_memory;
-    oam_ = &oam;
-  }
-
 private:
-  std::function<const uint8_t*(uint16_t)> read_memory_;
-  std::array<unsigned char, OAM_SIZE>* oam_;
   uint16_t source_address_;
   uint16_t index_ = 0;
   int wait_ = OAMDMA_WAIT_CYCLES;
@@ -0,0 +1,160 @@
+#include "pixel_conversion.h"
+#include <cstring>
+#include "rgb.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIXEL_CONVERSION_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define PIXEL_CONVERSION_NEON
+#endif
+
+namespace {
+constexpr size_t SHADES_PER_VECTOR = 16;
+
+void convert_argb8888_scalar(const uint8_t* shades, uint32_t* destination, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    destination[i] = GameBoyColors::ARGB8888[shades[i] & 0x03];
+  }
+}
+
+void convert_rgb565_scalar(const uint8_t* shades, uint16_t* destination, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    destination[i] = GameBoyColors::RGB565[shades[i] & 0x03];
+  }
+}
+
+#if defined(PIXEL_CONVERSION_SSE2)
+// Shades are only ever 0-3, so each lane is selected with one compare per shade rather than a table lookup
+// (SSE2 has no byte shuffle).
+[[gnu::always_inline]] inline __m128i select_argb(__m128i shades) {
+  __m128i result = _mm_and_si128(_mm_cmpeq_epi32(shades, _mm_set1_epi32(0)),
+                                 _mm_set1_epi32(static_cast<int>(GameBoyColors::ARGB8888[0])));
+  for (int shade = 1; shade < 4; shade++) {
+    result = _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi32(shades, _mm_set1_epi32(shade)),
+                                                _mm_set1_epi32(static_cast<int>(GameBoyColors::ARGB8888[shade]))));
+  }
+  return result;
+}
+
+[[gnu::always_inline]] inline __m128i select_rgb565(__m128i shades) {
+  __m128i result = _mm_and_si128(_mm_cmpeq_epi16(shades, _mm_set1_epi16(0)),
+                                 _mm_set1_epi16(static_cast<int16_t>(GameBoyColors::RGB565[0])));
+  for (int shade = 1; shade < 4; shade++) {
+    result =
+        _mm_or_si128(result, _mm_and_si128(_mm_cmpeq_epi16(shades, _mm_set1_epi16(static_cast<int16_t>(shade))),
+                                           _mm_set1_epi16(static_cast<int16_t>(GameBoyColors::RGB565[shade]))));
+  }
+  return result;
+}
+
+void convert_argb8888(const uint8_t* shades, uint32_t* destination, size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi8(0x03);
+  size_t i = 0;
+  for (; i + SHADES_PER_VECTOR <= count; i += SHADES_PER_VECTOR) {
+    const __m128i bytes =
+        _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + i)), mask);
+    const __m128i low = _mm_unpacklo_epi8(bytes, zero);
+    const __m128i high = _mm_unpackhi_epi8(bytes, zero);
+    __m128i* out = reinterpret_cast<__m128i*>(destination + i);
+    _mm_storeu_si128(out + 0, select_argb(_mm_unpacklo_epi16(low, zero)));
+    _mm_storeu_si128(out + 1, select_argb(_mm_unpackhi_epi16(low, zero)));
+    _mm_storeu_si128(out + 2, select_argb(_mm_unpacklo_epi16(high, zero)));
+    _mm_storeu_si128(out + 3, select_argb(_mm_unpackhi_epi16(high, zero)));
+  }
+  convert_argb8888_scalar(shades + i, destination + i, count - i);
+}
+
+void convert_rgb565(const uint8_t* shades, uint16_t* destination, size_t count) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i mask = _mm_set1_epi8(0x03);
+  size_t i = 0;
+  for (; i + SHADES_PER_VECTOR <= count; i += SHADES_PER_VECTOR) {
+    const __m128i bytes =
+        _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(shades + i)), mask);
+    __m128i* out = reinterpret_cast<__m128i*>(destination + i);
+    _mm_storeu_si128(out + 0, select_rgb565(_mm_unpacklo_epi8(bytes, zero)));
+    _mm_storeu_si128(out + 1, select_rgb565(_mm_unpackhi_epi8(bytes, zero)));
+  }
+  convert_rgb565_scalar(shades + i, destination + i, count - i);
+}
+#elif defined(PIXEL_CONVERSION_NEON)
+[[gnu::always_inline]] inline uint32x4_t select_argb(uint32x4_t shades) {
+  uint32x4_t result = vdupq_n_u32(GameBoyColors::ARGB8888[0]);
+  for (uint32_t shade = 1; shade < 4; shade++) {
+    result = vbslq_u32(vceqq_u32(shades, vdupq_n_u32(shade)), vdupq_n_u32(GameBoyColors::ARGB8888[shade]), result);
+  }
+  return result;
+}
+
+[[gnu::always_inline]] inline uint16x8_t select_rgb565(uint16x8_t shades) {
+  uint16x8_t result = vdupq_n_u16(GameBoyColors::RGB565[0]);
+  for (uint16_t shade = 1; shade < 4; shade++) {
+    result = vbslq_u16(vceqq_u16(shades, vdupq_n_u16(shade)), vdupq_n_u16(GameBoyColors::RGB565[shade]), result);
+  }
+  return result;
+}
+
+void convert_argb8888(const uint8_t* shades, uint32_t* destination, size_t count) {
+  size_t i = 0;
+  for (; i + SHADES_PER_VECTOR <= count; i += SHADES_PER_VECTOR) {
+    const uint8x16_t bytes = vandq_u8(vld1q_u8(shades + i), vdupq_n_u8(0x03));
+    const uint16x8_t low = vmovl_u8(vget_low_u8(bytes));
+    const uint16x8_t high = vmovl_u8(vget_high_u8(bytes));
+    vst1q_u32(destination + i + 0, select_argb(vmovl_u16(vget_low_u16(low))));
+    vst1q_u32(destination + i + 4, select_argb(vmovl_u16(vget_high_u16(low))));
+    vst1q_u32(destination + i + 8, select_argb(vmovl_u16(vget_low_u16(high))));
+    vst1q_u32(destination + i + 12, select_argb(vmovl_u16(vget_high_u16(high))));
+  }
+  convert_argb8888_scalar(shades + i, destination + i, count - i);
+}
+
+void convert_rgb565(const uint8_t* shades, uint16_t* destination, size_t count) {
+  size_t i = 0;
+  for (; i + SHADES_PER_VECTOR <= count; i += SHADES_PER_VECTOR) {
+    const uint8x16_t bytes = vandq_u8(vld1q_u8(shades + i), vdupq_n_u8(0x03));
+    vst1q_u16(destination + i + 0, select_rgb565(vmovl_u8(vget_low_u8(bytes))));
+    vst1q_u16(destination + i + 8, select_rgb565(vmovl_u8(vget_high_u8(bytes))));
+  }
+  convert_rgb565_scalar(shades + i, destination + i, count - i);
+}
+#else
+void convert_argb8888(const uint8_t* shades, uint32_t* destination, size_t count) {
+  convert_argb8888_scalar(shades, destination, count);
+}
+
+void convert_rgb565(const uint8_t* shades, uint16_t* destination, size_t count) {
+  convert_rgb565_scalar(shades, destination, count);
+}
+#endif
+}  // namespace
+
+void convert_shades(const uint8_t* shades, void* destination, size_t count, PixelFormat format) {
+  switch (format) {
+    case PixelFormat::ARGB8888:
+      convert_argb8888(shades, static_cast<uint32_t*>(destination), count);
+      break;
+    case PixelFormat::RGB565:
+      convert_rgb565(shades, static_cast<uint16_t*>(destination), count);
+      break;
+    case PixelFormat::Indexed:
+      std::memcpy(destination, shades, count);
+      break;
+  }
+}
+
+void convert_shades_scalar(const uint8_t* shades, void* destination, size_t count, PixelFormat format) {
+  switch (format) {
+    case PixelFormat::ARGB8888:
+      convert_argb8888_scalar(shades, static_cast<uint32_t*>(destination), count);
+      break;
+    case PixelFormat::RGB565:
+      convert_rgb565_scalar(shades, static_cast<uint16_t*>(destination), count);
+      break;
+    case PixelFormat::Indexed:
+      std::memcpy(destination, shades, count);
+      break;
+  }
+}
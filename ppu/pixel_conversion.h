@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class PixelFormat : uint8_t {
+  ARGB8888,  // 32 bits per pixel, what SDL_PIXELFORMAT_ARGB8888 expects
+  RGB565,    // 16 bits per pixel
+  Indexed    // 8 bits per pixel, the raw shade (0-3). No conversion pass is run.
+};
+
+// Where a frame is written. Supplied by the frontend (e.g. a locked SDL texture) to avoid an extra copy.
+struct FrameDestination {
+  void* pixels = nullptr;
+  size_t pitch = 0;  // Bytes per row
+};
+
+constexpr size_t bytes_per_pixel(PixelFormat format) {
+  switch (format) {
+    case PixelFormat::ARGB8888:
+      return 4;
+    case PixelFormat::RGB565:
+      return 2;
+    case PixelFormat::Indexed:
+      return 1;
+  }
+  return 1;
+}
+
+// Converts `count` shades (0-3) into `format` at `destination`. Uses SSE2 or NEON where available.
+void convert_shades(const uint8_t* shades, void* destination, size_t count, PixelFormat format);
+
+// Plain C++ version of convert_shades, kept as the reference for the vectorised paths.
+void convert_shades_scalar(const uint8_t* shades, void* destination, size_t count, PixelFormat format);
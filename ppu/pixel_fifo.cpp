@@ -0,0 +1,345 @@
+#include "pixel_fifo.h"
+#include <algorithm>
+#include "palette.h"
+#include "save_state.h"
+
+namespace {
+constexpr uint8_t PIXEL_BIT_SHIFT = 7;
+constexpr uint8_t BYTES_PER_TILE_ROW = 2;
+constexpr uint8_t FETCHER_STEP_DOTS = 2;   // Each fetcher step (tile, data low, data high) takes two dots
+constexpr uint8_t LINE_STARTUP_DOTS = 6;   // The first tile fetch of every line is thrown away
+constexpr uint8_t OBJECT_FETCH_DOTS = 6;   // Object tile fetch, with the background fetcher paused
+constexpr uint8_t TRANSPARENT_COLOR_INDEX = 0;
+
+[[gnu::always_inline]] inline uint8_t get_pixel(uint8_t low, uint8_t high, uint8_t pixel) {
+  return ((low >> (PIXEL_BIT_SHIFT - pixel)) & 1) | (((high >> (PIXEL_BIT_SHIFT - pixel)) & 1) << 1);
+}
+}  // namespace
+
+PixelFIFO::PixelFIFO(const PPURegisters& ppu_registers, const std::array<unsigned char, VRAM_SIZE>& vram,
+                     GameScreen& game_screen, uint16_t& window_line_counter)
+    : ppu_registers_(ppu_registers),
+      vram_(vram),
+      game_screen_(game_screen),
+      window_line_counter_(window_line_counter) {}
+
+void PixelFIFO::start_line(const ScanlineSnapshot& snapshot, bool render) {
+  line_ = snapshot.line;
+  render_ = render;
+  dot_ = 0;
+  x_ = 0;
+  pixels_to_discard_ = ppu_registers_.get_SCX() % TILE_WIDTH;
+  startup_dots_ = LINE_STARTUP_DOTS;
+
+  // WY is compared against LY once per line, and once it has matched the window can start on any later line
+  if (line_ == 0) {
+    window_y_triggered_ = false;
+  }
+  if (line_ == ppu_registers_.get_WY()) {
+    window_y_triggered_ = true;
+  }
+  window_active_ = false;
+
+  fetcher_state_ = FetcherState::GetTile;
+  fetcher_dots_ = 0;
+  fetcher_delay_dots_ = 0;
+  fetcher_x_ = 0;
+  bg_fifo_head_ = 0;
+  bg_fifo_size_ = 0;
+  object_fifo_.fill({});
+
+  objects_ = snapshot.objects;
+  object_count_ = snapshot.object_count;
+  fetched_objects_ = 0;
+  pending_object_ = -1;
+  object_fetch_dots_ = 0;
+  object_wait_dots_ = 0;
+  object_dots_ = 0;
+}
+
+bool PixelFIFO::run(uint16_t dots) {
+  while (x_ < SCREEN_WIDTH && dot_ < dots) {
+    step();
+  }
+  return x_ == SCREEN_WIDTH;
+}
+
+void PixelFIFO::resync(uint8_t line) {
+  window_y_triggered_ = line >= ppu_registers_.get_WY();
+}
+
+void PixelFIFO::serialize(SaveStateSerializer& serializer) const {
+  serializer << line_ << render_ << dot_ << x_ << pixels_to_discard_ << startup_dots_;
+  serializer << window_y_triggered_ << window_active_ << window_row_;
+  serializer << fetcher_state_ << fetcher_dots_ << fetcher_delay_dots_ << fetcher_x_;
+  serializer << tile_index_ << tile_data_low_ << tile_data_high_;
+  serializer << bg_fifo_ << bg_fifo_head_ << bg_fifo_size_ << object_fifo_;
+  serializer << objects_ << object_count_ << fetched_objects_ << pending_object_;
+  serializer << object_fetch_dots_ << object_wait_dots_ << object_dots_;
+}
+
+void PixelFIFO::deserialize(SaveStateSerializer& serializer) {
+  serializer >> line_ >> render_ >> dot_ >> x_ >> pixels_to_discard_ >> startup_dots_;
+  serializer >> window_y_triggered_ >> window_active_ >> window_row_;
+  serializer >> fetcher_state_ >> fetcher_dots_ >> fetcher_delay_dots_ >> fetcher_x_;
+  serializer >> tile_index_ >> tile_data_low_ >> tile_data_high_;
+  serializer >> bg_fifo_ >> bg_fifo_head_ >> bg_fifo_size_ >> object_fifo_;
+  serializer >> objects_ >> object_count_ >> fetched_objects_ >> pending_object_;
+  serializer >> object_fetch_dots_ >> object_wait_dots_ >> object_dots_;
+}
+
+void PixelFIFO::step() {
+  dot_++;
+
+  if (startup_dots_ > 0) {
+    startup_dots_--;
+    return;
+  }
+
+  if (object_fetch_dots_ == 0) {
+    if (pending_object_ < 0) {
+      pending_object_ = find_object_to_fetch();
+    }
+    if (pending_object_ >= 0) {
+      // Pixel output stops while the fetcher finishes the background tile it's on
+      if (!fetcher_ready_for_object()) {
+        step_fetcher();
+        if (bg_fifo_size_ > 0) {
+          object_wait_dots_++;  // A pixel would have been output this dot
+        }
+        return;
+      }
+
+      // An object hanging off the left edge was matched X dots before pixel 0, so that much of the wait has
+      // already passed
+      const uint8_t object_x = objects_[pending_object_].x;
+      const uint8_t waited_early = object_x < SPRITE_X_OFFSET ? std::min(object_wait_dots_, object_x) : 0;
+      object_dots_ += object_wait_dots_;
+      object_wait_dots_ = 0;
+      object_fetch_dots_ = OBJECT_FETCH_DOTS - waited_early;
+    }
+  }
+
+  if (object_fetch_dots_ > 0) {
+    object_dots_++;
+    if (--object_fetch_dots_ == 0) {
+      fetch_object(pending_object_);
+      finish_left_edge_objects();
+      pending_object_ = -1;
+    }
+    return;
+  }
+
+  step_fetcher();
+  shift_pixel();
+}
+
+void PixelFIFO::step_fetcher() {
+  if (fetcher_delay_dots_ > 0) {
+    fetcher_delay_dots_--;
+    return;
+  }
+
+  switch (fetcher_state_) {
+    case FetcherState::GetTile:
+      if (++fetcher_dots_ == FETCHER_STEP_DOTS) {
+        fetcher_dots_ = 0;
+        tile_index_ = vram(tile_map_address());
+        fetcher_state_ = FetcherState::GetDataLow;
+      }
+      break;
+    case FetcherState::GetDataLow:
+      if (++fetcher_dots_ == FETCHER_STEP_DOTS) {
+        fetcher_dots_ = 0;
+        tile_data_low_ = vram(tile_row_address());
+        fetcher_state_ = FetcherState::GetDataHigh;
+      }
+      break;
+    case FetcherState::GetDataHigh:
+      if (++fetcher_dots_ == FETCHER_STEP_DOTS) {
+        fetcher_dots_ = 0;
+        tile_data_high_ = vram(tile_row_address() + 1);
+        fetcher_state_ = FetcherState::Push;
+      }
+      break;
+    case FetcherState::Push:
+      // Retried every dot until the FIFO has emptied
+      if (bg_fifo_size_ != 0) {
+        break;
+      }
+      for (uint8_t pixel = 0; pixel < TILE_WIDTH; pixel++) {
+        bg_fifo_[pixel] = get_pixel(tile_data_low_, tile_data_high_, pixel);
+      }
+      bg_fifo_head_ = 0;
+      bg_fifo_size_ = TILE_WIDTH;
+      fetcher_x_++;
+      fetcher_state_ = FetcherState::GetTile;
+      break;
+  }
+}
+
+void PixelFIFO::shift_pixel() {
+  if (bg_fifo_size_ == 0) {
+    return;
+  }
+
+  // The first SCX % 8 pixels of the line are shifted out and thrown away
+  if (pixels_to_discard_ > 0) {
+    bg_fifo_head_++;
+    bg_fifo_size_--;
+    pixels_to_discard_--;
+    return;
+  }
+
+  if (window_should_start()) {
+    start_window();
+    return;
+  }
+
+  const uint8_t bg_index = bg_fifo_[bg_fifo_head_++];
+  bg_fifo_size_--;
+  const ObjectFIFOEntry object = object_fifo_[0];
+  std::copy(object_fifo_.begin() + 1, object_fifo_.end(), object_fifo_.begin());
+  object_fifo_.back() = {};
+
+  if (render_) {
+    if (LCDC() & LCDC_BG_ENABLE) {
+      game_screen_.draw_background_pixel(x_, line_, bg_index,
+                                         apply_palette(ppu_registers_.get_BGP(), bg_index));
+    } else {
+      game_screen_.draw_background_pixel(x_, line_, 0, GameBoyShades::WHITE);
+    }
+
+    if (object.color_index != TRANSPARENT_COLOR_INDEX && (LCDC() & LCDC_SPRITE_ENABLE)) {
+      const uint8_t palette = object.use_obp1 ? ppu_registers_.get_OBP1() : ppu_registers_.get_OBP0();
+      game_screen_.draw_object_pixel(x_, line_,
+                                     {apply_palette(palette, object.color_index), true, object.priority});
+    }
+  }
+
+  x_++;
+  if (x_ == SCREEN_WIDTH && render_) {
+    game_screen_.finish_line(line_);
+  }
+}
+
+bool PixelFIFO::window_should_start() const {
+  constexpr uint8_t WINDOW_REQUIRED = LCDC_BG_ENABLE | LCDC_WINDOW_ENABLE;
+  return !window_active_ && window_y_triggered_ && (LCDC() & WINDOW_REQUIRED) == WINDOW_REQUIRED &&
+         x_ + WINDOW_X_OFFSET >= ppu_registers_.get_WX();
+}
+
+// Switching to the window throws away the background pixels and restarts the fetcher on the window tile map
+void PixelFIFO::start_window() {
+  window_active_ = true;
+  window_row_ = static_cast<uint8_t>(window_line_counter_);
+  window_line_counter_++;
+
+  bg_fifo_head_ = 0;
+  bg_fifo_size_ = 0;
+  fetcher_x_ = 0;
+  fetcher_state_ = FetcherState::GetTile;
+  fetcher_dots_ = 1;  // The dot the window was detected on counts as the first fetcher dot
+}
+
+// An object fetch can only start once the background fetcher has its tile data and there are pixels to mix with
+bool PixelFIFO::fetcher_ready_for_object() const {
+  return bg_fifo_size_ > 0 &&
+         (fetcher_state_ == FetcherState::GetDataHigh || fetcher_state_ == FetcherState::Push);
+}
+
+int8_t PixelFIFO::find_object_to_fetch() const {
+  if ((LCDC() & LCDC_SPRITE_ENABLE) == 0 || pixels_to_discard_ > 0) {
+    return -1;
+  }
+
+  for (uint8_t i = 0; i < object_count_; i++) {
+    const ObjectAttribute& object = objects_[i];
+    if ((fetched_objects_ & (1 << i)) || object.x >= SCREEN_WIDTH + SPRITE_X_OFFSET) {
+      continue;
+    }
+    if (object.x <= x_ + SPRITE_X_OFFSET) {
+      return static_cast<int8_t>(i);
+    }
+  }
+  return -1;
+}
+
+void PixelFIFO::fetch_object(uint8_t index) {
+  const ObjectAttribute& object = objects_[index];
+  fetched_objects_ |= 1 << index;
+
+  const bool big_tile_mode = (LCDC() & LCDC_SPRITE_SIZE) != 0;
+  const uint8_t height_mask = big_tile_mode ? SPRITE_HEIGHT_8X16 : SPRITE_HEIGHT_8X8;
+  uint8_t row = static_cast<uint8_t>(line_ - (object.y - SPRITE_Y_OFFSET)) & height_mask;
+  if (object.flip_y()) {
+    row = height_mask - row;
+  }
+
+  uint8_t tile_index = object.index;
+  if (big_tile_mode) {
+    tile_index &= 0xFE;
+    if (row >= TILE_HEIGHT) {
+      tile_index |= 0x01;
+      row -= TILE_HEIGHT;
+    }
+  }
+
+  const uint16_t row_address = TILE_DATA_BASE_0 + (tile_index * TILE_SIZE_BYTES) + (row * BYTES_PER_TILE_ROW);
+  const uint8_t low = vram(row_address);
+  const uint8_t high = vram(row_address + 1);
+
+  for (uint8_t pixel = 0; pixel < TILE_PIXELS_PER_ROW; pixel++) {
+    const int16_t screen_x = object.x - SPRITE_X_OFFSET + pixel;
+    if (screen_x < x_ || screen_x >= x_ + TILE_WIDTH) {
+      continue;
+    }
+
+    // Objects fetched earlier have priority, so only transparent slots are replaced
+    ObjectFIFOEntry& slot = object_fifo_[screen_x - x_];
+    const uint8_t color_index =
+        get_pixel(low, high, object.flip_x() ? (TILE_PIXELS_PER_ROW - 1) - pixel : pixel);
+    if (color_index != TRANSPARENT_COLOR_INDEX && slot.color_index == TRANSPARENT_COLOR_INDEX) {
+      slot = {color_index, object.dmg_palette_obp1(), object.priority()};
+    }
+  }
+}
+
+// Objects hanging off the left edge sit in the tile before pixel 0. Once the last of them is fetched, the
+// background fetch starts over as if tile 0 had just been pushed, so the first object in tile 0 waits for it.
+void PixelFIFO::finish_left_edge_objects() {
+  if (objects_[pending_object_].x >= SPRITE_X_OFFSET) {
+    return;
+  }
+  const int8_t next_object = find_object_to_fetch();
+  if (next_object >= 0 && objects_[next_object].x < SPRITE_X_OFFSET) {
+    return;
+  }
+  fetcher_state_ = FetcherState::GetTile;
+  fetcher_dots_ = 0;
+  fetcher_delay_dots_ = 1;
+}
+
+uint16_t PixelFIFO::tile_map_address() const {
+  if (window_active_) {
+    const uint16_t base = (LCDC() & LCDC_WINDOW_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+    return base + ((window_row_ / TILE_HEIGHT) * TILES_PER_ROW) + (fetcher_x_ % TILES_PER_ROW);
+  }
+
+  const uint16_t base = (LCDC() & LCDC_BG_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+  const uint8_t y = line_ + ppu_registers_.get_SCY();
+  const uint8_t tile_x = ((ppu_registers_.get_SCX() / TILE_WIDTH) + fetcher_x_) % TILES_PER_ROW;
+  return base + ((y / TILE_HEIGHT) * TILES_PER_ROW) + tile_x;
+}
+
+uint16_t PixelFIFO::tile_row_address() const {
+  const uint8_t row = window_active_ ? window_row_ % TILE_HEIGHT
+                                     : static_cast<uint8_t>(line_ + ppu_registers_.get_SCY()) % TILE_HEIGHT;
+  uint16_t tile_address;
+  if (LCDC() & LCDC_TILE_DATA) {
+    tile_address = TILE_DATA_BASE_0 + (tile_index_ * TILE_SIZE_BYTES);
+  } else {
+    tile_address = TILE_DATA_BASE_1 + (static_cast<int8_t>(tile_index_) * TILE_SIZE_BYTES);
+  }
+  return tile_address + (row * BYTES_PER_TILE_ROW);
+}
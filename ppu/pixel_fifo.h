@@ -0,0 +1,105 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include "game_screen.h"
+#include "ppu_constants.h"
+#include "ppu_registers.h"
+#include "scanline_renderer.h"
+
+class SaveStateSerializer;
+
+// Dot accurate model of mode 3: the background/window tile fetcher, the background pixel FIFO and the object
+// FIFO, stepped one dot at a time as an explicit state machine. Registers and VRAM are read live as each
+// fetch or pixel happens, so mid-line writes (SCX, palettes, WX, LCDC...) take effect on the right pixel, and
+// the length of mode 3 falls out of the model instead of being estimated.
+class PixelFIFO {
+public:
+  PixelFIFO(const PPURegisters& ppu_registers, const std::array<unsigned char, VRAM_SIZE>& vram,
+            GameScreen& game_screen, uint16_t& window_line_counter);
+
+  // Call at the start of mode 3. Only the line number and the selected objects are used from the snapshot.
+  void start_line(const ScanlineSnapshot& snapshot, bool render);
+
+  // Runs until `dots` dots into mode 3 or the end of the line, returning true once all 160 pixels are out
+  bool run(uint16_t dots);
+
+  // Length of mode 3 in dots, valid once run() has returned true. Object fetches only hold up the end of mode 3
+  // in whole m-cycles, so this can be up to 3 dots less than the time the last pixel was output.
+  uint16_t length() const { return dot_ - (object_dots_ % T_CYCLES_PER_TICK); }
+
+  // Re-derives the per-frame window trigger after the PPU state has been replaced (e.g. a save state)
+  void resync(uint8_t line);
+
+  // The line in progress, so a save state taken part way through mode 3 finishes it dot for dot
+  void serialize(SaveStateSerializer& serializer) const;
+  void deserialize(SaveStateSerializer& serializer);
+
+private:
+  enum class FetcherState : uint8_t { GetTile, GetDataLow, GetDataHigh, Push };
+
+  struct ObjectFIFOEntry {
+    uint8_t color_index = 0;
+    bool use_obp1 = false;
+    bool priority = false;
+  };
+
+  void step();
+  void step_fetcher();
+  void shift_pixel();
+  bool window_should_start() const;
+  bool fetcher_ready_for_object() const;
+  int8_t find_object_to_fetch() const;
+  void fetch_object(uint8_t index);
+  void start_window();
+  void finish_left_edge_objects();
+  uint16_t tile_map_address() const;
+  uint16_t tile_row_address() const;
+
+  [[gnu::always_inline]] inline uint8_t LCDC() const { return ppu_registers_.get_LCDC(); }
+  [[gnu::always_inline]] inline uint8_t vram(uint16_t address) const {
+    return vram_[address - VRAM_BASE_ADDRESS];
+  }
+
+  const PPURegisters& ppu_registers_;
+  const std::array<unsigned char, VRAM_SIZE>& vram_;
+  GameScreen& game_screen_;
+  uint16_t& window_line_counter_;
+
+  // Line state
+  uint8_t line_ = 0;
+  bool render_ = false;
+  uint16_t dot_ = 0;
+  uint8_t x_ = 0;  // Next pixel to be output
+  uint8_t pixels_to_discard_ = 0;
+  uint8_t startup_dots_ = 0;
+  bool window_y_triggered_ = false;
+  bool window_active_ = false;
+  uint8_t window_row_ = 0;
+
+  // Fetcher
+  FetcherState fetcher_state_ = FetcherState::GetTile;
+  uint8_t fetcher_dots_ = 0;
+  uint8_t fetcher_delay_dots_ = 0;
+  uint8_t fetcher_x_ = 0;  // Tile column, relative to SCX/8 for the background and 0 for the window
+  uint8_t tile_index_ = 0;
+  uint8_t tile_data_low_ = 0;
+  uint8_t tile_data_high_ = 0;
+
+  // Background FIFO, only ever holds one tile row
+  std::array<uint8_t, TILE_WIDTH> bg_fifo_{};
+  uint8_t bg_fifo_head_ = 0;
+  uint8_t bg_fifo_size_ = 0;
+
+  // Object FIFO, slot 0 is the pixel at x_
+  std::array<ObjectFIFOEntry, TILE_WIDTH> object_fifo_{};
+
+  // Objects selected for this line in priority order, and which have been fetched
+  std::array<ObjectAttribute, MAX_SPRITES_PER_SCANLINE> objects_{};
+  uint8_t object_count_ = 0;
+  uint16_t fetched_objects_ = 0;
+  int8_t pending_object_ = -1;
+  uint8_t object_fetch_dots_ = 0;
+  uint8_t object_wait_dots_ = 0;  // Dots the pending object has held up pixel output waiting for the fetcher
+  uint8_t object_dots_ = 0;  // Dots spent waiting for and fetching objects this line
+};
@@ -1,12 +1,18 @@
 #pragma once
 
 #include <inttypes.h>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include "game_screen.h"
 #include "object_attributes.h"
-#include "palette.h"
+#include "pixel_fifo.h"
 #include "ppu_bridge.h"
 #include "ppu_memory.h"
 #include "ppu_registers.h"
+#include "ppu_trace.h"
+#include "render_thread.h"
+#include "scanline_renderer.h"
 
 class SaveStateSerializer;
 
@@ -17,16 +23,96 @@ enum class PPUMode : uint8_t {
   PixelTransfer = 3  // Mode 3
 };
 
+enum class PPUBackend : uint8_t {
+  Scanline,  // Draws each line in one go at the start of mode 3 and estimates how long mode 3 takes
+  PixelFIFO  // Steps the fetcher and pixel FIFOs dot by dot, so mid-line register writes land on the right pixel
+};
+
+//"scanline" or "fifo", as the test tools' --backend takes them. std::nullopt for anything else.
+inline std::optional<PPUBackend> ppu_backend_from_name(std::string_view name) {
+  if (name == "scanline") {
+    return PPUBackend::Scanline;
+  }
+  if (name == "fifo") {
+    return PPUBackend::PixelFIFO;
+  }
+  return std::nullopt;
+}
+
+//Bridge is PPUBridge, or any type with the same members as callable member functions. The emulator core uses a
+//bridge that calls straight into the CPU so the per m-cycle calls inline, see BusPPUBridge.
+template <typename Bridge>
 class PPU {
 public:
-  PPU(PPUBridge ppu_bridge, bool boot_rom_active);
+  PPU(Bridge ppu_bridge, bool boot_rom_active);
 
   //Call this once per m-cycle
   void tick();
 
+  //Same as calling tick() `ticks` times, but jumps straight to the next mode change instead of stepping every
+  //m-cycle, so bridge calls and STAT/LY changes happen exactly as they would have. Only valid if nothing is
+  //written to the PPU and is_halted() doesn't change during those ticks. frame_completed() afterwards reports
+  //a single frame, however many ended.
+  void tick_many(uint32_t ticks);
+
   //Call this once per m-cycle to check if a frame is ready to be rendered (You will also have just got a call on the PPUBridge to blit the screen)
   bool frame_completed();
 
+  //True if the most recently completed frame was rendered and blitted, false if it was skipped
+  bool frame_rendered() const { return render_frame_; }
+
+  //Skip rendering on `frames` out of every `frames + 1` frames. 0 renders every frame.
+  //Skipped frames keep exact timing and STAT behaviour but never compose pixels or call blit_screen.
+  void set_frame_skip(uint8_t frames);
+
+  //Skip rendering of the next frame only, on top of any fixed frame skip. Used by auto frame skip.
+  void skip_next_frame() { skip_next_frame_ = true; }
+
+  //Hash of the pixels of the most recently rendered frame, 0 if it isn't known (e.g. the LCD was switched on
+  //part way through it). Identical frames have identical hashes, so frontends and capture sinks can use it to
+  //skip work on repeated frames.
+  uint64_t frame_hash() const { return frame_hash_; }
+
+  //Don't call blit_screen for a rendered frame that is identical to the last one blitted. frame_duplicate() is
+  //then true for that frame, and there is nothing new to present. Off by default.
+  void set_skip_duplicate_frames(bool enabled) { skip_duplicate_frames_ = enabled; }
+  bool frame_duplicate() const { return frame_duplicate_; }
+
+  //Number of frames that weren't blitted because they were duplicates
+  uint64_t duplicate_frames() const { return duplicate_frames_; }
+
+  //Blit the next rendered frame even if it is a duplicate, e.g. after the frontend's window was exposed
+  void redraw_next_frame() { blitted_frame_hash_ = 0; }
+
+  //Pixel format of the frame passed to blit_screen. Defaults to ARGB8888.
+  //PixelFormat::Indexed passes the raw shades (0-3) and skips the colour conversion pass entirely.
+  void set_pixel_format(PixelFormat format);
+  PixelFormat pixel_format() const { return game_screen_.pixel_format(); }
+
+  //Rasterise scanlines on a worker thread instead of inline at the start of mode 3. Frames reach
+  //blit_screen one frame later, from the worker's buffers, and acquire_frame is not used.
+  void set_threaded_rendering(bool enabled);
+
+  //With threaded rendering, the hash of every frame the worker has finished, oldest first, as frame_hash()
+  //only gives the newest. False if none is waiting, or rendering isn't threaded.
+  bool pop_threaded_frame_hash(uint64_t& hash) {
+    return render_thread_ && render_thread_->pop_finished_frame_hash(hash);
+  }
+
+  //Selects how mode 3 is emulated. Can be switched at any time, and save states load into either backend.
+  //Threaded rendering is only used by the scanline backend.
+  void set_backend(PPUBackend backend);
+  PPUBackend backend() const { return backend_; }
+
+  //Draw the background and window from prerendered 256x256 copies of the tile maps, which are kept up to date
+  //tile by tile as VRAM is written. The cache only switches itself on while VRAM is mostly static, so games
+  //that stream tiles don't pay for it. On by default, and only used by the scanline backend.
+  void set_tile_map_cache(bool enabled) { tile_map_cache_enabled_ = enabled; }
+
+  //Log everything the PPU is fed, and the interrupts and frames it produces, to `writer` (see ppu_trace.h).
+  //Set it before the first tick(), as a replay starts from power on. nullptr stops tracing.
+  void set_trace_writer(PPUTraceWriter* writer) { trace_writer_ = writer; }
+
   //Read VRAM from here
   const uint8_t* read_vram(uint16_t addr) const {
     static uint8_t garbage = 0xFF;
@@ -38,8 +124,14 @@ public:
 
   //Write VRAM to here
   void write_vram(uint16_t addr, uint8_t value) {
+    if (trace_writer_) [[unlikely]] {
+      trace_writer_->write(addr, value);
+    }
     if (current_mode_ != PPUMode::PixelTransfer) {
       ppu_memory_.write_vram(addr, value);
+      if (render_thread_) {
+        render_thread_->write_vram(addr, value);
+      }
     }
   }
 
@@ -47,7 +139,12 @@ public:
   const uint8_t* read_oam(uint16_t addr) const { return ppu_memory_.read_oam(addr); }
 
   //Write OAM to here
-  void write_oam(uint16_t addr, uint8_t value) { ppu_memory_.write_oam(addr, value); }
+  void write_oam(uint16_t addr, uint8_t value) {
+    if (trace_writer_) [[unlikely]] {
+      trace_writer_->write(addr, value);
+    }
+    ppu_memory_.write_oam(addr, value);
+  }
 
   //Read PPU registers from here - Everything from FF40 -> FF6C
   const uint8_t* read_ppu_register(uint16_t addr) const { return &ppu_registers_.read_register(addr); }
@@ -62,16 +159,14 @@ public:
 private:
   void stat_write(uint16_t address, uint8_t value);
   void check_mode_change();
+  uint32_t ticks_until_mode_change() const;
 
   uint8_t get_object_mode_3_penalty(std::array<ObjectAttribute*, 10>& objects, uint8_t scx);
-  void render_scanline(uint8_t scanline);
-  void render_background_scanline(uint8_t scanline);
-  void render_object_scanline(uint8_t scanline);
-
-  uint16_t get_bg_tile_map_address(uint32_t x, uint32_t y);
-  uint16_t get_win_tile_map_address(uint32_t x, uint32_t y);
-  uint16_t get_bgwin_tile_address(uint16_t tile_index);
-  uint16_t get_obj_tile_address(uint16_t tile_index);
+  void start_frame();
+  void prepare_scanline(uint8_t scanline);
+  void render_scanline();
+  void start_pixel_fifo_line();
+  void complete_frame();
 
   void set_mode(PPUMode mode);
   void set_LY(bool force = false);
@@ -79,6 +174,11 @@ private:
   [[gnu::always_inline]] inline uint8_t LCDC() const { return ppu_registers_.get_LCDC(); }
   bool is_halted_hblank_interrupt() const;
 
+  // Bridge calls that are logged when tracing
+  void trigger_vblank_interrupt();
+  void trigger_lcd_stat_interrupt();
+  bool bridge_is_halted() const;
+
   // Timing state
   PPUMode current_mode_ = PPUMode::OAMSearch;
   uint16_t elapsed_t_cycles_ = 0;
@@ -86,6 +186,22 @@ private:
   uint8_t mode_3_penalty_ = 0;
   uint16_t window_scanline_ = 0;
 
+  // Everything rendering needs for the current scanline, captured at the start of mode 3
+  ScanlineSnapshot scanline_snapshot_;
+
+  // Frame skipping
+  uint8_t frame_skip_ = 0;
+  uint8_t frames_skipped_ = 0;
+  bool skip_next_frame_ = false;
+  bool render_frame_ = true;
+
+  // Duplicate frame detection
+  uint64_t frame_hash_ = 0;
+  uint64_t blitted_frame_hash_ = 0;
+  uint64_t duplicate_frames_ = 0;
+  bool skip_duplicate_frames_ = false;
+  bool frame_duplicate_ = false;
+
   // Enable and status flags
   bool enabled_ = false;
   bool just_enabled_ = false;
@@ -97,10 +213,22 @@ private:
   PPUMemory ppu_memory_;
   GameScreen game_screen_;
   ObjectAttributes oam_attributes_;
-  Palette palette_;
+  ScanlineRenderer scanline_renderer_;
+  std::unique_ptr<RenderThread> render_thread_;
+  PixelFIFO pixel_fifo_;
+
+  // Backend
+  PPUBackend backend_ = PPUBackend::Scanline;
+  bool pixel_fifo_active_ = false;  // The pixel FIFO is timing the current mode 3
+  bool tile_map_cache_enabled_ = true;
 
   // Bridge
-  PPUBridge ppu_bridge_;
+  Bridge ppu_bridge_;
+  PPUTraceWriter* trace_writer_ = nullptr;
 
   bool fire_hblank_next_tick_ = false;
-};
\ No newline at end of file
+};
+
+#include "ppu.inc"
+
+extern template class PPU<PPUBridge>;
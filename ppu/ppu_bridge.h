@@ -3,11 +3,16 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include "pixel_conversion.h"
 
+//Type-erased bridge for using the PPU on its own. PPU<Bridge> accepts any type with these members as callable
+//member functions, which avoids the std::function calls on the per m-cycle path.
 struct PPUBridge {
   std::function<void()> trigger_vblank_interrupt;
   std::function<void()> trigger_lcd_stat_interrupt;
-  std::function<void(const uint32_t* pixels, size_t pitch)> blit_screen;
+  std::function<void(const void* pixels, size_t pitch)> blit_screen;  //Pixels are in the PPU's PixelFormat.
   std::function<bool()> is_halted;  //Needed for correct handling of delaying interrupts in halted mode.
   std::function<const uint8_t*(uint16_t)> read_memory;  //Needed for OAM DMA transfers.
+  //Optional. Where to write the next frame, an empty FrameDestination means the PPU's own buffer.
+  std::function<FrameDestination()> acquire_frame = [] { return FrameDestination{}; };
 };
@@ -30,6 +30,7 @@ constexpr uint8_t TILE_WIDTH = 8;
 constexpr uint8_t TILE_HEIGHT = 8;
 constexpr uint8_t TILE_SIZE_BYTES = 16;  // Each tile is 16 bytes (8x8 pixels, 2 bytes per row)
 constexpr uint8_t TILES_PER_ROW = 32;    // 32 tiles per row in tile map
+constexpr uint16_t TILE_MAP_PIXELS = 256;  // Width and height of a tile map
 
 // Tile map addresses
 constexpr uint16_t TILE_MAP_BASE_0 = 0x9800;
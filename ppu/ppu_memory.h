@@ -2,10 +2,10 @@
 
 #include <array>
 #include <cstdint>
-#include <functional>
 #include "oamdma.h"
 #include "ppu_registers.h"
 #include "stack_vector.h"
+#include "tile_map_cache.h"
 
 class SaveStateSerializer;
 
@@ -13,31 +13,47 @@ class PPUMemory {
 public:
   PPUMemory(const PPURegisters& ppu_registers);
 
-  void tick();
+  //Bridge is the PPU's bridge, which OAM DMA reads through
+  template <typename Bridge>
+  void tick(Bridge& bridge) {
+    for (auto it = oam_dmas_.begin(); it != oam_dmas_.end();) {
+      if (it->tick(bridge, oam_)) {
+        it = oam_dmas_.erase(it);
+        PPU_VERBOSE_PRINT() << "OAMDMA completed: " << oam_dmas_.size() << std::endl;
+      } else {
+        ++it;
+      }
+    }
+  }
 
   // VRAM access
   const uint8_t* read_vram(uint16_t addr) const { return &vram_[addr - VRAM_BASE_ADDRESS]; }
-  void write_vram(uint16_t addr, uint8_t value) { vram_[addr - VRAM_BASE_ADDRESS] = value; }
+  void write_vram(uint16_t addr, uint8_t value) {
+    vram_[addr - VRAM_BASE_ADDRESS] = value;
+    tile_map_cache_.vram_written(addr - VRAM_BASE_ADDRESS);
+  }
 
   // OAM access
   const uint8_t* read_oam(uint16_t addr) const;
   void write_oam(uint16_t addr, uint8_t value);
 
   // OAMDMA management
-  void start_oamdma(std::function<const uint8_t*(uint16_t)> read_memory, uint16_t source_address);
+  void start_oamdma(uint16_t source_address) { oam_dmas_.emplace_back(source_address); }
   bool is_oam_dma_running() const { return !oam_dmas_.empty() && oam_dmas_.front().running(); }
+  bool has_oam_dma() const { return !oam_dmas_.empty(); }  // Including ones still in their start up delay
 
   // Direct access for sub-components
   const std::array<unsigned char, VRAM_SIZE>& vram() const { return vram_; }
   std::array<unsigned char, OAM_SIZE>& oam() { return oam_; }
+  TileMapCache& tile_map_cache() { return tile_map_cache_; }
 
   void serialize(SaveStateSerializer& serializer) const;
   void deserialize(SaveStateSerializer& serializer);
-  void restore_oamdma_pointers(std::function<const uint8_t*(uint16_t)> read_memory);
 
 private:
   std::array<unsigned char, VRAM_SIZE> vram_;
   std::array<unsigned char, OAM_SIZE> oam_;
+  TileMapCache tile_map_cache_{vram_.data()};
   StackVector<OAMDMA, OAM_DMA_MAX_COUNT> oam_dmas_;
   const PPURegisters& ppu_registers_;
 };
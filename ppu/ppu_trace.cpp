@@ -0,0 +1,175 @@
+#include "ppu_trace.h"
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+
+namespace {
+constexpr char TRACE_MAGIC[8] = {'G', 'B', 'P', 'P', 'U', 'T', 'R', 'C'};
+constexpr uint32_t TRACE_VERSION = 1;
+constexpr size_t TRACE_HEADER_BYTES = sizeof(TRACE_MAGIC) + sizeof(uint32_t) + 3;
+constexpr size_t TRACE_FLUSH_BYTES = 64 * 1024;
+
+// Events are a type byte, the ticks since the previous event as a LEB128 varint, then the payload
+void put_u16(std::vector<uint8_t>& buffer, uint16_t value) {
+  buffer.push_back(static_cast<uint8_t>(value));
+  buffer.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void put_u64(std::vector<uint8_t>& buffer, uint64_t value) {
+  for (int i = 0; i < 8; i++) {
+    buffer.push_back(static_cast<uint8_t>(value >> (i * 8)));
+  }
+}
+
+class TraceCursor {
+public:
+  TraceCursor(const std::vector<uint8_t>& data, size_t offset) : data_(data), offset_(offset) {}
+
+  bool done() const { return offset_ == data_.size(); }
+
+  uint8_t u8() {
+    if (offset_ >= data_.size()) {
+      throw std::runtime_error("PPU trace is truncated");
+    }
+    return data_[offset_++];
+  }
+
+  uint16_t u16() {
+    const uint16_t low = u8();
+    return low | (u8() << 8);
+  }
+
+  uint64_t u64() {
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+      value |= static_cast<uint64_t>(u8()) << (i * 8);
+    }
+    return value;
+  }
+
+  uint64_t varint() {
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      const uint8_t byte = u8();
+      value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80)) {
+        return value;
+      }
+    }
+    throw std::runtime_error("PPU trace has a bad tick delta");
+  }
+
+private:
+  const std::vector<uint8_t>& data_;
+  size_t offset_;
+};
+}  // namespace
+
+PPUTraceWriter::PPUTraceWriter(const std::string& path, const PPUTraceHeader& header)
+    : file_(path, std::ios::binary | std::ios::trunc) {
+  if (!file_) {
+    throw std::runtime_error("Failed to open PPU trace file: " + path);
+  }
+  buffer_.reserve(TRACE_FLUSH_BYTES + 16);
+  buffer_.insert(buffer_.end(), std::begin(TRACE_MAGIC), std::end(TRACE_MAGIC));
+  for (int i = 0; i < 4; i++) {
+    buffer_.push_back(static_cast<uint8_t>(TRACE_VERSION >> (i * 8)));
+  }
+  buffer_.push_back(header.boot_rom_active);
+  buffer_.push_back(static_cast<uint8_t>(header.backend));
+  buffer_.push_back(static_cast<uint8_t>(header.pixel_format));
+}
+
+PPUTraceWriter::~PPUTraceWriter() {
+  flush();
+}
+
+void PPUTraceWriter::frame(uint64_t hash) {
+  put(PPUTraceEventType::Frame, 0, 0);
+  put_u64(buffer_, hash);
+}
+
+void PPUTraceWriter::flush() {
+  file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+  file_.flush();
+  buffer_.clear();
+}
+
+void PPUTraceWriter::put(PPUTraceEventType type, uint16_t address, uint8_t value) {
+  if (buffer_.size() >= TRACE_FLUSH_BYTES) {
+    flush();
+  }
+
+  buffer_.push_back(static_cast<uint8_t>(type));
+  put_varint(ticks_ - last_event_tick_);
+  last_event_tick_ = ticks_;
+
+  switch (type) {
+    case PPUTraceEventType::Write:
+    case PPUTraceEventType::MemoryRead:
+      put_u16(buffer_, address);
+      buffer_.push_back(value);
+      break;
+    case PPUTraceEventType::Halted:
+      buffer_.push_back(value);
+      break;
+    default:
+      break;
+  }
+}
+
+void PPUTraceWriter::put_varint(uint64_t value) {
+  while (value >= 0x80) {
+    buffer_.push_back(static_cast<uint8_t>(value) | 0x80);
+    value >>= 7;
+  }
+  buffer_.push_back(static_cast<uint8_t>(value));
+}
+
+PPUTraceReader::PPUTraceReader(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    throw std::runtime_error("Failed to open PPU trace file: " + path);
+  }
+  const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  if (data.size() < TRACE_HEADER_BYTES || std::memcmp(data.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+    throw std::runtime_error("Not a PPU trace: " + path);
+  }
+  TraceCursor cursor(data, sizeof(TRACE_MAGIC));
+  const uint32_t version = cursor.u16() | (cursor.u16() << 16);
+  if (version != TRACE_VERSION) {
+    throw std::runtime_error("Unsupported PPU trace version " + std::to_string(version) + ": " + path);
+  }
+  header_.boot_rom_active = cursor.u8();
+  header_.backend = static_cast<PPUBackend>(cursor.u8());
+  header_.pixel_format = static_cast<PixelFormat>(cursor.u8());
+
+  uint64_t tick = 0;
+  while (!cursor.done()) {
+    PPUTraceEvent event{};
+    event.type = static_cast<PPUTraceEventType>(cursor.u8());
+    tick += cursor.varint();
+    event.tick = tick;
+
+    switch (event.type) {
+      case PPUTraceEventType::Write:
+      case PPUTraceEventType::MemoryRead:
+        event.address = cursor.u16();
+        event.value = cursor.u8();
+        break;
+      case PPUTraceEventType::Halted:
+        event.value = cursor.u8();
+        break;
+      case PPUTraceEventType::VBlankInterrupt:
+      case PPUTraceEventType::StatInterrupt:
+        break;
+      case PPUTraceEventType::Frame:
+        event.hash = cursor.u64();
+        break;
+      default:
+        throw std::runtime_error("PPU trace has an unknown event type: " + path);
+    }
+    events_.push_back(event);
+  }
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <inttypes.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "pixel_conversion.h"
+
+enum class PPUBackend : uint8_t;
+
+//A PPU trace is everything a PPU was fed from power on, timestamped in m-cycles: VRAM, OAM and register
+//writes, the bytes OAM DMA read through the bridge and the CPU's halt state. Replaying the inputs into a fresh
+//PPU gives the same frames and interrupts without a CPU, so PPU changes can be benchmarked and checked alone.
+//What the PPU produced (interrupts and frame hashes) is logged too, for the replay to compare against.
+
+enum class PPUTraceEventType : uint8_t {
+  Write,       //CPU write to VRAM, OAM or a PPU register, applied before the tick
+  MemoryRead,  //Byte OAM DMA read through the bridge during the tick
+  Halted,      //The bridge's is_halted() changed, logged at the first query that saw it
+  VBlankInterrupt,
+  StatInterrupt,
+  Frame        //A frame ended. hash is its frame_hash(), or 0 if it wasn't rendered or isn't known.
+};
+
+struct PPUTraceEvent {
+  uint64_t tick;  //Number of PPU::tick() calls started before the event
+  uint64_t hash;
+  uint16_t address;
+  uint8_t value;
+  PPUTraceEventType type;
+};
+
+struct PPUTraceHeader {
+  bool boot_rom_active;
+  PPUBackend backend;
+  PixelFormat pixel_format;
+};
+
+//Streams a trace to disk as the PPU runs. Throws std::runtime_error if the file can't be opened.
+class PPUTraceWriter {
+public:
+  PPUTraceWriter(const std::string& path, const PPUTraceHeader& header);
+  ~PPUTraceWriter();
+
+  PPUTraceWriter(const PPUTraceWriter&) = delete;
+  PPUTraceWriter& operator=(const PPUTraceWriter&) = delete;
+
+  //Called by the PPU at the start of every tick()
+  void tick() { ticks_++; }
+
+  void write(uint16_t address, uint8_t value) { put(PPUTraceEventType::Write, address, value); }
+  void memory_read(uint16_t address, uint8_t value) { put(PPUTraceEventType::MemoryRead, address, value); }
+  void halted(bool halted) {
+    if (halted != halted_) {
+      halted_ = halted;
+      put(PPUTraceEventType::Halted, 0, halted);
+    }
+  }
+  void vblank_interrupt() { put(PPUTraceEventType::VBlankInterrupt, 0, 0); }
+  void stat_interrupt() { put(PPUTraceEventType::StatInterrupt, 0, 0); }
+  void frame(uint64_t hash);
+
+  void flush();
+  bool good() const { return file_.good(); }
+
+private:
+  void put(PPUTraceEventType type, uint16_t address, uint8_t value);
+  void put_varint(uint64_t value);
+
+  std::ofstream file_;
+  std::vector<uint8_t> buffer_;
+  uint64_t ticks_ = 0;
+  uint64_t last_event_tick_ = 0;
+  bool halted_ = false;
+};
+
+//Loads a whole trace into memory. Throws std::runtime_error if it can't be read or isn't a trace.
+class PPUTraceReader {
+public:
+  explicit PPUTraceReader(const std::string& path);
+
+  const PPUTraceHeader& header() const { return header_; }
+  const std::vector<PPUTraceEvent>& events() const { return events_; }
+
+private:
+  PPUTraceHeader header_;
+  std::vector<PPUTraceEvent> events_;
+};
@@ -0,0 +1,104 @@
+#include "render_thread.h"
+
+RenderThread::RenderThread(const std::array<unsigned char, VRAM_SIZE>& vram, PixelFormat format)
+    : vram_(vram),
+      tile_map_cache_(vram_.data()),
+      renderer_(vram_.data(), game_screen_, &tile_map_cache_),
+      format_(format),
+      pitch_(SCREEN_WIDTH * bytes_per_pixel(format)) {
+  game_screen_.set_pixel_format(format_);
+  for (auto& frame : frames_.buffers()) {
+    frame.pixels.assign((pitch_ * SCREEN_HEIGHT) / sizeof(uint32_t), 0);
+  }
+  start_next_frame();
+
+  thread_ = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+  running_.store(false, std::memory_order_release);
+  wake_worker();
+  thread_.join();
+}
+
+void RenderThread::write_vram(uint16_t addr, uint8_t value) {
+  const VRAMWrite write{static_cast<uint16_t>(addr - VRAM_BASE_ADDRESS), value};
+  while (!vram_writes_.push(write)) {
+    // Lots of writes with no scanline to flush them (e.g. while frames are skipped). Every write so far came
+    // before any scanline that hasn't been submitted yet, so the worker is free to apply them all.
+    drainable_vram_writes_.store(vram_writes_pushed_, std::memory_order_release);
+    wake_worker();
+    std::this_thread::yield();
+  }
+  vram_writes_pushed_++;
+}
+
+void RenderThread::submit_scanline(ScanlineSnapshot snapshot) {
+  snapshot.vram_writes = vram_writes_pushed_;
+  push_command({Command::Type::Scanline, snapshot});
+}
+
+void RenderThread::end_frame() {
+  Command command;
+  command.type = Command::Type::EndFrame;
+  command.snapshot.vram_writes = vram_writes_pushed_;
+  push_command(command);
+}
+
+FrameDestination RenderThread::latest_frame() {
+  frames_.update();
+  return {frames_.front().pixels.data(), pitch_};
+}
+
+void RenderThread::push_command(const Command& command) {
+  while (!commands_.push(command)) {
+    wake_worker();
+    std::this_thread::yield();
+  }
+  wake_worker();
+}
+
+void RenderThread::wake_worker() {
+  wakeups_.fetch_add(1, std::memory_order_release);
+  wakeups_.notify_one();
+}
+
+void RenderThread::run() {
+  Command command;
+  while (running_.load(std::memory_order_acquire)) {
+    // Read these before checking for work so a wake up between the check and the wait isn't lost
+    const uint32_t wakeups = wakeups_.load(std::memory_order_acquire);
+    const uint64_t drainable = drainable_vram_writes_.load(std::memory_order_acquire);
+
+    if (commands_.pop(command)) {
+      apply_vram_writes(command.snapshot.vram_writes);
+      if (command.type == Command::Type::Scanline) {
+        renderer_.render(command.snapshot);
+      } else {
+        game_screen_.finish_frame();
+        frames_.back().hash = game_screen_.frame_hash();
+        finished_hashes_.push(frames_.back().hash);
+        frames_.publish();
+        start_next_frame();
+      }
+      continue;
+    }
+
+    // No scanline is queued, so the writes counted in drainable can't belong after one
+    apply_vram_writes(drainable);
+    wakeups_.wait(wakeups, std::memory_order_acquire);
+  }
+}
+
+void RenderThread::apply_vram_writes(uint64_t count) {
+  VRAMWrite write;
+  while (vram_writes_applied_ < count && vram_writes_.pop(write)) {
+    vram_[write.offset] = write.value;
+    tile_map_cache_.vram_written(write.offset);
+    vram_writes_applied_++;
+  }
+}
+
+void RenderThread::start_next_frame() {
+  game_screen_.set_destination({frames_.back().pixels.data(), pitch_});
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include "game_screen.h"
+#include "ppu_constants.h"
+#include "scanline_renderer.h"
+#include "spsc_ring_buffer.h"
+#include "tile_map_cache.h"
+#include "triple_buffer.h"
+
+// Rasterises scanlines on a worker thread. The emulation thread forwards every VRAM write and one
+// ScanlineSnapshot per rendered line through lock-free queues. The worker keeps its own copy of VRAM, draws
+// the lines and hands finished frames back through a triple buffer. All timing stays on the emulation thread.
+class RenderThread {
+public:
+  RenderThread(const std::array<unsigned char, VRAM_SIZE>& vram, PixelFormat format);
+  ~RenderThread();
+
+  RenderThread(const RenderThread&) = delete;
+  RenderThread& operator=(const RenderThread&) = delete;
+
+  // Emulation thread side
+  void write_vram(uint16_t addr, uint8_t value);
+  void submit_scanline(ScanlineSnapshot snapshot);
+  void end_frame();
+
+  // The newest frame the worker has finished. This is normally the frame before the one just ended.
+  FrameDestination latest_frame();
+  // GameScreen::frame_hash() of the frame last returned by latest_frame()
+  uint64_t latest_frame_hash() const { return frames_.front().hash; }
+  // The hash of every frame the worker has finished, oldest first, for callers that need all of them rather
+  // than the newest (e.g. checking a trace replay). False if none is waiting. Once FINISHED_HASH_QUEUE_SIZE
+  // are waiting, newer ones are dropped.
+  bool pop_finished_frame_hash(uint64_t& hash) { return finished_hashes_.pop(hash); }
+
+private:
+  struct VRAMWrite {
+    uint16_t offset;
+    uint8_t value;
+  };
+
+  struct Frame {
+    std::vector<uint32_t> pixels;
+    uint64_t hash = 0;
+  };
+
+  struct Command {
+    enum class Type : uint8_t { Scanline, EndFrame };
+    Type type = Type::Scanline;
+    ScanlineSnapshot snapshot;
+  };
+
+  void run();
+  void push_command(const Command& command);
+  void apply_vram_writes(uint64_t count);
+  void wake_worker();
+  void start_next_frame();
+
+  static constexpr size_t VRAM_WRITE_QUEUE_SIZE = 32768;
+  static constexpr size_t COMMAND_QUEUE_SIZE = 512;
+  static constexpr size_t FINISHED_HASH_QUEUE_SIZE = 64;
+
+  // Owned by the worker
+  std::array<unsigned char, VRAM_SIZE> vram_;
+  TileMapCache tile_map_cache_;
+  GameScreen game_screen_;
+  ScanlineRenderer renderer_;
+  uint64_t vram_writes_applied_ = 0;
+
+  // Shared
+  PixelFormat format_;
+  size_t pitch_;
+  TripleBuffer<Frame> frames_;
+  SPSCRingBuffer<VRAMWrite, VRAM_WRITE_QUEUE_SIZE> vram_writes_;
+  SPSCRingBuffer<Command, COMMAND_QUEUE_SIZE> commands_;
+  SPSCRingBuffer<uint64_t, FINISHED_HASH_QUEUE_SIZE> finished_hashes_;
+  std::atomic<uint64_t> drainable_vram_writes_{0};  // VRAM writes that may be applied with no scanline pending
+  std::atomic<uint32_t> wakeups_{0};
+  std::atomic<bool> running_{true};
+
+  // Owned by the emulation thread
+  uint64_t vram_writes_pushed_ = 0;
+
+  std::thread thread_;
+};
@@ -1,25 +1,35 @@
 #pragma once
 
 #include <inttypes.h>
-
-struct RGBValue {
-  uint32_t argb = 0xFF000000u;
-  uint8_t index = 0;
-};
+#include <array>
 
 constexpr uint32_t make_argb(uint8_t r, uint8_t g, uint8_t b) {
   return 0xFF000000u | (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) |
          static_cast<uint32_t>(b);
 }
 
-constexpr RGBValue make_rgb(uint8_t r, uint8_t g, uint8_t b) {
-  return RGBValue{make_argb(r, g, b), 0};
+constexpr uint16_t make_rgb565(uint8_t r, uint8_t g, uint8_t b) {
+  return static_cast<uint16_t>(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3));
 }
 
-struct RGBAValue : public RGBValue {
-  RGBAValue() = default;
-  RGBAValue(const RGBAValue&) = default;
-  RGBAValue(RGBValue rgb, bool active, bool priority) : RGBValue(rgb), active(active), priority(priority) {}
+// Shades are what the palettes map colour indices to, and what the PPU renders into the frame buffer.
+namespace GameBoyShades {
+constexpr uint8_t WHITE = 0;
+constexpr uint8_t LIGHT_GRAY = 1;
+constexpr uint8_t DARK_GRAY = 2;
+constexpr uint8_t BLACK = 3;
+}  // namespace GameBoyShades
+
+// Output colours for each shade, used by the VBlank conversion pass.
+namespace GameBoyColors {
+constexpr std::array<uint32_t, 4> ARGB8888 = {make_argb(255, 255, 255), make_argb(170, 170, 170),
+                                              make_argb(85, 85, 85), make_argb(0, 0, 0)};
+constexpr std::array<uint16_t, 4> RGB565 = {make_rgb565(255, 255, 255), make_rgb565(170, 170, 170),
+                                            make_rgb565(85, 85, 85), make_rgb565(0, 0, 0)};
+}  // namespace GameBoyColors
+
+struct ObjectPixel {
+  uint8_t shade = GameBoyShades::BLACK;
   bool active = false;
   bool priority = false;
 };
@@ -0,0 +1,205 @@
+#include "scanline_renderer.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include "palette.h"
+#include "ppu_constants.h"
+
+namespace {
+constexpr uint8_t PIXEL_BIT_SHIFT = 7;
+constexpr uint8_t BYTES_PER_TILE_ROW = 2;
+
+[[gnu::always_inline]] inline uint8_t get_half_pixel(uint8_t data, uint8_t pixel) {
+  return (data >> (PIXEL_BIT_SHIFT - pixel)) & 1;
+}
+
+[[gnu::always_inline]] inline uint8_t get_pixel(const uint8_t* data, uint8_t pixel) {
+  return get_half_pixel(data[0], pixel) | get_half_pixel(data[1], pixel) << 1;
+}
+
+uint16_t get_bg_tile_map_address(uint8_t lcdc, uint32_t x, uint32_t y) {
+  const uint16_t tile_map_base_address = (lcdc & LCDC_BG_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+  uint8_t tile_x = x / TILE_WIDTH;
+  uint8_t tile_y = y / TILE_HEIGHT;
+  return tile_map_base_address + ((tile_y * TILES_PER_ROW) + tile_x);
+}
+
+uint16_t get_win_tile_map_address(uint8_t lcdc, uint32_t x, uint32_t y) {
+  const uint16_t tile_map_base_address = (lcdc & LCDC_WINDOW_TILE_MAP) ? TILE_MAP_BASE_1 : TILE_MAP_BASE_0;
+  return tile_map_base_address + ((y / TILE_HEIGHT) * TILES_PER_ROW + (x / TILE_WIDTH));
+}
+
+uint16_t get_bgwin_tile_address(uint8_t lcdc, uint16_t tile_index) {
+  if (lcdc & LCDC_TILE_DATA) {
+    return TILE_DATA_BASE_0 + (tile_index * TILE_SIZE_BYTES);
+  } else {
+    const int8_t signed_index = (int8_t)tile_index;
+    return TILE_DATA_BASE_1 + (signed_index * TILE_SIZE_BYTES);
+  }
+}
+
+uint16_t get_obj_tile_address(uint16_t tile_index) {
+  return TILE_DATA_BASE_0 + (tile_index * TILE_SIZE_BYTES);
+}
+}  // namespace
+
+void ScanlineRenderer::render(const ScanlineSnapshot& snapshot) {
+  if (tile_map_cache_ && snapshot.line == 0) {
+    tile_map_cache_->start_frame();
+  }
+  render_background(snapshot);
+  render_objects(snapshot);
+  game_screen_.finish_line(snapshot.line);
+}
+
+void ScanlineRenderer::render_objects(const ScanlineSnapshot& snapshot) {
+  if ((snapshot.lcdc & LCDC_SPRITE_ENABLE) == 0) {
+    return;
+  }
+
+  const bool big_tile_mode = (snapshot.lcdc & LCDC_SPRITE_SIZE) != 0;
+  const uint8_t scanline = snapshot.line;
+
+  for (int32_t x = 0; x < (int32_t)SCREEN_WIDTH; x++) {
+    for (uint8_t i = 0; i < snapshot.object_count; i++) {
+      const ObjectAttribute* object = &snapshot.objects[i];
+
+      const int16_t object_left_position = object->x - SPRITE_X_OFFSET;
+      const int16_t object_right_position = object->x - 1;  // Rightmost pixel
+      const int16_t object_top_position = object->y - SPRITE_Y_OFFSET;
+      if (x < object_left_position || x > object_right_position)
+        continue;  // Not in range, check next object
+
+      uint32_t pixel_x = (int16_t)x - object_left_position;
+      uint32_t pixel_y = (int16_t)scanline - object_top_position;
+
+      // Handle flip X/Y
+      if (object->flip_x())
+        pixel_x = (TILE_PIXELS_PER_ROW - 1) - pixel_x;
+      if (object->flip_y()) {
+        uint8_t sprite_height = big_tile_mode ? SPRITE_HEIGHT_8X16 : SPRITE_HEIGHT_8X8;
+        pixel_y = sprite_height - pixel_y;
+      }
+
+      uint8_t tile_index = object->index;
+      if (big_tile_mode) {
+        // In 8x16 mode, bit 0 is ignored and two consecutive tiles are used
+        constexpr uint8_t TILE_INDEX_BIT_0_MASK = 0xFE;
+        constexpr uint8_t TILE_INDEX_BIT_0_SET = 0x01;
+        tile_index &= TILE_INDEX_BIT_0_MASK;  // Clear bit 0
+        if (pixel_y >= TILE_HEIGHT) {
+          tile_index |= TILE_INDEX_BIT_0_SET;  // Use second tile for bottom half
+          pixel_y -= TILE_HEIGHT;
+        }
+      }
+
+      const uint16_t tile_address = get_obj_tile_address(tile_index);
+      const uint16_t tile_row_address = tile_address + (pixel_y * BYTES_PER_TILE_ROW);
+      const uint8_t* byte1 = &vram_[tile_row_address - VRAM_BASE_ADDRESS];
+      const uint8_t colour_index = get_pixel(byte1, pixel_x);
+
+      const uint8_t palette = object->dmg_palette_obp1() ? snapshot.obp1 : snapshot.obp0;
+      game_screen_.draw_object_pixel(
+          x, scanline, {apply_palette(palette, colour_index), colour_index != 0, object->priority()});
+
+      constexpr uint8_t TRANSPARENT_COLOR_INDEX = 0;
+      if (colour_index == TRANSPARENT_COLOR_INDEX) {
+        continue;
+      }
+
+      break;  // Found object for this pixel, stop checking others
+    }
+  }
+}
+
+void ScanlineRenderer::render_background(const ScanlineSnapshot& snapshot) {
+  const uint8_t scanline = snapshot.line;
+  if ((snapshot.lcdc & LCDC_BG_ENABLE) == 0) {
+    for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+      game_screen_.draw_background_pixel(x, scanline, 0, GameBoyShades::WHITE);
+    }
+    return;
+  }
+
+  const uint8_t lcdc = snapshot.lcdc;
+  const uint8_t wx = snapshot.wx;
+  const std::array<uint8_t, 4> bg_shades = {apply_palette(snapshot.bgp, 0), apply_palette(snapshot.bgp, 1),
+                                            apply_palette(snapshot.bgp, 2), apply_palette(snapshot.bgp, 3)};
+  if (snapshot.use_tile_map_cache && tile_map_cache_ && tile_map_cache_->active()) {
+    render_background_cached(snapshot, bg_shades);
+    return;
+  }
+
+  const uint32_t window_y = snapshot.window_line;
+  const uint32_t background_y = (scanline + snapshot.scy) & 0xFF;
+
+  // Render only the specified scanline
+  for (uint32_t x = 0; x < SCREEN_WIDTH; x++) {
+    uint16_t map_x, map_y;
+    uint16_t tile_map_address;
+
+    // Check if we should render window or background at this pixel
+    // Window X position is WX - 7, and window is only visible if x + 7 >= WX
+    if (snapshot.window_visible && (x + WINDOW_X_OFFSET >= wx)) {
+      // Render window pixel
+      // Window has its own internal coordinate system starting at (0,0)
+      const uint16_t window_x = x + WINDOW_X_OFFSET - wx;
+
+      tile_map_address = get_win_tile_map_address(lcdc, window_x, window_y);
+      map_x = window_x;
+      map_y = window_y;
+    } else {
+      // Render background pixel
+      map_x = (x + snapshot.scx) & 0xFF;
+      map_y = background_y;
+      tile_map_address = get_bg_tile_map_address(lcdc, map_x, map_y);
+    }
+
+    const uint8_t tile_index = vram_[tile_map_address - VRAM_BASE_ADDRESS];
+    const uint16_t tile_data_address = get_bgwin_tile_address(lcdc, tile_index);
+
+    // Pixel position within the 8x8 tile
+    const uint16_t pixel_x = map_x % TILE_WIDTH;
+    const uint16_t pixel_y = map_y % TILE_HEIGHT;
+
+    const uint16_t tile_row_address = tile_data_address + (pixel_y * BYTES_PER_TILE_ROW);
+    const uint8_t* byte1 = &vram_[tile_row_address - VRAM_BASE_ADDRESS];
+    const uint8_t colour_index = get_pixel(byte1, pixel_x);
+    game_screen_.draw_background_pixel(x, scanline, colour_index, bg_shades[colour_index]);
+  }
+}
+
+// Copies the background, then the window, out of the tile map cache's layers
+void ScanlineRenderer::render_background_cached(const ScanlineSnapshot& snapshot,
+                                                const std::array<uint8_t, 4>& bg_shades) {
+  const uint8_t lcdc = snapshot.lcdc;
+  const bool unsigned_tile_data = lcdc & LCDC_TILE_DATA;
+  std::array<uint8_t, SCREEN_WIDTH> color_indices;
+
+  // The window covers every pixel from x = WX - 7
+  uint32_t window_start = SCREEN_WIDTH;
+  if (snapshot.window_visible) {
+    window_start = std::min<uint32_t>(SCREEN_WIDTH, std::max(snapshot.wx, WINDOW_X_OFFSET) - WINDOW_X_OFFSET);
+  }
+
+  if (window_start > 0) {
+    const uint8_t map = (lcdc & LCDC_BG_TILE_MAP) ? 1 : 0;
+    const uint8_t y = snapshot.line + snapshot.scy;
+    const uint8_t* row = tile_map_cache_->row(map, unsigned_tile_data, y, snapshot.scx, window_start);
+
+    // The background wraps around at 256 pixels
+    const uint32_t before_wrap = std::min<uint32_t>(window_start, TILE_MAP_PIXELS - snapshot.scx);
+    std::memcpy(color_indices.data(), row + snapshot.scx, before_wrap);
+    std::memcpy(color_indices.data() + before_wrap, row, window_start - before_wrap);
+  }
+
+  if (window_start < SCREEN_WIDTH) {
+    const uint8_t map = (lcdc & LCDC_WINDOW_TILE_MAP) ? 1 : 0;
+    const uint8_t window_x = window_start + WINDOW_X_OFFSET - snapshot.wx;
+    const uint16_t width = SCREEN_WIDTH - window_start;
+    const uint8_t* row = tile_map_cache_->row(map, unsigned_tile_data, snapshot.window_line, window_x, width);
+    std::memcpy(color_indices.data() + window_start, row + window_x, width);
+  }
+
+  game_screen_.draw_background_line(snapshot.line, color_indices.data(), bg_shades);
+}
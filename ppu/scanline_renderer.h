@@ -0,0 +1,48 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include "game_screen.h"
+#include "object_attributes.h"
+#include "ppu_constants.h"
+#include "tile_map_cache.h"
+
+// Everything needed to draw one scanline, captured at the start of mode 3. Rendering only ever reads from a
+// snapshot and VRAM, so it can happen on another thread (see RenderThread).
+struct ScanlineSnapshot {
+  uint8_t line = 0;
+  uint8_t lcdc = 0;
+  uint8_t scx = 0;
+  uint8_t scy = 0;
+  uint8_t wx = 0;
+  uint8_t wy = 0;
+  uint8_t bgp = 0;
+  uint8_t obp0 = 0;
+  uint8_t obp1 = 0;
+  bool use_tile_map_cache = false;
+  bool window_visible = false;
+  uint8_t window_line = 0;  // Value of the internal window line counter for this scanline
+  uint8_t object_count = 0;
+  std::array<ObjectAttribute, MAX_SPRITES_PER_SCANLINE> objects{};  // Sorted by drawing priority
+  uint64_t vram_writes = 0;  // Number of VRAM writes that happened before this scanline, used by RenderThread
+};
+
+class ScanlineRenderer {
+public:
+  // vram must point at VRAM_SIZE bytes and outlive the renderer. tile_map_cache is optional, and must be told
+  // about every write to the same VRAM.
+  ScanlineRenderer(const uint8_t* vram, GameScreen& game_screen, TileMapCache* tile_map_cache = nullptr)
+      : vram_(vram), game_screen_(game_screen), tile_map_cache_(tile_map_cache) {}
+
+  // Draws the scanline into the GameScreen and converts it into the output pixel format
+  void render(const ScanlineSnapshot& snapshot);
+
+private:
+  void render_background(const ScanlineSnapshot& snapshot);
+  void render_background_cached(const ScanlineSnapshot& snapshot, const std::array<uint8_t, 4>& bg_shades);
+  void render_objects(const ScanlineSnapshot& snapshot);
+
+  const uint8_t* vram_;
+  GameScreen& game_screen_;
+  TileMapCache* tile_map_cache_;
+};
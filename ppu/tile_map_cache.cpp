@@ -0,0 +1,96 @@
+#include "tile_map_cache.h"
+
+namespace {
+// VRAM writes in a frame (tile data bytes or map entries) that still count as quiet. A handful of animated
+// tiles and a scrolling column or two of map fit under this, streaming graphics doesn't.
+constexpr uint32_t MAX_QUIET_INVALIDATIONS = 128;
+constexpr uint32_t QUIET_FRAMES_TO_ACTIVATE = 30;
+constexpr uint8_t PIXEL_BIT_SHIFT = 7;
+constexpr uint8_t BYTES_PER_TILE_ROW = 2;
+constexpr uint16_t SIGNED_TILE_DATA_SLOT_BASE = (TILE_DATA_BASE_1 - VRAM_BASE_ADDRESS) / TILE_SIZE_BYTES;
+
+// Slot (16 byte tile in 0x8000-0x97FF) that a tile map entry refers to
+inline uint16_t tile_data_slot(uint8_t tile_index, bool unsigned_tile_data) {
+  if (unsigned_tile_data) {
+    return tile_index;
+  }
+  return SIGNED_TILE_DATA_SLOT_BASE + static_cast<int8_t>(tile_index);
+}
+}  // namespace
+
+TileMapCache::TileMapCache(const uint8_t* vram) : vram_(vram) {}
+
+void TileMapCache::invalidate_all() {
+  for (Layer& layer : layers_) {
+    layer.valid.fill(false);
+  }
+}
+
+void TileMapCache::start_frame() {
+  if (active_) {
+    // Drawing a tile into a layer decodes all 64 of its pixels, while drawing from VRAM decodes 8 for each
+    // line the tile is on. The first frame after turning on draws everything, so it isn't judged.
+    if (!warming_up_ && tiles_drawn_ * TILE_WIDTH * TILE_HEIGHT > tiles_used_ * TILE_WIDTH) {
+      active_ = false;
+    }
+    warming_up_ = false;
+    quiet_frames_ = 0;
+  } else if (invalidations_ <= MAX_QUIET_INVALIDATIONS) {
+    if (++quiet_frames_ == QUIET_FRAMES_TO_ACTIVATE) {
+      active_ = true;
+      warming_up_ = true;
+    }
+  } else {
+    quiet_frames_ = 0;
+  }
+
+  invalidations_ = 0;
+  tiles_drawn_ = 0;
+  tiles_used_ = 0;
+}
+
+const uint8_t* TileMapCache::row(uint8_t map, bool unsigned_tile_data, uint8_t y, uint8_t x, uint16_t width) {
+  Layer& layer = layers_[map];
+  if (layer.unsigned_tile_data != unsigned_tile_data) {
+    layer.unsigned_tile_data = unsigned_tile_data;
+    layer.valid.fill(false);
+  }
+
+  const uint8_t* tile_map = &vram_[TILE_MAP_OFFSET + map * TILE_MAP_TILES];
+  const uint16_t first_tile = (y / TILE_HEIGHT) * TILES_PER_ROW;
+  const uint16_t tile_count = ((x % TILE_WIDTH) + width + TILE_WIDTH - 1) / TILE_WIDTH;
+  for (uint16_t i = 0; i < tile_count; i++) {
+    const uint16_t tile = first_tile + ((x / TILE_WIDTH + i) % TILES_PER_ROW);
+    const uint16_t slot = tile_data_slot(tile_map[tile], unsigned_tile_data);
+    if (!layer.valid[tile] || layer.tile_data_slots[tile] != slot ||
+        layer.tile_data_versions[tile] != tile_data_versions_[slot]) {
+      draw_tile(layer, map, tile);
+    }
+  }
+  tiles_used_ += tile_count;
+
+  return &layer.pixels[y * LAYER_WIDTH];
+}
+
+void TileMapCache::draw_tile(Layer& layer, uint8_t map, uint16_t tile) {
+  const uint8_t tile_index = vram_[TILE_MAP_OFFSET + map * TILE_MAP_TILES + tile];
+  const uint16_t slot = tile_data_slot(tile_index, layer.unsigned_tile_data);
+  const uint8_t* tile_data = &vram_[slot * TILE_SIZE_BYTES];
+
+  uint8_t* pixels = &layer.pixels[(tile / TILES_PER_ROW) * TILE_HEIGHT * LAYER_WIDTH +
+                                  (tile % TILES_PER_ROW) * TILE_WIDTH];
+  for (uint8_t row = 0; row < TILE_HEIGHT; row++) {
+    const uint8_t low = tile_data[row * BYTES_PER_TILE_ROW];
+    const uint8_t high = tile_data[row * BYTES_PER_TILE_ROW + 1];
+    for (uint8_t pixel = 0; pixel < TILE_WIDTH; pixel++) {
+      const uint8_t shift = PIXEL_BIT_SHIFT - pixel;
+      pixels[pixel] = ((low >> shift) & 1) | (((high >> shift) & 1) << 1);
+    }
+    pixels += LAYER_WIDTH;
+  }
+
+  layer.valid[tile] = true;
+  layer.tile_data_slots[tile] = slot;
+  layer.tile_data_versions[tile] = tile_data_versions_[slot];
+  tiles_drawn_++;
+}
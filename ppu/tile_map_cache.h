@@ -0,0 +1,68 @@
+#pragma once
+
+#include <inttypes.h>
+#include <array>
+#include <vector>
+#include "ppu_constants.h"
+
+// Both tile maps drawn out as 256x256 layers of colour indices, so a background or window line is a copy out
+// of a layer instead of a tile fetch and decode per pixel. Tiles are redrawn lazily when a line needs them:
+// a tile map write marks its tile stale, and a tile data write bumps that tile's version, which stales every
+// map tile drawn from it.
+//
+// Games that stream tiles into VRAM would mostly be redrawing tiles, so the cache only turns itself on once
+// VRAM has been quiet for a while, and off again when it finds itself redrawing more than it saves.
+class TileMapCache {
+public:
+  explicit TileMapCache(const uint8_t* vram);
+
+  // Must be called for every VRAM write, with the offset into VRAM
+  void vram_written(uint16_t offset) {
+    invalidations_++;
+    if (offset < TILE_MAP_OFFSET) {
+      tile_data_versions_[offset / TILE_SIZE_BYTES]++;
+    } else {
+      const uint16_t map_offset = offset - TILE_MAP_OFFSET;
+      layers_[map_offset / TILE_MAP_TILES].valid[map_offset % TILE_MAP_TILES] = false;
+    }
+  }
+
+  // After VRAM was replaced wholesale, e.g. by loading a save state
+  void invalidate_all();
+
+  // Call once per rendered frame. Turns the cache on or off depending on how the last frame went.
+  void start_frame();
+  bool active() const { return active_; }
+
+  // Row `y` of tile map `map` (0 for 0x9800, 1 for 0x9C00), with the tiles covering pixels [x, x + width)
+  // brought up to date. x wraps at 256.
+  const uint8_t* row(uint8_t map, bool unsigned_tile_data, uint8_t y, uint8_t x, uint16_t width);
+
+private:
+  static constexpr uint16_t TILE_MAP_OFFSET = TILE_MAP_BASE_0 - VRAM_BASE_ADDRESS;
+  static constexpr uint16_t TILE_MAP_TILES = TILES_PER_ROW * TILES_PER_ROW;
+  static constexpr uint16_t LAYER_WIDTH = TILE_MAP_PIXELS;
+  static constexpr uint16_t TILE_DATA_SLOTS = TILE_MAP_OFFSET / TILE_SIZE_BYTES;
+
+  struct Layer {
+    std::vector<uint8_t> pixels = std::vector<uint8_t>(LAYER_WIDTH * LAYER_WIDTH);
+    std::array<bool, TILE_MAP_TILES> valid{};
+    std::array<uint16_t, TILE_MAP_TILES> tile_data_slots{};  // Slot each tile was drawn from
+    std::array<uint32_t, TILE_MAP_TILES> tile_data_versions{};  // Version of that slot when it was drawn
+    bool unsigned_tile_data = true;  // Which tile data area the layer was drawn with
+  };
+
+  void draw_tile(Layer& layer, uint8_t map, uint16_t tile);
+
+  const uint8_t* vram_;
+  std::array<Layer, 2> layers_;
+  std::array<uint32_t, TILE_DATA_SLOTS> tile_data_versions_{};
+
+  // Adaptive enabling
+  bool active_ = false;
+  bool warming_up_ = false;
+  uint32_t quiet_frames_ = 0;
+  uint32_t invalidations_ = 0;
+  uint32_t tiles_drawn_ = 0;
+  uint32_t tiles_used_ = 0;
+};
@@ -1,7 +1,9 @@
 #include "rom_loader.h"
 #include <algorithm>
+#include <cstring>
 #include <fstream>
 #include <iostream>
+#include <utility>
 #include "constants.h"
 #include "utils.h"
 
@@ -34,6 +36,11 @@ ROMLoader::ROMLoader(const ROMHeader& header) : should_initialise_mbc_(false) {
   memcpy(data_.data() + ROM_START, &header, sizeof(ROMHeader));
 }
 
+ROMLoader::ROMLoader(std::vector<unsigned char> image)
+    : cart_size_(static_cast<uint32_t>(image.size())),
+      data_(std::move(image)),
+      should_initialise_mbc_(true) {}
+
 bool ROMLoader::load() {
   std::ifstream file(cartridge_name_, std::ios::binary);
   if (!file) {
@@ -11,6 +11,8 @@ public:
   ROMLoader(const std::string& cartridge_name, const std::string& boot_rom_name)
       : cartridge_name_(cartridge_name), boot_rom_name_(boot_rom_name), should_initialise_mbc_(true) {}
   ROMLoader(const ROMHeader& header);
+  // A cartridge built in memory, with a header and a whole number of ROM banks. No load() needed.
+  explicit ROMLoader(std::vector<unsigned char> image);
 
   bool load();
   std::string get_load_error() const { return load_error_; }
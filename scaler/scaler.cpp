@@ -0,0 +1,131 @@
+#include "scaler.h"
+#include <algorithm>
+#include <cstring>
+
+Scaler::Scaler(ScalerISA isa) : isa_(std::min(isa, best_supported_isa())), kernels_(&SCALAR_KERNELS) {
+  switch (isa_) {
+    case ScalerISA::Scalar:
+      break;
+    case ScalerISA::SSE2:
+#if defined(SCALER_SSE2)
+      kernels_ = &SSE2_KERNELS;
+#endif
+      break;
+    case ScalerISA::AVX2:
+#if defined(SCALER_AVX2)
+      kernels_ = &AVX2_KERNELS;
+#endif
+      break;
+  }
+}
+
+ScalerISA Scaler::best_supported_isa() {
+#if defined(SCALER_AVX2)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return ScalerISA::AVX2;
+  }
+#endif
+#if defined(SCALER_SSE2)
+  return ScalerISA::SSE2;
+#else
+  return ScalerISA::Scalar;
+#endif
+}
+
+bool Scaler::scale(ScaleFilter filter, uint32_t factor, const uint32_t* source, size_t source_pitch,
+                   uint32_t width, uint32_t height, void* destination, size_t destination_pitch) {
+  factor = std::clamp(factor, MIN_SCALE_FACTOR, MAX_SCALE_FACTOR);
+  source_ = source;
+  source_pitch_ = source_pitch;
+  destination_ = static_cast<uint8_t*>(destination);
+  destination_pitch_ = destination_pitch;
+  row_bytes_ = width * factor * sizeof(uint32_t);
+  row_.resize((width * factor) + ROW_SLACK_PIXELS);
+
+  switch (filter) {
+    case ScaleFilter::Nearest:
+      scale_nearest(factor, width, height);
+      return true;
+    case ScaleFilter::Scale2x:
+      scale_scale2x(factor, width, height);
+      return true;
+    case ScaleFilter::LCDGrid:
+      return scale_lcd_grid(factor, width, height);
+  }
+  return true;
+}
+
+void Scaler::scale_nearest(uint32_t factor, uint32_t width, uint32_t height) {
+  for (uint32_t y = 0; y < height; y++) {
+    kernels_->expand_row(source_row(y), width, factor, factor, row_.data());
+    write_rows(y * factor, factor);
+  }
+}
+
+// Scale2x makes a 2x2 block per pixel. At other factors the left/top sub-pixels get the larger half of the
+// block, so 2x is exact and 4x and 6x are Scale2x followed by nearest.
+void Scaler::scale_scale2x(uint32_t factor, uint32_t width, uint32_t height) {
+  const uint32_t padded_width = width + 2;
+  padded_.resize(padded_width * (height + 2));
+  for (uint32_t y = 0; y < height; y++) {
+    uint32_t* padded_row = &padded_[(y + 1) * padded_width];
+    std::memcpy(padded_row + 1, source_row(y), width * sizeof(uint32_t));
+    padded_row[0] = padded_row[1];
+    padded_row[width + 1] = padded_row[width];
+  }
+  std::memcpy(&padded_[0], &padded_[padded_width], padded_width * sizeof(uint32_t));
+  std::memcpy(&padded_[(height + 1) * padded_width], &padded_[height * padded_width],
+              padded_width * sizeof(uint32_t));
+
+  top_.resize((width * 2) + ROW_SLACK_PIXELS);
+  bottom_.resize((width * 2) + ROW_SLACK_PIXELS);
+  const uint32_t first = (factor + 1) / 2;
+  const uint32_t second = factor / 2;
+  for (uint32_t y = 0; y < height; y++) {
+    const uint32_t* row = &padded_[((y + 1) * padded_width) + 1];
+    kernels_->scale2x_row(row - padded_width, row, row + padded_width, width, top_.data(), bottom_.data());
+
+    kernels_->expand_row(top_.data(), width * 2, first, second, row_.data());
+    write_rows(y * factor, first);
+    kernels_->expand_row(bottom_.data(), width * 2, first, second, row_.data());
+    write_rows((y * factor) + first, second);
+  }
+}
+
+// The frame is first blended into the ghost frame, which is what gets drawn. The last row and column of every
+// block are the darker grid lines.
+bool Scaler::scale_lcd_grid(uint32_t factor, uint32_t width, uint32_t height) {
+  bool settled = true;
+  if (!ghosting_valid_ || ghost_.size() != width * height) {
+    ghost_.resize(width * height);
+    for (uint32_t y = 0; y < height; y++) {
+      std::memcpy(&ghost_[y * width], source_row(y), width * sizeof(uint32_t));
+    }
+    ghosting_valid_ = true;
+  } else {
+    for (uint32_t y = 0; y < height; y++) {
+      if (kernels_->blend_ghost_row(source_row(y), &ghost_[y * width], width)) {
+        settled = false;
+      }
+    }
+  }
+
+  dark_.resize(width + ROW_SLACK_PIXELS);
+  for (uint32_t y = 0; y < height; y++) {
+    const uint32_t* ghost_row = &ghost_[y * width];
+    kernels_->darken_row(ghost_row, dark_.data(), width);
+
+    kernels_->expand_row_grid(ghost_row, dark_.data(), width, factor, row_.data());
+    write_rows(y * factor, factor - 1);
+    kernels_->expand_row(dark_.data(), width, factor, factor, row_.data());
+    write_rows((y * factor) + factor - 1, 1);
+  }
+  return settled;
+}
+
+void Scaler::write_rows(uint32_t first_row, uint32_t count) {
+  for (uint32_t y = first_row; y < first_row + count; y++) {
+    std::memcpy(destination_ + (y * destination_pitch_), row_.data(), row_bytes_);
+  }
+}
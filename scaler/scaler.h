@@ -0,0 +1,68 @@
+#pragma once
+
+#include <inttypes.h>
+#include <cstddef>
+#include <vector>
+#include "scaler_constants.h"
+#include "scaler_kernels.h"
+
+enum class ScaleFilter : uint8_t {
+  Nearest,  // Every pixel becomes a factor x factor block
+  Scale2x,  // Scale2x/EPX edge smoothing, with each of the four sub-pixels then grown to fill the block
+  LCDGrid   // Nearest with darker lines between pixels, and the DMG LCD's slow response blended in
+};
+
+enum class ScalerISA : uint8_t { Scalar, SSE2, AVX2 };
+
+// Integer upscaler for ARGB8888 frames. Each output row is built once in a cache-resident buffer and copied
+// into the destination `factor` times, so the destination (e.g. a locked streaming texture) is only ever
+// written. The kernels are chosen at runtime for the best instruction set the CPU supports.
+class Scaler {
+public:
+  explicit Scaler(ScalerISA isa = best_supported_isa());
+
+  static ScalerISA best_supported_isa();
+  ScalerISA isa() const { return isa_; }
+
+  // Scales a width x height frame into `destination`, which must hold (width * factor) x (height * factor)
+  // pixels. factor must be MIN_SCALE_FACTOR to MAX_SCALE_FACTOR. Returns false while LCDGrid's ghosting is
+  // still fading towards the frame, so the caller knows to keep scaling the same frame until it settles.
+  bool scale(ScaleFilter filter, uint32_t factor, const uint32_t* source, size_t source_pitch, uint32_t width,
+             uint32_t height, void* destination, size_t destination_pitch);
+
+  // Drops the LCD ghosting history, e.g. when a different ROM is loaded
+  void reset_ghosting() { ghosting_valid_ = false; }
+
+private:
+  void scale_nearest(uint32_t factor, uint32_t width, uint32_t height);
+  void scale_scale2x(uint32_t factor, uint32_t width, uint32_t height);
+  bool scale_lcd_grid(uint32_t factor, uint32_t width, uint32_t height);
+  void write_rows(uint32_t first_row, uint32_t count);
+
+  const uint32_t* source_row(uint32_t y) const {
+    return reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(source_) + (y * source_pitch_));
+  }
+
+  ScalerISA isa_;
+  const ScalerKernels* kernels_;
+
+  // The frame being scaled
+  const uint32_t* source_ = nullptr;
+  size_t source_pitch_ = 0;
+  uint8_t* destination_ = nullptr;
+  size_t destination_pitch_ = 0;
+  size_t row_bytes_ = 0;
+
+  // Scratch rows, each with ROW_SLACK_PIXELS spare
+  std::vector<uint32_t> row_;
+  std::vector<uint32_t> top_;
+  std::vector<uint32_t> bottom_;
+  std::vector<uint32_t> dark_;
+
+  // Scale2x reads one pixel around every pixel, so the frame is copied with its edges repeated
+  std::vector<uint32_t> padded_;
+
+  // LCD ghosting
+  std::vector<uint32_t> ghost_;
+  bool ghosting_valid_ = false;
+};
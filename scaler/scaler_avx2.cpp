@@ -0,0 +1,93 @@
+#include "scaler_constants.h"
+#include "scaler_kernels.h"
+
+// Built with AVX2 enabled. Nothing here may run unless Scaler::best_supported_isa() found AVX2.
+#if defined(SCALER_AVX2)
+#include <immintrin.h>
+
+namespace {
+constexpr uint32_t PIXELS_PER_VECTOR = 8;
+
+[[gnu::always_inline]] inline __m256i load(const uint32_t* pixels) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pixels));
+}
+
+[[gnu::always_inline]] inline void store(uint32_t* pixels, __m256i value) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels), value);
+}
+
+// A block is at most 6 pixels wide, so one store of a broadcast pixel always covers it
+void expand_row(const uint32_t* source, uint32_t count, uint32_t even_width, uint32_t odd_width,
+                uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    store(destination, _mm256_set1_epi32(static_cast<int>(source[x])));
+    destination += (x & 1) ? odd_width : even_width;
+  }
+}
+
+void expand_row_grid(const uint32_t* source, const uint32_t* dark, uint32_t count, uint32_t width,
+                     uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    store(destination, _mm256_set1_epi32(static_cast<int>(source[x])));
+    destination[width - 1] = dark[x];
+    destination += width;
+  }
+}
+
+// The unpacks interleave within each 128-bit half, so the halves are swapped back into order before storing
+void scale2x_row(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t count, uint32_t* top,
+                 uint32_t* bottom) {
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m256i b = load(above + x);
+    const __m256i d = load(row + x - 1);
+    const __m256i e = load(row + x);
+    const __m256i f = load(row + x + 1);
+    const __m256i h = load(below + x);
+    const __m256i inactive = _mm256_or_si256(_mm256_cmpeq_epi32(b, h), _mm256_cmpeq_epi32(d, f));
+
+    const __m256i e0 = _mm256_blendv_epi8(e, d, _mm256_andnot_si256(inactive, _mm256_cmpeq_epi32(d, b)));
+    const __m256i e1 = _mm256_blendv_epi8(e, f, _mm256_andnot_si256(inactive, _mm256_cmpeq_epi32(b, f)));
+    const __m256i e2 = _mm256_blendv_epi8(e, d, _mm256_andnot_si256(inactive, _mm256_cmpeq_epi32(d, h)));
+    const __m256i e3 = _mm256_blendv_epi8(e, f, _mm256_andnot_si256(inactive, _mm256_cmpeq_epi32(h, f)));
+
+    const __m256i top_low = _mm256_unpacklo_epi32(e0, e1);
+    const __m256i top_high = _mm256_unpackhi_epi32(e0, e1);
+    const __m256i bottom_low = _mm256_unpacklo_epi32(e2, e3);
+    const __m256i bottom_high = _mm256_unpackhi_epi32(e2, e3);
+    store(top + (x * 2), _mm256_permute2x128_si256(top_low, top_high, 0x20));
+    store(top + (x * 2) + PIXELS_PER_VECTOR, _mm256_permute2x128_si256(top_low, top_high, 0x31));
+    store(bottom + (x * 2), _mm256_permute2x128_si256(bottom_low, bottom_high, 0x20));
+    store(bottom + (x * 2) + PIXELS_PER_VECTOR, _mm256_permute2x128_si256(bottom_low, bottom_high, 0x31));
+  }
+  scaler_scalar::scale2x_row(above + x, row + x, below + x, count - x, top + (x * 2), bottom + (x * 2));
+}
+
+bool blend_ghost_row(const uint32_t* current, uint32_t* ghost, uint32_t count) {
+  __m256i changed = _mm256_setzero_si256();
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m256i old_ghost = load(ghost + x);
+    const __m256i blended = _mm256_avg_epu8(load(current + x), old_ghost);
+    changed = _mm256_or_si256(changed, _mm256_xor_si256(blended, old_ghost));
+    store(ghost + x, blended);
+  }
+  const bool vector_changed = !_mm256_testz_si256(changed, changed);
+  const bool tail_changed = scaler_scalar::blend_ghost_row(current + x, ghost + x, count - x);
+  return vector_changed || tail_changed;
+}
+
+void darken_row(const uint32_t* source, uint32_t* dark, uint32_t count) {
+  const __m256i mask = _mm256_set1_epi32(static_cast<int>(LCD_GRID_DARKEN_MASK));
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m256i pixels = load(source + x);
+    store(dark + x,
+          _mm256_sub_epi32(pixels, _mm256_and_si256(_mm256_srli_epi32(pixels, LCD_GRID_DARKEN_SHIFT), mask)));
+  }
+  scaler_scalar::darken_row(source + x, dark + x, count - x);
+}
+}  // namespace
+
+const ScalerKernels AVX2_KERNELS = {expand_row, expand_row_grid, scale2x_row, blend_ghost_row, darken_row};
+#endif
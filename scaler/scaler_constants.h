@@ -0,0 +1,14 @@
+#pragma once
+
+#include <inttypes.h>
+
+// Supported integer scale factors
+constexpr uint32_t MIN_SCALE_FACTOR = 2;
+constexpr uint32_t MAX_SCALE_FACTOR = 6;
+
+// The vectorised row kernels write whole vectors, so row buffers have this many pixels spare at the end
+constexpr uint32_t ROW_SLACK_PIXELS = 8;
+
+// LCD grid: grid lines keep 3/4 of the pixel's brightness, alpha is left alone
+constexpr uint32_t LCD_GRID_DARKEN_SHIFT = 2;
+constexpr uint32_t LCD_GRID_DARKEN_MASK = 0x003F3F3F;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <inttypes.h>
+
+// The per-row building blocks of every filter. Each instruction set provides a full table so the Scaler picks
+// one at runtime. Rows written to `destination`, `top` and `bottom` must have ROW_SLACK_PIXELS spare.
+struct ScalerKernels {
+  // Writes each source pixel even_width times for even x and odd_width times for odd x (at most 8)
+  void (*expand_row)(const uint32_t* source, uint32_t count, uint32_t even_width, uint32_t odd_width,
+                     uint32_t* destination);
+
+  // Writes each source pixel `width` times, except the last pixel of each block is taken from `dark`
+  void (*expand_row_grid)(const uint32_t* source, const uint32_t* dark, uint32_t count, uint32_t width,
+                          uint32_t* destination);
+
+  // Scale2x of one row. above, row and below must be readable one pixel either side of [0, count). Writes
+  // 2 * count pixels to each of top and bottom.
+  void (*scale2x_row)(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t count,
+                      uint32_t* top, uint32_t* bottom);
+
+  // Moves ghost half way to current (rounding up per channel). Returns true if any ghost pixel changed.
+  bool (*blend_ghost_row)(const uint32_t* current, uint32_t* ghost, uint32_t count);
+
+  // dark = source with each colour channel dimmed for the LCD grid lines
+  void (*darken_row)(const uint32_t* source, uint32_t* dark, uint32_t count);
+};
+
+// Plain C++ kernels. The reference for the vectorised ones, which also use them for any leftover pixels.
+namespace scaler_scalar {
+void expand_row(const uint32_t* source, uint32_t count, uint32_t even_width, uint32_t odd_width,
+                uint32_t* destination);
+void expand_row_grid(const uint32_t* source, const uint32_t* dark, uint32_t count, uint32_t width,
+                     uint32_t* destination);
+void scale2x_row(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t count, uint32_t* top,
+                 uint32_t* bottom);
+bool blend_ghost_row(const uint32_t* current, uint32_t* ghost, uint32_t count);
+void darken_row(const uint32_t* source, uint32_t* dark, uint32_t count);
+}  // namespace scaler_scalar
+
+extern const ScalerKernels SCALAR_KERNELS;
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define SCALER_SSE2
+extern const ScalerKernels SSE2_KERNELS;
+#endif
+
+// Defined by the build on x86, where scaler_avx2.cpp is compiled with AVX2 enabled
+#if defined(SCALER_AVX2)
+extern const ScalerKernels AVX2_KERNELS;
+#endif
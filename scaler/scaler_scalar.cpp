@@ -0,0 +1,72 @@
+#include "scaler_constants.h"
+#include "scaler_kernels.h"
+
+namespace scaler_scalar {
+
+void expand_row(const uint32_t* source, uint32_t count, uint32_t even_width, uint32_t odd_width,
+                uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    const uint32_t width = (x & 1) ? odd_width : even_width;
+    for (uint32_t i = 0; i < width; i++) {
+      destination[i] = source[x];
+    }
+    destination += width;
+  }
+}
+
+void expand_row_grid(const uint32_t* source, const uint32_t* dark, uint32_t count, uint32_t width,
+                     uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    for (uint32_t i = 0; i < width - 1; i++) {
+      destination[i] = source[x];
+    }
+    destination[width - 1] = dark[x];
+    destination += width;
+  }
+}
+
+// B is above, D left, F right, H below. Corners only change where two neighbours agree and the other two
+// don't, which smooths diagonals without touching straight edges.
+void scale2x_row(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t count, uint32_t* top,
+                 uint32_t* bottom) {
+  for (uint32_t x = 0; x < count; x++) {
+    const uint32_t* center = row + x;
+    const uint32_t b = above[x];
+    const uint32_t d = center[-1];
+    const uint32_t e = center[0];
+    const uint32_t f = center[1];
+    const uint32_t h = below[x];
+    const bool active = b != h && d != f;
+    top[(x * 2) + 0] = active && d == b ? d : e;
+    top[(x * 2) + 1] = active && b == f ? f : e;
+    bottom[(x * 2) + 0] = active && d == h ? d : e;
+    bottom[(x * 2) + 1] = active && h == f ? f : e;
+  }
+}
+
+bool blend_ghost_row(const uint32_t* current, uint32_t* ghost, uint32_t count) {
+  bool changed = false;
+  for (uint32_t x = 0; x < count; x++) {
+    uint32_t blended = 0;
+    for (uint32_t shift = 0; shift < 32; shift += 8) {
+      const uint32_t a = (current[x] >> shift) & 0xFF;
+      const uint32_t b = (ghost[x] >> shift) & 0xFF;
+      blended |= ((a + b + 1) >> 1) << shift;
+    }
+    changed |= blended != ghost[x];
+    ghost[x] = blended;
+  }
+  return changed;
+}
+
+void darken_row(const uint32_t* source, uint32_t* dark, uint32_t count) {
+  for (uint32_t x = 0; x < count; x++) {
+    dark[x] = source[x] - ((source[x] >> LCD_GRID_DARKEN_SHIFT) & LCD_GRID_DARKEN_MASK);
+  }
+}
+
+}  // namespace scaler_scalar
+
+const ScalerKernels SCALAR_KERNELS = {scaler_scalar::expand_row, scaler_scalar::expand_row_grid,
+                                      scaler_scalar::scale2x_row, scaler_scalar::blend_ghost_row,
+                                      scaler_scalar::darken_row};
@@ -0,0 +1,96 @@
+#include "scaler_constants.h"
+#include "scaler_kernels.h"
+
+#if defined(SCALER_SSE2)
+#include <emmintrin.h>
+
+namespace {
+constexpr uint32_t PIXELS_PER_VECTOR = 4;
+
+[[gnu::always_inline]] inline __m128i load(const uint32_t* pixels) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pixels));
+}
+
+[[gnu::always_inline]] inline void store(uint32_t* pixels, __m128i value) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(pixels), value);
+}
+
+[[gnu::always_inline]] inline __m128i select(__m128i mask, __m128i if_set, __m128i if_clear) {
+  return _mm_or_si128(_mm_and_si128(mask, if_set), _mm_andnot_si128(mask, if_clear));
+}
+
+// A block is at most 6 pixels wide, so two stores of a broadcast pixel always cover it. The extra pixels
+// are overwritten by the next block, or land in the row's slack.
+void expand_row(const uint32_t* source, uint32_t count, uint32_t even_width, uint32_t odd_width,
+                uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    const __m128i pixel = _mm_set1_epi32(static_cast<int>(source[x]));
+    store(destination, pixel);
+    store(destination + PIXELS_PER_VECTOR, pixel);
+    destination += (x & 1) ? odd_width : even_width;
+  }
+}
+
+void expand_row_grid(const uint32_t* source, const uint32_t* dark, uint32_t count, uint32_t width,
+                     uint32_t* destination) {
+  for (uint32_t x = 0; x < count; x++) {
+    const __m128i pixel = _mm_set1_epi32(static_cast<int>(source[x]));
+    store(destination, pixel);
+    store(destination + PIXELS_PER_VECTOR, pixel);
+    destination[width - 1] = dark[x];
+    destination += width;
+  }
+}
+
+void scale2x_row(const uint32_t* above, const uint32_t* row, const uint32_t* below, uint32_t count, uint32_t* top,
+                 uint32_t* bottom) {
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m128i b = load(above + x);
+    const __m128i d = load(row + x - 1);
+    const __m128i e = load(row + x);
+    const __m128i f = load(row + x + 1);
+    const __m128i h = load(below + x);
+    const __m128i inactive = _mm_or_si128(_mm_cmpeq_epi32(b, h), _mm_cmpeq_epi32(d, f));
+
+    const __m128i e0 = select(_mm_andnot_si128(inactive, _mm_cmpeq_epi32(d, b)), d, e);
+    const __m128i e1 = select(_mm_andnot_si128(inactive, _mm_cmpeq_epi32(b, f)), f, e);
+    const __m128i e2 = select(_mm_andnot_si128(inactive, _mm_cmpeq_epi32(d, h)), d, e);
+    const __m128i e3 = select(_mm_andnot_si128(inactive, _mm_cmpeq_epi32(h, f)), f, e);
+
+    store(top + (x * 2), _mm_unpacklo_epi32(e0, e1));
+    store(top + (x * 2) + PIXELS_PER_VECTOR, _mm_unpackhi_epi32(e0, e1));
+    store(bottom + (x * 2), _mm_unpacklo_epi32(e2, e3));
+    store(bottom + (x * 2) + PIXELS_PER_VECTOR, _mm_unpackhi_epi32(e2, e3));
+  }
+  scaler_scalar::scale2x_row(above + x, row + x, below + x, count - x, top + (x * 2), bottom + (x * 2));
+}
+
+// _mm_avg_epu8 rounds up, the same as the scalar kernel
+bool blend_ghost_row(const uint32_t* current, uint32_t* ghost, uint32_t count) {
+  __m128i changed = _mm_setzero_si128();
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m128i old_ghost = load(ghost + x);
+    const __m128i blended = _mm_avg_epu8(load(current + x), old_ghost);
+    changed = _mm_or_si128(changed, _mm_xor_si128(blended, old_ghost));
+    store(ghost + x, blended);
+  }
+  const bool vector_changed = _mm_movemask_epi8(_mm_cmpeq_epi8(changed, _mm_setzero_si128())) != 0xFFFF;
+  const bool tail_changed = scaler_scalar::blend_ghost_row(current + x, ghost + x, count - x);
+  return vector_changed || tail_changed;
+}
+
+void darken_row(const uint32_t* source, uint32_t* dark, uint32_t count) {
+  const __m128i mask = _mm_set1_epi32(static_cast<int>(LCD_GRID_DARKEN_MASK));
+  uint32_t x = 0;
+  for (; x + PIXELS_PER_VECTOR <= count; x += PIXELS_PER_VECTOR) {
+    const __m128i pixels = load(source + x);
+    store(dark + x, _mm_sub_epi32(pixels, _mm_and_si128(_mm_srli_epi32(pixels, LCD_GRID_DARKEN_SHIFT), mask)));
+  }
+  scaler_scalar::darken_row(source + x, dark + x, count - x);
+}
+}  // namespace
+
+const ScalerKernels SSE2_KERNELS = {expand_row, expand_row_grid, scale2x_row, blend_ghost_row, darken_row};
+#endif
@@ -0,0 +1,134 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include "apu.h"
+#include "apu_trace.h"
+
+// Replays an APU trace (see apu_trace.h, recorded with test/record_apu_trace or MainLoop::start_apu_trace)
+// into an APU with no CPU attached, as fast as it will go, and reports m-cycles per second and the PCM hash.
+// The hash of the samples at every generate_samples() is checked against the recorded one, so the exit code
+// says if an APU change altered the output by a single bit.
+//
+// Usage: apu_trace_replay <trace> [--repeat N] [--tick]
+//   --tick  Calls tick() once per m-cycle, as the emulator core does, instead of run() between events
+
+namespace {
+constexpr uint32_t DEFAULT_REPEATS = 3;
+
+struct ReplayResult {
+  uint64_t hash = PCM_HASH_SEED;
+  uint64_t samples = 0;
+  uint64_t mismatches = 0;
+  double nanoseconds = 0;
+};
+
+ReplayResult replay(const APUTraceReader& trace, bool tick) {
+  ReplayResult result;
+  APU apu([&result](const int16_t* samples, int num_samples) {
+    result.hash = hash_pcm(result.hash, samples, static_cast<size_t>(num_samples));
+    result.samples += num_samples;
+  });
+  const APUTraceHeader& header = trace.header();
+  apu.set_synthesis(header.synthesis);
+  apu.set_mixing(header.mixing);
+  apu.set_resampler_quality(header.quality);
+  apu.set_channel_mute_mask(header.mute_mask);
+  apu.set_sample_rate(header.sample_rate);
+
+  const auto start = std::chrono::steady_clock::now();
+  uint64_t m_cycle = 0;
+  for (const APUTraceEvent& event : trace.events()) {
+    if (tick) {
+      for (; m_cycle < event.m_cycle; m_cycle++) {
+        apu.tick();
+      }
+    } else {
+      while (m_cycle < event.m_cycle) {
+        const uint64_t remaining = event.m_cycle - m_cycle;
+        const uint32_t cycles = static_cast<uint32_t>(std::min<uint64_t>(remaining, UINT32_MAX));
+        apu.run(cycles);
+        m_cycle += cycles;
+      }
+    }
+
+    switch (event.type) {
+      case APUTraceEventType::Write:
+        apu.audio_register_write(event.address, event.value);
+        break;
+      case APUTraceEventType::FrameSequencer:
+        apu.tick_frame_sequencer();
+        break;
+      case APUTraceEventType::EndFrame:
+        apu.generate_samples();
+        if (result.hash != event.hash || result.samples != event.samples) {
+          if (result.mismatches == 0) {
+            std::printf("Output differs from m-cycle %" PRIu64 ": recorded %016" PRIx64 " over %" PRIu64
+                        " samples, replayed %016" PRIx64 " over %" PRIu64 "\n",
+                        event.m_cycle, event.hash, event.samples, result.hash, result.samples);
+          }
+          result.mismatches++;
+        }
+        break;
+    }
+  }
+  result.nanoseconds =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+  return result;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: apu_trace_replay <trace> [--repeat N] [--tick]" << std::endl;
+    return -1;
+  }
+
+  uint32_t repeats = DEFAULT_REPEATS;
+  bool tick = false;
+  for (int i = 2; i < argc; i++) {
+    if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeats = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--tick") == 0) {
+      tick = true;
+    } else {
+      std::cerr << "Unknown argument: " << argv[i] << std::endl;
+      return -1;
+    }
+  }
+
+  try {
+    const APUTraceReader trace(argv[1]);
+    const uint64_t m_cycles = trace.events().empty() ? 0 : trace.events().back().m_cycle;
+    size_t writes = 0;
+    for (const APUTraceEvent& event : trace.events()) {
+      writes += event.type == APUTraceEventType::Write;
+    }
+
+    // The first run is checked, the fastest is reported
+    ReplayResult best = replay(trace, tick);
+    const uint64_t mismatches = best.mismatches;
+    for (uint32_t i = 1; i < repeats; i++) {
+      const ReplayResult result = replay(trace, tick);
+      best.nanoseconds = std::min(best.nanoseconds, result.nanoseconds);
+    }
+
+    const double seconds = std::max(best.nanoseconds, 1.0) / 1e9;
+    std::cout << argv[1] << std::endl;
+    std::printf("  %" PRIu64 " m-cycles (%.1f s emulated), %zu writes, %" PRIu64 " samples\n", m_cycles,
+                static_cast<double>(m_cycles) / M_CYCLES_PER_SECOND, writes, best.samples);
+    std::printf("  %.1f M m-cycles/s, %.0fx real time (best of %u)\n", m_cycles / seconds / 1e6,
+                m_cycles / seconds / M_CYCLES_PER_SECOND, repeats);
+    std::printf("  PCM hash: %016" PRIx64 "\n", best.hash);
+    std::cout << (mismatches == 0 ? "  Matches the recording" : "  Does NOT match the recording")
+              << std::endl;
+    return mismatches == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+}
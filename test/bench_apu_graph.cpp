@@ -0,0 +1,95 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include "apu.h"
+
+// Times the APU's component graph: a stepped APU::tick() with all four channels playing, which walks every
+// channel, DAC and timer each m-cycle, and APU::tick_frame_sequencer() with every length counter, envelope
+// and the sweep running. Synthesis is off so only the graph is measured, not the resampler.
+
+namespace {
+constexpr uint32_t BENCHMARK_SECONDS = 20;
+constexpr uint32_t FRAME_SEQUENCER_STEPS = 1 << 22;
+constexpr uint32_t RETRIGGER_STEPS = 64;  // Well within the shortest length, so every channel keeps playing
+constexpr int RUNS = 5;
+
+// Every channel playing with its length counter and envelope running, and channel 1 sweeping
+void play_chord(APU& apu) {
+  apu.audio_register_write(NR26_ADDR, MASTER_ENABLE_BIT);
+  apu.audio_register_write(NR24_ADDR, 0x77);
+  apu.audio_register_write(NR25_ADDR, 0xFF);
+  apu.audio_register_write(NR10_ADDR, 0x79);  // Slowest sweep down, so it never overflows
+  apu.audio_register_write(NR11_ADDR, 0x80);
+  apu.audio_register_write(NR12_ADDR, 0xF1);
+  apu.audio_register_write(NR13_ADDR, 0x00);
+  apu.audio_register_write(NR14_ADDR, 0xC7);
+  apu.audio_register_write(NR16_ADDR, 0x80);
+  apu.audio_register_write(NR17_ADDR, 0x19);
+  apu.audio_register_write(NR18_ADDR, 0x80);
+  apu.audio_register_write(NR19_ADDR, 0xC6);
+  for (uint16_t address = WAVE_RAM_START; address <= WAVE_RAM_END; address++) {
+    apu.audio_register_write(address, static_cast<uint8_t>(address * 0x37));
+  }
+  apu.audio_register_write(NR1A_ADDR, 0x80);
+  apu.audio_register_write(NR1C_ADDR, 0x20);
+  apu.audio_register_write(NR1D_ADDR, 0x00);
+  apu.audio_register_write(NR1E_ADDR, 0xC7);
+  apu.audio_register_write(NR21_ADDR, 0xF1);
+  apu.audio_register_write(NR22_ADDR, 0x11);
+  apu.audio_register_write(NR23_ADDR, 0xC0);
+}
+
+// Nanoseconds per stepped APU::tick(), frame sequencer included
+double tick_nanoseconds() {
+  APU apu([](const int16_t*, int) {});
+  apu.set_synthesis(AudioSynthesis::None);
+  apu.set_event_driven(false);
+  play_chord(apu);
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND * BENCHMARK_SECONDS; tick++) {
+    apu.tick();
+    if ((tick & 2047) == 0) {
+      apu.tick_frame_sequencer();
+      if ((tick >> 11) % RETRIGGER_STEPS == 0) {
+        play_chord(apu);
+      }
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  const double ticks = static_cast<double>(M_CYCLES_PER_SECOND) * BENCHMARK_SECONDS;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / ticks;
+}
+
+// Nanoseconds per APU::tick_frame_sequencer(), with no m-cycles in between
+double frame_sequencer_nanoseconds() {
+  APU apu([](const int16_t*, int) {});
+  apu.set_synthesis(AudioSynthesis::None);
+  apu.set_event_driven(false);
+  play_chord(apu);
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t step = 0; step < FRAME_SEQUENCER_STEPS; step++) {
+    apu.tick_frame_sequencer();
+    if (step % RETRIGGER_STEPS == 0) {
+      play_chord(apu);
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / FRAME_SEQUENCER_STEPS;
+}
+
+template <typename Benchmark>
+double best_of(Benchmark benchmark) {
+  double best = benchmark();
+  for (int run = 1; run < RUNS; run++) {
+    best = std::min(best, benchmark());
+  }
+  return best;
+}
+}  // namespace
+
+int main() {
+  std::printf("Stepped APU::tick():          %6.2f ns\n", best_of(tick_nanoseconds));
+  std::printf("APU::tick_frame_sequencer():  %6.2f ns\n", best_of(frame_sequencer_nanoseconds));
+  return 0;
+}
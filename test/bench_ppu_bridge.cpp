@@ -0,0 +1,79 @@
+#include <inttypes.h>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include "ppu.h"
+#include "ppu_bridge.h"
+
+// Compares the cost of PPU::tick() through the type-erased PPUBridge against a bridge the compiler can see
+// through, which is what the emulator core uses. Rendering is skipped so the numbers are mostly the per m-cycle
+// timing, STAT and OAM DMA work that goes through the bridge.
+
+namespace {
+constexpr uint32_t M_CYCLES_PER_FRAME = 70224 / 4;
+constexpr uint32_t BENCHMARK_FRAMES = 3000;
+constexpr uint8_t LCDC_ON_BG_OBJECTS = 0x93;
+constexpr uint8_t STAT_ALL_INTERRUPTS = 0x78;
+constexpr uint8_t OAM_DMA_SOURCE_PAGE = 0xC0;
+constexpr uint16_t OAM_DMA_ADDR = 0xFF46;
+
+struct BridgeState {
+  uint32_t interrupts = 0;
+  std::array<uint8_t, 0x10000> memory{};
+};
+
+struct DirectBridge {
+  BridgeState* state;
+
+  void trigger_vblank_interrupt() { state->interrupts++; }
+  void trigger_lcd_stat_interrupt() { state->interrupts++; }
+  void blit_screen(const void*, size_t) {}
+  bool is_halted() const { return false; }
+  const uint8_t* read_memory(uint16_t address) { return &state->memory[address]; }
+  FrameDestination acquire_frame() const { return {}; }
+};
+
+PPUBridge make_type_erased_bridge(BridgeState& state) {
+  return {[&state]() { state.interrupts++; },
+          [&state]() { state.interrupts++; },
+          [](const void*, size_t) {},
+          []() { return false; },
+          [&state](uint16_t address) -> const uint8_t* { return &state.memory[address]; }};
+}
+
+template <typename Bridge>
+double nanoseconds_per_tick(Bridge bridge, const BridgeState& state) {
+  PPU<Bridge> ppu(std::move(bridge), false);
+  ppu.set_frame_skip(UINT8_MAX);
+  ppu.write_ppu_register(LCDC_ADDR, LCDC_ON_BG_OBJECTS);
+  ppu.write_ppu_register(STAT_ADDR, STAT_ALL_INTERRUPTS);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+    ppu.write_ppu_register(OAM_DMA_ADDR, OAM_DMA_SOURCE_PAGE);
+    for (uint32_t tick = 0; tick < M_CYCLES_PER_FRAME; tick++) {
+      ppu.tick();
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+
+  if (state.interrupts == 0) {
+    std::cerr << "No interrupts were raised, the benchmark isn't exercising the bridge" << std::endl;
+  }
+  return std::chrono::duration<double, std::nano>(elapsed).count() / (BENCHMARK_FRAMES * M_CYCLES_PER_FRAME);
+}
+}  // namespace
+
+int main() {
+  BridgeState type_erased_state;
+  BridgeState direct_state;
+
+  const double type_erased = nanoseconds_per_tick(make_type_erased_bridge(type_erased_state), type_erased_state);
+  const double direct = nanoseconds_per_tick(DirectBridge{&direct_state}, direct_state);
+
+  std::cout << "PPU::tick() over " << BENCHMARK_FRAMES << " frames" << std::endl;
+  std::cout << "  PPUBridge (std::function): " << type_erased << " ns/tick" << std::endl;
+  std::cout << "  Direct bridge:             " << direct << " ns/tick" << std::endl;
+  std::cout << "  Speedup:                   " << type_erased / direct << "x" << std::endl;
+  return 0;
+}
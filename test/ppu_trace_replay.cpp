@@ -0,0 +1,843 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "ppu.h"
+#include "ppu_trace.h"
+#include "save_state.h"
+
+// Replays a PPU trace (see ppu_trace.h, recorded with test/record_ppu_trace or MainLoop::start_ppu_trace)
+// into a PPU with no CPU attached, and reports the time per frame. The interrupts and frame hashes the
+// replay produces are checked against the recorded ones, so the exit code says if a PPU change altered them.
+//
+// --threaded renders on a RenderThread (PPU::set_threaded_rendering) instead, checks the frames the worker
+// finishes against the recording the same way, and reports the time per frame left on the emulation thread
+// against rendering inline.
+//
+// --dedup checks the frame hashes and duplicate frame skipping instead, against the pixels of every frame:
+//  - Frames with the same pixels have the same hash, and frames with different pixels different hashes.
+//  - With set_skip_duplicate_frames(), exactly the frames identical to the last one blitted aren't blitted,
+//    frame_duplicate() says so and duplicate_frames() counts them.
+//  - A frame after redraw_next_frame() is blitted even if it's a duplicate, and only that one frame.
+//
+// --transfer-states checks save states moving between the backends instead. It saves at points through the
+// trace (in each mode, two of them part way through mode 3) under each backend, loads each state into a new
+// PPU under each backend, and replays the rest of the trace there. STAT and LY after every tick, the
+// interrupts, the rest of the frame saved in and the later frames then have to match a replay under the
+// backend loaded into that was never interrupted.
+//
+// --frame-skip N checks set_frame_skip(N) instead: the interrupts have to match the recording, STAT and LY
+// after every tick a replay rendering every frame, exactly N frames have to be skipped after each one
+// rendered, and the rendered frames have to be the ones blitted, with their recorded hashes.
+//
+// Usage: ppu_trace_replay <trace> [--repeat N] [--per-frame] [--backend scanline|fifo] [--no-tile-map-cache]
+//                         [--threaded] [--dedup] [--transfer-states] [--frame-skip N]
+
+namespace {
+constexpr const char* USAGE =
+    "Usage: ppu_trace_replay <trace> [--repeat N] [--per-frame] [--backend scanline|fifo] "
+    "[--no-tile-map-cache] [--threaded] [--dedup] [--transfer-states] [--frame-skip N]";
+constexpr uint32_t DEFAULT_REPEATS = 3;
+constexpr uint8_t OPEN_BUS = 0xFF;
+constexpr uint32_t REDRAW_INTERVAL = 7;  // Frames between redraw_next_frame() calls in the dedup check
+
+struct TimedWrite {
+  uint64_t tick;
+  uint16_t address;
+  uint8_t value;
+};
+
+struct TimedInterrupt {
+  uint64_t tick;
+  PPUTraceEventType type;
+
+  bool operator==(const TimedInterrupt&) const = default;
+};
+
+// The trace split up by what uses each part, so the replay loop only walks arrays
+struct ReplayInputs {
+  std::vector<TimedWrite> writes;
+  std::vector<uint8_t> memory_reads;
+  std::vector<std::pair<uint64_t, bool>> halts;
+  std::vector<TimedInterrupt> interrupts;
+  std::vector<uint64_t> frame_hashes;
+  uint64_t ticks = 0;
+};
+
+struct ReplayState {
+  const ReplayInputs& inputs;
+  uint64_t tick = 0;
+  size_t write = 0;
+  size_t memory_read = 0;
+  size_t halt = 0;
+  bool halted = false;
+  std::vector<TimedInterrupt> interrupts;
+
+  // Only for the dedup check, which hashes every frame blitted when this is set, and the transfer check
+  size_t blit_line_bytes = 0;
+  uint64_t blits = 0;
+  uint64_t blitted_pixels_hash = 0;
+
+  // Only for the transfer check, which keeps the pixels of the frame blitted with this index
+  uint64_t captured_frame = UINT64_MAX;
+  std::vector<uint8_t> captured_pixels;
+};
+
+struct ReplayBridge {
+  ReplayState* state;
+
+  void trigger_vblank_interrupt() {
+    state->interrupts.push_back({state->tick, PPUTraceEventType::VBlankInterrupt});
+  }
+  void trigger_lcd_stat_interrupt() {
+    state->interrupts.push_back({state->tick, PPUTraceEventType::StatInterrupt});
+  }
+  void blit_screen(const void* pixels, size_t pitch) {
+    if (state->blits++ == state->captured_frame) {
+      for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* line = static_cast<const uint8_t*>(pixels) + (y * pitch);
+        state->captured_pixels.insert(state->captured_pixels.end(), line, line + state->blit_line_bytes);
+      }
+    }
+    if (state->blit_line_bytes != 0) {
+      uint64_t hash = 0xCBF29CE484222325;
+      for (uint32_t y = 0; y < SCREEN_HEIGHT; y++) {
+        const uint8_t* line = static_cast<const uint8_t*>(pixels) + (y * pitch);
+        for (size_t i = 0; i < state->blit_line_bytes; i++) {
+          hash = (hash ^ line[i]) * 0x100000001B3;
+        }
+      }
+      state->blitted_pixels_hash = hash;
+    }
+  }
+
+  bool is_halted() const {
+    const auto& halts = state->inputs.halts;
+    while (state->halt < halts.size() && halts[state->halt].first <= state->tick) {
+      state->halted = halts[state->halt++].second;
+    }
+    return state->halted;
+  }
+
+  const uint8_t* read_memory(uint16_t) {
+    static const uint8_t open_bus = OPEN_BUS;
+    const auto& reads = state->inputs.memory_reads;
+    return state->memory_read < reads.size() ? &reads[state->memory_read++] : &open_bus;
+  }
+
+  FrameDestination acquire_frame() const { return {}; }
+};
+
+struct ReplayResult {
+  std::vector<uint64_t> frame_hashes;
+  std::vector<double> frame_nanoseconds;
+  std::vector<TimedInterrupt> interrupts;
+  double total_nanoseconds = 0;
+};
+
+ReplayInputs split_trace(const PPUTraceReader& trace) {
+  ReplayInputs inputs;
+  for (const PPUTraceEvent& event : trace.events()) {
+    switch (event.type) {
+      case PPUTraceEventType::Write:
+        inputs.writes.push_back({event.tick, event.address, event.value});
+        break;
+      case PPUTraceEventType::MemoryRead:
+        inputs.memory_reads.push_back(event.value);
+        break;
+      case PPUTraceEventType::Halted:
+        inputs.halts.emplace_back(event.tick, event.value != 0);
+        break;
+      case PPUTraceEventType::VBlankInterrupt:
+      case PPUTraceEventType::StatInterrupt:
+        inputs.interrupts.push_back({event.tick, event.type});
+        break;
+      case PPUTraceEventType::Frame:
+        inputs.frame_hashes.push_back(event.hash);
+        break;
+    }
+    inputs.ticks = event.tick;
+  }
+  return inputs;
+}
+
+// Fills in the hashes of rendered frames the worker has finished since the last call. threaded_frames holds
+// the index of every rendered frame, in order, and next is the first without its hash.
+void collect_threaded_hashes(PPU<ReplayBridge>& ppu, const std::vector<size_t>& threaded_frames, size_t& next,
+                             ReplayResult& result) {
+  uint64_t hash;
+  while (next < threaded_frames.size() && ppu.pop_threaded_frame_hash(hash)) {
+    result.frame_hashes[threaded_frames[next++]] = hash;
+  }
+}
+
+// Feeds the trace's writes to `ppu` at their ticks, calling on_frame() at the end of every frame and
+// on_tick() after every tick. Stops part way through if on_tick() returns true, and driving the same state
+// again (into the same PPU, or one a save state has been loaded into) carries on from there.
+template <typename OnFrame, typename OnTick>
+void drive(PPU<ReplayBridge>& ppu, ReplayState& state, OnFrame on_frame, OnTick on_tick) {
+  const ReplayInputs& inputs = state.inputs;
+  while (true) {
+    while (state.write < inputs.writes.size() && inputs.writes[state.write].tick == state.tick) {
+      const TimedWrite& w = inputs.writes[state.write++];
+      if (w.address >= VRAM_BASE_ADDRESS && w.address < VRAM_BASE_ADDRESS + VRAM_SIZE) {
+        ppu.write_vram(w.address, w.value);
+      } else if (w.address >= OAM_BASE_ADDRESS && w.address <= OAM_END_ADDRESS) {
+        ppu.write_oam(w.address, w.value);
+      } else {
+        ppu.write_ppu_register(w.address, w.value);
+      }
+    }
+    if (state.tick == inputs.ticks) {
+      return;
+    }
+
+    state.tick++;
+    ppu.tick();
+
+    if (ppu.frame_completed()) {
+      on_frame();
+    }
+    if (on_tick()) {
+      return;
+    }
+  }
+}
+
+template <typename OnFrame>
+void drive(PPU<ReplayBridge>& ppu, ReplayState& state, OnFrame on_frame) {
+  drive(ppu, state, on_frame, []() { return false; });
+}
+
+ReplayResult replay(const ReplayInputs& inputs, const PPUTraceHeader& header, PPUBackend backend,
+                    bool tile_map_cache, bool threaded) {
+  ReplayState state{inputs};
+  state.interrupts.reserve(inputs.interrupts.size());
+
+  ReplayResult result;
+  result.frame_hashes.reserve(inputs.frame_hashes.size());
+  result.frame_nanoseconds.reserve(inputs.frame_hashes.size());
+
+  PPU<ReplayBridge> ppu(ReplayBridge{&state}, header.boot_rom_active);
+  ppu.set_backend(backend);
+  ppu.set_pixel_format(header.pixel_format);
+  ppu.set_tile_map_cache(tile_map_cache);
+  ppu.set_threaded_rendering(threaded);
+  std::vector<size_t> threaded_frames;
+  size_t next_threaded_frame = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  auto frame_start = start;
+  drive(ppu, state, [&]() {
+    const auto now = std::chrono::steady_clock::now();
+    result.frame_nanoseconds.push_back(std::chrono::duration<double, std::nano>(now - frame_start).count());
+    if (threaded) {
+      // The worker finishes the frame later, so its hash is filled in once it has
+      if (ppu.frame_rendered()) {
+        threaded_frames.push_back(result.frame_hashes.size());
+      }
+      result.frame_hashes.push_back(0);
+      collect_threaded_hashes(ppu, threaded_frames, next_threaded_frame, result);
+    } else {
+      result.frame_hashes.push_back(ppu.frame_hash());
+    }
+    frame_start = now;
+  });
+  result.total_nanoseconds =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+  // Not timed, as the emulation thread wouldn't wait for these
+  while (next_threaded_frame < threaded_frames.size()) {
+    collect_threaded_hashes(ppu, threaded_frames, next_threaded_frame, result);
+    std::this_thread::yield();
+  }
+  result.interrupts = std::move(state.interrupts);
+  return result;
+}
+
+// Returns the number of mismatches, printing the first of each kind
+uint32_t verify(const ReplayInputs& inputs, const ReplayResult& result) {
+  uint32_t mismatches = 0;
+
+  if (result.frame_hashes.size() != inputs.frame_hashes.size()) {
+    std::cout << "Frame count differs: recorded " << inputs.frame_hashes.size() << ", replayed "
+              << result.frame_hashes.size() << std::endl;
+    mismatches++;
+  }
+  const size_t frames = std::min(result.frame_hashes.size(), inputs.frame_hashes.size());
+  for (size_t i = 0; i < frames; i++) {
+    // Frames that weren't rendered when recording have no hash to compare against
+    if (inputs.frame_hashes[i] != 0 && inputs.frame_hashes[i] != result.frame_hashes[i]) {
+      if (mismatches == 0) {
+        std::printf("Frame %zu differs: recorded %016" PRIx64 ", replayed %016" PRIx64 "\n", i,
+                    inputs.frame_hashes[i], result.frame_hashes[i]);
+      }
+      mismatches++;
+    }
+  }
+
+  if (result.interrupts != inputs.interrupts) {
+    const auto first = std::mismatch(inputs.interrupts.begin(), inputs.interrupts.end(),
+                                     result.interrupts.begin(), result.interrupts.end());
+    std::cout << "Interrupts differ from #" << (first.first - inputs.interrupts.begin()) << " (recorded "
+              << inputs.interrupts.size() << ", replayed " << result.interrupts.size() << ")" << std::endl;
+    mismatches++;
+  }
+  return mismatches;
+}
+
+// A frame of the dedup check
+struct DedupFrame {
+  uint64_t hash;         // frame_hash()
+  uint64_t pixels_hash;  // Of the pixels blitted, 0 if the frame wasn't
+  bool duplicate;        // frame_duplicate()
+};
+
+// With skip_duplicates, redraw_next_frame() is called after every REDRAW_INTERVAL frames
+std::vector<DedupFrame> replay_dedup(const ReplayInputs& inputs, const PPUTraceHeader& header,
+                                     PPUBackend backend, bool skip_duplicates, uint64_t& duplicate_frames) {
+  ReplayState state{inputs};
+  state.blit_line_bytes = SCREEN_WIDTH * bytes_per_pixel(header.pixel_format);
+  PPU<ReplayBridge> ppu(ReplayBridge{&state}, header.boot_rom_active);
+  ppu.set_backend(backend);
+  ppu.set_pixel_format(header.pixel_format);
+  ppu.set_skip_duplicate_frames(skip_duplicates);
+
+  std::vector<DedupFrame> frames;
+  frames.reserve(inputs.frame_hashes.size());
+  uint64_t blits = 0;
+  drive(ppu, state, [&]() {
+    const bool blitted = state.blits != blits;
+    blits = state.blits;
+    frames.push_back({ppu.frame_hash(), blitted ? state.blitted_pixels_hash : 0, ppu.frame_duplicate()});
+    if (skip_duplicates && frames.size() % REDRAW_INTERVAL == 0) {
+      ppu.redraw_next_frame();
+    }
+  });
+  duplicate_frames = ppu.duplicate_frames();
+  return frames;
+}
+
+// Replays every frame blitted, then with duplicates skipped, and checks the second against what the first
+// says should have been skipped. Returns the number of mismatches, printing the first.
+uint32_t check_dedup(const ReplayInputs& inputs, const PPUTraceHeader& header, PPUBackend backend) {
+  uint64_t duplicate_frames = 0;
+  const std::vector<DedupFrame> all = replay_dedup(inputs, header, backend, false, duplicate_frames);
+  const std::vector<DedupFrame> deduped = replay_dedup(inputs, header, backend, true, duplicate_frames);
+
+  uint32_t mismatches = 0;
+  const auto mismatch = [&mismatches](size_t frame, const std::string& what) {
+    if (mismatches++ == 0) {
+      std::cout << "Frame " << frame << ": " << what << std::endl;
+    }
+  };
+
+  // Frames with hashes have to have the same hash exactly when they have the same pixels
+  std::unordered_map<uint64_t, uint64_t> pixels_by_hash;
+  std::unordered_map<uint64_t, uint64_t> hash_by_pixels;
+  for (size_t i = 0; i < all.size(); i++) {
+    if (all[i].hash == 0) {
+      continue;
+    }
+    if (all[i].pixels_hash == 0 || all[i].duplicate) {
+      mismatch(i, "wasn't blitted with duplicates not being skipped");
+      continue;
+    }
+    if (pixels_by_hash.emplace(all[i].hash, all[i].pixels_hash).first->second != all[i].pixels_hash) {
+      mismatch(i, "has the same hash as an earlier frame with different pixels");
+    }
+    if (hash_by_pixels.emplace(all[i].pixels_hash, all[i].hash).first->second != all[i].hash) {
+      mismatch(i, "has the same pixels as an earlier frame but a different hash");
+    }
+  }
+
+  if (deduped.size() != all.size()) {
+    std::cout << "Frame count differs with duplicates skipped: " << deduped.size() << ", expected "
+              << all.size() << std::endl;
+    return mismatches + 1;
+  }
+
+  // Each frame is skipped if it's the same as the last one blitted, unless a redraw was asked for since
+  uint64_t blitted_hash = 0;
+  uint64_t blitted_pixels = 0;
+  uint64_t expected_duplicates = 0;
+  uint32_t redraws = 0;
+  for (size_t i = 0; i < all.size(); i++) {
+    const bool expected_duplicate = all[i].hash != 0 && all[i].hash == blitted_hash;
+    if (deduped[i].hash != all[i].hash) {
+      mismatch(i, "has a different hash with duplicates skipped");
+    }
+    if (deduped[i].duplicate != expected_duplicate || (deduped[i].pixels_hash == 0) != expected_duplicate) {
+      mismatch(i, expected_duplicate ? "should have been skipped" : "should have been blitted");
+    }
+    if (expected_duplicate) {
+      expected_duplicates++;
+      if (all[i].pixels_hash != blitted_pixels) {
+        mismatch(i, "was skipped but isn't what was last blitted");
+      }
+    } else {
+      // A frame identical to the one on screen only gets here after a redraw
+      redraws += all[i].hash != 0 && all[i].pixels_hash == blitted_pixels;
+      if (deduped[i].pixels_hash != all[i].pixels_hash) {
+        mismatch(i, "blitted different pixels with duplicates skipped");
+      }
+      blitted_hash = all[i].hash;
+      blitted_pixels = all[i].pixels_hash;
+    }
+    if ((i + 1) % REDRAW_INTERVAL == 0) {
+      blitted_hash = 0;
+    }
+  }
+  if (duplicate_frames != expected_duplicates) {
+    std::cout << "duplicate_frames() is " << duplicate_frames << ", expected " << expected_duplicates
+              << std::endl;
+    mismatches++;
+  }
+
+  std::printf("  %zu frames, %zu distinct, %" PRIu64 " skipped as duplicates, %u forced through by "
+              "redraw_next_frame()\n",
+              all.size(), pixels_by_hash.size(), expected_duplicates, redraws);
+  return mismatches;
+}
+
+// Where the transfer check saves: the first tick at least `fraction` of the way through the trace on which
+// the PPU has been in `mode` for `ticks_in_mode` ticks
+struct SavePoint {
+  double fraction;
+  PPUMode mode;
+  uint32_t ticks_in_mode;
+};
+
+constexpr SavePoint SAVE_POINTS[] = {
+    {0.2, PPUMode::OAMSearch, 10},
+    {0.3, PPUMode::PixelTransfer, 3},  // Before the first pixel
+    {0.45, PPUMode::PixelTransfer, 30},
+    {0.6, PPUMode::HBlank, 5},
+    {0.8, PPUMode::VBlank, 200},
+};
+
+struct TransferRun {
+  std::vector<uint16_t> stat_ly;  // (LY << 8) | STAT after each tick, the first at index 0
+  std::vector<TimedInterrupt> interrupts;
+  std::vector<uint64_t> frame_hashes;
+  std::vector<uint8_t> captured_pixels;  // Of the frame in progress when saving
+  uint64_t save_tick = 0;                // Ticks replayed before saving
+  size_t save_frame = 0;                 // The frame in progress when saving
+};
+
+std::unique_ptr<PPU<ReplayBridge>> make_ppu(ReplayState& state, const PPUTraceHeader& header,
+                                            PPUBackend backend) {
+  auto ppu = std::make_unique<PPU<ReplayBridge>>(ReplayBridge{&state}, header.boot_rom_active);
+  ppu->set_backend(backend);
+  ppu->set_pixel_format(header.pixel_format);
+  return ppu;
+}
+
+// Replays the trace under `from` up to `save`, saves a state to state_path, loads it into a new PPU under
+// `to` and replays the rest of the trace there. Without a save point it's a replay under `from` that isn't
+// interrupted, keeping the pixels of captured_frame.
+TransferRun replay_transfer(const ReplayInputs& inputs, const PPUTraceHeader& header, PPUBackend from,
+                            PPUBackend to, const SavePoint* save, uint64_t captured_frame,
+                            const std::string& state_path) {
+  ReplayState state{inputs};
+  state.blit_line_bytes = SCREEN_WIDTH * bytes_per_pixel(header.pixel_format);
+  state.captured_frame = captured_frame;
+  TransferRun run;
+  run.stat_ly.reserve(inputs.ticks);
+  std::unique_ptr<PPU<ReplayBridge>> ppu = make_ppu(state, header, from);
+
+  bool saving = save != nullptr;
+  const uint64_t save_after =
+      save ? static_cast<uint64_t>(static_cast<double>(inputs.ticks) * save->fraction) : 0;
+  uint8_t mode = 0xFF;
+  uint32_t ticks_in_mode = 0;
+  const auto on_frame = [&]() { run.frame_hashes.push_back(ppu->frame_hash()); };
+  const auto on_tick = [&]() {
+    const uint8_t stat = *ppu->read_ppu_register(STAT_ADDR);
+    run.stat_ly.push_back(static_cast<uint16_t>((*ppu->read_ppu_register(LY_ADDR) << 8) | stat));
+    ticks_in_mode = (stat & STAT_MODE_MASK) == mode ? ticks_in_mode + 1 : 1;
+    mode = stat & STAT_MODE_MASK;
+    return saving && state.tick >= save_after && mode == static_cast<uint8_t>(save->mode) &&
+           ticks_in_mode == save->ticks_in_mode;
+  };
+  drive(*ppu, state, on_frame, on_tick);
+  if (!saving) {
+    run.interrupts = std::move(state.interrupts);
+    run.captured_pixels = std::move(state.captured_pixels);
+    return run;
+  }
+  if (state.tick == inputs.ticks) {
+    throw std::runtime_error("The trace ends before the save point");
+  }
+
+  {
+    SaveStateSerializer serializer(state_path, false);
+    serializer << *ppu;
+  }
+  run.save_tick = state.tick;
+  run.save_frame = run.frame_hashes.size();
+  state.captured_frame = state.blits;
+  saving = false;
+
+  ppu = make_ppu(state, header, to);
+  {
+    SaveStateSerializer serializer(state_path, true);
+    serializer >> *ppu;
+  }
+  std::filesystem::remove(state_path);
+  drive(*ppu, state, on_frame, on_tick);
+  run.interrupts = std::move(state.interrupts);
+  run.captured_pixels = std::move(state.captured_pixels);
+  return run;
+}
+
+const char* backend_label(PPUBackend backend) {
+  return backend == PPUBackend::PixelFIFO ? "fifo" : "scanline";
+}
+
+// Saves at every SAVE_POINTS entry under each backend and loads the state under each, checking the rest of
+// the replay against one under the backend loaded into that wasn't interrupted. Returns the number of
+// transfers that don't match, printing the first difference of each.
+uint32_t check_transfers(const ReplayInputs& inputs, const PPUTraceHeader& header,
+                         const std::string& state_path) {
+  constexpr PPUBackend BACKENDS[] = {PPUBackend::Scanline, PPUBackend::PixelFIFO};
+  const size_t pixel_bytes = bytes_per_pixel(header.pixel_format);
+
+  uint32_t failures = 0;
+  for (const SavePoint& save : SAVE_POINTS) {
+    for (PPUBackend from : BACKENDS) {
+      for (PPUBackend to : BACKENDS) {
+        const TransferRun run = replay_transfer(inputs, header, from, to, &save, UINT64_MAX, state_path);
+        const TransferRun expected =
+            replay_transfer(inputs, header, to, to, nullptr, run.save_frame, state_path);
+        const uint16_t saved_line = run.stat_ly[run.save_tick - 1] >> 8;
+
+        // The loaded state carries on exactly from the tick it was saved on, except that a line in mode 3 is
+        // finished by the backend it was saved under, so the other one only takes over from the next line
+        size_t first_tick = run.save_tick;
+        if (from != to && save.mode == PPUMode::PixelTransfer) {
+          while (first_tick < run.stat_ly.size() && (run.stat_ly[first_tick] >> 8) == saved_line) {
+            first_tick++;
+          }
+        }
+
+        // The screen isn't saved, so of the frame in progress only what's drawn after loading can be
+        // compared: the whole frame from VBlank, from the saved line in OAM search, and from the next line
+        // after the scanline backend has drawn the saved line. The pixel FIFO finishes the saved line, from
+        // at most a pixel a dot into mode 3 and an m-cycle ahead.
+        size_t first_pixel = (static_cast<size_t>(saved_line) + 1) * SCREEN_WIDTH;
+        if (save.mode == PPUMode::VBlank) {
+          first_pixel = 0;
+        } else if (save.mode == PPUMode::OAMSearch) {
+          first_pixel = static_cast<size_t>(saved_line) * SCREEN_WIDTH;
+        } else if (save.mode == PPUMode::PixelTransfer && from == PPUBackend::PixelFIFO) {
+          first_pixel = (static_cast<size_t>(saved_line) * SCREEN_WIDTH) +
+                        std::min<size_t>(SCREEN_WIDTH, (save.ticks_in_mode + 1) * T_CYCLES_PER_TICK);
+        }
+
+        std::string difference;
+        if (run.stat_ly.size() != expected.stat_ly.size()) {
+          difference = "replayed " + std::to_string(run.stat_ly.size()) + " ticks";
+        } else if (const auto first = std::mismatch(run.stat_ly.begin() + first_tick, run.stat_ly.end(),
+                                                    expected.stat_ly.begin() + first_tick);
+                   first.first != run.stat_ly.end()) {
+          difference = "STAT/LY differ from tick " + std::to_string(first.first - run.stat_ly.begin() + 1);
+        }
+
+        // Interrupts are logged with the tick they're raised in, which is one past its STAT/LY's index
+        const auto after = [first_tick](const std::vector<TimedInterrupt>& interrupts) {
+          std::vector<TimedInterrupt> later;
+          std::copy_if(interrupts.begin(), interrupts.end(), std::back_inserter(later),
+                       [first_tick](const TimedInterrupt& interrupt) { return interrupt.tick > first_tick; });
+          return later;
+        };
+        if (difference.empty() && after(run.interrupts) != after(expected.interrupts)) {
+          difference = "the interrupts differ";
+        }
+
+        const size_t first_byte = std::min(first_pixel * pixel_bytes, run.captured_pixels.size());
+        if (difference.empty() &&
+            (run.captured_pixels.size() != expected.captured_pixels.size() ||
+             !std::equal(run.captured_pixels.begin() + first_byte, run.captured_pixels.end(),
+                         expected.captured_pixels.begin() + first_byte))) {
+          difference = "the frame saved in differs after loading";
+        }
+        if (difference.empty() && run.frame_hashes.size() != expected.frame_hashes.size()) {
+          difference = "replayed " + std::to_string(run.frame_hashes.size()) + " frames";
+        }
+        for (size_t i = run.save_frame + 1; difference.empty() && i < run.frame_hashes.size(); i++) {
+          if (run.frame_hashes[i] != expected.frame_hashes[i]) {
+            difference = "frame " + std::to_string(i) + " differs";
+          }
+        }
+
+        if (!difference.empty()) {
+          std::cout << "  " << backend_label(from) << " to " << backend_label(to) << " saved at tick "
+                    << run.save_tick << " (mode " << static_cast<int>(save.mode) << "): " << difference
+                    << std::endl;
+          failures++;
+        }
+      }
+    }
+  }
+  std::printf("  %zu save points, each saved under both backends and loaded under both\n",
+              std::size(SAVE_POINTS));
+  return failures;
+}
+
+// A replay for the frame skip check
+struct FrameSkipRun {
+  uint64_t stat_ly_hash = 0xCBF29CE484222325;  // Of STAT and LY after every tick
+  std::vector<TimedInterrupt> interrupts;
+  std::vector<uint64_t> frame_hashes;  // 0 for the frames that weren't rendered
+  uint64_t blits = 0;
+};
+
+FrameSkipRun replay_frame_skip(const ReplayInputs& inputs, const PPUTraceHeader& header, PPUBackend backend,
+                               uint8_t frame_skip) {
+  ReplayState state{inputs};
+  std::unique_ptr<PPU<ReplayBridge>> ppu = make_ppu(state, header, backend);
+  ppu->set_frame_skip(frame_skip);
+
+  FrameSkipRun run;
+  drive(
+      *ppu, state, [&]() { run.frame_hashes.push_back(ppu->frame_rendered() ? ppu->frame_hash() : 0); },
+      [&]() {
+        run.stat_ly_hash = (run.stat_ly_hash ^ *ppu->read_ppu_register(STAT_ADDR)) * 0x100000001B3;
+        run.stat_ly_hash = (run.stat_ly_hash ^ *ppu->read_ppu_register(LY_ADDR)) * 0x100000001B3;
+        return false;
+      });
+  run.interrupts = std::move(state.interrupts);
+  run.blits = state.blits;
+  return run;
+}
+
+// Replays with set_frame_skip(frame_skip), which mustn't change anything but which frames are drawn, and
+// checks it against the recording and a replay rendering every frame. Returns the number of mismatches,
+// printing the first of each kind.
+uint32_t check_frame_skip(const ReplayInputs& inputs, const PPUTraceHeader& header, PPUBackend backend,
+                          uint8_t frame_skip) {
+  const FrameSkipRun every_frame = replay_frame_skip(inputs, header, backend, 0);
+  const FrameSkipRun skipping = replay_frame_skip(inputs, header, backend, frame_skip);
+
+  uint32_t mismatches = 0;
+  if (skipping.interrupts != inputs.interrupts) {
+    const auto first = std::mismatch(inputs.interrupts.begin(), inputs.interrupts.end(),
+                                     skipping.interrupts.begin(), skipping.interrupts.end());
+    std::cout << "Interrupts differ from #" << (first.first - inputs.interrupts.begin()) << " (recorded "
+              << inputs.interrupts.size() << ", replayed " << skipping.interrupts.size() << ")" << std::endl;
+    mismatches++;
+  }
+  if (skipping.stat_ly_hash != every_frame.stat_ly_hash) {
+    std::cout << "STAT/LY differ from the replay rendering every frame" << std::endl;
+    mismatches++;
+  }
+  if (skipping.frame_hashes.size() != inputs.frame_hashes.size()) {
+    std::cout << "Frame count differs: recorded " << inputs.frame_hashes.size() << ", replayed "
+              << skipping.frame_hashes.size() << std::endl;
+    mismatches++;
+  }
+
+  // After each frame rendered, the next frame_skip aren't
+  uint64_t rendered = 0;
+  uint32_t frame_mismatches = 0;
+  std::optional<size_t> last_rendered;
+  const size_t frames = std::min(skipping.frame_hashes.size(), inputs.frame_hashes.size());
+  for (size_t i = 0; i < frames; i++) {
+    const bool expected_rendered = !last_rendered || i - *last_rendered > frame_skip;
+    const uint64_t hash = skipping.frame_hashes[i];
+    std::string difference;
+    if ((hash != 0) != expected_rendered) {
+      difference = expected_rendered ? "should have been rendered" : "should have been skipped";
+    } else if (hash != 0 && inputs.frame_hashes[i] != 0 && hash != inputs.frame_hashes[i]) {
+      difference = "differs from the recording";
+    }
+    if (!difference.empty() && frame_mismatches++ == 0) {
+      std::cout << "Frame " << i << " " << difference << std::endl;
+    }
+    if (hash != 0) {
+      rendered++;
+      last_rendered = i;
+    }
+  }
+  mismatches += frame_mismatches;
+
+  if (skipping.blits != rendered) {
+    std::cout << skipping.blits << " frames blitted, expected the " << rendered << " rendered" << std::endl;
+    mismatches++;
+  }
+
+  std::printf("  %zu frames, %" PRIu64 " rendered and blitted, %" PRIu64 " without frame skip\n",
+              skipping.frame_hashes.size(), rendered, every_frame.blits);
+  return mismatches;
+}
+
+// Frames to skip after each one rendered, from 0 to 255
+std::optional<uint8_t> parse_frame_skip(const char* text) {
+  char* end = nullptr;
+  const long frames = std::strtol(text, &end, 10);
+  if (end == text || *end != '\0' || frames < 0 || frames > UINT8_MAX) {
+    return std::nullopt;
+  }
+  return static_cast<uint8_t>(frames);
+}
+
+uint64_t combined_hash(const std::vector<uint64_t>& hashes) {
+  uint64_t hash = 0xCBF29CE484222325;
+  for (uint64_t frame_hash : hashes) {
+    hash = (hash ^ frame_hash) * 0x100000001B3;
+  }
+  return hash;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+
+  uint32_t repeats = DEFAULT_REPEATS;
+  bool per_frame = false;
+  bool tile_map_cache = true;
+  bool threaded = false;
+  bool dedup = false;
+  bool transfer_states = false;
+  std::optional<uint8_t> frame_skip;
+  const char* backend_name = nullptr;
+  for (int i = 2; i < argc; i++) {
+    if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc) {
+      repeats = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--per-frame") == 0) {
+      per_frame = true;
+    } else if (std::strcmp(argv[i], "--backend") == 0 && i + 1 < argc && ppu_backend_from_name(argv[i + 1])) {
+      backend_name = argv[++i];
+    } else if (std::strcmp(argv[i], "--no-tile-map-cache") == 0) {
+      tile_map_cache = false;
+    } else if (std::strcmp(argv[i], "--threaded") == 0) {
+      threaded = true;
+    } else if (std::strcmp(argv[i], "--dedup") == 0) {
+      dedup = true;
+    } else if (std::strcmp(argv[i], "--transfer-states") == 0) {
+      transfer_states = true;
+    } else if (std::strcmp(argv[i], "--frame-skip") == 0 && i + 1 < argc && parse_frame_skip(argv[i + 1])) {
+      frame_skip = parse_frame_skip(argv[++i]);
+    } else {
+      std::cerr << "Unknown argument: " << argv[i] << std::endl << USAGE << std::endl;
+      return -1;
+    }
+  }
+
+  try {
+    const PPUTraceReader trace(argv[1]);
+    const ReplayInputs inputs = split_trace(trace);
+
+    PPUBackend backend = trace.header().backend;
+    if (backend_name) {
+      backend = *ppu_backend_from_name(backend_name);
+    }
+    if (threaded && backend != PPUBackend::Scanline) {
+      std::cerr << "Threaded rendering only applies to the scanline backend" << std::endl;
+      return -1;
+    }
+
+    if (frame_skip) {
+      if (threaded || dedup || transfer_states) {
+        std::cerr << "The frame skip check renders inline" << std::endl;
+        return -1;
+      }
+      std::cout << argv[1] << std::endl;
+      const uint32_t mismatches = check_frame_skip(inputs, trace.header(), backend, *frame_skip);
+      std::cout << (mismatches == 0 ? "  Frame skipping only changes which frames are drawn"
+                                    : "  Frame skipping is WRONG")
+                << std::endl;
+      return mismatches == 0 ? 0 : 1;
+    }
+
+    if (transfer_states) {
+      if (threaded || dedup || backend_name) {
+        std::cerr << "The transfer check renders inline under both backends" << std::endl;
+        return -1;
+      }
+      std::cout << argv[1] << std::endl;
+      const std::filesystem::path state_path = std::filesystem::temp_directory_path() /
+          (std::filesystem::path(argv[1]).stem().string() + ".transfer.state");
+      const uint32_t failures = check_transfers(inputs, trace.header(), state_path.string());
+      std::cout << (failures == 0 ? "  Save states move between the backends"
+                                  : "  Save states DON'T move between the backends")
+                << std::endl;
+      return failures == 0 ? 0 : 1;
+    }
+
+    if (dedup) {
+      if (threaded) {
+        std::cerr << "The dedup check renders inline" << std::endl;
+        return -1;
+      }
+      std::cout << argv[1] << std::endl;
+      const uint32_t mismatches = check_dedup(inputs, trace.header(), backend);
+      std::cout << (mismatches == 0 ? "  Frame hashes and duplicate skipping are right"
+                                    : "  Frame hashes or duplicate skipping are WRONG")
+                << std::endl;
+      return mismatches == 0 ? 0 : 1;
+    }
+
+    // The first run is checked, the fastest is reported
+    ReplayResult best = replay(inputs, trace.header(), backend, tile_map_cache, threaded);
+    const uint32_t mismatches = verify(inputs, best);
+    for (uint32_t i = 1; i < repeats; i++) {
+      ReplayResult result = replay(inputs, trace.header(), backend, tile_map_cache, threaded);
+      if (result.total_nanoseconds < best.total_nanoseconds) {
+        best = std::move(result);
+      }
+    }
+
+    // What the emulation thread saves, against the same replay rendering inline
+    double inline_nanoseconds = 0;
+    if (threaded) {
+      for (uint32_t i = 0; i < repeats; i++) {
+        const double nanoseconds =
+            replay(inputs, trace.header(), backend, tile_map_cache, false).total_nanoseconds;
+        inline_nanoseconds = i == 0 ? nanoseconds : std::min(inline_nanoseconds, nanoseconds);
+      }
+    }
+
+    if (per_frame) {
+      for (size_t i = 0; i < best.frame_hashes.size(); i++) {
+        std::printf("frame %5zu  %016" PRIx64 "  %9.0f ns\n", i, best.frame_hashes[i],
+                    best.frame_nanoseconds[i]);
+      }
+    }
+
+    const size_t frames = std::max<size_t>(best.frame_hashes.size(), 1);
+    std::cout << argv[1] << std::endl;
+    std::printf("  %zu frames, %" PRIu64 " ticks, %zu writes, %zu interrupts\n", best.frame_hashes.size(),
+                inputs.ticks, inputs.writes.size(), inputs.interrupts.size());
+    if (threaded) {
+      std::printf("  %.0f ns/frame on the emulation thread with threaded rendering, %.0f ns/frame inline "
+                  "(best of %u, %.2fx the speed)\n",
+                  best.total_nanoseconds / frames, inline_nanoseconds / frames, repeats,
+                  inline_nanoseconds / best.total_nanoseconds);
+    } else {
+      std::printf("  %.0f ns/frame (best of %u)\n", best.total_nanoseconds / frames, repeats);
+    }
+    std::printf("  Frame hash: %016" PRIx64 "\n", combined_hash(best.frame_hashes));
+    std::cout << (mismatches == 0 ? "  Matches the recording" : "  Does NOT match the recording")
+              << std::endl;
+    return mismatches == 0 ? 0 : 1;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+}
@@ -0,0 +1,48 @@
+#include <inttypes.h>
+#include <cstdlib>
+#include <iostream>
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Runs a ROM headless from power on for a number of frames' worth of cycles and records an APU trace for
+// apu_trace_replay. The traces in test/apu_traces were made with this.
+//
+// Usage: record_apu_trace <rom> <trace> <frames> [boot ROM]
+
+namespace {
+constexpr uint64_t M_CYCLES_PER_FRAME = 70224 / 4;
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: record_apu_trace <rom> <trace> <frames> [boot ROM]" << std::endl;
+    return -1;
+  }
+  const uint64_t frames = std::strtoull(argv[3], nullptr, 10);
+
+  ROMLoader loader(argv[1], argc > 4 ? argv[4] : "");
+  if (!loader.load()) {
+    return -1;
+  }
+
+  OSBridge bridge;
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {};
+  MainLoop loop(loader, bridge);
+  loop.ppu().set_pixel_format(PixelFormat::Indexed);
+
+  try {
+    loop.start_apu_trace(argv[2]);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  while (loop.cpu().m_cycles() < frames * M_CYCLES_PER_FRAME) {
+    loop.run_once();
+  }
+  loop.stop_apu_trace();
+  return 0;
+}
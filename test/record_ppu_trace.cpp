@@ -0,0 +1,62 @@
+#include <inttypes.h>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Runs a ROM headless from power on for a number of frames' worth of cycles (so it also ends if the LCD is
+// switched off) and records a PPU trace for ppu_trace_replay.
+// The traces in test/ppu_traces were made with this.
+//
+// Usage: record_ppu_trace <rom> <trace> <frames> [--backend scanline|fifo]
+
+namespace {
+constexpr const char* USAGE = "Usage: record_ppu_trace <rom> <trace> <frames> [--backend scanline|fifo]";
+constexpr uint64_t M_CYCLES_PER_FRAME = 70224 / 4;
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << USAGE << std::endl;
+    return -1;
+  }
+  const uint64_t frames = std::strtoull(argv[3], nullptr, 10);
+  PPUBackend backend = PPUBackend::Scanline;
+  if (argc > 4) {
+    const std::optional<PPUBackend> named =
+        argc == 6 && std::strcmp(argv[4], "--backend") == 0 ? ppu_backend_from_name(argv[5]) : std::nullopt;
+    if (!named) {
+      std::cerr << USAGE << std::endl;
+      return -1;
+    }
+    backend = *named;
+  }
+
+  ROMLoader loader(argv[1], "");
+  if (!loader.load()) {
+    return -1;
+  }
+
+  OSBridge bridge;
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {};
+  MainLoop loop(loader, bridge);
+  loop.ppu().set_backend(backend);
+
+  try {
+    loop.start_ppu_trace(argv[2]);
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+
+  while (loop.cpu().m_cycles() < frames * M_CYCLES_PER_FRAME) {
+    loop.run_once();
+  }
+  loop.stop_ppu_trace();
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <inttypes.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "gbs_player.h"
+#include "wav_writer.h"
+
+// Renders a song from a GBS rip to a stereo WAV as fast as it will go, running only the CPU, timer and APU
+// (see GBSPlayer), and reports how many times faster than real time that was.
+//
+// Usage: render_gbs <gbs> <wav> <seconds> [--song N] [--rate HZ]
+//   --song  1 based, defaults to the rip's first song
+//   --rate  Output sample rate, 48000 by default
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    std::cerr << "Usage: render_gbs <gbs> <wav> <seconds> [--song N] [--rate HZ]" << std::endl;
+    return -1;
+  }
+  const double seconds = std::strtod(argv[3], nullptr);
+  int song = 0;
+  uint32_t sample_rate = AUDIO_SAMPLE_RATE;
+  for (int i = 4; i < argc; i++) {
+    if (std::strcmp(argv[i], "--song") == 0 && i + 1 < argc) {
+      song = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      sample_rate = static_cast<uint32_t>(std::atoi(argv[++i]));
+    } else {
+      std::cerr << "Unknown argument: " << argv[i] << std::endl;
+      return -1;
+    }
+  }
+  if (seconds <= 0) {
+    std::cerr << "Nothing to render: " << argv[3] << " seconds" << std::endl;
+    return -1;
+  }
+
+  try {
+    const GBSFile file(argv[1]);
+    const GBSHeader& header = file.header();
+    if (song == 0) {
+      song = header.first_song;
+    }
+    if (song < 1 || song > 255) {
+      std::cerr << "No song " << song << std::endl;
+      return -1;
+    }
+    if (file.wants_double_speed()) {
+      std::cerr << "Warning: this rip wants CGB double speed, it will play at half tempo" << std::endl;
+    }
+
+    WAVWriter wav(argv[2], sample_rate, 2);
+    GBSPlayer player(file, static_cast<uint8_t>(song - 1), [&wav](const int16_t* samples, int num_samples) {
+      wav.write_samples(samples, static_cast<size_t>(num_samples));
+    });
+    player.apu().set_sample_rate(sample_rate);
+
+    const uint64_t m_cycles = static_cast<uint64_t>(seconds * M_CYCLES_PER_SECOND);
+    const auto start = std::chrono::steady_clock::now();
+    player.run(m_cycles);
+    wav.finish();
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (!wav.good()) {
+      std::cerr << "Failed to write " << argv[2] << std::endl;
+      return -1;
+    }
+
+    std::cout << header.title << std::endl;
+    if (!header.author.empty() || !header.copyright.empty()) {
+      std::cout << "  " << header.author << " " << header.copyright << std::endl;
+    }
+    std::printf("  Song %d of %u, PLAY at the %s rate\n", song, header.song_count,
+                file.uses_timer() ? "timer" : "VBlank");
+    std::printf("  %.1f s (%" PRIu64 " m-cycles, %" PRIu64 " samples) rendered in %.3f s\n", seconds,
+                player.cpu().m_cycles(), wav.samples_written(), elapsed);
+    std::printf("  %.1f M m-cycles/s, %.0fx real time\n", player.cpu().m_cycles() / elapsed / 1e6,
+                seconds / elapsed);
+    return 0;
+  } catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return -1;
+  }
+}
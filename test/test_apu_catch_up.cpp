@@ -0,0 +1,89 @@
+#include <inttypes.h>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Runs a ROM twice, once with the event-driven APU and once stepping every channel every m-cycle, and checks
+// the two produce the same samples and test result. The event-driven run goes until the ROM writes its result
+// code to 0xA000 (or MAX_M_CYCLES), the other for the same number of cycles.
+//
+// Usage: test_apu_catch_up <rom>
+
+namespace {
+constexpr uint64_t MAX_M_CYCLES = 1048576ull * 60;
+constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+constexpr uint16_t RESULT_ADDRESS = 0xA000;
+constexpr uint8_t RESULT_RUNNING = 0x80;
+constexpr int NO_RESULT = -1;
+
+struct AudioRun {
+  uint64_t hash = FNV_OFFSET;
+  uint64_t samples = 0;
+  uint64_t m_cycles = 0;
+  int result = NO_RESULT;
+};
+
+AudioRun run(const std::string& rom, bool event_driven, uint64_t m_cycles) {
+  ROMLoader loader(rom, "");
+  if (!loader.load()) {
+    std::exit(-1);
+  }
+
+  AudioRun result;
+  OSBridge bridge;
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [&result](const int16_t* samples, int num_samples) {
+    for (int i = 0; i < num_samples; i++) {
+      result.hash = (result.hash ^ static_cast<uint16_t>(samples[i])) * FNV_PRIME;
+    }
+    result.samples += num_samples;
+  };
+
+  auto loop = std::make_unique<MainLoop>(loader, bridge);
+  loop->ppu().set_pixel_format(PixelFormat::Indexed);
+  loop->apu().set_event_driven(event_driven);
+  loop->cpu().mc().set_write_callback([&result](uint16_t address, uint8_t value) {
+    if (address == RESULT_ADDRESS && value < RESULT_RUNNING && result.result == NO_RESULT) {
+      result.result = value;
+    }
+  });
+
+  while (loop->cpu().m_cycles() < m_cycles) {
+    loop->run_once();
+    if (m_cycles == MAX_M_CYCLES && result.result != NO_RESULT) {
+      break;
+    }
+  }
+  loop->apu().generate_samples();
+  result.m_cycles = loop->cpu().m_cycles();
+  return result;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_apu_catch_up <rom>" << std::endl;
+    return -1;
+  }
+
+  const AudioRun event_driven = run(argv[1], true, MAX_M_CYCLES);
+  const AudioRun stepped = run(argv[1], false, event_driven.m_cycles);
+
+  std::printf("Event-driven: %" PRIu64 " samples, hash %016" PRIx64 ", result %d over %" PRIu64 " m-cycles\n",
+              event_driven.samples, event_driven.hash, event_driven.result, event_driven.m_cycles);
+  std::printf("Stepped:      %" PRIu64 " samples, hash %016" PRIx64 ", result %d over %" PRIu64 " m-cycles\n",
+              stepped.samples, stepped.hash, stepped.result, stepped.m_cycles);
+  if (event_driven.samples != stepped.samples || event_driven.hash != stepped.hash ||
+      event_driven.result != stepped.result) {
+    std::cout << "FAILED: the event-driven APU differs" << std::endl;
+    return 1;
+  }
+  std::cout << "Identical" << std::endl;
+  return 0;
+}
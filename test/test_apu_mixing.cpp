@@ -0,0 +1,144 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "apu.h"
+
+// Checks the fixed-point mix against the float one and against golden hashes. All four channels play while
+// the envelopes, panning and master volume are swept through their values; the fixed and float samples
+// have to stay within MAX_DIFFERENCE of each other, and the fixed samples have to hash to the same value on
+// every build, which is what lets audio hashes be compared between platforms.
+// Then prints how long a second of point-sampled audio takes to mix each way.
+
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+constexpr uint32_t TEST_SECONDS = 4;
+constexpr uint32_t BENCHMARK_SECONDS = 20;
+constexpr int32_t MAX_DIFFERENCE = 4;  // Rounding differences, summed over the band-limited kernel
+
+// FNV-1a of the fixed-point samples. Update these only for an intended change to the APU's output.
+constexpr uint64_t POINT_SAMPLED_HASH = 0x5114FEE6FEFFCCCF;
+constexpr uint64_t BAND_LIMITED_HASH = 0xA30302FF6D924FCB;
+
+struct CapturedAPU {
+  std::vector<int16_t> samples;
+  APU apu{[this](const int16_t* data, int count) { samples.insert(samples.end(), data, data + count); }};
+};
+
+// Everything at once: two squares, the wave channel and noise
+void play_chord(APU& apu) {
+  apu.audio_register_write(NR26_ADDR, MASTER_ENABLE_BIT);
+  apu.audio_register_write(NR24_ADDR, 0x77);
+  apu.audio_register_write(NR25_ADDR, 0xFF);
+  apu.audio_register_write(NR11_ADDR, 0x40);
+  apu.audio_register_write(NR12_ADDR, 0xF3);
+  apu.audio_register_write(NR13_ADDR, 0x00);
+  apu.audio_register_write(NR14_ADDR, 0x87);
+  apu.audio_register_write(NR16_ADDR, 0x80);
+  apu.audio_register_write(NR17_ADDR, 0x0D);
+  apu.audio_register_write(NR18_ADDR, 0xC6);
+  apu.audio_register_write(NR19_ADDR, 0x87);
+  for (uint16_t address = WAVE_RAM_START; address <= WAVE_RAM_END; address++) {
+    apu.audio_register_write(address, static_cast<uint8_t>(address * 0x37));
+  }
+  apu.audio_register_write(NR1A_ADDR, 0x80);
+  apu.audio_register_write(NR1C_ADDR, 0x20);
+  apu.audio_register_write(NR1D_ADDR, 0x00);
+  apu.audio_register_write(NR1E_ADDR, 0x87);
+  apu.audio_register_write(NR21_ADDR, 0xF1);
+  apu.audio_register_write(NR22_ADDR, 0x11);
+  apu.audio_register_write(NR23_ADDR, 0x80);
+}
+
+// Runs for `seconds`, stepping the master volume, panning and wave volume every 1/8th of a second
+void run(APU& apu, uint32_t seconds) {
+  play_chord(apu);
+  for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND * seconds; tick++) {
+    apu.tick();
+    if ((tick & 2047) == 0) {
+      apu.tick_frame_sequencer();
+    }
+    if ((tick & 0x1FFFF) == 0x1FFFF) {
+      const uint8_t step = static_cast<uint8_t>(tick >> 17);
+      apu.audio_register_write(NR24_ADDR, static_cast<uint8_t>((step & 0x7) << 4 | (~step & 0x7)));
+      apu.audio_register_write(NR25_ADDR, static_cast<uint8_t>(step * 0x5B));
+      apu.audio_register_write(NR1C_ADDR, static_cast<uint8_t>((step & 0x3) << 5));
+    }
+  }
+  apu.generate_samples();
+}
+
+std::vector<int16_t> capture(AudioSynthesis synthesis, AudioMixing mixing) {
+  CapturedAPU captured;
+  captured.apu.set_synthesis(synthesis);
+  captured.apu.set_mixing(mixing);
+  run(captured.apu, TEST_SECONDS);
+  return captured.samples;
+}
+
+uint64_t hash(const std::vector<int16_t>& samples) {
+  uint64_t hash = FNV_OFFSET;
+  for (int16_t sample : samples) {
+    hash = (hash ^ static_cast<uint16_t>(sample)) * FNV_PRIME;
+  }
+  return hash;
+}
+
+bool check(const char* name, AudioSynthesis synthesis, uint64_t expected_hash) {
+  const std::vector<int16_t> fixed = capture(synthesis, AudioMixing::FixedPoint);
+  const std::vector<int16_t> floating = capture(synthesis, AudioMixing::Float);
+  bool passed = true;
+
+  if (fixed.size() != floating.size()) {
+    std::cout << name << ": " << fixed.size() << " fixed samples, " << floating.size() << " float"
+              << std::endl;
+    return false;
+  }
+
+  int32_t max_difference = 0;
+  for (size_t i = 0; i < fixed.size(); i++) {
+    max_difference = std::max(max_difference, std::abs(fixed[i] - floating[i]));
+  }
+  const uint64_t fixed_hash = hash(fixed);
+  std::printf("%s: %zu samples, fixed within %d of float, hash %016" PRIx64 "\n", name, fixed.size(),
+              max_difference, fixed_hash);
+
+  if (max_difference > MAX_DIFFERENCE) {
+    std::cout << "  Fixed-point mix differs from float by more than " << MAX_DIFFERENCE << std::endl;
+    passed = false;
+  }
+  if (fixed_hash != expected_hash) {
+    std::printf("  Expected hash %016" PRIx64 "\n", expected_hash);
+    passed = false;
+  }
+  return passed;
+}
+
+double nanoseconds_per_second(AudioMixing mixing) {
+  uint64_t sample_count = 0;
+  APU apu([&sample_count](const int16_t*, int count) { sample_count += count; });
+  apu.set_synthesis(AudioSynthesis::PointSampled);
+  apu.set_mixing(mixing);
+
+  const auto start = std::chrono::steady_clock::now();
+  run(apu, BENCHMARK_SECONDS);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / BENCHMARK_SECONDS;
+}
+}  // namespace
+
+int main() {
+  bool passed = check("Point sampled", AudioSynthesis::PointSampled, POINT_SAMPLED_HASH);
+  passed &= check("Band-limited ", AudioSynthesis::BandLimited, BAND_LIMITED_HASH);
+
+  std::printf("One second of point-sampled audio: %6.2f ms float, %6.2f ms fixed point\n",
+              nanoseconds_per_second(AudioMixing::Float) / 1e6,
+              nanoseconds_per_second(AudioMixing::FixedPoint) / 1e6);
+
+  std::cout << (passed ? "Fixed-point mixing passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,260 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "apu.h"
+#include "stem_writer.h"
+
+// Checks per-channel stems and the channel mute mask:
+//  - There is a stem frame for every sample frame, and muting other channels leaves a channel's stem as is.
+//  - A muted channel's stem is silent, and the mix while it's muted is exactly the mix with the channel
+//    panned off both sides. Its length counter and the rest of its state keep running: NR52 reads the same as
+//    in an unmuted run throughout, and once it's unmuted the mix is exactly the unmuted run's.
+//  - StemWriter writes each stem to its own WAV, sample for sample.
+// Then prints what muting channels saves and what stems cost.
+
+namespace {
+constexpr uint32_t TEST_SECONDS = 3;
+constexpr uint32_t BENCHMARK_SECONDS = 20;
+constexpr uint32_t MUTE_START = M_CYCLES_PER_SECOND / 2;  // Ticks at which channel 2 is muted and unmuted
+constexpr uint32_t MUTE_END = M_CYCLES_PER_SECOND * 2;
+constexpr uint8_t CHANNEL2 = 0x02;
+constexpr uint8_t CHANNEL2_PANNING = 0x22;  // NR51 bits for channel 2
+constexpr uint32_t WAV_HEADER_BYTES = 44;
+
+using Events = std::function<void(APU& apu, uint32_t tick)>;
+
+struct Run {
+  std::vector<int16_t> mix;
+  std::vector<int16_t> stems;
+  std::vector<uint8_t> nr52;  // Read at every frame sequencer tick
+};
+
+// Everything at once
+void play_chord(APU& apu) {
+  apu.audio_register_write(NR26_ADDR, MASTER_ENABLE_BIT);
+  apu.audio_register_write(NR24_ADDR, 0x77);
+  apu.audio_register_write(NR25_ADDR, 0xFF);
+  apu.audio_register_write(NR11_ADDR, 0x40);
+  apu.audio_register_write(NR12_ADDR, 0xF3);
+  apu.audio_register_write(NR13_ADDR, 0x00);
+  apu.audio_register_write(NR14_ADDR, 0x87);
+  apu.audio_register_write(NR17_ADDR, 0xC0);
+  apu.audio_register_write(NR18_ADDR, 0xC6);
+  for (uint16_t address = WAVE_RAM_START; address <= WAVE_RAM_END; address++) {
+    apu.audio_register_write(address, static_cast<uint8_t>(address * 0x37));
+  }
+  apu.audio_register_write(NR1A_ADDR, 0x80);
+  apu.audio_register_write(NR1C_ADDR, 0x20);
+  apu.audio_register_write(NR1D_ADDR, 0x00);
+  apu.audio_register_write(NR1E_ADDR, 0x87);
+  apu.audio_register_write(NR21_ADDR, 0xF1);
+  apu.audio_register_write(NR22_ADDR, 0x11);
+  apu.audio_register_write(NR23_ADDR, 0x80);
+}
+
+// Channel 2 with a short length every half second, so NR52 changes as its length counter runs out
+void retrigger_channel2(APU& apu, uint32_t tick) {
+  if (tick % (M_CYCLES_PER_SECOND / 2) == 0) {
+    apu.audio_register_write(NR16_ADDR, 0x80 | 0x20);  // Half a second is 128 length ticks, this is 32
+    apu.audio_register_write(NR19_ADDR, 0xC7);
+  }
+}
+
+Run run(AudioSynthesis synthesis, uint8_t mute_mask, const Events& events, uint32_t seconds = TEST_SECONDS) {
+  Run result;
+  APU apu([&result](const int16_t* samples, int count) {
+    result.mix.insert(result.mix.end(), samples, samples + count);
+  });
+  apu.set_synthesis(synthesis);
+  apu.set_stem_callback([&result](const int16_t* stems, int frames) {
+    result.stems.insert(result.stems.end(), stems, stems + frames * AUDIO_STEM_CHANNELS);
+  });
+  apu.set_channel_mute_mask(mute_mask);
+  play_chord(apu);
+  for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND * seconds; tick++) {
+    retrigger_channel2(apu, tick);
+    events(apu, tick);
+    apu.tick();
+    if ((tick & 2047) == 0) {
+      apu.tick_frame_sequencer();
+      result.nr52.push_back(*apu.audio_register_read(NR26_ADDR));
+    }
+  }
+  apu.generate_samples();
+  return result;
+}
+
+void no_events(APU&, uint32_t) {}
+
+// The stem for `channel` from interleaved stems
+std::vector<int16_t> stem(const std::vector<int16_t>& stems, uint32_t channel) {
+  std::vector<int16_t> samples;
+  for (size_t i = channel; i < stems.size(); i += AUDIO_STEM_CHANNELS) {
+    samples.push_back(stems[i]);
+  }
+  return samples;
+}
+
+bool check_stems(const char* name, AudioSynthesis synthesis) {
+  const Run full = run(synthesis, 0, no_events);
+  bool passed = true;
+  size_t audible = 0;
+  if (full.stems.size() != full.mix.size() / 2 * AUDIO_STEM_CHANNELS) {
+    std::printf("%s: %zu stem values for %zu samples\n", name, full.stems.size(), full.mix.size());
+    return false;
+  }
+  for (uint32_t channel = 0; channel < AUDIO_STEM_CHANNELS; channel++) {
+    const Run solo = run(synthesis, static_cast<uint8_t>(~(1 << channel) & 0x0F), no_events);
+    for (uint32_t other = 0; other < AUDIO_STEM_CHANNELS; other++) {
+      const std::vector<int16_t> samples = stem(solo.stems, other);
+      if (other == channel && samples != stem(full.stems, channel)) {
+        std::printf("%s: channel %u's stem changes when the other channels are muted\n", name, channel + 1);
+        passed = false;
+      }
+      if (other != channel && samples != std::vector<int16_t>(samples.size(), 0)) {
+        std::printf("%s: channel %u is muted but its stem isn't silent\n", name, other + 1);
+        passed = false;
+      }
+    }
+    const std::vector<int16_t> samples = stem(full.stems, channel);
+    audible += std::count_if(samples.begin(), samples.end(), [](int16_t sample) { return sample != 0; }) > 0;
+  }
+  if (audible != AUDIO_STEM_CHANNELS) {
+    std::printf("%s: only %zu stems have anything in them\n", name, audible);
+    passed = false;
+  }
+  return passed;
+}
+
+bool check_mute(const char* name, AudioSynthesis synthesis) {
+  const Run reference = run(synthesis, 0, no_events);
+  const Run muted = run(synthesis, 0, [](APU& apu, uint32_t tick) {
+    if (tick == MUTE_START || tick == MUTE_END) {
+      apu.set_channel_mute_mask(tick == MUTE_START ? CHANNEL2 : 0);
+    }
+  });
+  const Run panned_off = run(synthesis, 0, [](APU& apu, uint32_t tick) {
+    if (tick == MUTE_START || tick == MUTE_END) {
+      apu.audio_register_write(NR25_ADDR, tick == MUTE_START ? 0xFF & ~CHANNEL2_PANNING : 0xFF);
+    }
+  });
+  bool passed = true;
+
+  if (muted.nr52 != reference.nr52) {
+    std::printf("%s: NR52 differs while channel 2 is muted\n", name);
+    passed = false;
+  }
+  if (muted.mix != panned_off.mix) {
+    std::printf("%s: the mix with channel 2 muted isn't the mix with it panned off\n", name);
+    passed = false;
+  }
+  // Point sampling has no memory, so the mix matches again from the sample after unmuting
+  if (synthesis == AudioSynthesis::PointSampled) {
+    const size_t unmuted = (static_cast<size_t>(MUTE_END) * AUDIO_SAMPLE_RATE / M_CYCLES_PER_SECOND + 1) * 2;
+    if (!std::equal(muted.mix.begin() + unmuted, muted.mix.end(), reference.mix.begin() + unmuted)) {
+      std::printf("%s: the mix after unmuting differs\n", name);
+      passed = false;
+    }
+  }
+  const std::vector<int16_t> channel2 = stem(muted.stems, 1);
+  const size_t muted_from = static_cast<size_t>(MUTE_START) * AUDIO_SAMPLE_RATE / M_CYCLES_PER_SECOND + 64;
+  const size_t muted_to = static_cast<size_t>(MUTE_END) * AUDIO_SAMPLE_RATE / M_CYCLES_PER_SECOND;
+  if (!std::all_of(channel2.begin() + muted_from, channel2.begin() + muted_to,
+                   [](int16_t sample) { return sample == 0; })) {
+    std::printf("%s: channel 2's stem isn't silent while it's muted\n", name);
+    passed = false;
+  }
+  return passed;
+}
+
+std::vector<int16_t> read_wav(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  const std::vector<char> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  std::vector<int16_t> samples;
+  for (size_t i = WAV_HEADER_BYTES; i + 1 < bytes.size(); i += 2) {
+    const uint8_t low = static_cast<uint8_t>(bytes[i]);
+    const uint8_t high = static_cast<uint8_t>(bytes[i + 1]);
+    samples.push_back(static_cast<int16_t>(low | high << 8));
+  }
+  return samples;
+}
+
+bool check_stem_writer() {
+  const std::filesystem::path prefix = std::filesystem::temp_directory_path() / "gbemu_stems";
+  std::vector<int16_t> stems;
+  {
+    StemWriter writer(prefix.string(), AUDIO_SAMPLE_RATE);
+    APU apu([](const int16_t*, int) {});
+    apu.set_stem_callback([&](const int16_t* data, int frames) {
+      stems.insert(stems.end(), data, data + frames * AUDIO_STEM_CHANNELS);
+      writer.push(data, static_cast<size_t>(frames));
+    });
+    play_chord(apu);
+    for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND; tick++) {
+      apu.tick();
+      if ((tick & 2047) == 0) {
+        apu.tick_frame_sequencer();
+      }
+    }
+    apu.generate_samples();
+    if (writer.failed()) {
+      std::cout << writer.error() << std::endl;
+      return false;
+    }
+  }
+
+  bool passed = true;
+  for (uint32_t channel = 0; channel < AUDIO_STEM_CHANNELS; channel++) {
+    const std::filesystem::path path = prefix.string() + "-ch" + std::to_string(channel + 1) + ".wav";
+    if (read_wav(path) != stem(stems, channel)) {
+      std::printf("Stem writer: %s doesn't hold channel %u's stem\n", path.string().c_str(), channel + 1);
+      passed = false;
+    }
+    std::filesystem::remove(path);
+  }
+  return passed;
+}
+
+double milliseconds_per_second(uint8_t mute_mask, bool stems) {
+  APU apu([](const int16_t*, int) {});
+  if (stems) {
+    apu.set_stem_callback([](const int16_t*, int) {});
+  }
+  apu.set_channel_mute_mask(mute_mask);
+  play_chord(apu);
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND * BENCHMARK_SECONDS; tick++) {
+    apu.tick();
+    if ((tick & 2047) == 0) {
+      apu.tick_frame_sequencer();
+    }
+  }
+  apu.generate_samples();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::milli>(elapsed).count() / BENCHMARK_SECONDS;
+}
+}  // namespace
+
+int main() {
+  bool passed = check_stems("Point sampled", AudioSynthesis::PointSampled);
+  passed &= check_stems("Band-limited ", AudioSynthesis::BandLimited);
+  passed &= check_mute("Point sampled", AudioSynthesis::PointSampled);
+  passed &= check_mute("Band-limited ", AudioSynthesis::BandLimited);
+  passed &= check_stem_writer();
+
+  std::printf("One second of band-limited audio: %6.2f ms, %6.2f ms with three channels muted, "
+              "%6.2f ms with stems\n",
+              milliseconds_per_second(0, false), milliseconds_per_second(0x0E, false),
+              milliseconds_per_second(0, true));
+
+  std::cout << (passed ? "Stems and muting passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,289 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+#include "apu.h"
+#include "blip_buffer.h"
+
+// Measures aliasing of the APU synthesis modes. A square wave on channel 2 is swept up through the audible
+// range; for each tone the FFT of the output is split into the energy at the square's harmonics below
+// Nyquist and everything else, which for a pure tone can only be aliasing (and the spectral leakage floor).
+// Band-limited synthesis at Medium and High quality has to keep that under MAX_BAND_LIMITED_ALIAS_DB at every
+// pitch, at 48 kHz and at each of the OTHER_SAMPLE_RATES.
+// Then prints how long a second of audio takes to synthesise each way, and the cost per output sample of each
+// resampler quality.
+
+namespace {
+constexpr uint32_t FFT_SIZE = 1 << 14;
+constexpr uint32_t SETTLE_SAMPLES = 1024;  // Skipped, so the trigger isn't in the window
+constexpr int32_t HARMONIC_HALF_WIDTH = 6;  // Bins either side of a harmonic that count as the harmonic
+constexpr uint32_t DC_BINS = 8;
+constexpr double MAX_BAND_LIMITED_ALIAS_DB = -55.0;
+constexpr uint32_t BENCHMARK_SECONDS = 20;
+constexpr double PI = 3.14159265358979323846;
+
+// 11-bit channel 2 periods to sweep, from ~260 Hz to ~10.9 kHz
+constexpr uint16_t SWEEP_PERIODS[] = {1546, 1750, 1850, 1920, 1960, 1990, 2010, 2024, 2030, 2036};
+
+// 44.1 and 32 kHz sinks, and 48 kHz nudged the way rate control would. Only tones below
+// MAX_TONE_FRACTION of the rate are checked; above that the kernels start cutting the tone itself.
+constexpr double OTHER_SAMPLE_RATES[] = {44100.0, 32000.0, 48000.0 * 1.005};
+constexpr double MAX_TONE_FRACTION = 0.25;
+
+// Steps the resampler-only benchmark adds, one every this many m-cycles (about 5 per sample)
+constexpr uint32_t RESAMPLER_STEP_INTERVAL = 4;
+constexpr uint32_t RESAMPLER_FRAME_CLOCKS = 1024;
+
+constexpr ResamplerQuality QUALITIES[] = {ResamplerQuality::Linear, ResamplerQuality::Low,
+                                          ResamplerQuality::Medium, ResamplerQuality::High};
+constexpr const char* QUALITY_NAMES[] = {"linear", "low", "medium", "high"};
+
+struct CapturedAPU {
+  std::vector<int16_t> samples;
+  APU apu{[this](const int16_t* data, int count) { samples.insert(samples.end(), data, data + count); }};
+};
+
+void power_on(APU& apu) {
+  apu.audio_register_write(NR26_ADDR, MASTER_ENABLE_BIT);
+  apu.audio_register_write(NR24_ADDR, 0x77);  // NR50: full volume both sides
+}
+
+// Channel 2, 50% duty, full volume, panned to both sides
+void play_square(APU& apu, uint16_t period) {
+  apu.audio_register_write(NR25_ADDR, 0x22);
+  apu.audio_register_write(NR16_ADDR, 0x80);
+  apu.audio_register_write(NR17_ADDR, 0xF0);
+  apu.audio_register_write(NR18_ADDR, period & 0xFF);
+  apu.audio_register_write(NR19_ADDR, 0x80 | (period >> 8));
+}
+
+// Everything at once: two squares, the wave channel and noise
+void play_chord(APU& apu) {
+  apu.audio_register_write(NR25_ADDR, 0xFF);
+  apu.audio_register_write(NR11_ADDR, 0x40);
+  apu.audio_register_write(NR12_ADDR, 0xF0);
+  apu.audio_register_write(NR13_ADDR, 0x00);
+  apu.audio_register_write(NR14_ADDR, 0x87);
+  play_square(apu, 1990);
+  for (uint16_t address = WAVE_RAM_START; address <= WAVE_RAM_END; address++) {
+    apu.audio_register_write(address, static_cast<uint8_t>(address * 0x37));
+  }
+  apu.audio_register_write(NR1A_ADDR, 0x80);
+  apu.audio_register_write(NR1C_ADDR, 0x20);
+  apu.audio_register_write(NR1D_ADDR, 0x00);
+  apu.audio_register_write(NR1E_ADDR, 0x87);
+  apu.audio_register_write(NR21_ADDR, 0xF0);
+  apu.audio_register_write(NR22_ADDR, 0x11);
+  apu.audio_register_write(NR23_ADDR, 0x80);
+}
+
+void fft(std::vector<std::complex<double>>& data) {
+  const size_t n = data.size();
+  for (size_t i = 1, j = 0; i < n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+    if (i < j) {
+      std::swap(data[i], data[j]);
+    }
+  }
+  for (size_t length = 2; length <= n; length <<= 1) {
+    const std::complex<double> root = std::polar(1.0, -2.0 * PI / length);
+    for (size_t start = 0; start < n; start += length) {
+      std::complex<double> w = 1.0;
+      for (size_t k = 0; k < length / 2; k++) {
+        const std::complex<double> even = data[start + k];
+        const std::complex<double> odd = data[start + k + length / 2] * w;
+        data[start + k] = even + odd;
+        data[start + k + length / 2] = even - odd;
+        w *= root;
+      }
+    }
+  }
+}
+
+struct ToneResult {
+  double frequency;
+  double peak_frequency;  // Loudest bin
+  double alias_db;        // Energy away from the harmonics, relative to the harmonics
+  double bin_hz;
+
+  bool passed() const {
+    return std::abs(peak_frequency - frequency) <= 2 * bin_hz && alias_db <= MAX_BAND_LIMITED_ALIAS_DB;
+  }
+};
+
+ToneResult measure_tone(AudioSynthesis synthesis, uint16_t period,
+                        ResamplerQuality quality = ResamplerQuality::Medium,
+                        double sample_rate = AUDIO_SAMPLE_RATE) {
+  CapturedAPU captured;
+  captured.apu.set_synthesis(synthesis);
+  captured.apu.set_resampler_quality(quality);
+  captured.apu.set_sample_rate(sample_rate);
+  power_on(captured.apu);
+  play_square(captured.apu, period);
+  while (captured.samples.size() < (SETTLE_SAMPLES + FFT_SIZE) * 2) {
+    captured.apu.tick();
+  }
+
+  // Blackman-Harris window on the left channel
+  std::vector<std::complex<double>> spectrum(FFT_SIZE);
+  for (uint32_t i = 0; i < FFT_SIZE; i++) {
+    const double x = 2.0 * PI * i / (FFT_SIZE - 1);
+    const double window =
+        0.35875 - 0.48829 * std::cos(x) + 0.14128 * std::cos(2 * x) - 0.01168 * std::cos(3 * x);
+    spectrum[i] = captured.samples[(SETTLE_SAMPLES + i) * 2] * window;
+  }
+  fft(spectrum);
+
+  ToneResult result;
+  result.frequency = static_cast<double>(M_CYCLES_PER_SECOND) / (8.0 * (2048 - period));
+  const double bin_hz = sample_rate / FFT_SIZE;
+  result.bin_hz = bin_hz;
+
+  // A 50% square only has odd harmonics
+  std::vector<bool> harmonic(FFT_SIZE / 2, false);
+  for (double f = result.frequency; f < sample_rate / 2.0; f += 2.0 * result.frequency) {
+    const int32_t centre = static_cast<int32_t>(std::lround(f / bin_hz));
+    for (int32_t bin = centre - HARMONIC_HALF_WIDTH; bin <= centre + HARMONIC_HALF_WIDTH; bin++) {
+      if (bin >= 0 && bin < static_cast<int32_t>(FFT_SIZE / 2)) {
+        harmonic[bin] = true;
+      }
+    }
+  }
+
+  double harmonic_power = 0.0;
+  double alias_power = 0.0;
+  double peak_power = 0.0;
+  uint32_t peak_bin = 0;
+  for (uint32_t bin = DC_BINS; bin < FFT_SIZE / 2; bin++) {
+    const double power = std::norm(spectrum[bin]);
+    (harmonic[bin] ? harmonic_power : alias_power) += power;
+    if (power > peak_power) {
+      peak_power = power;
+      peak_bin = bin;
+    }
+  }
+  result.peak_frequency = peak_bin * bin_hz;
+  result.alias_db = 10.0 * std::log10(alias_power / harmonic_power);
+  return result;
+}
+
+// Nanoseconds to synthesise one second of audio
+template <typename Setup>
+double nanoseconds_per_second(AudioSynthesis synthesis, bool event_driven, Setup setup,
+                              ResamplerQuality quality = ResamplerQuality::Medium) {
+  uint64_t sample_count = 0;
+  APU apu([&sample_count](const int16_t*, int count) { sample_count += count; });
+  apu.set_synthesis(synthesis);
+  apu.set_event_driven(event_driven);
+  apu.set_resampler_quality(quality);
+  power_on(apu);
+  setup(apu);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t second = 0; second < BENCHMARK_SECONDS; second++) {
+    for (uint32_t tick = 0; tick < M_CYCLES_PER_SECOND; tick++) {
+      apu.tick();
+      if ((tick & 2047) == 0) {
+        apu.tick_frame_sequencer();
+      }
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / BENCHMARK_SECONDS;
+}
+// Nanoseconds per output sample for the blip buffer alone, with a step every RESAMPLER_STEP_INTERVAL m-cycles
+double resampler_nanoseconds_per_sample(ResamplerQuality quality) {
+  BlipBuffer blip_buffer(M_CYCLES_PER_SECOND, AUDIO_SAMPLE_RATE, quality);
+  std::vector<int16_t> out(BlipBuffer::MAX_FRAME_SAMPLES * 2);
+  int32_t level = 1000;
+  uint64_t samples = 0;
+
+  const auto start = std::chrono::steady_clock::now();
+  const uint32_t frames = BENCHMARK_SECONDS * M_CYCLES_PER_SECOND / RESAMPLER_FRAME_CLOCKS;
+  for (uint32_t frame = 0; frame < frames; frame++) {
+    for (uint32_t time = 0; time < RESAMPLER_FRAME_CLOCKS; time += RESAMPLER_STEP_INTERVAL) {
+      blip_buffer.add_delta(time, level, -level);
+      level = -level;
+    }
+    blip_buffer.end_frame(RESAMPLER_FRAME_CLOCKS);
+    const uint32_t available = blip_buffer.samples_available();
+    blip_buffer.read_samples(out.data(), available);
+    samples += available;
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / samples;
+}
+}  // namespace
+
+int main() {
+  bool passed = true;
+  std::printf("Aliasing at %u Hz\n%9s  %9s", AUDIO_SAMPLE_RATE, "tone", "point");
+  for (const char* name : QUALITY_NAMES) {
+    std::printf(" %9s", name);
+  }
+  std::printf("\n");
+  for (uint16_t period : SWEEP_PERIODS) {
+    const ToneResult point = measure_tone(AudioSynthesis::PointSampled, period);
+    std::printf("%7.0fHz  %6.1f dB", point.frequency, point.alias_db);
+    for (ResamplerQuality quality : QUALITIES) {
+      const ToneResult blep = measure_tone(AudioSynthesis::BandLimited, period, quality);
+      std::printf(" %6.1f dB", blep.alias_db);
+      if (quality >= ResamplerQuality::Medium && !blep.passed()) {
+        std::printf(" <- peaks at %.0f Hz, or aliasing above %.0f dB", blep.peak_frequency,
+                    MAX_BAND_LIMITED_ALIAS_DB);
+        passed = false;
+      }
+    }
+    std::printf("\n");
+  }
+
+  for (double sample_rate : OTHER_SAMPLE_RATES) {
+    double worst_alias_db = -1000.0;
+    for (uint16_t period : SWEEP_PERIODS) {
+      if (M_CYCLES_PER_SECOND / (8.0 * (2048 - period)) > sample_rate * MAX_TONE_FRACTION) {
+        continue;
+      }
+      const ToneResult blep =
+          measure_tone(AudioSynthesis::BandLimited, period, ResamplerQuality::Medium, sample_rate);
+      worst_alias_db = std::max(worst_alias_db, blep.alias_db);
+      if (!blep.passed()) {
+        std::printf("  %.0f Hz tone at %.1f Hz peaks at %.0f Hz, aliasing %.1f dB\n", blep.frequency,
+                    sample_rate, blep.peak_frequency, blep.alias_db);
+        passed = false;
+      }
+    }
+    std::printf("Worst aliasing at %.1f Hz: %.1f dB\n", sample_rate, worst_alias_db);
+  }
+
+  const auto silence = [](APU&) {};
+  const auto chord = [](APU& apu) { play_chord(apu); };
+  std::printf("One second of audio, point sampled:              %6.2f ms silent, %6.2f ms all channels\n",
+              nanoseconds_per_second(AudioSynthesis::PointSampled, false, silence) / 1e6,
+              nanoseconds_per_second(AudioSynthesis::PointSampled, false, chord) / 1e6);
+  std::printf("One second of audio, band-limited, stepped:      %6.2f ms silent, %6.2f ms all channels\n",
+              nanoseconds_per_second(AudioSynthesis::BandLimited, false, silence) / 1e6,
+              nanoseconds_per_second(AudioSynthesis::BandLimited, false, chord) / 1e6);
+  std::printf("One second of audio, band-limited, event-driven: %6.2f ms silent, %6.2f ms all channels\n",
+              nanoseconds_per_second(AudioSynthesis::BandLimited, true, silence) / 1e6,
+              nanoseconds_per_second(AudioSynthesis::BandLimited, true, chord) / 1e6);
+  std::printf("One second of emulation, no audio output:        %6.2f ms silent, %6.2f ms all channels\n",
+              nanoseconds_per_second(AudioSynthesis::None, true, silence) / 1e6,
+              nanoseconds_per_second(AudioSynthesis::None, true, chord) / 1e6);
+  for (ResamplerQuality quality : QUALITIES) {
+    const double playing = nanoseconds_per_second(AudioSynthesis::BandLimited, true, chord, quality);
+    std::printf("Resampler quality %-6s: %5.1f ns per sample resampling alone, %6.1f ns for the whole APU\n",
+                QUALITY_NAMES[static_cast<size_t>(quality)], resampler_nanoseconds_per_sample(quality),
+                playing / AUDIO_SAMPLE_RATE);
+  }
+
+  std::cout << (passed ? "Band-limited synthesis passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "audio_output_buffer.h"
+#include "spsc_ring_buffer.h"
+
+// Two checks of the audio path between the emulation thread and the device:
+//  - SPSCRingBuffer's bulk push/pop between two threads, with chunk sizes that keep wrapping the ring, has to
+//    deliver every value once and in order.
+//  - AudioOutputBuffer with its rate control, simulated for SIMULATED_SECONDS against devices whose clocks
+//    run fast and slow. Once settled there must be no underruns or dropped samples, every sample has to come
+//    out in order, the fill level has to stay within MIN_FILL..MAX_FILL and the rate within +-0.5%, moving
+//    by no more than MAX_RATE_STEP from one frame to the next.
+//    That's checked with both of the main loop's pacing clocks. PacingClock::Wall paces frames by the host's
+//    clock and generates at the controlled rate. PacingClock::Audio generates at the device's nominal rate
+//    and scales the frame duration by the controlled rate instead, so there the frame rate has to stay
+//    within +-0.5% of the Game Boy's.
+
+namespace {
+constexpr uint32_t RING_VALUES = 1 << 22;
+
+constexpr double SIMULATED_SECONDS = 600.0;
+constexpr double SETTLE_SECONDS = 60.0;
+constexpr double DEVICE_DRIFTS[] = {-0.003, -0.001, 0.0, 0.001, 0.003};
+constexpr double DEVICE_RATES[] = {48000.0, 44100.0};
+constexpr uint32_t DEVICE_CALLBACK_FRAMES = 512;
+// The main loop paces frames to 16.74 ms, a Game Boy frame is 70224 / 4194304 s
+constexpr double HOST_FRAME_SECONDS = 0.016740;
+constexpr double EMULATED_FRAME_SECONDS = 70224.0 / 4194304.0;
+constexpr double MIN_FILL = 0.2;
+constexpr double MAX_FILL = 0.8;
+constexpr double MAX_RATE_STEP = 0.0002;  // Fraction of the nominal rate
+constexpr size_t CHANNELS = 2;
+
+bool check_ring_threads() {
+  SPSCRingBuffer<uint32_t, 1024> ring;
+  std::thread producer([&ring]() {
+    std::vector<uint32_t> chunk(333);
+    uint32_t next = 0;
+    while (next < RING_VALUES) {
+      const size_t count = std::min<size_t>(chunk.size() - next % 97, RING_VALUES - next);
+      for (size_t i = 0; i < count; i++) {
+        chunk[i] = next + static_cast<uint32_t>(i);
+      }
+      const size_t pushed = ring.push(chunk.data(), count);
+      next += static_cast<uint32_t>(pushed);
+      if (pushed == 0) {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::vector<uint32_t> chunk(517);
+  uint32_t expected = 0;
+  bool in_order = true;
+  while (expected < RING_VALUES) {
+    const size_t popped = ring.pop(chunk.data(), chunk.size() - expected % 89);
+    for (size_t i = 0; i < popped; i++) {
+      in_order &= chunk[i] == expected++;
+    }
+    if (popped == 0) {
+      std::this_thread::yield();
+    }
+  }
+  producer.join();
+
+  std::printf("Ring: %u values across threads %s\n", RING_VALUES, in_order ? "in order" : "OUT OF ORDER");
+  return in_order && ring.empty();
+}
+
+struct SimulationResult {
+  uint64_t underruns = 0;
+  uint64_t overruns = 0;
+  uint64_t discontinuities = 0;
+  double min_fill = 1.0;
+  double max_fill = 0.0;
+  double max_rate_error = 0.0;  // Fractions of the nominal rate
+  double max_rate_step = 0.0;
+};
+
+// The emulation thread generates a frame's worth of samples at the controlled rate every HOST_FRAME_SECONDS,
+// or by the audio clock at the nominal rate every frame duration MainLoop::update_audio_output() sets; the
+// device pulls DEVICE_CALLBACK_FRAMES at a time on its own, drifted, clock. Samples count up, so a dropped
+// or repeated sample shows as a discontinuity.
+SimulationResult simulate(double device_rate, double drift, bool audio_clock) {
+  AudioOutputBuffer buffer(device_rate);
+  SimulationResult result;
+  const double callback_seconds = DEVICE_CALLBACK_FRAMES / (device_rate * (1.0 + drift));
+
+  std::vector<int16_t> generated;
+  std::vector<int16_t> pulled(DEVICE_CALLBACK_FRAMES * CHANNELS);
+  double rate = device_rate;
+  double fraction = 0.0;  // Samples generated, carried between frames
+  uint16_t next_sample = 0;
+  int16_t last_pulled = 0;
+  bool started = false;
+
+  double next_frame = 0.0;
+  double next_callback = 0.0;
+  uint64_t underruns_at_settle = 0;
+  uint64_t overruns_at_settle = 0;
+  while (next_frame < SIMULATED_SECONDS) {
+    const bool settled = next_frame > SETTLE_SECONDS;
+    if (next_frame <= next_callback) {
+      fraction += EMULATED_FRAME_SECONDS * (audio_clock ? device_rate : rate);
+      const size_t frames = static_cast<size_t>(fraction);
+      fraction -= frames;
+      generated.resize(frames * CHANNELS);
+      for (size_t frame = 0; frame < frames; frame++) {
+        generated[frame * CHANNELS] = generated[frame * CHANNELS + 1] = static_cast<int16_t>(next_sample++);
+      }
+      buffer.push(generated.data(), generated.size());
+
+      const AudioOutputStatus status = buffer.update();
+      if (settled) {
+        result.underruns = status.underruns - underruns_at_settle;
+        result.overruns = status.overruns - overruns_at_settle;
+        result.min_fill = std::min(result.min_fill, status.fill);
+        result.max_fill = std::max(result.max_fill, status.fill);
+        // By the audio clock this is also how far the frame rate is off the Game Boy's
+        const double rate_error = std::abs(status.sample_rate / device_rate - 1);
+        const double rate_step = std::abs(status.sample_rate - rate) / device_rate;
+        result.max_rate_error = std::max(result.max_rate_error, rate_error);
+        result.max_rate_step = std::max(result.max_rate_step, rate_step);
+      } else {
+        underruns_at_settle = status.underruns;
+        overruns_at_settle = status.overruns;
+      }
+      rate = status.sample_rate;
+      if (audio_clock) {
+        const double speed = status.sample_rate / device_rate;
+        next_frame += EMULATED_FRAME_SECONDS / speed;
+      } else {
+        next_frame += HOST_FRAME_SECONDS;
+      }
+    } else {
+      const uint64_t underruns_before = buffer.underruns();
+      buffer.pull(pulled.data(), pulled.size());
+      // Held samples repeat, anything else has to be the next sample
+      for (size_t frame = 0; frame < DEVICE_CALLBACK_FRAMES; frame++) {
+        const int16_t sample = pulled[frame * CHANNELS];
+        if (started && settled && sample != static_cast<int16_t>(last_pulled + 1) && sample != last_pulled) {
+          result.discontinuities++;
+        }
+        started |= buffer.underruns() == underruns_before && sample != 0;
+        last_pulled = sample;
+      }
+      next_callback += callback_seconds;
+    }
+  }
+  return result;
+}
+
+bool check_simulation(double device_rate, double drift, bool audio_clock) {
+  const SimulationResult result = simulate(device_rate, drift, audio_clock);
+  std::printf("%s clock, %5.0f Hz device %+.1f%%: fill %4.1f%%-%4.1f%%, %s within %.3f%%, step %.4f%%, "
+              "%" PRIu64 " underruns, %" PRIu64 " dropped, %" PRIu64 " discontinuities\n",
+              audio_clock ? "Audio" : "Wall", device_rate, drift * 100, result.min_fill * 100,
+              result.max_fill * 100, audio_clock ? "frame rate" : "rate", result.max_rate_error * 100,
+              result.max_rate_step * 100, result.underruns, result.overruns, result.discontinuities);
+
+  bool passed = true;
+  if (result.min_fill < MIN_FILL || result.max_fill > MAX_FILL) {
+    std::cout << "  Fill level out of range" << std::endl;
+    passed = false;
+  }
+  const bool rate_too_far = result.max_rate_error > AudioRateControl::MAX_ADJUSTMENT + 1e-9;
+  if (rate_too_far || result.max_rate_step > MAX_RATE_STEP) {
+    std::cout << "  Rate moved too far or too fast" << std::endl;
+    passed = false;
+  }
+  if (result.underruns > 0 || result.overruns > 0 || result.discontinuities > 0) {
+    std::cout << "  Samples dropped or out of order" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+}  // namespace
+
+int main() {
+  bool passed = check_ring_threads();
+
+  for (bool audio_clock : {false, true}) {
+    for (double device_rate : DEVICE_RATES) {
+      for (double drift : DEVICE_DRIFTS) {
+        passed &= check_simulation(device_rate, drift, audio_clock);
+      }
+    }
+  }
+
+  std::cout << (passed ? "Audio output passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+#include <inttypes.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_constants.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+#include "save_state.h"
+
+// Runs a ROM twice, once synthesizing audio inline and once on an AudioWorker from power on, and checks the
+// two produce the same samples and test result. The dmg_sound ROMs read NR52 and wave RAM throughout, so a
+// matching result means the status model answered every read correctly. The inline run goes until the ROM
+// writes its result code to 0xA000 (or MAX_M_CYCLES), the worker run for the same number of cycles.
+// Also prints the emulation thread's CPU time for each.
+//
+// With --save-state, saves and loads states with the worker attached and detached instead, and checks that
+// only the worker ever synthesizes while it is attached, that a state saved with it attached isn't silent
+// once it's gone, and that the amount of audio stays the same throughout, so nothing plays twice. Then does
+// the same with AudioSynthesis::None, which has to survive each save and load and stay silent.
+//
+// Usage: test_audio_worker <rom> [--save-state]
+
+namespace {
+constexpr uint64_t MAX_M_CYCLES = 1048576ull * 60;
+constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+constexpr uint16_t RESULT_ADDRESS = 0xA000;
+constexpr uint8_t RESULT_RUNNING = 0x80;
+constexpr int NO_RESULT = -1;
+constexpr uint64_t SAVE_STATE_M_CYCLES = 1048576ull * 2;  // Run between each save and load
+constexpr double SAMPLE_COUNT_TOLERANCE = 0.01;
+
+struct AudioRun {
+  uint64_t hash = FNV_OFFSET;
+  uint64_t samples = 0;
+  uint64_t m_cycles = 0;
+  int result = NO_RESULT;
+  double milliseconds = 0.0;  // CPU time of the emulation thread
+};
+
+// CPU time used by the calling thread, or wall time where that isn't available
+double thread_milliseconds() {
+#if defined(CLOCK_THREAD_CPUTIME_ID)
+  timespec time;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+  return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+#else
+  const auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration<double, std::milli>(now).count();
+#endif
+}
+
+AudioRun run(const std::string& rom, bool audio_thread, uint64_t m_cycles) {
+  ROMLoader loader(rom, "");
+  if (!loader.load()) {
+    std::exit(-1);
+  }
+
+  AudioRun result;
+  OSBridge bridge;
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [&result](const int16_t* samples, int num_samples) {
+    for (int i = 0; i < num_samples; i++) {
+      result.hash = (result.hash ^ static_cast<uint16_t>(samples[i])) * FNV_PRIME;
+    }
+    result.samples += num_samples;
+  };
+
+  auto loop = std::make_unique<MainLoop>(loader, bridge);
+  loop->ppu().set_pixel_format(PixelFormat::Indexed);
+  loop->set_audio_thread(audio_thread);
+  loop->cpu().mc().set_write_callback([&result](uint16_t address, uint8_t value) {
+    if (address == RESULT_ADDRESS && value < RESULT_RUNNING && result.result == NO_RESULT) {
+      result.result = value;
+    }
+  });
+
+  const double start = thread_milliseconds();
+  while (loop->cpu().m_cycles() < m_cycles) {
+    loop->run_once();
+    if (m_cycles == MAX_M_CYCLES && result.result != NO_RESULT) {
+      break;
+    }
+  }
+  loop->apu().generate_samples();
+  result.milliseconds = thread_milliseconds() - start;
+
+  // Waits for the worker to play out everything
+  loop->set_audio_thread(false);
+  result.m_cycles = loop->cpu().m_cycles();
+  return result;
+}
+void print_run(const char* name, const AudioRun& run) {
+  std::printf("%s: %" PRIu64 " samples, hash %016" PRIx64 ", result %d over %" PRIu64 " m-cycles, %.1f ms\n",
+              name, run.samples, run.hash, run.result, run.m_cycles, run.milliseconds);
+}
+
+// Counts samples by the thread they arrive on
+struct SampleCounter {
+  std::thread::id emulation_thread = std::this_thread::get_id();
+  std::atomic<uint64_t> emulation_samples{0};
+  std::atomic<uint64_t> worker_samples{0};
+
+  uint64_t total() const { return emulation_samples + worker_samples; }
+};
+
+void save(const MainLoop& loop, const std::string& path) {
+  SaveStateSerializer serializer(path, false);
+  serializer << loop;
+}
+
+void load(MainLoop& loop, const std::string& path) {
+  SaveStateSerializer serializer(path, true);
+  serializer >> loop;
+}
+
+void run_for(MainLoop& loop, uint64_t m_cycles) {
+  const uint64_t end = loop.cpu().m_cycles() + m_cycles;
+  while (loop.cpu().m_cycles() < end) {
+    loop.run_once();
+  }
+  loop.apu().generate_samples();
+}
+
+// Checks the samples from a stretch of emulation: from the expected thread only, at the output rate
+bool check_stretch(const char* name, MainLoop& loop, SampleCounter& counter, bool worker) {
+  const uint64_t emulation_before = counter.emulation_samples;
+  const uint64_t worker_before = counter.worker_samples;
+  run_for(loop, SAVE_STATE_M_CYCLES);
+  if (worker) {
+    // Plays out what the worker has been sent
+    loop.set_audio_thread(false);
+  }
+  const uint64_t emulation = counter.emulation_samples - emulation_before;
+  const uint64_t produced = counter.worker_samples - worker_before;
+  const uint64_t samples = emulation + produced;
+  const double expected =
+      static_cast<double>(SAVE_STATE_M_CYCLES) / M_CYCLES_PER_SECOND * AUDIO_SAMPLE_RATE * 2;
+  std::printf("%s: %" PRIu64 " samples on the emulation thread, %" PRIu64
+              " from the worker, expected %.0f\n",
+              name, emulation, produced, expected);
+
+  bool passed = true;
+  if ((worker && emulation != 0) || (!worker && produced != 0)) {
+    std::cout << "  Samples came from the wrong thread" << std::endl;
+    passed = false;
+  }
+  if (samples < expected * (1 - SAMPLE_COUNT_TOLERANCE) ||
+      samples > expected * (1 + SAMPLE_COUNT_TOLERANCE)) {
+    std::cout << "  Wrong amount of audio" << std::endl;
+    passed = false;
+  }
+  if (worker) {
+    loop.set_audio_thread(true);
+  }
+  return passed;
+}
+
+// Every APU register, as the CPU reads them
+std::vector<uint8_t> audio_snapshot(MainLoop& loop) {
+  std::vector<uint8_t> snapshot;
+  for (uint16_t address = AUDIO_REG_START; address <= WAVE_RAM_END; address++) {
+    snapshot.push_back(*loop.apu().audio_register_read(address));
+  }
+  return snapshot;
+}
+
+// Whether a stretch of emulation played nothing at all, the way AudioSynthesis::None has to
+bool check_silent(const char* name, MainLoop& loop, SampleCounter& counter) {
+  const uint64_t before = counter.total();
+  run_for(loop, SAVE_STATE_M_CYCLES);
+  const bool worker = loop.audio_thread();
+  loop.set_audio_thread(false);
+  const uint64_t samples = counter.total() - before;
+  std::printf("%s: %" PRIu64 " samples, expected none\n", name, samples);
+  if (worker) {
+    loop.set_audio_thread(true);
+  }
+  return samples == 0;
+}
+
+// AudioSynthesis::None through save states: a state saved in it loads in it, with or without the worker, and
+// a load puts the emulation back exactly where it was saved. Leaves the loop on BandLimited.
+bool check_null_audio_round_trip(MainLoop& loop, SampleCounter& counter,
+                                 const std::filesystem::path& directory) {
+  const std::string without_worker = (directory / "test_audio_worker_null_inline.state").string();
+  const std::string with_worker = (directory / "test_audio_worker_null_worker.state").string();
+  bool passed = true;
+
+  loop.apu().set_synthesis(AudioSynthesis::None);
+  save(loop, without_worker);
+  passed &= check_silent("None", loop, counter);
+  const std::vector<uint8_t> expected = audio_snapshot(loop);
+
+  loop.apu().set_synthesis(AudioSynthesis::BandLimited);
+  load(loop, without_worker);
+  if (loop.apu().synthesis() != AudioSynthesis::None) {
+    std::cout << "A state saved with AudioSynthesis::None loaded with synthesis on" << std::endl;
+    passed = false;
+  }
+  passed &= check_silent("None state, reloaded", loop, counter);
+  if (audio_snapshot(loop) != expected) {
+    std::cout << "  The APU registers differ from the run before the state was loaded" << std::endl;
+    passed = false;
+  }
+
+  // Under the worker the APU stays on None whatever the state says, and the worker takes the saved mode
+  loop.apu().set_synthesis(AudioSynthesis::BandLimited);
+  loop.set_audio_thread(true);
+  load(loop, without_worker);
+  passed &= check_silent("None state, worker attached", loop, counter);
+  if (audio_snapshot(loop) != expected) {
+    std::cout << "  The APU registers differ from the run before the state was loaded" << std::endl;
+    passed = false;
+  }
+  save(loop, with_worker);
+  loop.set_audio_thread(false);
+  if (loop.apu().synthesis() != AudioSynthesis::None) {
+    std::cout << "The worker didn't hand the loaded AudioSynthesis::None back to the APU" << std::endl;
+    passed = false;
+  }
+
+  loop.apu().set_synthesis(AudioSynthesis::BandLimited);
+  load(loop, with_worker);
+  if (loop.apu().synthesis() != AudioSynthesis::None) {
+    std::cout << "A state saved with the worker on AudioSynthesis::None loaded with synthesis on"
+              << std::endl;
+    passed = false;
+  }
+  passed &= check_silent("None worker state, worker detached", loop, counter);
+
+  loop.apu().set_synthesis(AudioSynthesis::BandLimited);
+  std::filesystem::remove(without_worker);
+  std::filesystem::remove(with_worker);
+  return passed;
+}
+
+bool check_save_states(const std::string& rom) {
+  ROMLoader loader(rom, "");
+  if (!loader.load()) {
+    return false;
+  }
+
+  SampleCounter counter;
+  OSBridge bridge;
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState& joypad_state) { return false; };
+  bridge.on_audio_generated = [&counter](const int16_t* samples, int num_samples) {
+    if (std::this_thread::get_id() == counter.emulation_thread) {
+      counter.emulation_samples += num_samples;
+    } else {
+      counter.worker_samples += num_samples;
+    }
+  };
+  MainLoop loop(loader, bridge);
+  loop.ppu().set_pixel_format(PixelFormat::Indexed);
+
+  const std::filesystem::path directory = std::filesystem::temp_directory_path();
+  const std::string without_worker = (directory / "test_audio_worker_inline.state").string();
+  const std::string with_worker = (directory / "test_audio_worker_worker.state").string();
+
+  bool passed = true;
+  run_for(loop, SAVE_STATE_M_CYCLES);
+  save(loop, without_worker);
+
+  // A state saved without the worker, loaded with it attached
+  loop.set_audio_thread(true);
+  run_for(loop, SAVE_STATE_M_CYCLES);
+  save(loop, with_worker);
+  load(loop, without_worker);
+  if (loop.apu().synthesis() != AudioSynthesis::None) {
+    std::cout << "Loading a state turned synthesis back on under the worker" << std::endl;
+    passed = false;
+  }
+  passed &= check_stretch("Inline state, worker attached", loop, counter, true);
+
+  // A state saved with the worker attached, loaded with it attached and then without
+  load(loop, with_worker);
+  passed &= check_stretch("Worker state, worker attached", loop, counter, true);
+  loop.set_audio_thread(false);
+  load(loop, with_worker);
+  if (loop.apu().synthesis() != AudioSynthesis::BandLimited) {
+    std::cout << "Synthesis wasn't handed back to the APU" << std::endl;
+    passed = false;
+  }
+  passed &= check_stretch("Worker state, worker detached", loop, counter, false);
+  passed &= check_null_audio_round_trip(loop, counter, directory);
+
+  std::filesystem::remove(without_worker);
+  std::filesystem::remove(with_worker);
+  return passed;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_audio_worker <rom> [--save-state]" << std::endl;
+    return -1;
+  }
+  if (argc > 2 && std::strcmp(argv[2], "--save-state") == 0) {
+    const bool passed = check_save_states(argv[1]);
+    std::cout << (passed ? "Save states passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+  }
+
+  const AudioRun inline_run = run(argv[1], false, MAX_M_CYCLES);
+  const AudioRun worker_run = run(argv[1], true, inline_run.m_cycles);
+
+  print_run("Inline", inline_run);
+  print_run("Worker", worker_run);
+  if (inline_run.samples != worker_run.samples || inline_run.hash != worker_run.hash ||
+      inline_run.result != worker_run.result) {
+    std::cout << "FAILED: the audio worker differs" << std::endl;
+    return 1;
+  }
+  std::cout << "Identical" << std::endl;
+  return 0;
+}
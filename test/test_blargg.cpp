@@ -1,9 +1,14 @@
 #include <inttypes.h>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
 #include "main_loop.h"
 #include "rom_header.h"
 #include "rom_loader.h"
 
+constexpr const char* USAGE = "Usage: Rom [BootRom] [--null-audio] [--backend scanline|fifo]";
+
 std::string previous_test_output;
 
 void check_test(std::string& test_output) {
@@ -39,16 +44,34 @@ void write_callback(MainLoop& loop, uint16_t address, uint8_t value, std::string
 }
 
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cerr << "Usage: Rom" << std::endl;
+  // --null-audio runs the APU with AudioSynthesis::None, --backend fifo the PPU with PPUBackend::PixelFIFO
+  bool null_audio = false;
+  PPUBackend backend = PPUBackend::Scanline;
+  std::vector<std::string> arguments;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--null-audio") {
+      null_audio = true;
+    } else if (std::string(argv[i]) == "--backend") {
+      const std::optional<PPUBackend> named = i + 1 < argc ? ppu_backend_from_name(argv[++i]) : std::nullopt;
+      if (!named) {
+        std::cerr << USAGE << std::endl;
+        return -1;
+      }
+      backend = *named;
+    } else {
+      arguments.emplace_back(argv[i]);
+    }
+  }
+  if (arguments.empty()) {
+    std::cerr << USAGE << std::endl;
     return -1;
   }
   std::string boot_rom_filename;
-  if (argc > 2) {
-    boot_rom_filename = std::string(argv[2]);
+  if (arguments.size() > 1) {
+    boot_rom_filename = arguments[1];
   }
 
-  std::string filename(argv[1]);
+  std::string filename(arguments[0]);
   ROMLoader loader(filename, boot_rom_filename);
 
   if (!loader.load()) {
@@ -58,7 +81,7 @@ int main(int argc, char** argv) {
   loader.header()->pretty_print();
 
   OSBridge bridge;
-  bridge.blit_screen = [](const uint32_t* pixels, size_t pitch) {
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {
   };
   bridge.present_frame = [](void) {
   };
@@ -68,6 +91,11 @@ int main(int argc, char** argv) {
   bridge.on_audio_generated = [](const int16_t* samples, int num_samples) {
   };
   MainLoop loop(loader, bridge);
+  if (null_audio) {
+    loop.apu().set_synthesis(AudioSynthesis::None);
+  }
+  loop.ppu().set_backend(backend);
+  loop.ppu().set_pixel_format(PixelFormat::Indexed);  // Nothing looks at the screen, so skip the colour pass
   std::string test_output;
   loop.cpu().mc().set_write_callback(std::bind(write_callback, std::ref(loop), std::placeholders::_1,
                                                std::placeholders::_2, std::ref(test_output)));
@@ -0,0 +1,419 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "capture_sink.h"
+#include "main_loop.h"
+#include "rom_loader.h"
+
+// Checks CaptureSink, VideoWriter and WAVWriter without a window:
+//  - A scripted run of frames lands on the video timeline by emulated m-cycle. A frame with the previous
+//    frame's hash, push_repeat() and a gap are all written as repeats of the frame before, and finish() pads
+//    the video out to the end. Checked frame by frame for Y4M and raw RGB, along with the Y4M header.
+//  - The WAV header describes the samples pushed, they come out unchanged, and the audio is as long as the
+//    video.
+//  - A writer that falls behind fails the capture, and everything queued before that is still written.
+// Given a ROM, also captures a few seconds of it through MainLoop and checks the number of frames and the
+// length of the audio against the emulated m-cycles.
+//
+// Usage: test_capture_sink [rom]
+
+namespace {
+constexpr uint32_t SAMPLE_RATE = 48000;
+constexpr uint64_t M_CYCLES_PER_FRAME = CAPTURE_M_CYCLES_PER_FRAME;
+constexpr uint64_t SLOT_OFFSET = 1000;  // How far into its slot each frame finishes
+
+// Every colour is a grey, which BT.601 turns into Y = the channel value and U = V = 128
+constexpr uint32_t WHITE = 0xFFFFFFFF;
+constexpr uint32_t BLACK = 0xFF000000;
+constexpr uint32_t GREY = 0xFF808080;
+constexpr uint8_t NEUTRAL_CHROMA = 128;
+constexpr uint32_t PADDING = 0xFF123456;  // Past the end of each row, where the capture mustn't read
+constexpr size_t PITCH_PIXELS = CAPTURE_WIDTH + 16;
+
+constexpr size_t Y4M_FRAME_HEADER_BYTES = 6;  // "FRAME\n"
+constexpr size_t FRAME_BYTES = CAPTURE_PIXELS * 3;
+constexpr size_t WAV_HEADER_BYTES = 44;
+
+constexpr uint64_t OVERFLOW_FRAMES = 100000;                 // Far more than the writer can keep up with
+constexpr size_t OVERFLOW_AUDIO_SAMPLES = 16 * 1024 * 1024;  // Likewise, pushed in one go
+constexpr uint32_t ROM_SECONDS = 3;
+constexpr int64_t ROM_SAMPLE_TOLERANCE = 4;
+constexpr auto WRITER_TIMEOUT = std::chrono::seconds(10);
+
+struct ScriptedFrame {
+  uint64_t slot;
+  uint32_t colour;
+  uint64_t hash;
+  bool repeat;  // push_repeat(), as MainLoop does for a duplicate the PPU didn't blit
+};
+
+constexpr ScriptedFrame SCRIPT[] = {
+    {0, WHITE, 1, false},
+    {1, BLACK, 2, false},
+    {2, BLACK, 2, false},  // The same hash, so recorded as a repeat
+    {3, 0, 0, true},
+    // Nothing in slots 4 and 5, e.g. the LCD was off
+    {6, GREY, 3, false},
+    {7, GREY, 0, false},  // The hash isn't known, so it's written out in full
+};
+constexpr uint64_t FINISH_SLOT = 9;
+constexpr uint32_t EXPECTED_FRAMES[] = {WHITE, BLACK, BLACK, BLACK, BLACK, BLACK, GREY, GREY, GREY, GREY};
+constexpr uint64_t EXPECTED_REPEATS = 6;  // Slots 2, 3, 4, 5, 8 and 9
+
+struct Paths {
+  std::filesystem::path video = std::filesystem::temp_directory_path() / "gbemu_capture_test.video";
+  std::filesystem::path audio = std::filesystem::temp_directory_path() / "gbemu_capture_test.wav";
+
+  ~Paths() {
+    std::filesystem::remove(video);
+    std::filesystem::remove(audio);
+  }
+};
+
+std::vector<uint8_t> read_file(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+}
+
+uint32_t read_u32(const std::vector<uint8_t>& bytes, size_t offset) {
+  return bytes[offset] | (bytes[offset + 1] << 8) | (bytes[offset + 2] << 16) |
+         (static_cast<uint32_t>(bytes[offset + 3]) << 24);
+}
+
+uint16_t read_u16(const std::vector<uint8_t>& bytes, size_t offset) {
+  return static_cast<uint16_t>(bytes[offset] | (bytes[offset + 1] << 8));
+}
+
+// A frame with padding at the end of every row
+std::vector<uint32_t> make_frame(uint32_t colour) {
+  std::vector<uint32_t> pixels(PITCH_PIXELS * CAPTURE_HEIGHT, PADDING);
+  for (uint32_t y = 0; y < CAPTURE_HEIGHT; y++) {
+    std::fill_n(pixels.begin() + (y * PITCH_PIXELS), CAPTURE_WIDTH, colour);
+  }
+  return pixels;
+}
+
+uint64_t samples_until(uint64_t m_cycle) {
+  return m_cycle * SAMPLE_RATE / CAPTURE_M_CYCLES_PER_SECOND * CAPTURE_AUDIO_CHANNELS;
+}
+
+// Pushes a known pattern in blocks of varying size, some bigger than CAPTURE_AUDIO_BLOCK_SAMPLES
+struct AudioPusher {
+  CaptureSink& sink;
+  std::vector<int16_t> pushed;
+  size_t block = 1;
+
+  void push_until(uint64_t m_cycle) {
+    const uint64_t target = samples_until(m_cycle);
+    while (pushed.size() < target) {
+      const size_t first = pushed.size();
+      const size_t count = std::min<size_t>(block, target - first);
+      for (size_t i = 0; i < count; i++) {
+        pushed.push_back(static_cast<int16_t>((first + i) * 7919));
+      }
+      sink.push_audio(pushed.data() + first, count);
+      block = (block % 300) + 37;
+    }
+  }
+};
+
+// Frames are left as written, planes or RGB after the Y4M frame header
+std::optional<std::vector<std::vector<uint8_t>>> read_video(const std::filesystem::path& path,
+                                                            CaptureVideoFormat format) {
+  const std::vector<uint8_t> bytes = read_file(path);
+  size_t offset = 0;
+  if (format == CaptureVideoFormat::Y4M) {
+    const uint64_t gcd = std::gcd(CAPTURE_M_CYCLES_PER_SECOND, M_CYCLES_PER_FRAME);
+    const std::string expected =
+        "YUV4MPEG2 W" + std::to_string(CAPTURE_WIDTH) + " H" + std::to_string(CAPTURE_HEIGHT) + " F" +
+        std::to_string(CAPTURE_M_CYCLES_PER_SECOND / gcd) + ":" + std::to_string(M_CYCLES_PER_FRAME / gcd) +
+        " Ip A1:1 C444 XCOLORRANGE=FULL\n";
+    if (bytes.size() < expected.size() ||
+        std::string(bytes.begin(), bytes.begin() + expected.size()) != expected) {
+      std::cout << "  Bad Y4M header, expected " << expected;
+      return std::nullopt;
+    }
+    offset = expected.size();
+  }
+
+  std::vector<std::vector<uint8_t>> frames;
+  while (offset < bytes.size()) {
+    if (format == CaptureVideoFormat::Y4M) {
+      if (bytes.size() - offset < Y4M_FRAME_HEADER_BYTES ||
+          std::memcmp(bytes.data() + offset, "FRAME\n", Y4M_FRAME_HEADER_BYTES) != 0) {
+        std::cout << "  No Y4M frame header at " << offset << std::endl;
+        return std::nullopt;
+      }
+      offset += Y4M_FRAME_HEADER_BYTES;
+    }
+    if (bytes.size() - offset < FRAME_BYTES) {
+      std::cout << "  The last frame is cut short" << std::endl;
+      return std::nullopt;
+    }
+    frames.emplace_back(bytes.begin() + offset, bytes.begin() + offset + FRAME_BYTES);
+    offset += FRAME_BYTES;
+  }
+  return frames;
+}
+
+bool frame_is(const std::vector<uint8_t>& frame, CaptureVideoFormat format, uint32_t colour) {
+  const uint8_t value = static_cast<uint8_t>(colour);
+  if (format == CaptureVideoFormat::RawRGB) {
+    return std::all_of(frame.begin(), frame.end(), [value](uint8_t byte) { return byte == value; });
+  }
+  return std::all_of(frame.begin(), frame.begin() + CAPTURE_PIXELS,
+                     [value](uint8_t y) { return y == value; }) &&
+         std::all_of(frame.begin() + CAPTURE_PIXELS, frame.end(),
+                     [](uint8_t chroma) { return chroma == NEUTRAL_CHROMA; });
+}
+
+// Checks the header against the file and returns the samples
+std::optional<std::vector<int16_t>> read_wav(const std::filesystem::path& path, uint32_t sample_rate) {
+  const std::vector<uint8_t> bytes = read_file(path);
+  const uint32_t block_align = CAPTURE_AUDIO_CHANNELS * (CAPTURE_AUDIO_BITS_PER_SAMPLE / 8);
+  if (bytes.size() < WAV_HEADER_BYTES || std::memcmp(bytes.data(), "RIFF", 4) != 0 ||
+      read_u32(bytes, 4) != bytes.size() - 8 || std::memcmp(bytes.data() + 8, "WAVEfmt ", 8) != 0 ||
+      read_u32(bytes, 16) != 16 || read_u16(bytes, 20) != 1 ||
+      read_u16(bytes, 22) != CAPTURE_AUDIO_CHANNELS || read_u32(bytes, 24) != sample_rate ||
+      read_u32(bytes, 28) != sample_rate * block_align || read_u16(bytes, 32) != block_align ||
+      read_u16(bytes, 34) != CAPTURE_AUDIO_BITS_PER_SAMPLE ||
+      std::memcmp(bytes.data() + 36, "data", 4) != 0 ||
+      read_u32(bytes, 40) != bytes.size() - WAV_HEADER_BYTES) {
+    std::cout << "  Bad WAV header" << std::endl;
+    return std::nullopt;
+  }
+  std::vector<int16_t> samples((bytes.size() - WAV_HEADER_BYTES) / sizeof(int16_t));
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = static_cast<int16_t>(read_u16(bytes, WAV_HEADER_BYTES + (i * sizeof(int16_t))));
+  }
+  return samples;
+}
+
+// The writer's counters are only exact once it has caught up
+bool wait_for_writer(const CaptureSink& sink, uint64_t frames) {
+  const auto deadline = std::chrono::steady_clock::now() + WRITER_TIMEOUT;
+  while (sink.frames_written() < frames) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+bool check_capture(CaptureVideoFormat format) {
+  const char* name = format == CaptureVideoFormat::Y4M ? "Y4M" : "Raw RGB";
+  const Paths paths;
+  const uint64_t end = (FINISH_SLOT * M_CYCLES_PER_FRAME) + SLOT_OFFSET;
+  const size_t expected_frames = std::size(EXPECTED_FRAMES);
+  bool passed = true;
+
+  std::vector<int16_t> pushed;
+  {
+    CaptureSink sink({paths.video.string(), paths.audio.string(), format, SAMPLE_RATE});
+    AudioPusher audio{sink};
+    for (const ScriptedFrame& frame : SCRIPT) {
+      const uint64_t m_cycle = (frame.slot * M_CYCLES_PER_FRAME) + SLOT_OFFSET;
+      audio.push_until(m_cycle);
+      if (frame.repeat) {
+        sink.push_repeat(m_cycle);
+      } else {
+        const std::vector<uint32_t> pixels = make_frame(frame.colour);
+        sink.push_frame(pixels.data(), PITCH_PIXELS * sizeof(uint32_t), m_cycle, frame.hash);
+      }
+    }
+    audio.push_until(end);
+    sink.finish(end);
+    pushed = std::move(audio.pushed);
+
+    if (sink.failed()) {
+      std::cout << name << ": " << sink.error() << std::endl;
+      return false;
+    }
+    if (!wait_for_writer(sink, expected_frames)) {
+      std::cout << name << ": the writer stopped at " << sink.frames_written() << " frames" << std::endl;
+      return false;
+    }
+    std::printf("%s: %" PRIu64 " frames written, %" PRIu64 " of them repeats, %zu samples\n", name,
+                sink.frames_written(), sink.frames_repeated(), pushed.size());
+    if (sink.frames_written() != expected_frames || sink.frames_repeated() != EXPECTED_REPEATS) {
+      std::printf("  Expected %zu frames, %" PRIu64 " repeats\n", expected_frames, EXPECTED_REPEATS);
+      passed = false;
+    }
+  }
+
+  const auto frames = read_video(paths.video, format);
+  if (!frames) {
+    return false;
+  }
+  if (frames->size() != expected_frames) {
+    std::printf("  The file holds %zu frames, expected %zu\n", frames->size(), expected_frames);
+    return false;
+  }
+  for (size_t i = 0; i < expected_frames; i++) {
+    if (!frame_is((*frames)[i], format, EXPECTED_FRAMES[i])) {
+      std::printf("  Frame %zu isn't %08X\n", i, EXPECTED_FRAMES[i]);
+      passed = false;
+    }
+  }
+
+  const auto samples = read_wav(paths.audio, SAMPLE_RATE);
+  if (!samples) {
+    return false;
+  }
+  if (*samples != pushed) {
+    std::printf("  The WAV holds %zu samples, not the %zu pushed\n", samples->size(), pushed.size());
+    passed = false;
+  }
+
+  // The video runs to the end of the frame the capture finished in
+  const double video_seconds =
+      static_cast<double>(expected_frames * M_CYCLES_PER_FRAME) / CAPTURE_M_CYCLES_PER_SECOND;
+  const double audio_seconds = static_cast<double>(samples->size()) / CAPTURE_AUDIO_CHANNELS / SAMPLE_RATE;
+  const double frame_seconds = static_cast<double>(M_CYCLES_PER_FRAME) / CAPTURE_M_CYCLES_PER_SECOND;
+  if (std::abs(video_seconds - audio_seconds) > frame_seconds) {
+    std::printf("  %.4f s of video but %.4f s of audio\n", video_seconds, audio_seconds);
+    passed = false;
+  }
+  return passed;
+}
+
+bool check_frame_overflow() {
+  const Paths paths;
+  const std::vector<uint32_t> pixels = make_frame(WHITE);
+  const size_t pitch = PITCH_PIXELS * sizeof(uint32_t);
+  uint64_t accepted = 0;
+  bool passed = true;
+  {
+    CaptureSink sink({paths.video.string(), "", CaptureVideoFormat::Y4M, 0});
+    for (uint64_t i = 0; i < OVERFLOW_FRAMES && !sink.failed(); i++) {
+      sink.push_frame(pixels.data(), pitch, i * M_CYCLES_PER_FRAME, i + 1);
+      accepted += sink.failed() ? 0 : 1;
+    }
+    std::cout << "Frame overflow: " << accepted << " frames queued before: " << sink.error() << std::endl;
+    if (!sink.failed() || sink.error().empty()) {
+      std::cout << "  The capture didn't fail" << std::endl;
+      return false;
+    }
+    // Nothing more is taken
+    sink.push_frame(pixels.data(), pitch, accepted * M_CYCLES_PER_FRAME, accepted + 1);
+    sink.push_repeat((accepted + 1) * M_CYCLES_PER_FRAME);
+  }
+
+  const auto frames = read_video(paths.video, CaptureVideoFormat::Y4M);
+  if (!frames) {
+    return false;
+  }
+  if (frames->size() != accepted) {
+    std::printf("  The file holds %zu frames, expected the %" PRIu64 " queued\n", frames->size(), accepted);
+    passed = false;
+  }
+  return passed;
+}
+
+bool check_audio_overflow() {
+  const Paths paths;
+  std::vector<int16_t> pushed(OVERFLOW_AUDIO_SAMPLES);
+  for (size_t i = 0; i < pushed.size(); i++) {
+    pushed[i] = static_cast<int16_t>(i * 7919);
+  }
+  {
+    CaptureSink sink({paths.video.string(), paths.audio.string(), CaptureVideoFormat::Y4M, SAMPLE_RATE});
+    sink.push_audio(pushed.data(), pushed.size());
+    std::cout << "Audio overflow: " << sink.error() << std::endl;
+    if (!sink.failed()) {
+      std::cout << "  The capture didn't fail" << std::endl;
+      return false;
+    }
+  }
+
+  const auto samples = read_wav(paths.audio, SAMPLE_RATE);
+  if (!samples) {
+    return false;
+  }
+  // Whole blocks, the ones queued before the failure
+  std::printf("  %zu of %zu samples written\n", samples->size(), pushed.size());
+  if (samples->empty() || samples->size() >= pushed.size() ||
+      samples->size() % CAPTURE_AUDIO_BLOCK_SAMPLES != 0 ||
+      !std::equal(samples->begin(), samples->end(), pushed.begin())) {
+    std::cout << "  Expected the queued blocks of what was pushed" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool check_main_loop(const std::string& rom) {
+  ROMLoader loader(rom, "");
+  if (!loader.load()) {
+    return false;
+  }
+  OSBridge bridge;
+  bridge.blit_screen = [](const void*, size_t) {};
+  bridge.present_frame = []() {};
+  bridge.handle_events = [](JoypadState&) { return false; };
+  bridge.on_audio_generated = [](const int16_t*, int) {};
+
+  const Paths paths;
+  MainLoop loop(loader, bridge);
+  const uint32_t sample_rate = static_cast<uint32_t>(std::lround(loop.apu().sample_rate()));
+  loop.start_capture({paths.video.string(), paths.audio.string(), CaptureVideoFormat::Y4M, 0});
+  const uint64_t start = loop.cpu().m_cycles();
+  while (loop.cpu().m_cycles() - start < ROM_SECONDS * CAPTURE_M_CYCLES_PER_SECOND) {
+    loop.run_once();
+  }
+  loop.apu().generate_samples();
+  const uint64_t m_cycles = loop.cpu().m_cycles() - start;
+  loop.stop_capture();
+  if (!loop.capture_error().empty()) {
+    std::cout << loop.capture_error() << std::endl;
+    return false;
+  }
+
+  const auto frames = read_video(paths.video, CaptureVideoFormat::Y4M);
+  const auto samples = read_wav(paths.audio, sample_rate);
+  if (!frames || !samples) {
+    return false;
+  }
+  const uint64_t expected_frames = (m_cycles / M_CYCLES_PER_FRAME) + 1;
+  const int64_t expected_samples = static_cast<int64_t>(m_cycles * sample_rate / CAPTURE_M_CYCLES_PER_SECOND *
+                                                        CAPTURE_AUDIO_CHANNELS);
+  std::printf("%s: %" PRIu64 " m-cycles, %zu frames (expected %" PRIu64 "), %zu samples (expected %" PRId64
+              ")\n",
+              rom.c_str(), m_cycles, frames->size(), expected_frames, samples->size(), expected_samples);
+  bool passed = true;
+  if (frames->size() != expected_frames) {
+    std::cout << "  Wrong number of frames" << std::endl;
+    passed = false;
+  }
+  if (std::abs(static_cast<int64_t>(samples->size()) - expected_samples) > ROM_SAMPLE_TOLERANCE) {
+    std::cout << "  The audio isn't as long as the emulated time" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  bool passed = check_capture(CaptureVideoFormat::Y4M);
+  passed &= check_capture(CaptureVideoFormat::RawRGB);
+  passed &= check_frame_overflow();
+  passed &= check_audio_overflow();
+  if (argc > 1) {
+    passed &= check_main_loop(argv[1]);
+  }
+
+  std::cout << (passed ? "Capture passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
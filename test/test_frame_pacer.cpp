@@ -0,0 +1,75 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include "frame_pacer.h"
+
+// Paces FRAMES idle frames by spinning the whole frame (what the main loop used to do) and by sleeping with
+// the default spin margin, and compares the CPU time each uses. The sleeping pacer has to use at most a
+// quarter of the CPU while taking within 5% of the right total time, and prints how precisely it released
+// each frame. It typically uses 1-3% and is off by well under 0.1%, but the bounds leave room for a loaded
+// machine, where spinning gets less than a whole core and sleeps wake late.
+
+namespace {
+constexpr std::chrono::microseconds FRAME_DURATION(16740);
+constexpr uint32_t FRAMES = 120;
+constexpr double MAX_CPU_RATIO = 0.25;
+constexpr double MAX_DURATION_ERROR = 0.05;
+
+struct PacingResult {
+  PacingStats stats;
+  double seconds;
+  double cpu_seconds;
+};
+
+PacingResult pace(std::chrono::nanoseconds spin_margin) {
+  FramePacer pacer(FRAME_DURATION, spin_margin);
+  pacer.wait();  // Lines the deadlines up with now
+  pacer.take_stats();
+
+  const auto start = std::chrono::steady_clock::now();
+  const std::clock_t cpu_start = std::clock();
+  for (uint32_t frame = 0; frame < FRAMES; frame++) {
+    pacer.wait();
+  }
+  const double cpu_seconds = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return {pacer.take_stats(), seconds, cpu_seconds};
+}
+
+void print(const char* name, const PacingResult& result) {
+  const auto microseconds = [](std::chrono::nanoseconds time) {
+    return std::chrono::duration<double, std::micro>(time).count();
+  };
+  std::printf("%-6s %5.1f%% CPU, %.3f s, jitter %6.1f us, latest %6.1f us, spun %7.1f us/frame, "
+              "%u late, %u overslept\n",
+              name, result.cpu_seconds / result.seconds * 100, result.seconds,
+              microseconds(result.stats.jitter), microseconds(result.stats.max_lateness),
+              microseconds(result.stats.spun) / FRAMES,
+              result.stats.late_frames, result.stats.overslept_frames);
+}
+}  // namespace
+
+int main() {
+  const PacingResult spin = pace(FRAME_DURATION);
+  const PacingResult hybrid = pace(FramePacer::DEFAULT_SPIN_MARGIN);
+  print("Spin", spin);
+  print("Hybrid", hybrid);
+
+  bool passed = true;
+  const double expected_seconds = std::chrono::duration<double>(FRAME_DURATION).count() * FRAMES;
+  if (std::abs(hybrid.seconds / expected_seconds - 1.0) > MAX_DURATION_ERROR) {
+    std::cout << "Hybrid pacing took " << hybrid.seconds << " s, expected " << expected_seconds << " s"
+              << std::endl;
+    passed = false;
+  }
+  if (hybrid.cpu_seconds > spin.cpu_seconds * MAX_CPU_RATIO) {
+    std::cout << "Hybrid pacing used more than " << MAX_CPU_RATIO * 100 << "% of the CPU spinning does"
+              << std::endl;
+    passed = false;
+  }
+
+  std::cout << (passed ? "Frame pacing passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <initializer_list>
+#include <iostream>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+#include "gbs_player.h"
+
+// Plays a small hand-assembled GBS rip through GBSPlayer and checks:
+//  - INIT gets the song number in A, RST 08 reaches the rip's own handler at load_address + 8, and a bank
+//    number written to 0x2000 maps that bank of the rip at 0x4000.
+//  - PLAY is called once per VBlank when the rip doesn't use the timer, and at the rate set by TMA/TAC when
+//    it does, and the tone INIT starts is heard.
+//  - A rip without a song, or that isn't a GBS at all, is refused.
+// Then prints how much faster than real time a rip renders.
+
+namespace {
+constexpr uint16_t LOAD_ADDRESS = 0x0400;
+constexpr uint16_t INIT_ADDRESS = 0x0420;
+constexpr uint16_t PLAY_ADDRESS = 0x0460;
+constexpr uint16_t STACK_POINTER = 0xFFFE;
+constexpr size_t GBS_HEADER_SIZE = 0x70;
+
+// Where the rip leaves what it saw, in WRAM
+constexpr uint16_t PLAY_COUNT = 0xC000;
+constexpr uint16_t BANK_MARKER = 0xC001;
+constexpr uint16_t RST_MARKER = 0xC002;
+constexpr uint16_t SONG = 0xC003;
+
+constexpr uint8_t BANK1_VALUE = 0xB1;
+constexpr uint8_t BANK2_VALUE = 0xB2;
+constexpr uint8_t RST_VALUE = 0x5A;
+constexpr uint32_t BENCHMARK_SECONDS = 120;
+constexpr uint64_t M_CYCLES_PER_FRAME = 17556;
+
+void put(std::vector<uint8_t>& rip, uint16_t address, std::initializer_list<uint8_t> code) {
+  std::copy(code.begin(), code.end(), rip.begin() + GBS_HEADER_SIZE + (address - LOAD_ADDRESS));
+}
+
+// Two songs, with the driver:
+//   load + 08: ld a,$5A / ld ($C002),a / ret
+//   INIT:      ld ($C003),a / xor a / ld ($C000),a / rst $08 / ld a,2 / ld ($2000),a / ld a,($4000)
+//              ld ($C001),a, then a square wave on channel 2 / ret
+//   PLAY:      ld hl,$C000 / inc (hl) / ld a,(hl) / ldh ($18),a / ret, so the pitch changes on every call
+std::vector<uint8_t> make_rip(uint8_t timer_modulo, uint8_t timer_control) {
+  std::vector<uint8_t> rip(GBS_HEADER_SIZE + 0x8001 - LOAD_ADDRESS, 0);
+  std::memcpy(rip.data(), "GBS", 3);
+  rip[0x03] = 1;
+  rip[0x04] = 2;
+  rip[0x05] = 1;
+  rip[0x06] = LOAD_ADDRESS & 0xFF;
+  rip[0x07] = LOAD_ADDRESS >> 8;
+  rip[0x08] = INIT_ADDRESS & 0xFF;
+  rip[0x09] = INIT_ADDRESS >> 8;
+  rip[0x0A] = PLAY_ADDRESS & 0xFF;
+  rip[0x0B] = PLAY_ADDRESS >> 8;
+  rip[0x0C] = STACK_POINTER & 0xFF;
+  rip[0x0D] = STACK_POINTER >> 8;
+  rip[0x0E] = timer_modulo;
+  rip[0x0F] = timer_control;
+  std::memcpy(rip.data() + 0x10, "GBSPlayer test", 14);
+
+  put(rip, LOAD_ADDRESS + 0x08, {0x3E, RST_VALUE, 0xEA, 0x02, 0xC0, 0xC9});
+  put(rip, INIT_ADDRESS, {0xEA, 0x03, 0xC0,                                   // ld ($C003),a
+                          0xAF, 0xEA, 0x00, 0xC0,                             // xor a / ld ($C000),a
+                          0xCF,                                               // rst $08
+                          0x3E, 0x02, 0xEA, 0x00, 0x20,                       // Bank 2
+                          0xFA, 0x00, 0x40, 0xEA, 0x01, 0xC0,                 // ld a,($4000) / ld ($C001),a
+                          0x3E, 0x80, 0xE0, 0x26, 0x3E, 0x77, 0xE0, 0x24,     // NR52, NR50
+                          0x3E, 0xFF, 0xE0, 0x25, 0x3E, 0x80, 0xE0, 0x16,     // NR51, NR21
+                          0x3E, 0xF0, 0xE0, 0x17, 0x3E, 0x00, 0xE0, 0x18,     // NR22, NR23
+                          0x3E, 0x87, 0xE0, 0x19,                             // NR24, trigger
+                          0xC9});
+  put(rip, PLAY_ADDRESS, {0x21, 0x00, 0xC0, 0x34, 0x7E, 0xE0, 0x18, 0xC9});
+  put(rip, 0x4000, {BANK1_VALUE});
+  put(rip, 0x8000, {BANK2_VALUE});
+  return rip;
+}
+
+uint8_t read(GBSPlayer& player, uint16_t address) {
+  return *player.cpu().memory_bridge().read(address);
+}
+
+// Plays song 2 for m_cycles and checks the driver ran and PLAY was called about expected_plays times
+bool check_rip(const char* name, uint8_t timer_modulo, uint8_t timer_control, uint64_t m_cycles,
+               uint32_t expected_plays) {
+  bool heard = false;
+  GBSPlayer player(GBSFile(make_rip(timer_modulo, timer_control)), 1,
+                   [&heard](const int16_t* samples, int num_samples) {
+                     for (int i = 0; i < num_samples; i++) {
+                       heard |= samples[i] != 0;
+                     }
+                   });
+  player.run(m_cycles);
+
+  const uint32_t plays = read(player, PLAY_COUNT);
+  std::printf("%s: %u PLAY calls in %" PRIu64 " m-cycles, expected %u\n", name, plays, m_cycles,
+              expected_plays);
+  bool passed = true;
+  if (plays + 1 < expected_plays || plays > expected_plays + 1) {
+    std::cout << "  PLAY was called at the wrong rate" << std::endl;
+    passed = false;
+  }
+  if (read(player, SONG) != 1) {
+    std::printf("  INIT got song %u, expected 1\n", read(player, SONG));
+    passed = false;
+  }
+  if (read(player, RST_MARKER) != RST_VALUE) {
+    std::cout << "  RST 08 didn't reach the rip's handler" << std::endl;
+    passed = false;
+  }
+  if (read(player, BANK_MARKER) != BANK2_VALUE) {
+    std::printf("  Read %02X from bank 2, expected %02X\n", read(player, BANK_MARKER), BANK2_VALUE);
+    passed = false;
+  }
+  if (!heard) {
+    std::cout << "  Nothing was heard" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+bool check_refused() {
+  try {
+    GBSPlayer player(GBSFile(make_rip(0, 0)), 2, [](const int16_t*, int) {});
+    std::cout << "Song 3 of 2 wasn't refused" << std::endl;
+    return false;
+  } catch (const std::invalid_argument&) {
+  }
+  try {
+    std::vector<uint8_t> not_a_rip = make_rip(0, 0);
+    not_a_rip[0] = 'X';
+    GBSFile file(not_a_rip);
+    std::cout << "A file without the GBS magic wasn't refused" << std::endl;
+    return false;
+  } catch (const std::runtime_error&) {
+  }
+  return true;
+}
+
+void benchmark() {
+  GBSPlayer player(GBSFile(make_rip(0, 0)), 0, [](const int16_t*, int) {});
+  const uint64_t m_cycles = static_cast<uint64_t>(BENCHMARK_SECONDS) * M_CYCLES_PER_SECOND;
+  const auto start = std::chrono::steady_clock::now();
+  player.run(m_cycles);
+  const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("Rendered %u s in %.3f s: %.1f M m-cycles/s, %.0fx real time\n", BENCHMARK_SECONDS, elapsed,
+              m_cycles / elapsed / 1e6, BENCHMARK_SECONDS / elapsed);
+}
+}  // namespace
+
+int main() {
+  static_assert(!GBSBus::HAS_PPU && std::is_empty_v<GBSBus::PPUType>, "GBSPlayer has no PPU");
+
+  bool passed = true;
+  // 1 s at 59.7 VBlanks a second
+  passed &= check_rip("VBlank rate", 0, 0, M_CYCLES_PER_SECOND, M_CYCLES_PER_SECOND / M_CYCLES_PER_FRAME);
+  // 4096 Hz / (256 - 0xC0) = 64 Hz
+  passed &= check_rip("Timer at 64 Hz", 0xC0, 0x04, M_CYCLES_PER_SECOND, 64);
+  // 65536 Hz / 256 = 256 Hz, for half a second so the count fits in a byte
+  passed &= check_rip("Timer at 256 Hz", 0x00, 0x06, M_CYCLES_PER_SECOND / 2, 128);
+  passed &= check_refused();
+  benchmark();
+
+  std::cout << (passed ? "GBS player passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
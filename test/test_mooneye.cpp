@@ -1,9 +1,15 @@
 #include <inttypes.h>
+#include <cstdlib>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
 #include "main_loop.h"
 #include "rom_header.h"
 #include "rom_loader.h"
 
+constexpr const char* USAGE = "Usage: Rom [BootRom] [--backend scanline|fifo] [--frame-skip N]";
+
 void check_test(CPURegisters& registers) {
   if (registers.B().get() == 3 && registers.C().get() == 5 && registers.D().get() == 8 &&
       registers.E().get() == 13 && registers.H().get() == 21 && registers.L().get() == 34) {
@@ -15,16 +21,40 @@ void check_test(CPURegisters& registers) {
 }
 
 int main(int argc, char** argv) {
-  if (argc < 2) {
-    std::cerr << "Usage: Rom" << std::endl;
+  // --backend fifo runs the PPU with PPUBackend::PixelFIFO, --frame-skip N renders one frame in N + 1
+  PPUBackend backend = PPUBackend::Scanline;
+  uint8_t frame_skip = 0;
+  std::vector<std::string> arguments;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "--backend") {
+      const std::optional<PPUBackend> named = i + 1 < argc ? ppu_backend_from_name(argv[++i]) : std::nullopt;
+      if (!named) {
+        std::cerr << USAGE << std::endl;
+        return -1;
+      }
+      backend = *named;
+    } else if (std::string(argv[i]) == "--frame-skip") {
+      char* end = nullptr;
+      const long frames = i + 1 < argc ? std::strtol(argv[++i], &end, 10) : -1;
+      if (end == argv[i] || *end != '\0' || frames < 0 || frames > UINT8_MAX) {
+        std::cerr << USAGE << std::endl;
+        return -1;
+      }
+      frame_skip = static_cast<uint8_t>(frames);
+    } else {
+      arguments.emplace_back(argv[i]);
+    }
+  }
+  if (arguments.empty()) {
+    std::cerr << USAGE << std::endl;
     return -1;
   }
 
-  std::string filename(argv[1]);
+  std::string filename(arguments[0]);
 
   std::string boot_rom_filename;
-  if (argc > 2) {
-    boot_rom_filename = std::string(argv[2]);
+  if (arguments.size() > 1) {
+    boot_rom_filename = arguments[1];
   }
   ROMLoader loader(filename, boot_rom_filename);
   if (!loader.load()) {
@@ -34,7 +64,7 @@ int main(int argc, char** argv) {
   loader.header()->pretty_print();
 
   OSBridge bridge;
-  bridge.blit_screen = [](const uint32_t* pixels, size_t pitch) {
+  bridge.blit_screen = [](const void* pixels, size_t pitch) {
   };
   bridge.present_frame = [](void) {
   };
@@ -45,6 +75,9 @@ int main(int argc, char** argv) {
   };
 
   MainLoop loop(loader, bridge);
+  loop.ppu().set_backend(backend);
+  loop.set_frame_skip(frame_skip == 0 ? FrameSkipMode::Off : FrameSkipMode::Fixed, frame_skip);
+  loop.ppu().set_pixel_format(PixelFormat::Indexed);  // Nothing looks at the screen, so skip the colour pass
 
   while (true) {
     loop.run_once();
@@ -0,0 +1,128 @@
+#include <inttypes.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "pixel_conversion.h"
+#include "ppu_constants.h"
+
+// Checks convert_shades (SSE2 or NEON where the build has them) against convert_shades_scalar, for ARGB8888
+// and RGB565:
+//  - Every byte value, as only the low two bits are the shade, and every shade in every lane of a vector.
+//  - Every background palette (BGP) applied to runs of every colour number.
+//  - Every length up to a few vectors, odd lengths up to a whole frame, and every start alignment, and that
+//    nothing past the end is written.
+// Then prints how long converting a frame takes each way.
+
+namespace {
+constexpr size_t LANES = 16;  // Shades per vector, the widest of the vectorised paths
+constexpr size_t MAX_SHORT_LENGTH = (LANES * 4) + 1;
+constexpr size_t FRAME_PIXELS = SCREEN_WIDTH * SCREEN_HEIGHT;
+constexpr size_t LONG_LENGTHS[] = {SCREEN_WIDTH - 1, SCREEN_WIDTH + 1, FRAME_PIXELS - 1, FRAME_PIXELS};
+constexpr uint8_t GUARD = 0xA5;
+constexpr uint32_t BENCHMARK_FRAMES = 2000;
+
+const char* format_name(PixelFormat format) {
+  return format == PixelFormat::ARGB8888 ? "ARGB8888" : "RGB565";
+}
+
+// Converts shades[offset, offset + count) both ways into buffers with guard bytes all around
+bool matches_scalar(const std::vector<uint8_t>& shades, size_t offset, size_t count, PixelFormat format) {
+  const size_t size = bytes_per_pixel(format);
+  std::vector<uint8_t> expected((count + (LANES * 2)) * size, GUARD);
+  std::vector<uint8_t> actual(expected.size(), GUARD);
+  convert_shades_scalar(shades.data() + offset, expected.data() + (LANES * size), count, format);
+  convert_shades(shades.data() + offset, actual.data() + (LANES * size), count, format);
+  if (expected != actual) {
+    std::cerr << format_name(format) << " differs from scalar for " << count << " shades at offset " << offset
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool check_format(PixelFormat format) {
+  bool passed = true;
+
+  // Every byte value, so each shade with every combination of the bits above it
+  std::vector<uint8_t> bytes(256 + LANES);
+  for (size_t i = 0; i < bytes.size(); i++) {
+    bytes[i] = static_cast<uint8_t>(i);
+  }
+  for (size_t offset = 0; offset < LANES; offset++) {
+    passed &= matches_scalar(bytes, offset, 256, format);
+  }
+
+  // Each shade alone in each lane of a vector, the rest another shade
+  for (uint8_t shade = 0; shade < 4; shade++) {
+    for (uint8_t background = 0; background < 4; background++) {
+      for (size_t lane = 0; lane < LANES; lane++) {
+        std::vector<uint8_t> shades(LANES, background);
+        shades[lane] = shade;
+        passed &= matches_scalar(shades, 0, LANES, format);
+      }
+    }
+  }
+
+  // Every palette applied to a line of colour numbers in runs, the way the renderer produces shades
+  for (uint32_t palette = 0; palette < 256; palette++) {
+    std::vector<uint8_t> line(SCREEN_WIDTH);
+    for (size_t x = 0; x < line.size(); x++) {
+      const uint32_t colour = ((x * 7) / 5) % 4;
+      line[x] = static_cast<uint8_t>((palette >> (colour * 2)) & 0x03);
+    }
+    passed &= matches_scalar(line, 0, line.size(), format);
+  }
+
+  // Lengths that end part way through a vector, from every alignment
+  std::vector<uint8_t> random(FRAME_PIXELS + LANES);
+  uint32_t state = 12345;
+  for (uint8_t& shade : random) {
+    state = state * 1664525u + 1013904223u;
+    shade = static_cast<uint8_t>(state >> 24);
+  }
+  for (size_t count = 0; count <= MAX_SHORT_LENGTH; count++) {
+    for (size_t offset = 0; offset < LANES; offset++) {
+      passed &= matches_scalar(random, offset, count, format);
+    }
+  }
+  for (size_t count : LONG_LENGTHS) {
+    passed &= matches_scalar(random, 1, count, format);
+  }
+  return passed;
+}
+
+double microseconds_per_frame(PixelFormat format, bool scalar) {
+  std::vector<uint8_t> shades(FRAME_PIXELS);
+  for (size_t i = 0; i < shades.size(); i++) {
+    shades[i] = static_cast<uint8_t>((i * 7) / 5 % 4);
+  }
+  std::vector<uint8_t> destination(FRAME_PIXELS * bytes_per_pixel(format));
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCHMARK_FRAMES; i++) {
+    if (scalar) {
+      convert_shades_scalar(shades.data(), destination.data(), shades.size(), format);
+    } else {
+      convert_shades(shades.data(), destination.data(), shades.size(), format);
+    }
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::micro>(elapsed).count() / BENCHMARK_FRAMES;
+}
+}  // namespace
+
+int main() {
+  bool passed = true;
+  for (PixelFormat format : {PixelFormat::ARGB8888, PixelFormat::RGB565}) {
+    passed &= check_format(format);
+  }
+
+  for (PixelFormat format : {PixelFormat::ARGB8888, PixelFormat::RGB565}) {
+    std::cout << format_name(format) << ": " << microseconds_per_frame(format, false) << " us/frame, scalar "
+              << microseconds_per_frame(format, true) << " us/frame" << std::endl;
+  }
+
+  std::cout << (passed ? "Passed" : "Failed") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,185 @@
+#include <inttypes.h>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include "ppu.h"
+
+// Drives two PPUs with the same random register, OAM and VRAM writes and halt states. One is stepped with
+// tick(), the other with tick_many() over random splits, and every register, the interrupt counts and the
+// frame hashes have to match after every step. Then prints how long a frame takes each way.
+
+namespace {
+constexpr uint32_t M_CYCLES_PER_FRAME = 70224 / 4;
+constexpr uint32_t TEST_FRAMES = 300;
+constexpr uint32_t MAX_STEP = 600;  // A bit more than a scanline
+constexpr uint32_t BENCHMARK_FRAMES = 3000;
+constexpr uint32_t RANDOM_SEED = 0x5EED;
+constexpr uint16_t OAM_DMA_ADDR = 0xFF46;
+constexpr uint16_t LAST_PPU_REGISTER = 0xFF4B;
+constexpr uint8_t LCDC_ON_BG_OBJECTS_WINDOW = 0xB3;
+
+struct BridgeState {
+  uint32_t vblank_interrupts = 0;
+  uint32_t stat_interrupts = 0;
+  bool halted = false;
+  std::array<uint8_t, 0x10000> memory{};
+};
+
+struct TestBridge {
+  BridgeState* state;
+
+  void trigger_vblank_interrupt() { state->vblank_interrupts++; }
+  void trigger_lcd_stat_interrupt() { state->stat_interrupts++; }
+  void blit_screen(const void*, size_t) {}
+  bool is_halted() const { return state->halted; }
+  const uint8_t* read_memory(uint16_t address) { return &state->memory[address]; }
+  FrameDestination acquire_frame() const { return {}; }
+};
+
+struct TestPPU {
+  BridgeState state;
+  PPU<TestBridge> ppu{TestBridge{&state}, false};
+  uint32_t frames = 0;
+};
+
+// A write a game might make between steps
+void random_write(std::mt19937& rng, TestPPU& a, TestPPU& b) {
+  uint16_t address = 0;
+  uint8_t value = static_cast<uint8_t>(rng());
+  switch (rng() % 8) {
+    case 0:
+      address = STAT_ADDR;
+      break;
+    case 1:
+      address = LYC_ADDR;
+      value %= 154;
+      break;
+    case 2:
+      address = 0xFF43;  // SCX
+      break;
+    case 3:
+      address = 0xFF4B;  // WX
+      break;
+    case 4:
+      // Toggling the LCD is rare, and it mostly stays on
+      address = LCDC_ADDR;
+      value = (rng() % 16 == 0) ? (value & ~LCDC_DISPLAY_ENABLE) : (value | LCDC_DISPLAY_ENABLE);
+      break;
+    case 5:
+      address = OAM_DMA_ADDR;
+      value = 0xC0;
+      break;
+    case 6: {
+      // Objects, which change the length of mode 3
+      const uint16_t oam_address = OAM_BASE_ADDRESS + rng() % OAM_SIZE;
+      a.ppu.write_oam(oam_address, value);
+      b.ppu.write_oam(oam_address, value);
+      return;
+    }
+    default: {
+      const uint16_t vram_address = VRAM_BASE_ADDRESS + rng() % VRAM_SIZE;
+      a.ppu.write_vram(vram_address, value);
+      b.ppu.write_vram(vram_address, value);
+      return;
+    }
+  }
+  a.ppu.write_ppu_register(address, value);
+  b.ppu.write_ppu_register(address, value);
+}
+
+bool same_state(TestPPU& a, TestPPU& b) {
+  for (uint16_t address = LCDC_ADDR; address <= LAST_PPU_REGISTER; address++) {
+    if (*a.ppu.read_ppu_register(address) != *b.ppu.read_ppu_register(address)) {
+      std::cout << "Register " << std::hex << address << std::dec << " differs" << std::endl;
+      return false;
+    }
+  }
+  if (a.state.vblank_interrupts != b.state.vblank_interrupts ||
+      a.state.stat_interrupts != b.state.stat_interrupts) {
+    std::cout << "Interrupts differ: vblank " << a.state.vblank_interrupts << "/" << b.state.vblank_interrupts
+              << ", stat " << a.state.stat_interrupts << "/" << b.state.stat_interrupts << std::endl;
+    return false;
+  }
+  if (a.frames != b.frames || a.ppu.frame_hash() != b.ppu.frame_hash()) {
+    std::cout << "Frames differ" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool tick_many_matches_tick(PPUBackend backend) {
+  std::mt19937 rng(RANDOM_SEED);
+  TestPPU single;
+  TestPPU batched;
+  for (uint32_t i = 0; i < single.state.memory.size(); i++) {
+    single.state.memory[i] = batched.state.memory[i] = static_cast<uint8_t>(rng());
+  }
+  single.ppu.set_backend(backend);
+  batched.ppu.set_backend(backend);
+  single.ppu.write_ppu_register(LCDC_ADDR, LCDC_ON_BG_OBJECTS_WINDOW);
+  batched.ppu.write_ppu_register(LCDC_ADDR, LCDC_ON_BG_OBJECTS_WINDOW);
+
+  for (uint64_t ticks = 0; ticks < uint64_t{TEST_FRAMES} * M_CYCLES_PER_FRAME;) {
+    // Short steps land on and around mode changes, long ones cross several
+    const uint32_t step = (rng() % 4 == 0) ? 1 + rng() % 8 : 1 + rng() % MAX_STEP;
+    for (uint32_t i = 0; i < step; i++) {
+      single.ppu.tick();
+      single.frames += single.ppu.frame_completed();
+    }
+    batched.ppu.tick_many(step);
+    batched.frames += batched.ppu.frame_completed();
+    ticks += step;
+
+    if (!same_state(single, batched)) {
+      std::cout << "tick_many() differs from tick() after " << ticks << " ticks" << std::endl;
+      return false;
+    }
+
+    if (rng() % 3 == 0) {
+      random_write(rng, single, batched);
+    }
+    if (rng() % 16 == 0) {
+      single.state.halted = batched.state.halted = !single.state.halted;
+    }
+  }
+  return true;
+}
+
+template <typename Step>
+double nanoseconds_per_frame(Step step) {
+  BridgeState state;
+  PPU<TestBridge> ppu(TestBridge{&state}, false);
+  ppu.set_frame_skip(UINT8_MAX);  // Time the stepping, not the drawing
+  ppu.write_ppu_register(LCDC_ADDR, LCDC_ON_BG_OBJECTS_WINDOW);
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+    step(ppu);
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / BENCHMARK_FRAMES;
+}
+}  // namespace
+
+int main() {
+  for (PPUBackend backend : {PPUBackend::Scanline, PPUBackend::PixelFIFO}) {
+    if (!tick_many_matches_tick(backend)) {
+      std::cout << "FAILED for the " << (backend == PPUBackend::Scanline ? "scanline" : "pixel FIFO")
+                << " backend" << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "tick_many() matches tick() over " << TEST_FRAMES << " frames of random steps" << std::endl;
+
+  const double single = nanoseconds_per_frame([](PPU<TestBridge>& ppu) {
+    for (uint32_t tick = 0; tick < M_CYCLES_PER_FRAME; tick++) {
+      ppu.tick();
+    }
+  });
+  const double batched =
+      nanoseconds_per_frame([](PPU<TestBridge>& ppu) { ppu.tick_many(M_CYCLES_PER_FRAME); });
+  std::cout << "Frame of tick():     " << single << " ns" << std::endl;
+  std::cout << "tick_many(frame):    " << batched << " ns" << std::endl;
+  return 0;
+}
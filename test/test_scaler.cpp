@@ -0,0 +1,123 @@
+#include <inttypes.h>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "scaler.h"
+
+// Checks every vectorised scaler kernel set against the scalar reference, for every filter and factor, and
+// prints how long each filter takes at 5x with the kernels the CPU would actually use.
+
+namespace {
+constexpr uint32_t WIDTH = 160;
+constexpr uint32_t HEIGHT = 144;
+constexpr uint32_t TEST_FRAMES = 6;  // Enough for the LCD ghosting to be part way through fading
+constexpr uint32_t BENCHMARK_FACTOR = 5;
+constexpr uint32_t BENCHMARK_FRAMES = 500;
+constexpr uint32_t SHADES[] = {0xFFE0F8D0, 0xFF88C070, 0xFF346856, 0xFF081820};
+
+const char* filter_name(ScaleFilter filter) {
+  switch (filter) {
+    case ScaleFilter::Nearest:
+      return "Nearest";
+    case ScaleFilter::Scale2x:
+      return "Scale2x";
+    case ScaleFilter::LCDGrid:
+      return "LCDGrid";
+  }
+  return "?";
+}
+
+const char* isa_name(ScalerISA isa) {
+  switch (isa) {
+    case ScalerISA::Scalar:
+      return "Scalar";
+    case ScalerISA::SSE2:
+      return "SSE2";
+    case ScalerISA::AVX2:
+      return "AVX2";
+  }
+  return "?";
+}
+
+// Game Boy like frames: four shades in runs, so Scale2x sees both edges and flat areas. The source pitch is
+// wider than the frame, like the PPU's frame destinations can be.
+std::vector<uint32_t> make_frame(uint32_t seed, size_t pitch_pixels) {
+  std::vector<uint32_t> frame(pitch_pixels * HEIGHT, 0xDEADBEEF);
+  uint32_t state = seed * 2654435761u + 1;
+  for (uint32_t y = 0; y < HEIGHT; y++) {
+    for (uint32_t x = 0; x < WIDTH; x++) {
+      state = state * 1664525u + 1013904223u;
+      const bool keep_run = x > 0 && (state >> 28) < 10;
+      frame[(y * pitch_pixels) + x] = keep_run ? frame[(y * pitch_pixels) + x - 1] : SHADES[state >> 30];
+    }
+  }
+  return frame;
+}
+
+bool matches_scalar(ScalerISA isa, ScaleFilter filter, uint32_t factor) {
+  constexpr size_t SOURCE_PITCH_PIXELS = WIDTH + 16;
+  const size_t pitch_pixels = (WIDTH * factor) + 8;  // Destination pitch wider than a row, like a texture's
+  std::vector<uint32_t> expected(pitch_pixels * HEIGHT * factor, 0);
+  std::vector<uint32_t> actual(pitch_pixels * HEIGHT * factor, 0);
+  Scaler reference(ScalerISA::Scalar);
+  Scaler scaler(isa);
+
+  for (uint32_t frame_number = 0; frame_number < TEST_FRAMES; frame_number++) {
+    const std::vector<uint32_t> frame = make_frame(frame_number, SOURCE_PITCH_PIXELS);
+    const size_t source_pitch = SOURCE_PITCH_PIXELS * sizeof(uint32_t);
+    const size_t destination_pitch = pitch_pixels * sizeof(uint32_t);
+    const bool expected_settled = reference.scale(filter, factor, frame.data(), source_pitch, WIDTH, HEIGHT,
+                                                  expected.data(), destination_pitch);
+    const bool actual_settled =
+        scaler.scale(filter, factor, frame.data(), source_pitch, WIDTH, HEIGHT, actual.data(), destination_pitch);
+    if (expected != actual || expected_settled != actual_settled) {
+      std::cerr << isa_name(isa) << " " << filter_name(filter) << " " << factor << "x differs from scalar on frame "
+                << frame_number << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+double milliseconds_per_frame(ScaleFilter filter) {
+  const std::vector<uint32_t> frame = make_frame(0, WIDTH);
+  std::vector<uint32_t> destination(WIDTH * BENCHMARK_FACTOR * HEIGHT * BENCHMARK_FACTOR);
+  Scaler scaler;
+
+  const auto start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BENCHMARK_FRAMES; i++) {
+    scaler.scale(filter, BENCHMARK_FACTOR, frame.data(), WIDTH * sizeof(uint32_t), WIDTH, HEIGHT,
+                 destination.data(), WIDTH * BENCHMARK_FACTOR * sizeof(uint32_t));
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::milli>(elapsed).count() / BENCHMARK_FRAMES;
+}
+}  // namespace
+
+int main() {
+  constexpr ScaleFilter FILTERS[] = {ScaleFilter::Nearest, ScaleFilter::Scale2x, ScaleFilter::LCDGrid};
+  const ScalerISA best = Scaler::best_supported_isa();
+  std::cout << "Best supported: " << isa_name(best) << std::endl;
+
+  bool passed = true;
+  for (ScalerISA isa : {ScalerISA::SSE2, ScalerISA::AVX2}) {
+    if (isa > best) {
+      std::cout << isa_name(isa) << " not supported, skipped" << std::endl;
+      continue;
+    }
+    for (ScaleFilter filter : FILTERS) {
+      for (uint32_t factor = MIN_SCALE_FACTOR; factor <= MAX_SCALE_FACTOR; factor++) {
+        passed &= matches_scalar(isa, filter, factor);
+      }
+    }
+  }
+
+  for (ScaleFilter filter : FILTERS) {
+    std::cout << filter_name(filter) << " " << BENCHMARK_FACTOR << "x: " << milliseconds_per_frame(filter)
+              << " ms/frame" << std::endl;
+  }
+
+  std::cout << (passed ? "Passed" : "Failed") << std::endl;
+  return passed ? 0 : 1;
+}
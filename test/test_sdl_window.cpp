@@ -0,0 +1,223 @@
+#define SDL_MAIN_HANDLED
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include "SDLWindow.h"
+#include "audio_output_buffer.h"
+
+// Smoke test of SDLWindow against SDL2 itself, headless on SDL's dummy video driver and its disk audio driver
+// (which plays the device into a file from SDL's own audio thread):
+//  - A frame goes through blit_screen both with the built-in scaler and written straight into the texture,
+//    and handleEvents passes F7 on and reports SDL_QUIT.
+//  - The emulation thread queues a numbered pattern with queue_audio while audio_callback pulls it, then
+//    prepare_for_pause, a pause, resume_from_pause and more of the pattern.
+// The file then has to hold the pattern in order with the channels the right way round, holding the last
+// sample rather than skipping any, in two runs: before the pause, and after it from an emptied buffer. The
+// first has to fade smoothly to silence and stay silent until the second starts.
+
+namespace {
+constexpr int WIDTH = 160;
+constexpr int HEIGHT = 144;
+constexpr size_t CHANNELS = 2;
+constexpr int32_t PATTERN_PERIOD = 30000;  // Left counts 1 to PATTERN_PERIOD, right is its negation
+// The fade lasts one callback. SDL asks for 512 frames, so 256 leaves room for a device that wants fewer.
+constexpr int32_t MAX_FADE_STEP = (PATTERN_PERIOD / 256) + 1;
+constexpr auto PLAY_TIME = std::chrono::milliseconds(1500);
+constexpr auto PAUSE_TIME = std::chrono::milliseconds(300);
+constexpr auto QUEUE_INTERVAL = std::chrono::milliseconds(5);
+constexpr double MIN_PLAYED_FRACTION = 0.5;  // Of PLAY_TIME, the disk driver's clock is only roughly right
+
+// Counts the pattern out in stereo frames
+class Pattern {
+public:
+  // Tops the window's buffer up to half full, as the rate control would keep it
+  void queue(SDLWindow& window) {
+    const int wanted = static_cast<int>(AudioOutputBuffer::CAPACITY / 2) - window.get_queued_audio_samples();
+    if (wanted <= 0) {
+      return;
+    }
+    samples_.resize(static_cast<size_t>(wanted) & ~(CHANNELS - 1));
+    for (size_t i = 0; i < samples_.size(); i += CHANNELS) {
+      next_ = (next_ % PATTERN_PERIOD) + 1;
+      samples_[i] = static_cast<int16_t>(next_);
+      samples_[i + 1] = static_cast<int16_t>(-next_);
+    }
+    window.queue_audio(samples_.data(), static_cast<int>(samples_.size()));
+  }
+
+private:
+  int32_t next_ = 0;
+  std::vector<int16_t> samples_;
+};
+
+void play(SDLWindow& window, Pattern& pattern, AudioOutputStatus& status) {
+  const auto end = std::chrono::steady_clock::now() + PLAY_TIME;
+  while (std::chrono::steady_clock::now() < end) {
+    status = window.audio_output_status();
+    pattern.queue(window);
+    std::this_thread::sleep_for(QUEUE_INTERVAL);
+  }
+}
+
+bool check_video(SDLWindow& window) {
+  std::vector<uint32_t> frame(WIDTH * HEIGHT);
+  for (size_t i = 0; i < frame.size(); i++) {
+    frame[i] = 0xFF000000 | static_cast<uint32_t>(i * 0x010101);
+  }
+
+  // The scaler and SDL's scaling
+  for (std::optional<ScaleFilter> filter : {std::optional<ScaleFilter>(ScaleFilter::Scale2x),
+                                            std::optional<ScaleFilter>()}) {
+    window.set_scale_filter(filter);
+    size_t pitch = 0;
+    void* pixels = window.lock_screen(pitch);
+    if (pixels) {
+      for (int y = 0; y < HEIGHT; y++) {
+        std::copy(frame.begin() + (y * WIDTH), frame.begin() + ((y + 1) * WIDTH),
+                  reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(pixels) + (y * pitch)));
+      }
+      window.blit_screen(pixels, pitch);
+    } else {
+      window.blit_screen(frame.data(), WIDTH * sizeof(uint32_t));
+    }
+    window.present();
+  }
+
+  bool toggled = false;
+  window.set_on_toggle_pacing_clock([&toggled]() { toggled = true; });
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = SDL_KEYDOWN;
+  event.key.keysym.sym = SDLK_F7;
+  SDL_PushEvent(&event);
+  JoypadState joypad = {false, false, false, false, false, false, false, false};
+  const bool quit_before = window.handleEvents(joypad);
+
+  SDL_zero(event);
+  event.type = SDL_QUIT;
+  SDL_PushEvent(&event);
+  const bool quit = window.handleEvents(joypad);
+
+  if (!toggled || quit_before || !quit) {
+    std::cerr << "handleEvents: F7 " << (toggled ? "passed on" : "ignored") << ", SDL_QUIT "
+              << (quit && !quit_before ? "reported" : "not reported") << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool check_audio(const std::string& path, uint64_t min_played) {
+  FILE* file = std::fopen(path.c_str(), "rb");
+  if (!file) {
+    std::cerr << "Can't open " << path << std::endl;
+    return false;
+  }
+  std::vector<int16_t> samples;
+  int16_t buffer[4096];
+  size_t read = 0;
+  while ((read = std::fread(buffer, sizeof(int16_t), std::size(buffer), file)) > 0) {
+    samples.insert(samples.end(), buffer, buffer + read);
+  }
+  std::fclose(file);
+
+  // Walks the left channel: up by one while playing, level while holding or silent, down towards zero while
+  // fading, and up from silence when a run starts
+  std::vector<uint64_t> runs;
+  uint32_t fades = 0;
+  bool fading = false;
+  int32_t previous = 0;
+  for (size_t i = 0; i + 1 < samples.size(); i += CHANNELS) {
+    const int32_t left = samples[i];
+    const int32_t right = samples[i + 1];
+    const size_t frame = i / CHANNELS;
+    if (right != -left) {
+      std::cerr << "Frame " << frame << " is " << left << ", " << right << ", the channels don't match"
+                << std::endl;
+      return false;
+    }
+
+    if (left == previous) {
+    } else if (previous == 0 && left > 0 && !fading) {
+      runs.push_back(1);
+    } else if (left == (previous % PATTERN_PERIOD) + 1 && !fading) {
+      runs.back()++;
+    } else if (left < previous && left >= 0 && previous - left <= MAX_FADE_STEP) {
+      fades += fading ? 0 : 1;
+      fading = left != 0;
+    } else {
+      std::cerr << "Frame " << frame << " went from " << previous << " to " << left
+                << (fading ? " while fading out" : "") << std::endl;
+      return false;
+    }
+    previous = left;
+  }
+
+  std::cout << samples.size() / CHANNELS << " frames played, runs of";
+  for (uint64_t run : runs) {
+    std::cout << " " << run;
+  }
+  std::cout << ", " << fades << " fade out" << std::endl;
+
+  if (runs.size() != 2 || fades != 1) {
+    std::cerr << "Expected a run, a fade out, silence and another run" << std::endl;
+    return false;
+  }
+  for (uint64_t run : runs) {
+    if (run < min_played) {
+      std::cerr << "A run played " << run << " frames, expected at least " << min_played << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: test_sdl_window <audio output file>" << std::endl;
+    return 1;
+  }
+  const std::string audio_path = argv[1];
+  std::remove(audio_path.c_str());
+  SDL_setenv("SDL_VIDEODRIVER", "dummy", 1);
+  SDL_setenv("SDL_AUDIODRIVER", "disk", 1);
+  SDL_setenv("SDL_DISKAUDIOFILE", audio_path.c_str(), 1);
+
+  bool passed = true;
+  uint64_t min_played = 0;
+  {
+    SDLWindow window("test_sdl_window", WIDTH, HEIGHT);
+    passed &= check_video(window);
+
+    Pattern pattern;
+    AudioOutputStatus status{};
+    play(window, pattern, status);
+    min_played = static_cast<uint64_t>(status.device_sample_rate * MIN_PLAYED_FRACTION *
+                                       std::chrono::duration<double>(PLAY_TIME).count());
+
+    window.prepare_for_pause();
+    if (window.get_queued_audio_samples() != 0) {
+      std::cerr << "prepare_for_pause left " << window.get_queued_audio_samples() << " samples queued"
+                << std::endl;
+      passed = false;
+    }
+    std::this_thread::sleep_for(PAUSE_TIME);
+    window.resume_from_pause();
+
+    play(window, pattern, status);
+    std::cout << "Device at " << status.device_sample_rate << " Hz, generating at " << status.sample_rate
+              << " Hz, fill " << status.fill << ", " << status.underruns << " underruns, " << status.overruns
+              << " overruns" << std::endl;
+  }
+  passed &= check_audio(audio_path, min_played);
+
+  std::cout << (passed ? "Passed" : "Failed") << std::endl;
+  return passed ? 0 : 1;
+}
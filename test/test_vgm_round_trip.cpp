@@ -0,0 +1,231 @@
+#include <inttypes.h>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include "apu.h"
+#include "vgm_recorder.h"
+
+// Logs a scripted tune to a VGM file through the APU's event sinks, then plays the file back
+// through a fresh APU. The two have to produce exactly the same samples, which holds as long as every write
+// is made on the first m-cycle of a VGM sample (44100 Hz), as those are the only times VGM can express.
+// The script starts part way through, after the channels have been set up, so the log opens with the
+// register state, and its gaps cover every kind of wait command: 1-16 samples, 735, 882, 16-bit and longer.
+// Also checks the header, and that waits are counted across apu_clock() wrapping.
+
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325;
+constexpr uint64_t FNV_PRIME = 0x100000001B3;
+constexpr uint64_t VGM_SAMPLE_RATE = 44100;
+constexpr uint32_t END_SAMPLE = 77782;
+
+constexpr uint32_t VGM_HEADER_BYTES = 0x100;
+constexpr uint32_t VGM_DATA_START = 0xCC;  // What the data offset at 0x34 holds
+constexpr uint32_t VGM_VERSION = 0x161;
+constexpr uint32_t GB_DMG_CLOCK = 4194304;
+
+struct ScriptedWrite {
+  uint32_t sample;
+  uint16_t address;
+  uint8_t value;
+};
+
+// Registers set before the log starts, nothing triggered
+constexpr ScriptedWrite SETUP[] = {
+    {0, NR26_ADDR, MASTER_ENABLE_BIT}, {0, NR24_ADDR, 0x77}, {0, NR25_ADDR, 0xFF}, {0, NR11_ADDR, 0x80},
+    {0, NR12_ADDR, 0xF0},              {0, NR13_ADDR, 0x00}, {0, NR14_ADDR, 0x06}, {0, NR16_ADDR, 0x40},
+    {0, NR17_ADDR, 0xA3},              {0, NR18_ADDR, 0x83}, {0, NR19_ADDR, 0x07}, {0, NR1A_ADDR, 0x80},
+    {0, NR1C_ADDR, 0x20},              {0, NR1D_ADDR, 0x40}, {0, NR1E_ADDR, 0x07}, {0, NR21_ADDR, 0xA1},
+    {0, NR22_ADDR, 0x34},
+};
+
+constexpr ScriptedWrite SCRIPT[] = {
+    {0, NR14_ADDR, 0x86},      // Square 1
+    {1, NR19_ADDR, 0x87},      // Square 2, 1 sample later
+    {17, NR1E_ADDR, 0x87},     // Wave, 16 later
+    {34, NR23_ADDR, 0x80},     // Noise, 17 later
+    {769, NR13_ADDR, 0x40},    // 735 later
+    {1651, NR25_ADDR, 0x5A},   // 882 later
+    {1651, NR24_ADDR, 0x35},   // Same sample
+    {1655, NR10_ADDR, 0x24},   // Sweep
+    {1655, NR14_ADDR, 0x86},
+    {3272, NR1A_ADDR, 0x00},   // Rewrite wave RAM with the DAC off
+    {3272, WAVE_RAM_START, 0x12},
+    {3272, WAVE_RAM_END, 0xEF},
+    {3272, NR1A_ADDR, 0x80},
+    {3272, NR1E_ADDR, 0x86},
+    {73272, NR26_ADDR, 0x00},  // Power off for 70000 samples, more than one wait command holds
+    {73372, NR26_ADDR, MASTER_ENABLE_BIT},
+    {73372, NR24_ADDR, 0x77},
+    {73372, NR25_ADDR, 0xFF},
+    {73372, NR12_ADDR, 0xF0},
+    {73372, NR14_ADDR, 0x87},
+};
+
+struct CapturedAPU {
+  std::vector<int16_t> samples;
+  APU apu{[this](const int16_t* data, int count) { samples.insert(samples.end(), data, data + count); }};
+};
+
+// The first m-cycle in VGM sample `sample`
+uint32_t m_cycle_at(uint64_t sample) {
+  return static_cast<uint32_t>((sample * M_CYCLES_PER_SECOND + VGM_SAMPLE_RATE - 1) / VGM_SAMPLE_RATE);
+}
+
+// Makes the writes at their samples until `end_sample`, ticking the frame sequencer every 2048 m-cycles
+void play(APU& apu, const std::vector<ScriptedWrite>& writes, uint64_t end_sample) {
+  const uint32_t end = m_cycle_at(end_sample);
+  size_t next = 0;
+  for (uint32_t cycle = 0; cycle < end; cycle++) {
+    while (next < writes.size() && m_cycle_at(writes[next].sample) == cycle) {
+      apu.audio_register_write(writes[next].address, writes[next].value);
+      next++;
+    }
+    apu.tick();
+    if ((cycle & 2047) == 0) {
+      apu.tick_frame_sequencer();
+    }
+  }
+  apu.generate_samples();
+}
+
+uint32_t read_u32(const std::vector<uint8_t>& bytes, size_t offset) {
+  return bytes[offset] | bytes[offset + 1] << 8 | bytes[offset + 2] << 16 |
+         static_cast<uint32_t>(bytes[offset + 3]) << 24;
+}
+
+struct ParsedVGM {
+  std::vector<ScriptedWrite> writes;
+  uint64_t samples = 0;
+  uint32_t header_samples = 0;
+  uint32_t waits[4] = {};  // 0x7n, 0x62, 0x63, 0x61
+};
+
+std::optional<ParsedVGM> parse(const std::filesystem::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  const std::vector<uint8_t> bytes{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+  if (bytes.size() <= VGM_HEADER_BYTES || std::string(bytes.begin(), bytes.begin() + 4) != "Vgm " ||
+      read_u32(bytes, 0x04) != bytes.size() - 4 || read_u32(bytes, 0x08) != VGM_VERSION ||
+      read_u32(bytes, 0x34) != VGM_DATA_START || read_u32(bytes, 0x80) != GB_DMG_CLOCK) {
+    std::cout << "Bad VGM header" << std::endl;
+    return std::nullopt;
+  }
+
+  ParsedVGM vgm;
+  vgm.header_samples = read_u32(bytes, 0x18);
+  for (size_t i = 0x34 + VGM_DATA_START; i < bytes.size();) {
+    const uint8_t command = bytes[i];
+    if (command == 0xB3 && i + 2 < bytes.size()) {
+      vgm.writes.push_back({static_cast<uint32_t>(vgm.samples), static_cast<uint16_t>(0xFF10 + bytes[i + 1]),
+                            bytes[i + 2]});
+      i += 3;
+    } else if (command >= 0x70 && command <= 0x7F) {
+      vgm.samples += command - 0x70 + 1;
+      vgm.waits[0]++;
+      i++;
+    } else if (command == 0x62 || command == 0x63) {
+      vgm.samples += command == 0x62 ? 735 : 882;
+      vgm.waits[command - 0x61]++;
+      i++;
+    } else if (command == 0x61 && i + 2 < bytes.size()) {
+      vgm.samples += bytes[i + 1] | bytes[i + 2] << 8;
+      vgm.waits[3]++;
+      i += 3;
+    } else if (command == 0x66 && i + 1 == bytes.size()) {
+      return vgm;
+    } else {
+      std::printf("Unexpected command %02X at %zu\n", command, i);
+      return std::nullopt;
+    }
+  }
+  std::cout << "No end of data command" << std::endl;
+  return std::nullopt;
+}
+
+uint64_t hash(const std::vector<int16_t>& samples) {
+  uint64_t hash = FNV_OFFSET;
+  for (int16_t sample : samples) {
+    hash = (hash ^ static_cast<uint16_t>(sample)) * FNV_PRIME;
+  }
+  return hash;
+}
+
+bool check_round_trip(const std::filesystem::path& path) {
+  CapturedAPU live;
+  for (const ScriptedWrite& write : SETUP) {
+    live.apu.audio_register_write(write.address, write.value);
+  }
+  {
+    VGMRecorder recorder(path.string(), live.apu.apu_clock());
+    live.apu.log_register_state(recorder);
+    live.apu.add_event_sink(&recorder);
+    play(live.apu, {std::begin(SCRIPT), std::end(SCRIPT)}, END_SAMPLE);
+    recorder.finish(live.apu.apu_clock());
+    live.apu.remove_event_sink(&recorder);
+    if (recorder.failed()) {
+      std::cout << recorder.error() << std::endl;
+      return false;
+    }
+  }
+
+  const std::optional<ParsedVGM> vgm = parse(path);
+  if (!vgm) {
+    return false;
+  }
+  CapturedAPU replayed;
+  play(replayed.apu, vgm->writes, vgm->samples);
+
+  const uint64_t live_hash = hash(live.samples);
+  const uint64_t replayed_hash = hash(replayed.samples);
+  std::printf("Round trip: %zu writes over %" PRIu64 " samples, waits %u short, %u 1/60 s, %u 1/50 s, "
+              "%u 16-bit\n",
+              vgm->writes.size(), vgm->samples, vgm->waits[0], vgm->waits[1], vgm->waits[2], vgm->waits[3]);
+  std::printf("  Live %zu samples, hash %016" PRIx64 ", replayed %zu samples, hash %016" PRIx64 "\n",
+              live.samples.size(), live_hash, replayed.samples.size(), replayed_hash);
+
+  bool passed = true;
+  if (vgm->samples != END_SAMPLE || vgm->header_samples != END_SAMPLE) {
+    std::cout << "  Expected " << END_SAMPLE << " samples, the header says " << vgm->header_samples
+              << std::endl;
+    passed = false;
+  }
+  for (uint32_t count : vgm->waits) {
+    if (count == 0) {
+      std::cout << "  Not every kind of wait was used" << std::endl;
+      passed = false;
+      break;
+    }
+  }
+  if (live.samples.size() != replayed.samples.size() || live_hash != replayed_hash) {
+    std::cout << "  The replay doesn't match" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+// A log starting just before apu_clock() wraps
+bool check_wrap(const std::filesystem::path& path) {
+  const uint32_t start = 0xFFFFFF00;
+  VGMRecorder recorder(path.string(), start);
+  recorder.write(start + m_cycle_at(10), NR12_ADDR, 0xF0);  // Wraps to a small number
+  recorder.finish(start + m_cycle_at(20));
+  if (recorder.samples() != 20) {
+    std::cout << "Wrap: " << recorder.samples() << " samples, expected 20" << std::endl;
+    return false;
+  }
+  return true;
+}
+}  // namespace
+
+int main() {
+  const std::filesystem::path path = std::filesystem::temp_directory_path() / "gbemu_vgm_round_trip.vgm";
+  bool passed = check_round_trip(path);
+  passed &= check_wrap(path);
+  std::filesystem::remove(path);
+
+  std::cout << (passed ? "VGM round trip passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}